@@ -178,7 +178,8 @@ class Ctl {
   ff_msgs::ControlFeedback feedback_;
 
   config_reader::ConfigReader config_;
-  ff_util::PerfTimer pt_ctl_;
+  ff_util::PerfReporter perf_;
+  ff_util::LatencyHistogram * pt_step_;
   ros::Timer config_timer_;
 
   std::string name_;
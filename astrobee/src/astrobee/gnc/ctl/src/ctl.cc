@@ -112,7 +112,8 @@ Ctl::Ctl(ros::NodeHandle* nh, std::string const& name) :
   ReadParams();
   config_timer_ = nh->createTimer(ros::Duration(1), [this](ros::TimerEvent e) {
       config_.CheckFilesUpdated(std::bind(&Ctl::ReadParams, this));}, false, true);
-  pt_ctl_.Initialize("ctl");
+  perf_.Initialize(nh, "ctl");
+  pt_step_ = perf_.AddTimer("step");
 
   // Subscribers
   ekf_sub_ = nh->subscribe(
@@ -267,9 +268,10 @@ void Ctl::EkfCallback(const ff_msgs::EkfState::ConstPtr& state) {
     }
 
     // advance control forward whenever the pose is updated
-    pt_ctl_.Tick();
-    Step();
-    pt_ctl_.Tock();
+    {
+      ff_util::ScopedLatencyTimer timer(pt_step_);
+      Step();
+    }
   }
 }
 
@@ -285,9 +287,10 @@ void Ctl::PoseCallback(const geometry_msgs::PoseStamped::ConstPtr& truth) {
     ctl.current_time_nsec = truth->header.stamp.nsec;
     mutex_cmd_msg_.unlock();
     // advance control forward whenever the pose is updated
-    pt_ctl_.Tick();
-    Step();
-    pt_ctl_.Tock();
+    {
+      ff_util::ScopedLatencyTimer timer(pt_step_);
+      Step();
+    }
   }
 }
 
@@ -60,7 +60,8 @@ class Fam {
   ros::Publisher pmc_pub_;
 
   config_reader::ConfigReader config_;
-  ff_util::PerfTimer pt_fam_;
+  ff_util::PerfReporter perf_;
+  ff_util::LatencyHistogram * pt_step_;
   ros::Timer config_timer_;
 
   std::mutex mutex_speed_;
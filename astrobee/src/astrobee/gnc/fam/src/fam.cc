@@ -32,7 +32,8 @@ Fam::Fam(ros::NodeHandle* nh) : inertia_received_(false) {
   ReadParams();
   config_timer_ = nh->createTimer(ros::Duration(1), [this](ros::TimerEvent e) {
       config_.CheckFilesUpdated(std::bind(&Fam::ReadParams, this));}, false, true);
-  pt_fam_.Initialize("fam");
+  perf_.Initialize(nh, "fam");
+  pt_step_ = perf_.AddTimer("step");
 
   pmc_pub_ = nh->advertise<ff_hw_msgs::PmcCommand>(TOPIC_HARDWARE_PMC_COMMAND, 1);
 
@@ -98,9 +99,10 @@ void Fam::Step(ex_time_msg* ex_time, cmd_msg* cmd, ctl_msg* ctl) {
   }
 
   // Step the FAM simulink code
-  pt_fam_.Tick();
-  gnc_.Step(ex_time, cmd, ctl);
-  pt_fam_.Tock();
+  {
+    ff_util::ScopedLatencyTimer timer(pt_step_);
+    gnc_.Step(ex_time, cmd, ctl);
+  }
 
   // Send the PMC command
   static ff_hw_msgs::PmcCommand pmc;
@@ -114,8 +116,6 @@ void Fam::Step(ex_time_msg* ex_time, cmd_msg* cmd, ctl_msg* ctl) {
   std::copy(gnc_.act_.act_servo_pwm_cmd + 6, gnc_.act_.act_servo_pwm_cmd + 12,
       pmc.goals[1].nozzle_positions.c_array());
   pmc_pub_.publish<ff_hw_msgs::PmcCommand>(pmc);
-
-  pt_fam_.Send();
 }
 
 void Fam::ReadParams(void) {
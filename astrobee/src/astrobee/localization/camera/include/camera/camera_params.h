@@ -22,6 +22,7 @@
 #include <config_reader/config_reader.h>
 #include <Eigen/Core>
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -73,12 +74,39 @@ namespace camera {
     // location in the DISTORTED image.
     void GenerateRemapMaps(cv::Mat* remap_map, double scale = 1.0);
 
+    // Tabulate the undistortion of the DISTORTED image on a grid with
+    // the given spacing in pixels. Undistorting a point then only needs
+    // a bilinear interpolation in this table, which is much cheaper
+    // than the exact conversion for the Tsai model. With a spacing of
+    // one pixel the error is a few hundredths of a pixel at worst, near
+    // the image corners. Points outside of the image are still
+    // undistorted exactly. Changing any of the parameters discards the
+    // table. Copies of these parameters share it.
+    void GenerateUndistortionTable(double spacing = 1.0);
+    void ClearUndistortionTable();
+    bool HasUndistortionTable() const;
+
     // Conversion utilities
     template <int SRC, int DEST>
     void Convert(Eigen::Vector2d const& input, Eigen::Vector2d *output) const {
       throw("Please use the explicitly specified conversions by using the correct enum.");
     }
 
+    // Conversion of many points at once, one per column. This falls
+    // back to converting each point on its own, except for the
+    // conversions from DISTORTED_C, DISTORTED to UNDISTORTED_C,
+    // UNDISTORTED, which undistort all points in one pass.
+    template <int SRC, int DEST>
+    void Convert(Eigen::Matrix2Xd const& input, Eigen::Matrix2Xd *output) const {
+      Eigen::Matrix2Xd result(2, input.cols());
+      Eigen::Vector2d point;
+      for (int i = 0; i < input.cols(); i++) {
+        Convert<SRC, DEST>(Eigen::Vector2d(input.col(i)), &point);
+        result.col(i) = point;
+      }
+      *output = result;
+    }
+
     // Utility to create intrinsic matrix for the correct coordinate frame
     template <int FRAME>
     Eigen::Matrix3d GetIntrinsicMatrix() const {
@@ -139,6 +167,22 @@ namespace camera {
     // Converts DISTORTED_C to UNDISTORTED_C
     void UndistortCentered(Eigen::Vector2d const& distorted_c,
                            Eigen::Vector2d* undistorted_c) const;
+    // Same, for many points, using the undistortion table if there is one
+    void UndistortCentered(Eigen::Matrix2Xd const& distorted_c,
+                           Eigen::Matrix2Xd* undistorted_c) const;
+    // Without the undistortion table
+    void UndistortCenteredExact(Eigen::Matrix2Xd const& distorted_c,
+                                Eigen::Matrix2Xd* undistorted_c) const;
+
+    // The UNDISTORTED_C coordinates of a grid of DISTORTED_C points,
+    // starting at origin, with spacing between them.
+    struct UndistortionTable {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+      Eigen::Vector2d origin;
+      double spacing;
+      int cols, rows;
+      Eigen::Matrix2Xf values;  // the sample at (col, row) is values.col(row * cols + col)
+    };
 
     // Members
     Eigen::Vector2i
@@ -161,6 +205,9 @@ namespace camera {
     // or 5 = TSAI/OpenCV model.
     Eigen::VectorXd distortion_coeffs_;
     double distortion_precalc1_, distortion_precalc2_, distortion_precalc3_;
+
+    // Optional, never modified once made, so it can be shared by copies
+    std::shared_ptr<const UndistortionTable> undistortion_table_;
   };
 
 #define DECLARE_CONVERSION(TYPEA, TYPEB) \
@@ -178,6 +225,14 @@ namespace camera {
   DECLARE_CONVERSION(UNDISTORTED_C, DISTORTED);
 #undef DECLARE_CONVERSION
 
+#define DECLARE_BATCH_CONVERSION(TYPEA, TYPEB) \
+  template <>  \
+  void CameraParameters::Convert<TYPEA, TYPEB>(Eigen::Matrix2Xd const& input, Eigen::Matrix2Xd *output) const
+  DECLARE_BATCH_CONVERSION(DISTORTED_C, UNDISTORTED_C);
+  DECLARE_BATCH_CONVERSION(DISTORTED, UNDISTORTED_C);
+  DECLARE_BATCH_CONVERSION(DISTORTED, UNDISTORTED);
+#undef DECLARE_BATCH_CONVERSION
+
 #define DECLARE_INTRINSIC(TYPE) \
   template <>  \
   Eigen::Matrix3d CameraParameters::GetIntrinsicMatrix<TYPE>() const
@@ -28,8 +28,10 @@
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 camera::CameraParameters::CameraParameters(Eigen::Vector2i const& image_size,
     Eigen::Vector2d const& focal_length,
@@ -156,6 +158,7 @@ camera::CameraParameters::CameraParameters(config_reader::ConfigReader* config,
 }
 
 void camera::CameraParameters::SetDistortedSize(Eigen::Vector2i const& image_size) {
+  ClearUndistortionTable();
   distorted_image_size_ = image_size;
   distorted_half_size_ = image_size.cast<double>() / 2;
 }
@@ -169,6 +172,7 @@ const Eigen::Vector2d& camera::CameraParameters::GetDistortedHalfSize() const {
 }
 
 void camera::CameraParameters::SetUndistortedSize(Eigen::Vector2i const& image_size) {
+  ClearUndistortionTable();
   undistorted_image_size_ = image_size;
   undistorted_half_size_ = image_size.cast<double>() / 2;
 }
@@ -190,6 +194,7 @@ const Eigen::Vector2i& camera::CameraParameters::GetCropOffset() const {
 }
 
 void camera::CameraParameters::SetOpticalOffset(Eigen::Vector2d const& offset) {
+  ClearUndistortionTable();
   optical_offset_ = offset;
 }
 
@@ -198,6 +203,7 @@ const Eigen::Vector2d& camera::CameraParameters::GetOpticalOffset() const {
 }
 
 void camera::CameraParameters::SetFocalLength(Eigen::Vector2d const& f) {
+  ClearUndistortionTable();
   focal_length_ = f;
 }
 
@@ -210,6 +216,7 @@ const Eigen::Vector2d& camera::CameraParameters::GetFocalVector() const {
 }
 
 void camera::CameraParameters::SetDistortion(Eigen::VectorXd const& distortion) {
+  ClearUndistortionTable();
   distortion_coeffs_ = distortion;
 
   // Ensure variables are initialized
@@ -336,6 +343,110 @@ void camera::CameraParameters::UndistortCentered(Eigen::Vector2d const& distorte
   }
 }
 
+void camera::CameraParameters::UndistortCenteredExact(Eigen::Matrix2Xd const& distorted_c,
+                                                      Eigen::Matrix2Xd *undistorted_c) const {
+  int num_points = distorted_c.cols();
+  if (distortion_coeffs_.size() == 0) {
+    // No lens distortion
+    *undistorted_c = distorted_c.colwise() - (optical_offset_ - distorted_half_size_);
+  } else if ((distortion_coeffs_.size() == 4 || distortion_coeffs_.size() == 5) &&
+             num_points > 0) {
+    // Tsai lens distortion. Set up OpenCV once and undistort all points
+    // in one call. A 2xN column-major matrix has the layout of a 1xN
+    // two-channel one, so it can be handed to OpenCV without copying.
+    Eigen::Matrix2Xd distorted = distorted_c.colwise() + distorted_half_size_;
+    undistorted_c->resize(2, num_points);
+    cv::Mat src(1, num_points, CV_64FC2, distorted.data());
+    cv::Mat dst(1, num_points, CV_64FC2, undistorted_c->data());
+    cv::Mat dist_int_mat, undist_int_mat, cvdist;
+    cv::eigen2cv(distortion_coeffs_, cvdist);
+    cv::eigen2cv(GetIntrinsicMatrix<DISTORTED>(), dist_int_mat);
+    cv::eigen2cv(GetIntrinsicMatrix<UNDISTORTED>(), undist_int_mat);
+    cv::undistortPoints(src, dst, dist_int_mat, cvdist, cv::Mat(), undist_int_mat);
+    *undistorted_c = undistorted_c->colwise() - undistorted_half_size_;
+  } else {
+    // The FOV model has a closed form, so there is nothing to batch
+    Eigen::Matrix2Xd result(2, num_points);
+    Eigen::Vector2d point;
+    for (int i = 0; i < num_points; i++) {
+      UndistortCentered(Eigen::Vector2d(distorted_c.col(i)), &point);
+      result.col(i) = point;
+    }
+    *undistorted_c = result;
+  }
+}
+
+void camera::CameraParameters::UndistortCentered(Eigen::Matrix2Xd const& distorted_c,
+                                                 Eigen::Matrix2Xd *undistorted_c) const {
+  if (!undistortion_table_) {
+    UndistortCenteredExact(distorted_c, undistorted_c);
+    return;
+  }
+
+  UndistortionTable const& table = *undistortion_table_;
+  int num_points = distorted_c.cols();
+  Eigen::Matrix2Xd result(2, num_points);
+  std::vector<int> outside;  // points not covered by the table
+  for (int i = 0; i < num_points; i++) {
+    double x = (distorted_c(0, i) - table.origin[0]) / table.spacing;
+    double y = (distorted_c(1, i) - table.origin[1]) / table.spacing;
+    int col = static_cast<int>(std::floor(x));
+    int row = static_cast<int>(std::floor(y));
+    if (col < 0 || row < 0 || col >= table.cols - 1 || row >= table.rows - 1) {
+      outside.push_back(i);
+      continue;
+    }
+    double a = x - col, b = y - row;
+    int k = row * table.cols + col;
+    result.col(i) =
+      ((1 - a) * (1 - b)) * table.values.col(k).cast<double>() +
+      (a * (1 - b))       * table.values.col(k + 1).cast<double>() +
+      ((1 - a) * b)       * table.values.col(k + table.cols).cast<double>() +
+      (a * b)             * table.values.col(k + table.cols + 1).cast<double>();
+  }
+
+  if (!outside.empty()) {
+    Eigen::Matrix2Xd in(2, outside.size()), out;
+    for (size_t j = 0; j < outside.size(); j++)
+      in.col(j) = distorted_c.col(outside[j]);
+    UndistortCenteredExact(in, &out);
+    for (size_t j = 0; j < outside.size(); j++)
+      result.col(outside[j]) = out.col(j);
+  }
+
+  *undistorted_c = result;
+}
+
+void camera::CameraParameters::GenerateUndistortionTable(double spacing) {
+  if (spacing <= 0)
+    LOG(FATAL) << "The undistortion table spacing must be positive.";
+
+  std::shared_ptr<UndistortionTable> table(new UndistortionTable);
+  table->spacing = spacing;
+  table->origin = -distorted_half_size_;  // pixel (0, 0) of the DISTORTED image
+  // One sample past the last pixel so every pixel has all four neighbors
+  table->cols = static_cast<int>(std::ceil(distorted_image_size_[0] / spacing)) + 2;
+  table->rows = static_cast<int>(std::ceil(distorted_image_size_[1] / spacing)) + 2;
+
+  Eigen::Matrix2Xd grid(2, table->cols * table->rows), values;
+  for (int row = 0; row < table->rows; row++) {
+    for (int col = 0; col < table->cols; col++)
+      grid.col(row * table->cols + col) = table->origin + spacing * Eigen::Vector2d(col, row);
+  }
+  UndistortCenteredExact(grid, &values);
+  table->values = values.cast<float>();
+
+  undistortion_table_ = table;
+}
+
+void camera::CameraParameters::ClearUndistortionTable() {
+  undistortion_table_.reset();
+}
+
+bool camera::CameraParameters::HasUndistortionTable() const {
+  return static_cast<bool>(undistortion_table_);
+}
+
 // The 'scale' variable is useful when we have the distortion model for a given
 // image, and want to apply it to a version of that image at a different resolution,
 // with 'scale' being the ratio of the width of the image at different resolution
@@ -398,6 +509,23 @@ namespace camera {
 
 #undef DEFINE_CONVERSION
 
+#define DEFINE_BATCH_CONVERSION(TYPEA, TYPEB) \
+  template <> \
+  void camera::CameraParameters::Convert<TYPEA, TYPEB>(Eigen::Matrix2Xd const& input, Eigen::Matrix2Xd *output) const
+
+  DEFINE_BATCH_CONVERSION(DISTORTED_C, UNDISTORTED_C) {
+    UndistortCentered(input, output);
+  }
+  DEFINE_BATCH_CONVERSION(DISTORTED, UNDISTORTED_C) {
+    UndistortCentered(input.colwise() - distorted_half_size_, output);
+  }
+  DEFINE_BATCH_CONVERSION(DISTORTED, UNDISTORTED) {
+    UndistortCentered(input.colwise() - distorted_half_size_, output);
+    *output = output->colwise() + undistorted_half_size_;
+  }
+
+#undef DEFINE_BATCH_CONVERSION
+
   // Helper functions to give the intrinsic matrix
 #define DEFINE_INTRINSIC(TYPE) \
   template <> \
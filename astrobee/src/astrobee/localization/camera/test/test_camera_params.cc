@@ -196,6 +196,51 @@ TEST(camera_params, conversion) {
   EXPECT_NEAR(input[1], output2[1], 1e-6);
 }
 
+TEST(camera_params, batch_undistortion) {
+  Eigen::VectorXd fov(1), tsai(4);
+  fov << 0.998693;
+  tsai << -0.259498, -0.08484934, 0.0032980311, -0.00024045673;
+
+  for (Eigen::VectorXd const& distortion : {fov, tsai}) {
+    camera::CameraParameters params(
+        Eigen::Vector2i(1280, 960),
+        Eigen::Vector2d(608.8, 607.6),
+        Eigen::Vector2d(632.5, 549.1), distortion);
+
+    // Some of these are outside of the image
+    Eigen::Matrix2Xd input = Eigen::Matrix2Xd::Random(2, 500);
+    input.row(0) *= 700;
+    input.row(1) *= 520;
+
+    // Undistorting all points at once must agree with doing it one by one
+    Eigen::Matrix2Xd output;
+    params.Convert<camera::DISTORTED_C, camera::UNDISTORTED_C>(input, &output);
+    ASSERT_EQ(input.cols(), output.cols());
+    for (int i = 0; i < input.cols(); i++) {
+      Eigen::Vector2d point;
+      params.Convert<camera::DISTORTED_C, camera::UNDISTORTED_C>(Eigen::Vector2d(input.col(i)), &point);
+      EXPECT_NEAR(point[0], output(0, i), 1e-6);
+      EXPECT_NEAR(point[1], output(1, i), 1e-6);
+    }
+
+    // The table must be close, also for copies, and go away when
+    // the parameters change
+    params.GenerateUndistortionTable(1.0);
+    camera::CameraParameters copy = params;
+    EXPECT_TRUE(copy.HasUndistortionTable());
+    Eigen::Matrix2Xd table_output;
+    copy.Convert<camera::DISTORTED_C, camera::UNDISTORTED_C>(input, &table_output);
+    EXPECT_LT((table_output - output).cwiseAbs().maxCoeff(), 0.1);
+
+    Eigen::Matrix2Xd distorted = input.colwise() + params.GetDistortedHalfSize();
+    copy.Convert<camera::DISTORTED, camera::UNDISTORTED_C>(distorted, &table_output);
+    EXPECT_LT((table_output - output).cwiseAbs().maxCoeff(), 0.1);
+
+    copy.SetDistortion(distortion);
+    EXPECT_FALSE(copy.HasUndistortionTable());
+  }
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
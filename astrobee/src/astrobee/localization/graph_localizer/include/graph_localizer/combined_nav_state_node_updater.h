@@ -48,8 +48,9 @@ class CombinedNavStateNodeUpdater
   bool Update(const localization_common::Time timestamp, gtsam::NonlinearFactorGraph& factors) final;
 
   bool SlideWindow(const localization_common::Time oldest_allowed_timestamp,
-                   const boost::optional<gtsam::Marginals>& marginals, const gtsam::KeyVector& old_keys,
-                   const double huber_k, gtsam::NonlinearFactorGraph& factors) final;
+                   const boost::optional<graph_optimizer::SelectiveMarginals>& marginals,
+                   const gtsam::KeyVector& old_keys, const double huber_k,
+                   gtsam::NonlinearFactorGraph& factors) final;
 
   void ThresholdBiasUncertainty(gtsam::Matrix& bias_covariance) const;
 
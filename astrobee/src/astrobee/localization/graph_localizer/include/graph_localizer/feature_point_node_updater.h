@@ -40,10 +40,12 @@ class FeaturePointNodeUpdater
   bool Update(const localization_common::Time timestamp, gtsam::NonlinearFactorGraph& factors) final;
 
   bool SlideWindow(const localization_common::Time oldest_allowed_timestamp,
-                   const boost::optional<gtsam::Marginals>& marginals, const gtsam::KeyVector& old_keys,
-                   const double huber_k, gtsam::NonlinearFactorGraph& factors) final;
+                   const boost::optional<graph_optimizer::SelectiveMarginals>& marginals,
+                   const gtsam::KeyVector& old_keys, const double huber_k,
+                   gtsam::NonlinearFactorGraph& factors) final;
 
-  void UpdatePointPriors(const gtsam::Marginals& marginals, gtsam::NonlinearFactorGraph& factors);
+  void UpdatePointPriors(const graph_optimizer::SelectiveMarginals& marginals,
+                         gtsam::NonlinearFactorGraph& factors);
 
   graph_optimizer::NodeUpdaterType type() const final;
 
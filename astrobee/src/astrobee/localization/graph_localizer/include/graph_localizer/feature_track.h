@@ -19,8 +19,12 @@
 #ifndef GRAPH_LOCALIZER_FEATURE_TRACK_H_
 #define GRAPH_LOCALIZER_FEATURE_TRACK_H_
 
+#include <localization_common/time_series.h>
 #include <localization_measurements/feature_point.h>
 
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
+
 #include <map>
 #include <set>
 #include <vector>
@@ -28,9 +32,11 @@
 namespace graph_localizer {
 class FeatureTrack {
  public:
-  using Points = std::map<localization_common::Time, localization_measurements::FeaturePoint>;
+  using Points = localization_common::TimeSeries<localization_measurements::FeaturePoint>;
   explicit FeatureTrack(const localization_measurements::FeatureId id);
   FeatureTrack() {}
+  // Clears the track and assigns it a new id, keeping the point buffer so the track can be reused
+  void Reset(const localization_measurements::FeatureId id);
   void AddMeasurement(const localization_common::Time timestamp,
                       const localization_measurements::FeaturePoint& feature_point);
   void RemoveOldMeasurements(const localization_common::Time oldest_allowed_timestamp);
@@ -55,10 +61,24 @@ class FeatureTrack {
   // Serialization function
   friend class boost::serialization::access;
   template <class ARCHIVE>
-  void serialize(ARCHIVE& ar, const unsigned int /*version*/) {
+  void save(ARCHIVE& ar, const unsigned int /*version*/) const {
+    ar& BOOST_SERIALIZATION_NVP(id_);
+    const std::map<localization_common::Time, localization_measurements::FeaturePoint> points(points_.cbegin(),
+                                                                                              points_.cend());
+    ar& boost::serialization::make_nvp("points_", points);
+  }
+  template <class ARCHIVE>
+  void load(ARCHIVE& ar, const unsigned int /*version*/) {
     ar& BOOST_SERIALIZATION_NVP(id_);
-    ar& BOOST_SERIALIZATION_NVP(points_);
+    std::map<localization_common::Time, localization_measurements::FeaturePoint> points;
+    ar& boost::serialization::make_nvp("points_", points);
+    points_.clear();
+    points_.reserve(points.size());
+    for (const auto& point : points) {
+      points_.emplace(point.first, point.second);
+    }
   }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
 
   localization_measurements::FeatureId id_;
   Points points_;
@@ -26,28 +26,35 @@
 
 #include <gtsam/geometry/Point2.h>
 
-#include <deque>
-#include <map>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <cstdint>
 #include <set>
+#include <vector>
 
 namespace graph_localizer {
-using FeatureTrackIdMap = std::map<localization_measurements::FeatureId, std::shared_ptr<FeatureTrack>>;
-using FeatureTrackLengthMap = std::multimap<int, std::shared_ptr<FeatureTrack>>;
+// Feature tracks sorted by feature id
+using FeatureTracks = std::vector<FeatureTrack>;
+// Feature tracks sorted by length, then by feature id.  Points to the tracks of a FeatureTracker and is invalidated
+// when its tracks are updated.
+using FeatureTracksLengthOrdered = std::vector<const FeatureTrack*>;
+// Stores feature tracks contiguously in a table sorted by feature id.  Each update stamps the tracks of detected
+// features with a new generation, tracks with an older generation are undetected and removed in one compaction pass.
+// Removed tracks are kept as spares and reused for new features along with their point buffers, so once the table has
+// grown to the number of tracked features updates don't allocate.
 class FeatureTracker {
  public:
   explicit FeatureTracker(const FeatureTrackerParams& params = FeatureTrackerParams());
   // Update existing tracks and add new tracks.  Remove tracks without
   // detections.
   void UpdateFeatureTracks(const localization_measurements::FeaturePoints& feature_points);
-  const FeatureTrackIdMap& feature_tracks() const;
+  const FeatureTracks& feature_tracks() const;
   const std::set<localization_common::Time>& smart_factor_timestamp_allow_list() const;
-  const FeatureTrackLengthMap& feature_tracks_length_ordered() const;
+  const FeatureTracksLengthOrdered& feature_tracks_length_ordered() const;
   int NumTracksWithAtLeastNPoints(int n) const;
-  void RemoveUndetectedFeatures(const localization_common::Time& feature_point);
   void RemoveOldFeaturePointsAndSlideWindow(
     boost::optional<localization_common::Time> oldest_allowed_time = boost::none);
-  void AddOrUpdateTrack(const localization_measurements::FeaturePoint& feature_point);
-  void UpdateLengthMap();
   void UpdateAllowList(const localization_common::Time& timestamp);
   void SlideAllowList(const localization_common::Time& oldest_allowed_time);
   boost::optional<const FeatureTrack&> LongestFeatureTrack() const;
@@ -59,16 +66,32 @@ class FeatureTracker {
   boost::optional<localization_common::Time> PreviousTimestamp() const;
 
  private:
+  void AddOrUpdateTrack(const localization_measurements::FeaturePoint& feature_point);
+  void RemoveUndetectedFeatures();
+  void UpdateLengthMap();
+  FeatureTrack NewTrack(const localization_measurements::FeatureId id);
+
   // Serialization function
   friend class boost::serialization::access;
   template <class ARCHIVE>
-  void serialize(ARCHIVE& ar, const unsigned int /*version*/) {
-    ar& BOOST_SERIALIZATION_NVP(feature_track_id_map_);
-    ar& BOOST_SERIALIZATION_NVP(feature_track_length_map_);
+  void save(ARCHIVE& ar, const unsigned int /*version*/) const {
+    ar& BOOST_SERIALIZATION_NVP(feature_tracks_);
+  }
+  template <class ARCHIVE>
+  void load(ARCHIVE& ar, const unsigned int /*version*/) {
+    ar& BOOST_SERIALIZATION_NVP(feature_tracks_);
+    detected_generations_.assign(feature_tracks_.size(), generation_);
+    UpdateLengthMap();
   }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
 
-  FeatureTrackIdMap feature_track_id_map_;
-  FeatureTrackLengthMap feature_track_length_map_;
+  FeatureTracks feature_tracks_;
+  // Generation of the latest update each track was detected in, parallel to feature_tracks_
+  std::vector<uint64_t> detected_generations_;
+  uint64_t generation_ = 0;
+  // Removed tracks kept for reuse
+  FeatureTracks spare_tracks_;
+  FeatureTracksLengthOrdered feature_tracks_length_ordered_;
   FeatureTrackerParams params_;
   // TODO(rsoussan): Move ths somewhere else?
   std::set<localization_common::Time> smart_factor_timestamp_allow_list_;
@@ -54,7 +54,6 @@
 #include <gtsam/navigation/ImuBias.h>
 #include <gtsam/navigation/NavState.h>
 #include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
-#include <gtsam/nonlinear/Marginals.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include <gtsam/slam/ProjectionFactor.h>
 #include <gtsam/slam/SmartFactorParams.h>
@@ -98,7 +97,7 @@ class GraphLocalizer : public graph_optimizer::GraphOptimizer {
   void AddDepthOdometryMeasurement(
     const localization_measurements::DepthOdometryMeasurement& depth_odometry_measurement);
   bool DoPostOptimizeActions() final;
-  const FeatureTrackIdMap& feature_tracks() const { return feature_tracker_->feature_tracks(); }
+  const FeatureTracks& feature_tracks() const { return feature_tracker_->feature_tracks(); }
 
   boost::optional<std::pair<gtsam::imuBias::ConstantBias, localization_common::Time>> LatestBiases() const;
 
@@ -129,10 +128,7 @@ class GraphLocalizer : public graph_optimizer::GraphOptimizer {
   void InitializeFactorAdders();
   void InitializeGraphActionCompleters();
   void DoPostSlideWindowActions(const localization_common::Time oldest_allowed_time,
-                                const boost::optional<gtsam::Marginals>& marginals) final;
-
-  boost::optional<std::pair<localization_common::CombinedNavState, localization_common::CombinedNavStateCovariances>>
-  LatestCombinedNavStateAndCovariances(const gtsam::Marginals& marginals) const;
+                                const boost::optional<graph_optimizer::SelectiveMarginals>& marginals) final;
 
   void BufferCumulativeFactors() final;
 
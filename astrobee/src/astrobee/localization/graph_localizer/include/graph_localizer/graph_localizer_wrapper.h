@@ -89,7 +89,7 @@ class GraphLocalizerWrapper {
 
   void FlightModeCallback(const ff_msgs::FlightMode& flight_mode);
 
-  boost::optional<const FeatureTrackIdMap&> feature_tracks() const;
+  boost::optional<const FeatureTracks&> feature_tracks() const;
 
   boost::optional<const GraphLocalizer&> graph_localizer() const;
 
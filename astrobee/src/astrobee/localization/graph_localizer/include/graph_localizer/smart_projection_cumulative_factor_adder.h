@@ -39,11 +39,11 @@ class SmartProjectionCumulativeFactorAdder
 
   std::vector<graph_optimizer::FactorsToAdd> AddFactors() final;
   void AddFactors(
-    const FeatureTrackLengthMap& feature_tracks, const int spacing, const double feature_track_min_separation,
+    const FeatureTracksLengthOrdered& feature_tracks, const int spacing, const double feature_track_min_separation,
     graph_optimizer::FactorsToAdd& smart_factors_to_add,
     std::unordered_map<localization_measurements::FeatureId, localization_measurements::FeaturePoint>& added_points);
   void AddAllowedFactors(
-    const FeatureTrackLengthMap& feature_tracks, const double feature_track_min_separation,
+    const FeatureTracksLengthOrdered& feature_tracks, const double feature_track_min_separation,
     graph_optimizer::FactorsToAdd& smart_factors_to_add,
     std::unordered_map<localization_measurements::FeatureId, localization_measurements::FeaturePoint>& added_points);
 
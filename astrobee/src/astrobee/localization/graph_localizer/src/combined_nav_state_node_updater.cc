@@ -94,7 +94,7 @@ void CombinedNavStateNodeUpdater::AddPriors(const lc::CombinedNavState& global_N
 }
 
 bool CombinedNavStateNodeUpdater::SlideWindow(const lc::Time oldest_allowed_timestamp,
-                                              const boost::optional<gtsam::Marginals>& marginals,
+                                              const boost::optional<go::SelectiveMarginals>& marginals,
                                               const gtsam::KeyVector& old_keys, const double huber_k,
                                               gtsam::NonlinearFactorGraph& factors) {
   graph_values_->RemoveOldCombinedNavStates(oldest_allowed_timestamp);
@@ -119,13 +119,15 @@ bool CombinedNavStateNodeUpdater::SlideWindow(const lc::Time oldest_allowed_time
 
     // Make sure priors are removed before adding new ones
     RemovePriors(*key_index, factors);
-    if (marginals) {
+    // Request the covariances together so they are computed at once
+    const auto covariances =
+      marginals ? marginals->MarginalCovariances({sym::P(*key_index), sym::V(*key_index), sym::B(*key_index)})
+                : boost::none;
+    if (covariances) {
       lc::CombinedNavStateNoise noise;
-      noise.pose_noise =
-        Robust(gtsam::noiseModel::Gaussian::Covariance(marginals->marginalCovariance(sym::P(*key_index))), huber_k);
-      noise.velocity_noise =
-        Robust(gtsam::noiseModel::Gaussian::Covariance(marginals->marginalCovariance(sym::V(*key_index))), huber_k);
-      auto bias_covariance = marginals->marginalCovariance(sym::B(*key_index));
+      noise.pose_noise = Robust(gtsam::noiseModel::Gaussian::Covariance((*covariances)[0]), huber_k);
+      noise.velocity_noise = Robust(gtsam::noiseModel::Gaussian::Covariance((*covariances)[1]), huber_k);
+      auto bias_covariance = (*covariances)[2];
       if (params_.threshold_bias_uncertainty) ThresholdBiasUncertainty(bias_covariance);
       noise.bias_noise = Robust(gtsam::noiseModel::Gaussian::Covariance(bias_covariance), huber_k);
       AddPriors(*global_N_body_oldest, noise, factors);
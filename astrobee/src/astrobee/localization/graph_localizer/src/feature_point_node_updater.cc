@@ -22,6 +22,8 @@
 #include <gtsam/inference/Symbol.h>
 #include <gtsam/slam/PriorFactor.h>
 
+#include <unordered_set>
+
 namespace graph_localizer {
 namespace go = graph_optimizer;
 namespace lc = localization_common;
@@ -40,7 +42,7 @@ void FeaturePointNodeUpdater::AddPriors(const lc::FeaturePoint3d& global_t_point
                                         gtsam::NonlinearFactorGraph& factors) {}
 
 bool FeaturePointNodeUpdater::SlideWindow(const lc::Time oldest_allowed_timestamp,
-                                          const boost::optional<gtsam::Marginals>& marginals,
+                                          const boost::optional<go::SelectiveMarginals>& marginals,
                                           const gtsam::KeyVector& old_keys, const double huber_k,
                                           gtsam::NonlinearFactorGraph& factors) {
   feature_point_graph_values_->RemoveOldFeatures(old_keys);
@@ -48,10 +50,27 @@ bool FeaturePointNodeUpdater::SlideWindow(const lc::Time oldest_allowed_timestam
   return true;
 }
 
-void FeaturePointNodeUpdater::UpdatePointPriors(const gtsam::Marginals& marginals,
+void FeaturePointNodeUpdater::UpdatePointPriors(const go::SelectiveMarginals& marginals,
                                                 gtsam::NonlinearFactorGraph& factors) {
-  const auto feature_keys = feature_point_graph_values_->FeatureKeys();
-  for (const auto& feature_key : feature_keys) {
+  // Find the features with priors first so their covariances are computed at once
+  std::unordered_set<gtsam::Key> feature_keys;
+  for (const auto& feature_key : feature_point_graph_values_->FeatureKeys()) feature_keys.emplace(feature_key);
+  gtsam::KeyVector prior_keys;
+  for (const auto& factor : factors) {
+    const auto point_prior_factor = dynamic_cast<gtsam::PriorFactor<gtsam::Point3>*>(factor.get());
+    // Only one point prior per feature
+    if (point_prior_factor && feature_keys.erase(point_prior_factor->key()) > 0)
+      prior_keys.emplace_back(point_prior_factor->key());
+  }
+  if (prior_keys.empty()) return;
+  const auto covariances = marginals.MarginalCovariances(prior_keys);
+  if (!covariances) {
+    LogError("UpdatePointPriors: Failed to get marginal covariances.");
+    return;
+  }
+
+  for (int i = 0; i < static_cast<int>(prior_keys.size()); ++i) {
+    const auto& feature_key = prior_keys[i];
     const auto world_t_point = feature_point_graph_values_->at<gtsam::Point3>(feature_key);
     if (!world_t_point) {
       LogError("UpdatePointPriors: Failed to get world_t_point.");
@@ -64,7 +83,7 @@ void FeaturePointNodeUpdater::UpdatePointPriors(const gtsam::Marginals& marginal
         factor_it = factors.erase(factor_it);
         // Add updated one
         const auto point_prior_noise =
-          Robust(gtsam::noiseModel::Gaussian::Covariance(marginals.marginalCovariance(feature_key)), params_.huber_k);
+          Robust(gtsam::noiseModel::Gaussian::Covariance((*covariances)[i]), params_.huber_k);
         const gtsam::PriorFactor<gtsam::Point3> point_prior_factor(feature_key, *world_t_point, point_prior_noise);
         factors.push_back(point_prior_factor);
         // Only one point prior per feature
@@ -24,6 +24,11 @@ namespace lc = localization_common;
 namespace lm = localization_measurements;
 FeatureTrack::FeatureTrack(const localization_measurements::FeatureId id) : id_(id) {}
 
+void FeatureTrack::Reset(const localization_measurements::FeatureId id) {
+  id_ = id;
+  points_.clear();
+}
+
 void FeatureTrack::AddMeasurement(const lc::Time timestamp, const lm::FeaturePoint& feature_point) {
   points_.emplace(timestamp, feature_point);
 }
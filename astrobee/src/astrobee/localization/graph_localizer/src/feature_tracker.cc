@@ -19,6 +19,8 @@
 #include <graph_localizer/feature_tracker.h>
 #include <localization_common/logger.h>
 
+#include <algorithm>
+
 namespace graph_localizer {
 namespace lc = localization_common;
 namespace lm = localization_measurements;
@@ -32,6 +34,7 @@ void FeatureTracker::UpdateFeatureTracks(const lm::FeaturePoints& feature_points
 
   const int starting_num_feature_tracks = size();
   LogDebug("UpdateFeatureTracks: Starting num feature tracks: " << starting_num_feature_tracks);
+  ++generation_;
   for (const auto& feature_point : feature_points) {
     AddOrUpdateTrack(feature_point);
   }
@@ -39,8 +42,7 @@ void FeatureTracker::UpdateFeatureTracks(const lm::FeaturePoints& feature_points
   LogDebug("UpdateFeatureTracks: Added feature tracks: " << post_add_num_feature_tracks - starting_num_feature_tracks);
 
   // Remove features that weren't detected
-  const auto feature_points_timestamp = feature_points.front().timestamp;
-  RemoveUndetectedFeatures(feature_points_timestamp);
+  RemoveUndetectedFeatures();
   UpdateLengthMap();
   UpdateAllowList(feature_points.front().timestamp);
   const int removed_num_feature_tracks = post_add_num_feature_tracks - size();
@@ -67,65 +69,100 @@ void FeatureTracker::RemoveOldFeaturePointsAndSlideWindow(boost::optional<lc::Ti
   if (window_start <= 0 && !oldest_allowed_time) return;
   oldest_allowed_time = oldest_allowed_time ? std::max(*oldest_allowed_time, window_start) : window_start;
 
-  for (auto feature_track : feature_track_id_map_) {
-    feature_track.second->RemoveOldMeasurements(*oldest_allowed_time);
+  for (auto& feature_track : feature_tracks_) {
+    feature_track.RemoveOldMeasurements(*oldest_allowed_time);
   }
 
   SlideAllowList(*oldest_allowed_time);
   UpdateLengthMap();
 }
 
-void FeatureTracker::RemoveUndetectedFeatures(const lc::Time& feature_point_timestamp) {
-  for (auto feature_it = feature_track_id_map_.cbegin(); feature_it != feature_track_id_map_.cend();) {
-    if (!feature_it->second->HasMeasurement(feature_point_timestamp)) {
-      feature_it = feature_track_id_map_.erase(feature_it);
-    } else {
-      ++feature_it;
+void FeatureTracker::RemoveUndetectedFeatures() {
+  // Compact detected tracks in place, preserving their order
+  size_t num_detected_tracks = 0;
+  for (size_t i = 0; i < feature_tracks_.size(); ++i) {
+    if (detected_generations_[i] != generation_) {
+      spare_tracks_.emplace_back(std::move(feature_tracks_[i]));
+      continue;
+    }
+    if (i != num_detected_tracks) {
+      feature_tracks_[num_detected_tracks] = std::move(feature_tracks_[i]);
+      detected_generations_[num_detected_tracks] = detected_generations_[i];
     }
+    ++num_detected_tracks;
   }
+  feature_tracks_.erase(feature_tracks_.begin() + num_detected_tracks, feature_tracks_.end());
+  detected_generations_.erase(detected_generations_.begin() + num_detected_tracks, detected_generations_.end());
 }
 
 void FeatureTracker::AddOrUpdateTrack(const lm::FeaturePoint& feature_point) {
-  if (feature_track_id_map_.count(feature_point.feature_id) == 0) {
-    feature_track_id_map_[feature_point.feature_id] = std::make_shared<FeatureTrack>(feature_point.feature_id);
+  const auto feature_track_it =
+    std::lower_bound(feature_tracks_.begin(), feature_tracks_.end(), feature_point.feature_id,
+                     [](const FeatureTrack& feature_track, const lm::FeatureId id) { return feature_track.id() < id; });
+  const auto index = std::distance(feature_tracks_.begin(), feature_track_it);
+  if (feature_track_it == feature_tracks_.end() || feature_track_it->id() != feature_point.feature_id) {
+    // Feature ids are increasing for new features, so new tracks are usually appended
+    feature_tracks_.emplace(feature_track_it, NewTrack(feature_point.feature_id));
+    detected_generations_.emplace(detected_generations_.begin() + index, generation_);
   }
-  feature_track_id_map_[feature_point.feature_id]->AddMeasurement(feature_point.timestamp, feature_point);
+  feature_tracks_[index].AddMeasurement(feature_point.timestamp, feature_point);
+  detected_generations_[index] = generation_;
+}
+
+FeatureTrack FeatureTracker::NewTrack(const lm::FeatureId id) {
+  if (spare_tracks_.empty()) return FeatureTrack(id);
+  FeatureTrack feature_track = std::move(spare_tracks_.back());
+  spare_tracks_.pop_back();
+  feature_track.Reset(id);
+  return feature_track;
 }
 
 void FeatureTracker::UpdateLengthMap() {
-  feature_track_length_map_.clear();
-  for (const auto& feature_track : feature_track_id_map_) {
-    feature_track_length_map_.emplace(feature_track.second->size(), feature_track.second);
+  feature_tracks_length_ordered_.clear();
+  for (const auto& feature_track : feature_tracks_) {
+    feature_tracks_length_ordered_.emplace_back(&feature_track);
   }
+  std::sort(feature_tracks_length_ordered_.begin(), feature_tracks_length_ordered_.end(),
+            [](const FeatureTrack* lhs, const FeatureTrack* rhs) {
+              return lhs->size() < rhs->size() || (lhs->size() == rhs->size() && lhs->id() < rhs->id());
+            });
 }
 
-const FeatureTrackIdMap& FeatureTracker::feature_tracks() const { return feature_track_id_map_; }
+const FeatureTracks& FeatureTracker::feature_tracks() const { return feature_tracks_; }
 
 const std::set<lc::Time>& FeatureTracker::smart_factor_timestamp_allow_list() const {
   return smart_factor_timestamp_allow_list_;
 }
 
-const FeatureTrackLengthMap& FeatureTracker::feature_tracks_length_ordered() const { return feature_track_length_map_; }
+const FeatureTracksLengthOrdered& FeatureTracker::feature_tracks_length_ordered() const {
+  return feature_tracks_length_ordered_;
+}
 
 int FeatureTracker::NumTracksWithAtLeastNPoints(int n) const {
-  const auto lower_bound_it = feature_track_length_map_.lower_bound(n);
-  return std::distance(lower_bound_it, feature_track_length_map_.end());
+  const auto lower_bound_it = std::lower_bound(
+    feature_tracks_length_ordered_.cbegin(), feature_tracks_length_ordered_.cend(), n,
+    [](const FeatureTrack* feature_track, const int n) { return static_cast<int>(feature_track->size()) < n; });
+  return std::distance(lower_bound_it, feature_tracks_length_ordered_.cend());
 }
 
-size_t FeatureTracker::size() const { return feature_track_id_map_.size(); }
+size_t FeatureTracker::size() const { return feature_tracks_.size(); }
 
-bool FeatureTracker::empty() const { return feature_track_id_map_.empty(); }
+bool FeatureTracker::empty() const { return feature_tracks_.empty(); }
 
 void FeatureTracker::Clear() {
-  feature_track_id_map_.clear();
-  feature_track_length_map_.clear();
+  for (auto& feature_track : feature_tracks_) {
+    spare_tracks_.emplace_back(std::move(feature_track));
+  }
+  feature_tracks_.clear();
+  detected_generations_.clear();
+  feature_tracks_length_ordered_.clear();
   smart_factor_timestamp_allow_list_.clear();
 }
 
 boost::optional<lc::Time> FeatureTracker::LatestTimestamp() const {
   if (empty()) return boost::none;
   // Since Feature Tracks without latest timestamp are erased on updates, each track contains the latest timestamp
-  return feature_track_id_map_.cbegin()->second->LatestTimestamp();
+  return feature_tracks_.front().LatestTimestamp();
 }
 
 boost::optional<lc::Time> FeatureTracker::PreviousTimestamp() const {
@@ -143,6 +180,6 @@ boost::optional<localization_common::Time> FeatureTracker::OldestTimestamp() con
 
 boost::optional<const FeatureTrack&> FeatureTracker::LongestFeatureTrack() const {
   if (empty()) return boost::none;
-  return *(feature_track_length_map_.rbegin()->second.get());
+  return *(feature_tracks_length_ordered_.back());
 }
 }  // namespace graph_localizer
@@ -118,23 +118,6 @@ void GraphLocalizer::InitializeGraphActionCompleters() {
 
 boost::optional<std::pair<lc::CombinedNavState, lc::CombinedNavStateCovariances>>
 GraphLocalizer::LatestCombinedNavStateAndCovariances() const {
-  if (!marginals()) {
-    LogDebugEveryN(50, "LatestCombinedNavStateAndCovariances: No marginals available.");
-    return boost::none;
-  }
-  const auto state_covariance_pair = LatestCombinedNavStateAndCovariances(*marginals());
-  if (!state_covariance_pair) {
-    LogDebug(
-      "LatestCombinedNavStateAndCovariances: Failed to get latest combined nav state and "
-      "covariances.");
-    return boost::none;
-  }
-
-  return state_covariance_pair;
-}
-
-boost::optional<std::pair<lc::CombinedNavState, lc::CombinedNavStateCovariances>>
-GraphLocalizer::LatestCombinedNavStateAndCovariances(const gtsam::Marginals& marginals) const {
   const auto global_N_body_latest = combined_nav_state_node_updater_->graph_values().LatestCombinedNavState();
   if (!global_N_body_latest) {
     LogError("LatestCombinedNavStateAndCovariance: Failed to get latest combined nav state.");
@@ -147,18 +130,19 @@ GraphLocalizer::LatestCombinedNavStateAndCovariances(const gtsam::Marginals& mar
     return boost::none;
   }
 
-  try {
-    const auto pose_covariance = marginals.marginalCovariance(sym::P(*latest_combined_nav_state_key_index));
-    const auto velocity_covariance = marginals.marginalCovariance(sym::V(*latest_combined_nav_state_key_index));
-    const auto bias_covariance = marginals.marginalCovariance(sym::B(*latest_combined_nav_state_key_index));
-    const lc::CombinedNavStateCovariances latest_combined_nav_state_covariances(pose_covariance, velocity_covariance,
-                                                                                bias_covariance);
-    return std::pair<lc::CombinedNavState, lc::CombinedNavStateCovariances>{*global_N_body_latest,
-                                                                            latest_combined_nav_state_covariances};
-  } catch (...) {
-    LogError("LatestCombinedNavStateAndCovariances: Failed to get marginal covariances.");
+  // Only the covariances of the latest state are computed
+  const auto covariances = MarginalCovariances({sym::P(*latest_combined_nav_state_key_index),
+                                                sym::V(*latest_combined_nav_state_key_index),
+                                                sym::B(*latest_combined_nav_state_key_index)});
+  if (!covariances) {
+    LogDebugEveryN(50, "LatestCombinedNavStateAndCovariances: No marginals available.");
     return boost::none;
   }
+
+  const lc::CombinedNavStateCovariances latest_combined_nav_state_covariances((*covariances)[0], (*covariances)[1],
+                                                                              (*covariances)[2]);
+  return std::pair<lc::CombinedNavState, lc::CombinedNavStateCovariances>{*global_N_body_latest,
+                                                                          latest_combined_nav_state_covariances};
 }
 
 boost::optional<lc::CombinedNavState> GraphLocalizer::LatestCombinedNavState() const {
@@ -260,9 +244,9 @@ void GraphLocalizer::CheckForStandstill() {
   int num_valid_feature_tracks = 0;
   for (const auto& feature_track : feature_tracker_->feature_tracks()) {
     const double average_distance_from_mean =
-      AverageDistanceFromMean(feature_track.second->LatestPointsInWindow(params_.standstill_feature_track_duration));
+      AverageDistanceFromMean(feature_track.LatestPointsInWindow(params_.standstill_feature_track_duration));
     // Only consider long enough feature tracks for standstill candidates
-    if (static_cast<int>(feature_track.second->size()) >= params_.standstill_min_num_points_per_track) {
+    if (static_cast<int>(feature_track.size()) >= params_.standstill_min_num_points_per_track) {
       total_average_distance_from_mean += average_distance_from_mean;
       ++num_valid_feature_tracks;
     }
@@ -329,7 +313,7 @@ void GraphLocalizer::AddDepthOdometryMeasurement(const lm::DepthOdometryMeasurem
 }
 
 void GraphLocalizer::DoPostSlideWindowActions(const localization_common::Time oldest_allowed_time,
-                                              const boost::optional<gtsam::Marginals>& marginals) {
+                                              const boost::optional<go::SelectiveMarginals>& marginals) {
   feature_tracker_->RemoveOldFeaturePointsAndSlideWindow(oldest_allowed_time);
   latest_imu_integrator_->RemoveOldMeasurements(oldest_allowed_time);
 }
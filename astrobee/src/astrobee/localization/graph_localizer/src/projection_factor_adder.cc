@@ -62,8 +62,7 @@ std::vector<go::FactorsToAdd> ProjectionFactorAdder::AddFactors(
 
   // Add new feature tracks and measurements if possible
   int new_features = 0;
-  for (const auto& feature_track_pair : feature_tracker_->feature_tracks()) {
-    const auto& feature_track = *(feature_track_pair.second);
+  for (const auto& feature_track : feature_tracker_->feature_tracks()) {
     if (static_cast<int>(feature_track.size()) >= params().min_num_measurements_for_triangulation &&
         !feature_point_graph_values_->HasFeature(feature_track.id()) &&
         (new_features + feature_point_graph_values_->NumFeatures()) < params().max_num_features) {
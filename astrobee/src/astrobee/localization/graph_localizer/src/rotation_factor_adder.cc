@@ -39,8 +39,7 @@ std::vector<go::FactorsToAdd> RotationFactorAdder::AddFactors(const lm::FeatureP
   std::vector<cv::Point2d> points_1;
   std::vector<cv::Point2d> points_2;
   double total_disparity = 0;
-  for (const auto& feature_track_pair : feature_tracker_->feature_tracks()) {
-    const auto& feature_track = *(feature_track_pair.second);
+  for (const auto& feature_track : feature_tracker_->feature_tracks()) {
     if (feature_track.size() < 2) continue;
     // Get points for most recent and second to most recent images
     const auto& point_1 = std::next(feature_track.points().crbegin())->second.image_point;
@@ -41,13 +41,13 @@ SmartProjectionCumulativeFactorAdder::SmartProjectionCumulativeFactorAdder(
 }
 
 void SmartProjectionCumulativeFactorAdder::AddFactors(
-  const FeatureTrackLengthMap& feature_tracks, const int spacing, const double feature_track_min_separation,
+  const FeatureTracksLengthOrdered& feature_tracks, const int spacing, const double feature_track_min_separation,
   go::FactorsToAdd& smart_factors_to_add, std::unordered_map<lm::FeatureId, lm::FeaturePoint>& added_points) {
   // Iterate in reverse order so longer feature tracks are prioritized
   for (auto feature_track_it = feature_tracks.crbegin(); feature_track_it != feature_tracks.crend();
        ++feature_track_it) {
     if (static_cast<int>(smart_factors_to_add.size()) >= params().max_num_factors) break;
-    const auto& feature_track = *(feature_track_it->second);
+    const auto& feature_track = **feature_track_it;
     const auto points = feature_track.LatestPoints(spacing);
     // Skip already added tracks
     if (added_points.count(points.front().feature_id) > 0) continue;
@@ -67,7 +67,7 @@ std::vector<go::FactorsToAdd> SmartProjectionCumulativeFactorAdder::AddFactors()
   go::FactorsToAdd smart_factors_to_add(go::GraphActionCompleterType::SmartFactor);
   if (params().use_allowed_timestamps) {
     for (const auto& feature_track : feature_tracker_->feature_tracks()) {
-      const auto points = feature_track.second->AllowedPoints(feature_tracker_->smart_factor_timestamp_allow_list());
+      const auto points = feature_track.AllowedPoints(feature_tracker_->smart_factor_timestamp_allow_list());
       const double average_distance_from_mean = AverageDistanceFromMean(points);
       if (ValidPointSet(points.size(), average_distance_from_mean, params().min_avg_distance_from_mean,
                         params().min_num_points) &&
@@ -62,6 +62,9 @@ go::GraphOptimizerParams DefaultGraphOptimizerParams() {
   params.use_ceres_params = false;
   params.max_iterations = 4;
   params.marginals_factorization = "qr";
+  params.optimizer = "batch";
+  params.isam2_relinearize_threshold = 0.1;
+  params.num_linearization_threads = 1;
   params.add_marginal_factors = false;
   params.huber_k = 1.345;
   params.log_rate = 100;
@@ -0,0 +1,124 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_localizer/feature_tracker.h>
+#include <localization_measurements/feature_point.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace gl = graph_localizer;
+namespace lc = localization_common;
+namespace lm = localization_measurements;
+
+class FeatureTrackerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    gl::FeatureTrackerParams params;
+    params.sliding_window_duration = 2.0;
+    params.smart_projection_adder_measurement_spacing = 0;
+    params.use_allowed_timestamps = false;
+    feature_tracker_.reset(new gl::FeatureTracker(params));
+  }
+
+  void Update(const std::vector<lm::FeatureId>& feature_ids, const lc::Time timestamp) {
+    lm::FeaturePoints feature_points;
+    for (const auto feature_id : feature_ids) {
+      feature_points.emplace_back(feature_id, 2 * feature_id, 0, feature_id, timestamp);
+    }
+    feature_tracker_->UpdateFeatureTracks(feature_points);
+  }
+
+  std::vector<lm::FeatureId> FeatureIds() const {
+    std::vector<lm::FeatureId> feature_ids;
+    for (const auto& feature_track : feature_tracker_->feature_tracks()) {
+      feature_ids.emplace_back(feature_track.id());
+    }
+    return feature_ids;
+  }
+
+  std::unique_ptr<gl::FeatureTracker> feature_tracker_;
+};
+
+TEST_F(FeatureTrackerTest, RemovesUndetectedTracks) {
+  Update({0, 1, 2, 3, 4}, 1.0);
+  EXPECT_EQ(feature_tracker_->size(), 5);
+  Update({0, 2, 4, 5}, 2.0);
+  EXPECT_EQ(FeatureIds(), std::vector<lm::FeatureId>({0, 2, 4, 5}));
+  for (const auto& feature_track : feature_tracker_->feature_tracks()) {
+    EXPECT_EQ(feature_track.size(), feature_track.id() == 5 ? 1 : 2);
+    EXPECT_EQ(*(feature_track.LatestTimestamp()), 2.0);
+    EXPECT_EQ(feature_track.LatestPoint()->feature_id, feature_track.id());
+  }
+  EXPECT_EQ(*(feature_tracker_->LatestTimestamp()), 2.0);
+  EXPECT_EQ(*(feature_tracker_->PreviousTimestamp()), 1.0);
+  // Redetected ids start new tracks
+  Update({1, 2}, 3.0);
+  EXPECT_EQ(FeatureIds(), std::vector<lm::FeatureId>({1, 2}));
+  EXPECT_EQ(feature_tracker_->feature_tracks()[0].size(), 1);
+  EXPECT_EQ(feature_tracker_->feature_tracks()[1].size(), 3);
+  Update({}, 4.0);
+  EXPECT_TRUE(feature_tracker_->empty());
+  EXPECT_FALSE(feature_tracker_->LatestTimestamp());
+}
+
+TEST_F(FeatureTrackerTest, SortsTracksById) {
+  Update({7, 3, 5}, 1.0);
+  Update({9, 1, 5, 3}, 2.0);
+  EXPECT_EQ(FeatureIds(), std::vector<lm::FeatureId>({1, 3, 5, 9}));
+}
+
+TEST_F(FeatureTrackerTest, OrdersTracksByLength) {
+  Update({0, 1, 2}, 1.0);
+  Update({0, 1, 2, 3}, 2.0);
+  Update({1, 2, 3, 4}, 3.0);
+  const auto& length_ordered = feature_tracker_->feature_tracks_length_ordered();
+  ASSERT_EQ(length_ordered.size(), 4);
+  EXPECT_EQ(length_ordered[0]->id(), 4);
+  EXPECT_EQ(length_ordered[1]->id(), 3);
+  EXPECT_EQ(length_ordered[2]->id(), 1);
+  EXPECT_EQ(length_ordered[3]->id(), 2);
+  EXPECT_EQ(feature_tracker_->LongestFeatureTrack()->id(), 2);
+  EXPECT_EQ(feature_tracker_->NumTracksWithAtLeastNPoints(1), 4);
+  EXPECT_EQ(feature_tracker_->NumTracksWithAtLeastNPoints(2), 3);
+  EXPECT_EQ(feature_tracker_->NumTracksWithAtLeastNPoints(3), 2);
+  EXPECT_EQ(feature_tracker_->NumTracksWithAtLeastNPoints(4), 0);
+  EXPECT_EQ(*(feature_tracker_->OldestTimestamp()), 1.0);
+}
+
+TEST_F(FeatureTrackerTest, SlidesWindow) {
+  for (int i = 0; i < 10; ++i) {
+    Update({0, 1}, i);
+    feature_tracker_->RemoveOldFeaturePointsAndSlideWindow();
+  }
+  // Window is [7, 9]
+  for (const auto& feature_track : feature_tracker_->feature_tracks()) {
+    EXPECT_EQ(feature_track.size(), 3);
+    EXPECT_EQ(*(feature_track.OldestTimestamp()), 7.0);
+  }
+  feature_tracker_->RemoveOldFeaturePointsAndSlideWindow(lc::Time(8.5));
+  EXPECT_EQ(feature_tracker_->LongestFeatureTrack()->size(), 1);
+  EXPECT_EQ(*(feature_tracker_->smart_factor_timestamp_allow_list().cbegin()), 9.0);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -23,12 +23,14 @@
 #include <graph_optimizer/graph_action_completer.h>
 #include <graph_optimizer/graph_optimizer_params.h>
 #include <graph_optimizer/graph_stats.h>
+#include <graph_optimizer/incremental_optimizer.h>
 #include <graph_optimizer/key_info.h>
 #include <graph_optimizer/node_updater.h>
+#include <graph_optimizer/parallel_linearizer.h>
+#include <graph_optimizer/selective_marginals.h>
 #include <localization_common/time.h>
 
 #include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
-#include <gtsam/nonlinear/Marginals.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 
 #include <boost/serialization/serialization.hpp>
@@ -68,7 +70,12 @@ class GraphOptimizer {
   void LogOnDestruction(const bool log_on_destruction);
   const GraphStats* const graph_stats() const;
   GraphStats* graph_stats();
-  const boost::optional<gtsam::Marginals>& marginals() const;
+  const boost::optional<SelectiveMarginals>& marginals() const;
+  // Marginal covariances of keys after the last update, computed on request for the batch optimizer
+  // and from the Bayes tree for the incremental one.  Request keys needed together in one call so
+  // they share the computation.
+  boost::optional<std::vector<gtsam::Matrix>> MarginalCovariances(const gtsam::KeyVector& keys) const;
+  boost::optional<gtsam::Matrix> MarginalCovariance(const gtsam::Key& key) const;
   std::shared_ptr<gtsam::Values> shared_values();
   const gtsam::Values& values() const;
 
@@ -81,7 +88,7 @@ class GraphOptimizer {
   // Removes any factors depending on removed values
   // Optionally adds marginalized factors encapsulating linearized error of removed factors
   // Optionally adds priors using marginalized covariances for new oldest states
-  bool SlideWindow(const boost::optional<gtsam::Marginals>& marginals,
+  bool SlideWindow(const boost::optional<SelectiveMarginals>& marginals,
                    const localization_common::Time last_latest_time);
 
   boost::optional<localization_common::Time> SlideWindowNewOldestTime() const;
@@ -91,9 +98,15 @@ class GraphOptimizer {
   std::pair<gtsam::KeyVector, gtsam::NonlinearFactorGraph> OldKeysAndFactors(
     const localization_common::Time oldest_allowed_time);
 
+  // Optimizes the whole window with Levenberg-Marquardt, returns the number of iterations
+  int OptimizeBatch();
+
+  // Updates the iSAM2 solution with the changes to the window since the last update
+  int OptimizeIncrementally();
+
   // Called after SlideWindow
   virtual void DoPostSlideWindowActions(const localization_common::Time oldest_allowed_time,
-                                        const boost::optional<gtsam::Marginals>& marginals);
+                                        const boost::optional<SelectiveMarginals>& marginals);
 
   // void UpdatePointPriors(const gtsam::Marginals& marginals);
 
@@ -152,12 +165,14 @@ class GraphOptimizer {
   GraphOptimizerParams params_;
   gtsam::LevenbergMarquardtParams levenberg_marquardt_params_;
   gtsam::NonlinearFactorGraph graph_;
-  boost::optional<gtsam::Marginals> marginals_;
+  boost::optional<SelectiveMarginals> marginals_;
   std::multimap<localization_common::Time, FactorsToAdd> buffered_factors_to_add_;
 
   std::vector<std::shared_ptr<NodeUpdater>> node_updaters_;
   std::vector<std::shared_ptr<GraphActionCompleter>> graph_action_completers_;
   gtsam::Marginals::Factorization marginals_factorization_;
+  std::unique_ptr<IncrementalOptimizer> incremental_optimizer_;
+  std::unique_ptr<ParallelLinearizer> linearizer_;
   boost::optional<localization_common::Time> last_latest_time_;
 };
 
@@ -29,6 +29,11 @@ struct GraphOptimizerParams {
   bool use_ceres_params;
   int max_iterations;
   std::string marginals_factorization;
+  // batch or isam2
+  std::string optimizer;
+  double isam2_relinearize_threshold;
+  // Threads linearizing the graph in each batch optimization iteration, including the calling thread
+  int num_linearization_threads;
   bool add_marginal_factors;
   double huber_k;
   int log_rate;
@@ -43,6 +43,7 @@ class GraphStats {
 
   // Timers
   localization_common::Timer optimization_timer_ = localization_common::Timer("Optimization");
+  localization_common::Timer linearization_timer_ = localization_common::Timer("Linearization");
   localization_common::Timer update_timer_ = localization_common::Timer("Update");
   localization_common::Timer marginals_timer_ = localization_common::Timer("Marginals");
   localization_common::Timer slide_window_timer_ = localization_common::Timer("Slide Window");
@@ -0,0 +1,71 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GRAPH_OPTIMIZER_INCREMENTAL_OPTIMIZER_H_
+#define GRAPH_OPTIMIZER_INCREMENTAL_OPTIMIZER_H_
+
+#include <graph_optimizer/graph_optimizer_params.h>
+
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include <boost/optional.hpp>
+
+#include <unordered_map>
+
+namespace graph_optimizer {
+// Keeps an iSAM2 solver in sync with the sliding window graph of a GraphOptimizer.
+// Factors are tracked by pointer, so factors replaced in the graph are removed from iSAM2
+// and their replacements added.  Keys removed from the window values are marginalized
+// out of iSAM2 together with the factors that were removed from the graph for depending
+// on them, so their information is kept as a linear marginal factor.
+class IncrementalOptimizer {
+ public:
+  explicit IncrementalOptimizer(const GraphOptimizerParams& params);
+
+  // Factors removed from the graph because they depend on keys slid out of the window.
+  // These are marginalized with those keys rather than removed at the next Update().
+  void MarginalizeFactors(const gtsam::NonlinearFactorGraph& old_factors);
+
+  // Factors added to the graph to summarize marginalized keys, such as priors on the new
+  // oldest states.  iSAM2 already holds this information so they are not added to it.
+  void IgnoreFactors(const gtsam::NonlinearFactorGraph& factors);
+
+  // Adds factors and values new to the graph, removes factors no longer in it, marginalizes
+  // keys no longer in values, and updates values with the new estimate.
+  // Throws on failure, after which Reset() should be called.
+  void Update(const gtsam::NonlinearFactorGraph& graph, gtsam::Values& values);
+
+  boost::optional<gtsam::Matrix> MarginalCovariance(const gtsam::Key& key) const;
+
+  // Drops the iSAM2 state so the next Update() starts over from the full graph.
+  void Reset();
+
+ private:
+  gtsam::FastList<gtsam::Key> AffectedKeys(const gtsam::FastList<gtsam::Key>& old_keys) const;
+
+  gtsam::ISAM2Params isam2_params_;
+  gtsam::ISAM2 isam2_;
+  std::unordered_map<const gtsam::NonlinearFactor*, size_t> factor_indices_;
+  std::unordered_map<const gtsam::NonlinearFactor*, gtsam::NonlinearFactor::shared_ptr> old_factors_;
+  std::unordered_map<const gtsam::NonlinearFactor*, gtsam::NonlinearFactor::shared_ptr> ignored_factors_;
+};
+}  // namespace graph_optimizer
+
+#endif  // GRAPH_OPTIMIZER_INCREMENTAL_OPTIMIZER_H_
@@ -21,9 +21,9 @@
 
 #include <graph_optimizer/key_info.h>
 #include <graph_optimizer/node_updater_type.h>
+#include <graph_optimizer/selective_marginals.h>
 #include <localization_common/time.h>
 
-#include <gtsam/nonlinear/Marginals.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 
 namespace graph_optimizer {
@@ -34,7 +34,7 @@ class NodeUpdater {
   virtual bool Update(const localization_common::Time timestamp, gtsam::NonlinearFactorGraph& factors) = 0;
 
   virtual bool SlideWindow(const localization_common::Time oldest_allowed_timestamp,
-                           const boost::optional<gtsam::Marginals>& marginals, const gtsam::KeyVector& old_keys,
+                           const boost::optional<SelectiveMarginals>& marginals, const gtsam::KeyVector& old_keys,
                            const double huber_k, gtsam::NonlinearFactorGraph& factors) = 0;
 
   // Returns the oldest time that will be in graph values once the window is slid using params
@@ -0,0 +1,93 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GRAPH_OPTIMIZER_PARALLEL_LINEARIZER_H_
+#define GRAPH_OPTIMIZER_PARALLEL_LINEARIZER_H_
+
+#include <localization_common/timer.h>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace graph_optimizer {
+// Linearizes the factors of a graph concurrently on a persistent pool of threads.  Threads claim
+// factors one at a time, so a few expensive factors (i.e. smart factors triangulating their points)
+// don't hold up the others.  Each linearized factor is stored at the index of its nonlinear factor,
+// so the result matches gtsam::NonlinearFactorGraph::linearize regardless of scheduling.
+// Factors must be safe to linearize concurrently with other factors, which holds for gtsam factors
+// since they only modify their own cached state.
+class ParallelLinearizer {
+ public:
+  // Uses num_threads - 1 pool threads along with the calling thread, linearizes serially if
+  // num_threads <= 1
+  explicit ParallelLinearizer(const int num_threads);
+  ~ParallelLinearizer();
+
+  // Rethrows the first exception thrown by a factor, if any
+  gtsam::GaussianFactorGraph::shared_ptr Linearize(const gtsam::NonlinearFactorGraph& graph,
+                                                   const gtsam::Values& values);
+
+ private:
+  void Work();
+  void LinearizeFactors();
+
+  std::vector<std::thread> threads_;
+  // Serializes calls to Linearize
+  std::mutex linearize_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_condition_;
+  std::condition_variable done_condition_;
+  uint64_t job_ = 0;
+  int num_working_threads_ = 0;
+  bool stop_ = false;
+
+  // Current job, set while the pool threads are stopped
+  const gtsam::NonlinearFactorGraph* graph_ = nullptr;
+  const gtsam::Values* values_ = nullptr;
+  gtsam::GaussianFactorGraph* linearized_graph_ = nullptr;
+  std::atomic<size_t> next_factor_index_;
+  std::exception_ptr exception_;
+};
+
+// Levenberg-Marquardt optimizer linearizing the graph with a ParallelLinearizer on each iteration.
+// The timer, if provided, times each linearization.
+class ParallelLevenbergMarquardtOptimizer : public gtsam::LevenbergMarquardtOptimizer {
+ public:
+  ParallelLevenbergMarquardtOptimizer(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& initial_values,
+                                      const gtsam::LevenbergMarquardtParams& params, ParallelLinearizer& linearizer,
+                                      localization_common::Timer* timer = nullptr);
+
+  gtsam::GaussianFactorGraph::shared_ptr linearize() const override;
+
+ private:
+  ParallelLinearizer& linearizer_;
+  localization_common::Timer* timer_;
+};
+}  // namespace graph_optimizer
+
+#endif  // GRAPH_OPTIMIZER_PARALLEL_LINEARIZER_H_
@@ -0,0 +1,66 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GRAPH_OPTIMIZER_SELECTIVE_MARGINALS_H_
+#define GRAPH_OPTIMIZER_SELECTIVE_MARGINALS_H_
+
+#include <localization_common/timer.h>
+
+#include <gtsam/linear/GaussianBayesTree.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include <boost/optional.hpp>
+
+#include <map>
+#include <vector>
+
+namespace graph_optimizer {
+// Marginal covariances of requested keys only.  Unlike gtsam::Marginals, which linearizes and eliminates
+// the graph up front, nothing is computed until covariances are requested.  The first request linearizes
+// and eliminates the graph into a Bayes tree, which every later request reuses, so there is a single
+// elimination however many requests are made.  The covariance of each key is then recovered from its
+// clique as gtsam::Marginals does.  Covariances are cached so repeated requests are free.
+class SelectiveMarginals {
+ public:
+  // Copies the graph and values so these can still change after construction.  The timer, if
+  // provided, times the computation of covariances.
+  SelectiveMarginals(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
+                     const gtsam::Marginals::Factorization factorization,
+                     localization_common::Timer* timer = nullptr);
+
+  // Returns the covariance of each key in the same order, or none if any fails
+  boost::optional<std::vector<gtsam::Matrix>> MarginalCovariances(const gtsam::KeyVector& keys) const;
+
+  boost::optional<gtsam::Matrix> MarginalCovariance(const gtsam::Key& key) const;
+
+ private:
+  boost::optional<std::vector<gtsam::Matrix>> ComputeMarginalCovariances(const gtsam::KeyVector& keys) const;
+
+  gtsam::NonlinearFactorGraph graph_;
+  gtsam::Values values_;
+  gtsam::Marginals::Factorization factorization_;
+  localization_common::Timer* timer_;
+  mutable gtsam::GaussianBayesTree::shared_ptr bayes_tree_;
+  mutable std::map<gtsam::Key, gtsam::Matrix> covariances_;
+};
+}  // namespace graph_optimizer
+
+#endif  // GRAPH_OPTIMIZER_SELECTIVE_MARGINALS_H_
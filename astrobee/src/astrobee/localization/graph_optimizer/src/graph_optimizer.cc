@@ -64,6 +64,13 @@ GraphOptimizer::GraphOptimizer(const GraphOptimizerParams& params, std::unique_p
     LogError("GraphOptimizer: No marginals factorization entered, defaulting to qr.");
     marginals_factorization_ = gtsam::Marginals::Factorization::QR;
   }
+
+  if (params_.optimizer == "isam2") {
+    incremental_optimizer_.reset(new IncrementalOptimizer(params_));
+  } else if (params_.optimizer != "batch") {
+    LogError("GraphOptimizer: Invalid optimizer entered, defaulting to batch.");
+  }
+  if (!incremental_optimizer_) linearizer_.reset(new ParallelLinearizer(params_.num_linearization_threads));
 }
 
 GraphOptimizer::~GraphOptimizer() {
@@ -126,7 +133,8 @@ std::pair<gtsam::KeyVector, gtsam::NonlinearFactorGraph> GraphOptimizer::OldKeys
   return std::make_pair(old_keys, old_factors);
 }
 
-bool GraphOptimizer::SlideWindow(const boost::optional<gtsam::Marginals>& marginals, const lc::Time last_latest_time) {
+bool GraphOptimizer::SlideWindow(const boost::optional<SelectiveMarginals>& marginals,
+                                 const lc::Time last_latest_time) {
   const auto ideal_new_oldest_time = SlideWindowNewOldestTime();
   if (!ideal_new_oldest_time) {
     LogDebug("SlideWindow: No states removed. ");
@@ -139,7 +147,9 @@ bool GraphOptimizer::SlideWindow(const boost::optional<gtsam::Marginals>& margin
   const auto new_oldest_time = std::min(last_latest_time, *ideal_new_oldest_time);
 
   const auto old_keys_and_factors = OldKeysAndFactors(new_oldest_time);
-  if (params_.add_marginal_factors) {
+  // The incremental optimizer marginalizes the old factors itself
+  if (incremental_optimizer_) incremental_optimizer_->MarginalizeFactors(old_keys_and_factors.second);
+  if (params_.add_marginal_factors && !incremental_optimizer_) {
     const auto marginal_factors =
       MarginalFactors(old_keys_and_factors.second, old_keys_and_factors.first, gtsam::EliminateQR);
     for (const auto& marginal_factor : marginal_factors) {
@@ -147,16 +157,30 @@ bool GraphOptimizer::SlideWindow(const boost::optional<gtsam::Marginals>& margin
     }
   }
 
+  std::unordered_set<const gtsam::NonlinearFactor*> factors_before_slide;
+  if (incremental_optimizer_) {
+    for (const auto& factor : graph_) factors_before_slide.emplace(factor.get());
+  }
+
   for (auto& node_updater : node_updaters_)
     node_updater->SlideWindow(new_oldest_time, marginals, old_keys_and_factors.first, params_.huber_k, graph_);
 
+  // Priors added for the new oldest states duplicate the marginal already kept by the incremental optimizer
+  if (incremental_optimizer_) {
+    gtsam::NonlinearFactorGraph prior_factors;
+    for (const auto& factor : graph_) {
+      if (factors_before_slide.count(factor.get()) == 0) prior_factors.push_back(factor);
+    }
+    incremental_optimizer_->IgnoreFactors(prior_factors);
+  }
+
   RemoveOldBufferedFactors(new_oldest_time);
   DoPostSlideWindowActions(new_oldest_time, marginals);
   return true;
 }
 
 void GraphOptimizer::DoPostSlideWindowActions(const localization_common::Time oldest_allowed_time,
-                                              const boost::optional<gtsam::Marginals>& marginals) {}
+                                              const boost::optional<SelectiveMarginals>& marginals) {}
 
 void GraphOptimizer::BufferCumulativeFactors() {}
 
@@ -353,7 +377,32 @@ gtsam::NonlinearFactorGraph& GraphOptimizer::graph_factors() { return graph_; }
 
 const int GraphOptimizer::num_factors() const { return graph_.size(); }
 
-const boost::optional<gtsam::Marginals>& GraphOptimizer::marginals() const { return marginals_; }
+const boost::optional<SelectiveMarginals>& GraphOptimizer::marginals() const { return marginals_; }
+
+boost::optional<std::vector<gtsam::Matrix>> GraphOptimizer::MarginalCovariances(const gtsam::KeyVector& keys) const {
+  if (marginals_) return marginals_->MarginalCovariances(keys);
+  if (!incremental_optimizer_) return boost::none;
+  std::vector<gtsam::Matrix> covariances;
+  graph_stats_->marginals_timer_.Start();
+  try {
+    for (const auto& key : keys) {
+      const auto covariance = incremental_optimizer_->MarginalCovariance(key);
+      if (!covariance) break;
+      covariances.emplace_back(*covariance);
+    }
+  } catch (...) {
+    LogError("MarginalCovariances: Failed to get marginal covariances.");
+  }
+  graph_stats_->marginals_timer_.Stop();
+  if (covariances.size() != keys.size()) return boost::none;
+  return covariances;
+}
+
+boost::optional<gtsam::Matrix> GraphOptimizer::MarginalCovariance(const gtsam::Key& key) const {
+  const auto covariances = MarginalCovariances(gtsam::KeyVector{key});
+  if (!covariances) return boost::none;
+  return covariances->front();
+}
 
 std::shared_ptr<gtsam::Values> GraphOptimizer::shared_values() { return values_; }
 
@@ -374,6 +423,43 @@ void GraphOptimizer::LogOnDestruction(const bool log_on_destruction) {
 
 bool GraphOptimizer::DoPostOptimizeActions() { return true; }
 
+int GraphOptimizer::OptimizeBatch() {
+  ParallelLevenbergMarquardtOptimizer optimizer(graph_, *values_, levenberg_marquardt_params_, *linearizer_,
+                                                &graph_stats_->linearization_timer_);
+  // TODO(rsoussan): Indicate if failure occurs in state msg, perhaps using confidence value in msg
+  try {
+    *values_ = optimizer.optimize();
+  } catch (gtsam::IndeterminantLinearSystemException) {
+    log(params_.fatal_failures, "Update: Graph optimization failed, indeterminant linear system, keeping old values.");
+  } catch (gtsam::InvalidNoiseModel) {
+    log(params_.fatal_failures, "Update: Graph optimization failed, invalid noise model, keeping old values.");
+  } catch (gtsam::InvalidMatrixBlock) {
+    log(params_.fatal_failures, "Update: Graph optimization failed, invalid matrix block, keeping old values.");
+  } catch (gtsam::InvalidDenseElimination) {
+    log(params_.fatal_failures, "Update: Graph optimization failed, invalid dense elimination, keeping old values.");
+  } catch (...) {
+    log(params_.fatal_failures, "Update: Graph optimization failed, keeping old values.");
+  }
+  return optimizer.iterations();
+}
+
+int GraphOptimizer::OptimizeIncrementally() {
+  // On failure the solver restarts from the whole window on the next update.  The priors
+  // on the oldest states then stand in for the marginals of states slid out before.
+  try {
+    incremental_optimizer_->Update(graph_, *values_);
+    return 1;
+  } catch (gtsam::IndeterminantLinearSystemException) {
+    log(params_.fatal_failures, "Update: Incremental optimization failed, indeterminant linear system, resetting.");
+  } catch (const std::exception& exception) {
+    log(params_.fatal_failures, "Update: Incremental optimization failed, resetting. " + std::string(exception.what()));
+  } catch (...) {
+    log(params_.fatal_failures, "Update: Incremental optimization failed, resetting.");
+  }
+  incremental_optimizer_->Reset();
+  return 0;
+}
+
 bool GraphOptimizer::Update() {
   LogDebug("Update: Updating.");
   graph_stats_->update_timer_.Start();
@@ -387,25 +473,10 @@ bool GraphOptimizer::Update() {
     return false;
   }
 
-  // Only get marginals and slide window if optimization has already occured
+  // Only slide window if optimization has already occured
   // TODO(rsoussan): Make cleaner way to check for this
   if (last_latest_time_) {
-    graph_stats_->marginals_timer_.Start();
-    // Calculate marginals for covariances
-    try {
-      marginals_ = gtsam::Marginals(graph_, *values_, marginals_factorization_);
-    } catch (gtsam::IndeterminantLinearSystemException) {
-      log(params_.fatal_failures, "Update: Indeterminant linear system error during computation of marginals.");
-      marginals_ = boost::none;
-    } catch (const std::exception& exception) {
-      log(params_.fatal_failures, "Update: Computing marginals failed. " + std::string(exception.what()));
-      marginals_ = boost::none;
-    } catch (...) {
-      log(params_.fatal_failures, "Update: Computing marginals failed.");
-      marginals_ = boost::none;
-    }
-    graph_stats_->marginals_timer_.Stop();
-
+    // Priors for the new oldest states use the marginals from the last optimization
     graph_stats_->slide_window_timer_.Start();
     if (!SlideWindow(marginals_, *last_latest_time_)) {
       LogError("Update: Failed to slide window.");
@@ -416,7 +487,7 @@ bool GraphOptimizer::Update() {
 
   // TODO(rsoussan): Is ordering required? if so clean these calls open and unify with marginalization
   // TODO(rsoussan): Remove this now that marginalization occurs before optimization?
-  if (params_.add_marginal_factors) {
+  if (params_.add_marginal_factors && !incremental_optimizer_) {
     // Add graph ordering to place keys that will be marginalized in first group
     const auto new_oldest_time = SlideWindowNewOldestTime();
     if (new_oldest_time) {
@@ -433,48 +504,19 @@ bool GraphOptimizer::Update() {
     return false;
   }
 
-  // Optimize
-  gtsam::LevenbergMarquardtOptimizer optimizer(graph_, *values_, levenberg_marquardt_params_);
-
   graph_stats_->optimization_timer_.Start();
-  // TODO(rsoussan): Indicate if failure occurs in state msg, perhaps using confidence value in msg
-  try {
-    *values_ = optimizer.optimize();
-  } catch (gtsam::IndeterminantLinearSystemException) {
-    log(params_.fatal_failures, "Update: Graph optimization failed, indeterminant linear system, keeping old values.");
-  } catch (gtsam::InvalidNoiseModel) {
-    log(params_.fatal_failures, "Update: Graph optimization failed, invalid noise model, keeping old values.");
-  } catch (gtsam::InvalidMatrixBlock) {
-    log(params_.fatal_failures, "Update: Graph optimization failed, invalid matrix block, keeping old values.");
-  } catch (gtsam::InvalidDenseElimination) {
-    log(params_.fatal_failures, "Update: Graph optimization failed, invalid dense elimination, keeping old values.");
-  } catch (...) {
-    log(params_.fatal_failures, "Update: Graph optimization failed, keeping old values.");
-  }
+  const int iterations = incremental_optimizer_ ? OptimizeIncrementally() : OptimizeBatch();
   graph_stats_->optimization_timer_.Stop();
 
-  // Calculate marginals after the first optimization iteration so covariances
-  // can be used for first loc msg
-  // TODO(rsoussan): Clean this up
-  if (!last_latest_time_) {
-    graph_stats_->marginals_timer_.Start();
-    // Calculate marginals for covariances
-    try {
-      marginals_ = gtsam::Marginals(graph_, *values_, marginals_factorization_);
-    } catch (gtsam::IndeterminantLinearSystemException) {
-      log(params_.fatal_failures, "Update: Indeterminant linear system error during computation of marginals.");
-      marginals_ = boost::none;
-    } catch (...) {
-      log(params_.fatal_failures, "Update: Computing marginals failed.");
-      marginals_ = boost::none;
-    }
-    graph_stats_->marginals_timer_.Stop();
-  }
+  // Covariances are only computed for keys requested before the next optimization, and
+  // the incremental optimizer keeps its own
+  if (!incremental_optimizer_)
+    marginals_ = SelectiveMarginals(graph_, *values_, marginals_factorization_, &graph_stats_->marginals_timer_);
 
   last_latest_time_ = LatestTimestamp();
 
   graph_stats_->log_stats_timer_.Start();
-  graph_stats_->iterations_averager_.Update(optimizer.iterations());
+  graph_stats_->iterations_averager_.Update(iterations);
   graph_stats_->UpdateStats(graph_);
   graph_stats_->log_stats_timer_.Stop();
   graph_stats_->log_error_timer_.Start();
@@ -23,6 +23,7 @@
 namespace graph_optimizer {
 GraphStats::GraphStats() {
   timers_.emplace_back(optimization_timer_);
+  timers_.emplace_back(linearization_timer_);
   timers_.emplace_back(update_timer_);
   timers_.emplace_back(marginals_timer_);
   timers_.emplace_back(slide_window_timer_);
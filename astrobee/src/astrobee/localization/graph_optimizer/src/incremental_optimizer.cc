@@ -0,0 +1,153 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/incremental_optimizer.h>
+#include <localization_common/logger.h>
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace graph_optimizer {
+namespace {
+// Adapted from gtsam::IncrementalFixedLagSmoother
+void MarkAffectedKeys(const gtsam::Key& key, const gtsam::ISAM2Clique::shared_ptr& clique,
+                      std::unordered_set<gtsam::Key>& affected_keys) {
+  const auto& conditional = clique->conditional();
+  if (std::find(conditional->beginParents(), conditional->endParents(), key) == conditional->endParents()) return;
+  for (const auto frontal_key : conditional->frontals()) affected_keys.emplace(frontal_key);
+  for (const auto& child : clique->children) MarkAffectedKeys(key, child, affected_keys);
+}
+}  // namespace
+
+IncrementalOptimizer::IncrementalOptimizer(const GraphOptimizerParams& params) {
+  isam2_params_.relinearizeThreshold = params.isam2_relinearize_threshold;
+  isam2_params_.relinearizeSkip = 1;
+  // Smart factors change their linearization with the values of their keys
+  isam2_params_.cacheLinearizedFactors = false;
+  isam2_params_.factorization =
+    params.marginals_factorization == "cholesky" ? gtsam::ISAM2Params::CHOLESKY : gtsam::ISAM2Params::QR;
+  isam2_ = gtsam::ISAM2(isam2_params_);
+}
+
+void IncrementalOptimizer::MarginalizeFactors(const gtsam::NonlinearFactorGraph& old_factors) {
+  for (const auto& factor : old_factors) {
+    if (factor) old_factors_.emplace(factor.get(), factor);
+  }
+}
+
+void IncrementalOptimizer::IgnoreFactors(const gtsam::NonlinearFactorGraph& factors) {
+  for (const auto& factor : factors) {
+    if (factor) ignored_factors_.emplace(factor.get(), factor);
+  }
+}
+
+// Keys in cliques below the old keys.  These need to be reeliminated for the old keys to
+// become leaves of the Bayes tree which can be marginalized.
+gtsam::FastList<gtsam::Key> IncrementalOptimizer::AffectedKeys(const gtsam::FastList<gtsam::Key>& old_keys) const {
+  std::unordered_set<gtsam::Key> affected_keys;
+  for (const auto& key : old_keys) {
+    for (const auto& child : isam2_[key]->children) MarkAffectedKeys(key, child, affected_keys);
+  }
+  return gtsam::FastList<gtsam::Key>(affected_keys.begin(), affected_keys.end());
+}
+
+void IncrementalOptimizer::Update(const gtsam::NonlinearFactorGraph& graph, gtsam::Values& values) {
+  std::unordered_set<const gtsam::NonlinearFactor*> graph_factors;
+  for (const auto& factor : graph) {
+    if (factor) graph_factors.emplace(factor.get());
+  }
+
+  // Remove factors that left the graph for reasons other than sliding the window
+  gtsam::FactorIndices remove_factor_indices;
+  for (auto factor_it = factor_indices_.begin(); factor_it != factor_indices_.end();) {
+    if (graph_factors.count(factor_it->first) > 0 || old_factors_.count(factor_it->first) > 0) {
+      ++factor_it;
+      continue;
+    }
+    remove_factor_indices.emplace_back(factor_it->second);
+    factor_it = factor_indices_.erase(factor_it);
+  }
+  for (auto factor_it = old_factors_.begin(); factor_it != old_factors_.end();) {
+    factor_it = factor_indices_.count(factor_it->first) > 0 ? std::next(factor_it) : old_factors_.erase(factor_it);
+  }
+  for (auto factor_it = ignored_factors_.begin(); factor_it != ignored_factors_.end();) {
+    factor_it = graph_factors.count(factor_it->first) > 0 ? std::next(factor_it) : ignored_factors_.erase(factor_it);
+  }
+
+  gtsam::NonlinearFactorGraph new_factors;
+  for (const auto& factor : graph) {
+    if (!factor || factor_indices_.count(factor.get()) > 0 || ignored_factors_.count(factor.get()) > 0) continue;
+    new_factors.push_back(factor);
+  }
+
+  gtsam::Values new_values;
+  for (const auto& key_value : values) {
+    if (!isam2_.valueExists(key_value.key)) new_values.insert(key_value.key, key_value.value);
+  }
+
+  // Eliminate the keys slid out of the window first so they are leaves that can be marginalized
+  gtsam::FastList<gtsam::Key> old_keys;
+  for (const auto& key : isam2_.getLinearizationPoint().keys()) {
+    if (!values.exists(key)) old_keys.emplace_back(key);
+  }
+  boost::optional<gtsam::FastMap<gtsam::Key, int>> constrained_keys;
+  boost::optional<gtsam::FastList<gtsam::Key>> affected_keys;
+  if (!old_keys.empty()) {
+    constrained_keys = gtsam::FastMap<gtsam::Key, int>();
+    for (const auto& key : values.keys()) (*constrained_keys)[key] = 1;
+    for (const auto& key : old_keys) (*constrained_keys)[key] = 0;
+    affected_keys = AffectedKeys(old_keys);
+  }
+
+  LogDebug("Update: Adding " << new_factors.size() << " factors, removing " << remove_factor_indices.size()
+                             << " factors and marginalizing " << old_keys.size() << " keys.");
+  const auto result =
+    isam2_.update(new_factors, new_values, remove_factor_indices, constrained_keys, boost::none, affected_keys);
+  for (size_t i = 0; i < new_factors.size(); ++i) factor_indices_[new_factors[i].get()] = result.newFactorsIndices[i];
+
+  if (!old_keys.empty()) {
+    gtsam::FactorIndices marginalized_factor_indices;
+    isam2_.marginalizeLeaves(old_keys, boost::none, marginalized_factor_indices);
+    const std::unordered_set<size_t> marginalized_indices(marginalized_factor_indices.begin(),
+                                                          marginalized_factor_indices.end());
+    for (auto factor_it = factor_indices_.begin(); factor_it != factor_indices_.end();) {
+      factor_it = marginalized_indices.count(factor_it->second) > 0 ? factor_indices_.erase(factor_it)
+                                                                    : std::next(factor_it);
+    }
+    old_factors_.clear();
+  }
+
+  const auto estimate = isam2_.calculateEstimate();
+  for (const auto& key : values.keys()) {
+    if (estimate.exists(key)) values.update(key, estimate.at(key));
+  }
+}
+
+boost::optional<gtsam::Matrix> IncrementalOptimizer::MarginalCovariance(const gtsam::Key& key) const {
+  if (!isam2_.valueExists(key)) return boost::none;
+  return isam2_.marginalCovariance(key);
+}
+
+void IncrementalOptimizer::Reset() {
+  isam2_ = gtsam::ISAM2(isam2_params_);
+  factor_indices_.clear();
+  old_factors_.clear();
+  ignored_factors_.clear();
+}
+}  // namespace graph_optimizer
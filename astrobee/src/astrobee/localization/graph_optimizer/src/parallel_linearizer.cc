@@ -0,0 +1,110 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/parallel_linearizer.h>
+
+#include <boost/make_shared.hpp>
+
+namespace graph_optimizer {
+ParallelLinearizer::ParallelLinearizer(const int num_threads) : next_factor_index_(0) {
+  for (int i = 1; i < num_threads; ++i) {
+    threads_.emplace_back(&ParallelLinearizer::Work, this);
+  }
+}
+
+ParallelLinearizer::~ParallelLinearizer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+gtsam::GaussianFactorGraph::shared_ptr ParallelLinearizer::Linearize(const gtsam::NonlinearFactorGraph& graph,
+                                                                     const gtsam::Values& values) {
+  std::lock_guard<std::mutex> linearize_lock(linearize_mutex_);
+  auto linearized_graph = boost::make_shared<gtsam::GaussianFactorGraph>();
+  // Null factors stay null so indices match the nonlinear graph
+  linearized_graph->resize(graph.size());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    graph_ = &graph;
+    values_ = &values;
+    linearized_graph_ = linearized_graph.get();
+    next_factor_index_ = 0;
+    exception_ = nullptr;
+    num_working_threads_ = threads_.size();
+    ++job_;
+  }
+  start_condition_.notify_all();
+  LinearizeFactors();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return num_working_threads_ == 0; });
+  }
+  if (exception_) std::rethrow_exception(exception_);
+  return linearized_graph;
+}
+
+void ParallelLinearizer::Work() {
+  uint64_t last_job = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_condition_.wait(lock, [this, last_job] { return stop_ || job_ != last_job; });
+      if (stop_) return;
+      last_job = job_;
+    }
+    LinearizeFactors();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--num_working_threads_ == 0) done_condition_.notify_one();
+    }
+  }
+}
+
+void ParallelLinearizer::LinearizeFactors() {
+  for (size_t i = next_factor_index_++; i < graph_->size(); i = next_factor_index_++) {
+    const auto& factor = graph_->at(i);
+    if (!factor) continue;
+    try {
+      (*linearized_graph_)[i] = factor->linearize(*values_);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!exception_) exception_ = std::current_exception();
+    }
+  }
+}
+
+ParallelLevenbergMarquardtOptimizer::ParallelLevenbergMarquardtOptimizer(const gtsam::NonlinearFactorGraph& graph,
+                                                                         const gtsam::Values& initial_values,
+                                                                         const gtsam::LevenbergMarquardtParams& params,
+                                                                         ParallelLinearizer& linearizer,
+                                                                         localization_common::Timer* timer)
+    : gtsam::LevenbergMarquardtOptimizer(graph, initial_values, params), linearizer_(linearizer), timer_(timer) {}
+
+gtsam::GaussianFactorGraph::shared_ptr ParallelLevenbergMarquardtOptimizer::linearize() const {
+  if (timer_) timer_->Start();
+  auto linearized_graph = linearizer_.Linearize(graph_, values());
+  if (timer_) timer_->Stop();
+  return linearized_graph;
+}
+}  // namespace graph_optimizer
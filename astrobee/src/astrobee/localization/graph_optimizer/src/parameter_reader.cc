@@ -30,6 +30,9 @@ void LoadGraphOptimizerParams(config_reader::ConfigReader& config, GraphOptimize
   params.use_ceres_params = mc::LoadBool(config, "use_ceres_params");
   params.max_iterations = mc::LoadInt(config, "max_iterations");
   params.marginals_factorization = mc::LoadString(config, "marginals_factorization");
+  params.optimizer = mc::LoadString(config, "optimizer");
+  params.isam2_relinearize_threshold = mc::LoadDouble(config, "isam2_relinearize_threshold");
+  params.num_linearization_threads = mc::LoadInt(config, "num_linearization_threads");
   params.add_marginal_factors = mc::LoadBool(config, "add_marginal_factors");
   params.huber_k = mc::LoadDouble(config, "huber_k");
   params.log_rate = mc::LoadInt(config, "log_rate");
@@ -0,0 +1,85 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/selective_marginals.h>
+#include <localization_common/logger.h>
+
+namespace graph_optimizer {
+SelectiveMarginals::SelectiveMarginals(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
+                                       const gtsam::Marginals::Factorization factorization,
+                                       localization_common::Timer* timer)
+    : graph_(graph), values_(values), factorization_(factorization), timer_(timer) {}
+
+boost::optional<std::vector<gtsam::Matrix>> SelectiveMarginals::MarginalCovariances(
+  const gtsam::KeyVector& keys) const {
+  gtsam::KeyVector uncached_keys;
+  for (const auto& key : keys) {
+    if (covariances_.count(key) == 0) uncached_keys.emplace_back(key);
+  }
+
+  if (!uncached_keys.empty()) {
+    if (timer_) timer_->Start();
+    const auto uncached_covariances = ComputeMarginalCovariances(uncached_keys);
+    if (timer_) timer_->Stop();
+    if (!uncached_covariances) return boost::none;
+    for (int i = 0; i < static_cast<int>(uncached_keys.size()); ++i)
+      covariances_.emplace(uncached_keys[i], (*uncached_covariances)[i]);
+  }
+
+  std::vector<gtsam::Matrix> covariances;
+  for (const auto& key : keys) covariances.emplace_back(covariances_.at(key));
+  return covariances;
+}
+
+boost::optional<gtsam::Matrix> SelectiveMarginals::MarginalCovariance(const gtsam::Key& key) const {
+  const auto covariances = MarginalCovariances(gtsam::KeyVector{key});
+  if (!covariances) return boost::none;
+  return covariances->front();
+}
+
+boost::optional<std::vector<gtsam::Matrix>> SelectiveMarginals::ComputeMarginalCovariances(
+  const gtsam::KeyVector& keys) const {
+  try {
+    gtsam::GaussianFactorGraph::Eliminate eliminate_function = gtsam::EliminateQR;
+    if (factorization_ == gtsam::Marginals::Factorization::CHOLESKY)
+      eliminate_function = gtsam::EliminatePreferCholesky;
+    if (!bayes_tree_) bayes_tree_ = graph_.linearize(values_)->eliminateMultifrontal(boost::none, eliminate_function);
+
+    std::vector<gtsam::Matrix> covariances;
+    for (const auto& key : keys) {
+      if (!bayes_tree_->nodes().exists(key)) {
+        LogError("ComputeMarginalCovariances: Key not present in graph.");
+        return boost::none;
+      }
+      const gtsam::Matrix information = bayes_tree_->marginalFactor(key, eliminate_function)->information();
+      const Eigen::LDLT<gtsam::Matrix> information_ldlt(information);
+      if (information_ldlt.info() != Eigen::Success || !information_ldlt.isPositive()) {
+        LogError("ComputeMarginalCovariances: Marginal information is not positive definite.");
+        return boost::none;
+      }
+      covariances.emplace_back(information_ldlt.solve(gtsam::Matrix::Identity(information.rows(), information.cols())));
+    }
+    return covariances;
+  } catch (const std::exception& exception) {
+    LogError("ComputeMarginalCovariances: Failed to compute marginals. " << exception.what());
+  } catch (...) {
+    LogError("ComputeMarginalCovariances: Failed to compute marginals.");
+  }
+  return boost::none;
+}
+}  // namespace graph_optimizer
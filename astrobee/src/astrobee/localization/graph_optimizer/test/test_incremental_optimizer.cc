@@ -0,0 +1,197 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/graph_optimizer_params.h>
+#include <graph_optimizer/incremental_optimizer.h>
+#include <localization_common/test_utilities.h>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace go = graph_optimizer;
+namespace lc = localization_common;
+namespace sym = gtsam::symbol_shorthand;
+
+class IncrementalOptimizerTest : public ::testing::Test {
+ protected:
+  IncrementalOptimizerTest() : generator_(0), noise_(0.0, 0.05) {
+    params_.marginals_factorization = "qr";
+    params_.optimizer = "isam2";
+    // Relinearize every key on each update so repeated updates converge like the batch optimizer
+    params_.isam2_relinearize_threshold = 0.0;
+  }
+
+  gtsam::Point3 NoisyPoint(const gtsam::Point3& point) {
+    return point + gtsam::Point3(noise_(generator_), noise_(generator_), noise_(generator_));
+  }
+
+  // Keeps the factors of the graph except those in the removed graph, compared by pointer
+  static gtsam::NonlinearFactorGraph Without(const gtsam::NonlinearFactorGraph& graph,
+                                            const gtsam::NonlinearFactorGraph& removed_factors) {
+    gtsam::NonlinearFactorGraph remaining_factors;
+    for (const auto& factor : graph) {
+      if (std::find(removed_factors.begin(), removed_factors.end(), factor) == removed_factors.end())
+        remaining_factors.push_back(factor);
+    }
+    return remaining_factors;
+  }
+
+  static gtsam::Values Optimize(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values) {
+    gtsam::LevenbergMarquardtParams params;
+    params.setRelativeErrorTol(1e-12);
+    params.setAbsoluteErrorTol(1e-12);
+    params.setMaxIterations(100);
+    return gtsam::LevenbergMarquardtOptimizer(graph, values, params).optimize();
+  }
+
+  go::GraphOptimizerParams params_;
+  std::mt19937 generator_;
+  std::normal_distribution<double> noise_;
+};
+
+// Slides a window over a chain of positions as the GraphOptimizer does: factors on the oldest position
+// are removed from the graph and marginalized, and a prior on the new oldest position is added to the
+// graph but ignored by iSAM2.  A factor added with each position is replaced by the next one.  The
+// problem is linear, so marginalization loses nothing and the window estimate has to match a batch
+// optimization of every factor ever kept.
+TEST_F(IncrementalOptimizerTest, SlidingWindowMatchesBatch) {
+  const int num_positions = 30;
+  const int window_size = 6;
+  const auto prior_noise = gtsam::noiseModel::Isotropic::Sigma(3, 0.1);
+  const auto odometry_noise = gtsam::noiseModel::Diagonal::Sigmas(gtsam::Vector3(0.05, 0.1, 0.2));
+  const auto skip_noise = gtsam::noiseModel::Isotropic::Sigma(3, 0.3);
+  go::IncrementalOptimizer optimizer(params_);
+
+  gtsam::NonlinearFactorGraph graph;
+  gtsam::NonlinearFactorGraph all_factors;
+  gtsam::Values values;
+  gtsam::Values all_values;
+  gtsam::NonlinearFactorGraph::sharedFactor skip_factor;
+  std::vector<gtsam::Point3> positions;
+  for (int i = 0; i < num_positions; ++i) {
+    positions.emplace_back(0.2 * i, std::sin(0.3 * i), 0.01 * i * i);
+    values.insert(sym::P(i), NoisyPoint(positions.back()));
+    all_values.insert(sym::P(i), values.at<gtsam::Point3>(sym::P(i)));
+    gtsam::NonlinearFactorGraph new_factors;
+    if (i == 0) {
+      new_factors.add(gtsam::PriorFactor<gtsam::Point3>(sym::P(0), NoisyPoint(positions[0]), prior_noise));
+    } else {
+      new_factors.add(gtsam::BetweenFactor<gtsam::Point3>(
+        sym::P(i - 1), sym::P(i), NoisyPoint(positions[i] - positions[i - 1]), odometry_noise));
+    }
+    if (skip_factor) {
+      gtsam::NonlinearFactorGraph replaced_factors;
+      replaced_factors.push_back(skip_factor);
+      graph = Without(graph, replaced_factors);
+      all_factors = Without(all_factors, replaced_factors);
+    }
+    if (i >= 2) {
+      skip_factor.reset(new gtsam::BetweenFactor<gtsam::Point3>(
+        sym::P(i - 2), sym::P(i), NoisyPoint(positions[i] - positions[i - 2]), skip_noise));
+      new_factors.push_back(skip_factor);
+    }
+    graph.push_back(new_factors);
+    all_factors.push_back(new_factors);
+
+    if (i >= window_size) {
+      const gtsam::Key old_key = sym::P(i - window_size);
+      const gtsam::Key new_oldest_key = sym::P(i - window_size + 1);
+      gtsam::NonlinearFactorGraph old_factors;
+      for (const auto& factor : graph) {
+        if (factor->find(old_key) != factor->end()) old_factors.push_back(factor);
+      }
+      graph = Without(graph, old_factors);
+      optimizer.MarginalizeFactors(old_factors);
+      values.erase(old_key);
+      gtsam::NonlinearFactorGraph prior_factors;
+      prior_factors.add(gtsam::PriorFactor<gtsam::Point3>(new_oldest_key, values.at<gtsam::Point3>(new_oldest_key),
+                                                          prior_noise));
+      graph.push_back(prior_factors);
+      optimizer.IgnoreFactors(prior_factors);
+    }
+
+    optimizer.Update(graph, values);
+    const auto expected_values = Optimize(all_factors, all_values);
+    for (const auto& key : values.keys()) {
+      EXPECT_TRUE(gtsam::assert_equal(expected_values.at<gtsam::Point3>(key), values.at<gtsam::Point3>(key), 1e-6))
+        << "Update " << i << ", " << gtsam::DefaultKeyFormatter(key);
+    }
+    const gtsam::Marginals expected_marginals(all_factors, expected_values);
+    const auto covariance = optimizer.MarginalCovariance(sym::P(i));
+    ASSERT_TRUE(covariance);
+    EXPECT_TRUE(gtsam::assert_equal(expected_marginals.marginalCovariance(sym::P(i)), *covariance, 1e-6))
+      << "Update " << i;
+  }
+  EXPECT_FALSE(optimizer.MarginalCovariance(sym::P(0)));
+}
+
+// Repeatedly updates a nonlinear pose graph whose factors change between updates without sliding the window.
+// With every key relinearized on each update, a few updates reach the batch Levenberg-Marquardt optimum.
+TEST_F(IncrementalOptimizerTest, ChangingFactorsMatchBatch) {
+  const int num_poses = 10;
+  const auto prior_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+  const auto odometry_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.05);
+  go::IncrementalOptimizer optimizer(params_);
+
+  std::vector<gtsam::Pose3> poses;
+  gtsam::NonlinearFactorGraph graph;
+  gtsam::Values values;
+  for (int i = 0; i < num_poses; ++i) {
+    poses.emplace_back(gtsam::Rot3::RzRyRx(0.1 * i, 0.2 * i, -0.1 * i), gtsam::Point3(0.5 * i, 0.2 * i, 0));
+    values.insert(sym::P(i), lc::AddNoiseToPose(poses.back(), 0.05, 0.05));
+  }
+  graph.add(gtsam::PriorFactor<gtsam::Pose3>(sym::P(0), poses[0], prior_noise));
+  for (int i = 1; i < num_poses; ++i) {
+    graph.add(gtsam::BetweenFactor<gtsam::Pose3>(sym::P(i - 1), sym::P(i),
+                                                 lc::AddNoiseToPose(poses[i - 1].between(poses[i]), 0.01, 0.01),
+                                                 odometry_noise));
+  }
+
+  for (int update = 0; update < 5; ++update) {
+    // Replace a loop closure with a different one
+    if (update > 0) graph.erase(graph.end() - 1);
+    const int first = update;
+    const int last = num_poses - 1 - update;
+    graph.add(gtsam::BetweenFactor<gtsam::Pose3>(sym::P(first), sym::P(last),
+                                                 lc::AddNoiseToPose(poses[first].between(poses[last]), 0.01, 0.01),
+                                                 odometry_noise));
+    const auto expected_values = Optimize(graph, values);
+    for (int i = 0; i < 10; ++i) optimizer.Update(graph, values);
+    for (const auto& key : values.keys()) {
+      EXPECT_TRUE(gtsam::assert_equal(expected_values.at<gtsam::Pose3>(key), values.at<gtsam::Pose3>(key), 1e-5))
+        << "Update " << update << ", " << gtsam::DefaultKeyFormatter(key);
+    }
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/parallel_linearizer.h>
+#include <localization_common/test_utilities.h>
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/PinholeCamera.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/slam/SmartProjectionPoseFactor.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace go = graph_optimizer;
+namespace lc = localization_common;
+namespace sym = gtsam::symbol_shorthand;
+
+// Throws when linearized
+class ThrowingFactor : public gtsam::NoiseModelFactor1<gtsam::Pose3> {
+ public:
+  ThrowingFactor(const gtsam::SharedNoiseModel& noise, const gtsam::Key key)
+      : gtsam::NoiseModelFactor1<gtsam::Pose3>(noise, key) {}
+
+  gtsam::Vector evaluateError(const gtsam::Pose3&, boost::optional<gtsam::Matrix&> = boost::none) const override {
+    throw std::runtime_error("ThrowingFactor linearized.");
+  }
+};
+
+class ParallelLinearizerTest : public ::testing::Test {
+ protected:
+  ParallelLinearizerTest() : linearizer_(4) {}
+
+  // Adds a pose chain with a prior, null slots between some of the factors and smart factors
+  // observing points from every pose, and noisy values for the poses
+  void MakeGraph(const int num_poses) {
+    graph_ = gtsam::NonlinearFactorGraph();
+    values_.clear();
+    const auto pose_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+    const auto pixel_noise = gtsam::noiseModel::Isotropic::Sigma(2, 1.0);
+    const boost::shared_ptr<gtsam::Cal3_S2> K(new gtsam::Cal3_S2(500, 500, 0, 320, 240));
+    std::vector<gtsam::Pose3> poses;
+    for (int i = 0; i < num_poses; ++i) {
+      // Cameras look along z, so points with positive z are in front of each of them
+      poses.emplace_back(gtsam::Rot3(), gtsam::Point3(0.1 * i, 0, 0));
+      values_.insert(sym::P(i), lc::AddNoiseToPose(poses.back(), 0.01, 0.01));
+    }
+    graph_.add(gtsam::PriorFactor<gtsam::Pose3>(sym::P(0), poses[0], pose_noise));
+    for (int i = 1; i < num_poses; ++i) {
+      graph_.add(gtsam::BetweenFactor<gtsam::Pose3>(sym::P(i - 1), sym::P(i), poses[i - 1].between(poses[i]),
+                                                    pose_noise));
+      if (i % 3 == 0) graph_.push_back(gtsam::NonlinearFactor::shared_ptr());
+    }
+    for (int j = 0; j < 5; ++j) {
+      const gtsam::Point3 point(0.2 * j - 0.4, 0.1 * j, 4.0 + j);
+      boost::shared_ptr<gtsam::SmartProjectionPoseFactor<gtsam::Cal3_S2>> smart_factor(
+        new gtsam::SmartProjectionPoseFactor<gtsam::Cal3_S2>(pixel_noise, K));
+      for (int i = 0; i < num_poses; ++i) {
+        smart_factor->add(gtsam::PinholeCamera<gtsam::Cal3_S2>(poses[i], *K).project(point), sym::P(i));
+      }
+      graph_.push_back(smart_factor);
+    }
+  }
+
+  // Compares against serial linearization, factor by factor
+  void ExpectSerialLinearization(const gtsam::GaussianFactorGraph& linearized_graph) {
+    const auto expected_linearized_graph = graph_.linearize(values_);
+    ASSERT_EQ(expected_linearized_graph->size(), linearized_graph.size());
+    for (size_t i = 0; i < linearized_graph.size(); ++i) {
+      const auto& expected_factor = expected_linearized_graph->at(i);
+      const auto& factor = linearized_graph.at(i);
+      if (!expected_factor) {
+        EXPECT_FALSE(factor) << "Factor " << i;
+        continue;
+      }
+      ASSERT_TRUE(factor) << "Factor " << i;
+      EXPECT_TRUE(factor->equals(*expected_factor, 1e-9)) << "Factor " << i;
+    }
+  }
+
+  go::ParallelLinearizer linearizer_;
+  gtsam::NonlinearFactorGraph graph_;
+  gtsam::Values values_;
+};
+
+TEST_F(ParallelLinearizerTest, MatchesSerialLinearization) {
+  MakeGraph(20);
+  ExpectSerialLinearization(*linearizer_.Linearize(graph_, values_));
+}
+
+TEST_F(ParallelLinearizerTest, SingleThread) {
+  MakeGraph(20);
+  go::ParallelLinearizer linearizer(1);
+  ExpectSerialLinearization(*linearizer.Linearize(graph_, values_));
+}
+
+TEST_F(ParallelLinearizerTest, RethrowsFactorException) {
+  MakeGraph(20);
+  const auto noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+  // Each factor must appear once, as factors may not be linearized concurrently with themselves
+  gtsam::NonlinearFactorGraph throwing_graph = graph_;
+  throwing_graph.add(ThrowingFactor(noise, sym::P(5)));
+  EXPECT_THROW(linearizer_.Linearize(throwing_graph, values_), std::runtime_error);
+  // The linearizer is still usable afterwards
+  ExpectSerialLinearization(*linearizer_.Linearize(graph_, values_));
+  EXPECT_THROW(linearizer_.Linearize(throwing_graph, values_), std::runtime_error);
+}
+
+TEST_F(ParallelLinearizerTest, RepeatedLinearization) {
+  for (int i = 0; i < 50; ++i) {
+    // Vary the graph size so threads sometimes outnumber factors
+    MakeGraph(2 + i % 20);
+    ExpectSerialLinearization(*linearizer_.Linearize(graph_, values_));
+    ExpectSerialLinearization(*linearizer_.Linearize(graph_, values_));
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <graph_optimizer/selective_marginals.h>
+#include <localization_common/test_utilities.h>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace go = graph_optimizer;
+namespace lc = localization_common;
+namespace sym = gtsam::symbol_shorthand;
+
+class SelectiveMarginalsTest : public ::testing::Test {
+ protected:
+  // Adds a pose chain with a prior on the first pose, points seen from each pose and a loop closure
+  // between the first and last poses, with noisy values
+  SelectiveMarginalsTest() {
+    const int num_poses = 10;
+    const auto prior_noise =
+      gtsam::noiseModel::Diagonal::Sigmas((gtsam::Vector(6) << 0.1, 0.2, 0.3, 1, 2, 3).finished());
+    const auto odometry_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+    const auto point_noise = gtsam::noiseModel::Isotropic::Sigma(3, 0.5);
+    std::vector<gtsam::Pose3> poses;
+    for (int i = 0; i < num_poses; ++i) {
+      poses.emplace_back(gtsam::Rot3::RzRyRx(0.1 * i, -0.05 * i, 0.2 * i), gtsam::Point3(0.5 * i, 0.1 * i, 0));
+      values_.insert(sym::P(i), lc::AddNoiseToPose(poses.back(), 0.05, 0.05));
+      keys_.emplace_back(sym::P(i));
+    }
+    graph_.add(gtsam::PriorFactor<gtsam::Pose3>(sym::P(0), poses[0], prior_noise));
+    for (int i = 1; i < num_poses; ++i) {
+      graph_.add(gtsam::BetweenFactor<gtsam::Pose3>(sym::P(i - 1), sym::P(i), poses[i - 1].between(poses[i]),
+                                                    odometry_noise));
+    }
+    graph_.add(gtsam::BetweenFactor<gtsam::Pose3>(sym::P(0), sym::P(num_poses - 1),
+                                                  poses[0].between(poses[num_poses - 1]), odometry_noise));
+    for (int j = 0; j < num_poses / 2; ++j) {
+      const gtsam::Point3 point(j, 1.0, 2.0);
+      values_.insert(sym::L(j), point + gtsam::Point3(0.1, -0.1, 0.05));
+      keys_.emplace_back(sym::L(j));
+      for (const int i : {2 * j, 2 * j + 1}) {
+        graph_.add(gtsam::BetweenFactor<gtsam::Point3>(sym::P(i), sym::L(j), poses[i].transformTo(point), point_noise));
+      }
+    }
+  }
+
+  // Compares against gtsam::Marginals computed with the same factorization, requesting the keys in groups
+  // of different sizes and orders to exercise the shared Bayes tree
+  void ExpectGtsamMarginals(const gtsam::Marginals::Factorization factorization) {
+    const gtsam::Marginals expected_marginals(graph_, values_, factorization);
+    const go::SelectiveMarginals marginals(graph_, values_, factorization);
+    const std::vector<gtsam::KeyVector> requests{
+      {sym::P(9), sym::P(0)}, {sym::L(2)}, {sym::P(3), sym::L(0), sym::P(4), sym::L(4)}, keys_};
+    for (const auto& request : requests) {
+      const auto covariances = marginals.MarginalCovariances(request);
+      ASSERT_TRUE(covariances);
+      ASSERT_EQ(request.size(), covariances->size());
+      for (size_t i = 0; i < request.size(); ++i) {
+        const gtsam::Matrix expected_covariance = expected_marginals.marginalCovariance(request[i]);
+        EXPECT_TRUE(gtsam::assert_equal(expected_covariance, (*covariances)[i], 1e-8))
+          << gtsam::DefaultKeyFormatter(request[i]);
+      }
+    }
+    for (const auto& key : keys_) {
+      const auto covariance = marginals.MarginalCovariance(key);
+      ASSERT_TRUE(covariance);
+      EXPECT_TRUE(gtsam::assert_equal(expected_marginals.marginalCovariance(key), *covariance, 1e-8))
+        << gtsam::DefaultKeyFormatter(key);
+    }
+  }
+
+  gtsam::NonlinearFactorGraph graph_;
+  gtsam::Values values_;
+  gtsam::KeyVector keys_;
+};
+
+TEST_F(SelectiveMarginalsTest, MatchesGtsamMarginalsQR) { ExpectGtsamMarginals(gtsam::Marginals::Factorization::QR); }
+
+TEST_F(SelectiveMarginalsTest, MatchesGtsamMarginalsCholesky) {
+  ExpectGtsamMarginals(gtsam::Marginals::Factorization::CHOLESKY);
+}
+
+TEST_F(SelectiveMarginalsTest, MissingKey) {
+  const go::SelectiveMarginals marginals(graph_, values_, gtsam::Marginals::Factorization::QR);
+  EXPECT_FALSE(marginals.MarginalCovariance(sym::V(0)));
+  EXPECT_FALSE(marginals.MarginalCovariances({sym::P(0), sym::V(0)}));
+  // Keys present in the graph are still available afterwards
+  EXPECT_TRUE(marginals.MarginalCovariances({sym::P(0), sym::L(1)}));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -20,9 +20,12 @@
 #define IMU_AUGMENTOR_IMU_AUGMENTOR_H_
 
 #include <imu_augmentor/imu_augmentor_params.h>
+#include <imu_augmentor/incremental_preintegration.h>
 #include <imu_integration/imu_integrator.h>
 #include <localization_common/combined_nav_state.h>
 
+#include <boost/optional.hpp>
+
 #include <string>
 
 namespace imu_augmentor {
@@ -30,8 +33,26 @@ class ImuAugmentor : public imu_integration::ImuIntegrator {
  public:
   explicit ImuAugmentor(const ImuAugmentorParams& params);
 
+  // Predicts latest_imu_augmented_combined_nav_state forward to the latest imu measurement using the biases of
+  // latest_combined_nav_state.
+  // Measurements are integrated once, when they are first used. If latest_imu_augmented_combined_nav_state is the
+  // previous prediction only the new measurements are added, otherwise the delta since its timestamp is taken from the
+  // already integrated measurements, corrected to first order for the new biases.
   void PimPredict(const localization_common::CombinedNavState& latest_combined_nav_state,
                   localization_common::CombinedNavState& latest_imu_augmented_combined_nav_state);
+
+ private:
+  bool ContinuesPrediction(const localization_common::CombinedNavState& imu_augmented_combined_nav_state,
+                           const gtsam::imuBias::ConstantBias& bias) const;
+
+  void StartPrediction(const localization_common::CombinedNavState& start_combined_nav_state);
+
+  gtsam::Vector3 gravity_;
+  IncrementalPreintegration preintegration_;
+  // State predictions start from and the delta from it to the start of the latest preintegration segment
+  boost::optional<localization_common::CombinedNavState> start_combined_nav_state_;
+  PreintegratedDelta start_to_segment_delta_;
+  boost::optional<localization_common::CombinedNavState> latest_prediction_;
 };
 }  // namespace imu_augmentor
 
@@ -0,0 +1,134 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef IMU_AUGMENTOR_INCREMENTAL_PREINTEGRATION_H_
+#define IMU_AUGMENTOR_INCREMENTAL_PREINTEGRATION_H_
+
+#include <localization_common/combined_nav_state.h>
+#include <localization_common/time.h>
+#include <localization_common/time_series.h>
+#include <localization_measurements/imu_measurement.h>
+
+#include <gtsam/geometry/Rot3.h>
+#include <gtsam/navigation/CombinedImuFactor.h>
+#include <gtsam/navigation/ImuBias.h>
+
+#include <boost/optional.hpp>
+
+#include <deque>
+
+namespace imu_augmentor {
+// Motion preintegrated over an interval, in the body frame at the start of the interval and without gravity.
+struct PreintegratedDelta {
+  PreintegratedDelta();
+  // From the [rotation, position, velocity] tangent vector used by gtsam's preintegration
+  PreintegratedDelta(const gtsam::Vector9& delta, const double dt);
+
+  gtsam::Rot3 rotation;
+  gtsam::Vector3 position;
+  gtsam::Vector3 velocity;
+  double dt;
+};
+
+// Delta over the interval of a followed by the interval of b.
+PreintegratedDelta Compose(const PreintegratedDelta& a, const PreintegratedDelta& b);
+
+// Delta from the end of a to the end of b, for deltas starting at the same time.
+PreintegratedDelta Between(const PreintegratedDelta& a, const PreintegratedDelta& b);
+
+// Predicts the state at the end of delta, equivalent to gtsam's PreintegrationBase::predict.
+localization_common::CombinedNavState Predict(const localization_common::CombinedNavState& combined_nav_state,
+                                              const PreintegratedDelta& delta, const gtsam::Vector3& gravity);
+
+// Running preintegration of an imu stream, so that the delta between any two times it covers can be computed
+// without integrating the measurements again.
+// Measurements are integrated into segments, each with the bias it was started with. Each integrated
+// measurement stores the segment's delta up to it and the delta's jacobian wrt the bias, so deltas for
+// another bias are corrected to first order. A new segment is started when the bias changes.
+class IncrementalPreintegration {
+ public:
+  explicit IncrementalPreintegration(
+    const boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params>& params);
+
+  // Removes all segments and starts a new one at start_time.
+  void Reset(const gtsam::imuBias::ConstantBias& bias, const localization_common::Time start_time);
+
+  // Starts a new segment at the latest integrated time if bias differs from the latest segment's bias.
+  void SetBias(const gtsam::imuBias::ConstantBias& bias);
+
+  // Integrates a measurement newer than LatestTime() into the latest segment.
+  void Integrate(const localization_measurements::ImuMeasurement& measurement);
+
+  // Delta from start_time to the start of the latest segment using bias, which covers a negative interval if
+  // start_time is in the latest segment. The measurement following start_time is integrated again from start_time, the
+  // others are reused. Returns none if start_time is not in [StartTime(), LatestTime()].
+  boost::optional<PreintegratedDelta> DeltaToSegmentStart(const localization_common::Time start_time,
+                                                          const gtsam::imuBias::ConstantBias& bias) const;
+
+  // Delta of the latest segment from its start to LatestTime().
+  PreintegratedDelta SegmentDelta() const;
+
+  // Removes segments and integrated measurements not needed for deltas to times >= oldest_allowed_time.
+  void RemoveOldMeasurements(const localization_common::Time oldest_allowed_time);
+
+  bool Empty() const;
+
+  localization_common::Time StartTime() const;
+
+  localization_common::Time SegmentStartTime() const;
+
+  localization_common::Time LatestTime() const;
+
+ private:
+  struct Snapshot {
+    Snapshot(const gtsam::Vector9& delta, const Eigen::Matrix<double, 9, 6>& d_delta_d_bias,
+             const localization_measurements::ImuMeasurement& measurement)
+        : delta(delta), d_delta_d_bias(d_delta_d_bias), measurement(measurement) {}
+    // Delta from the segment start
+    gtsam::Vector9 delta;
+    Eigen::Matrix<double, 9, 6> d_delta_d_bias;
+    // Measurement integrated since the previous snapshot
+    localization_measurements::ImuMeasurement measurement;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  struct Segment {
+    gtsam::imuBias::ConstantBias bias;
+    localization_common::Time start_time;
+    localization_common::TimeSeries<Snapshot> snapshots;
+  };
+
+  // Delta from the segment start to the snapshot using bias
+  PreintegratedDelta Delta(const Segment& segment,
+                           const localization_common::TimeSeries<Snapshot>::value_type& snapshot,
+                           const gtsam::imuBias::ConstantBias& bias) const;
+
+  // Delta from the start of the oldest segment to an integrated measurement or segment start time using bias
+  PreintegratedDelta DeltaFromStart(const localization_common::Time timestamp,
+                                    const gtsam::imuBias::ConstantBias& bias) const;
+
+  void StartSegment(const gtsam::imuBias::ConstantBias& bias, const localization_common::Time start_time);
+
+  boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params> params_;
+  std::deque<Segment> segments_;
+  // Preintegration of the latest segment
+  gtsam::PreintegratedCombinedMeasurements pim_;
+};
+}  // namespace imu_augmentor
+
+#endif  // IMU_AUGMENTOR_INCREMENTAL_PREINTEGRATION_H_
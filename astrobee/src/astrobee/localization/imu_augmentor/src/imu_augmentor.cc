@@ -20,36 +20,68 @@
 #include <imu_integration/utilities.h>
 #include <localization_common/logger.h>
 
+#include <algorithm>
+
 namespace imu_augmentor {
 namespace ii = imu_integration;
 namespace lc = localization_common;
 namespace lm = localization_measurements;
-ImuAugmentor::ImuAugmentor(const ImuAugmentorParams& params) : ii::ImuIntegrator(params) {}
+ImuAugmentor::ImuAugmentor(const ImuAugmentorParams& params)
+    : ii::ImuIntegrator(params), gravity_(params.gravity), preintegration_(pim_params()) {}
 
 void ImuAugmentor::PimPredict(const lc::CombinedNavState& latest_combined_nav_state,
                               lc::CombinedNavState& latest_imu_augmented_combined_nav_state) {
   if (Empty()) return;
-  // Start with least upper bound measurement
-  // Don't add measurements with same timestamp as start_time
-  // since these would have a dt of 0 (wrt the pim start time) and cause errors for the pim
-  auto measurement_it = measurements().upper_bound(latest_imu_augmented_combined_nav_state.timestamp());
-  if (measurement_it == measurements().cend()) return;
   // Always use the biases from the lastest combined nav state
-  auto pim = ii::Pim(latest_combined_nav_state.bias(), pim_params());
+  const auto& bias = latest_combined_nav_state.bias();
+  if (!ContinuesPrediction(latest_imu_augmented_combined_nav_state, bias)) {
+    StartPrediction(lc::CombinedNavState(latest_imu_augmented_combined_nav_state.nav_state(), bias,
+                                         latest_imu_augmented_combined_nav_state.timestamp()));
+  }
+
+  // Don't add measurements with same timestamp as the latest integrated one
+  // since these would have a dt of 0 and cause errors for the pim
   int num_measurements_added = 0;
-  // Create new pim each time since pim uses beginning orientation and velocity for
-  // gravity integration and initial velocity integration.
-  for (; measurement_it != measurements().cend(); ++measurement_it) {
-    pim.resetIntegrationAndSetBias(latest_combined_nav_state.bias());
-    auto time = latest_imu_augmented_combined_nav_state.timestamp();
-    ii::AddMeasurement(measurement_it->second, time, pim);
-    latest_imu_augmented_combined_nav_state = ii::PimPredict(latest_imu_augmented_combined_nav_state, pim);
+  for (auto measurement_it = measurements().upper_bound(preintegration_.LatestTime());
+       measurement_it != measurements().cend(); ++measurement_it) {
+    preintegration_.Integrate(measurement_it->second);
     ++num_measurements_added;
   }
+  if (preintegration_.LatestTime() <= start_combined_nav_state_->timestamp()) return;
+
+  latest_imu_augmented_combined_nav_state =
+    Predict(*start_combined_nav_state_, Compose(start_to_segment_delta_, preintegration_.SegmentDelta()), gravity_);
+  latest_prediction_ = latest_imu_augmented_combined_nav_state;
 
   // Only remove measurements up to latest combined nav state so that when a new nav state is received IMU data is still
   // available for extrapolation
-  RemoveOldMeasurements(latest_combined_nav_state.timestamp());
+  const lc::Time oldest_allowed_time =
+    std::min(latest_combined_nav_state.timestamp(), start_combined_nav_state_->timestamp());
+  RemoveOldMeasurements(oldest_allowed_time);
+  preintegration_.RemoveOldMeasurements(oldest_allowed_time);
   LogDebug("PimPredict: Added " << num_measurements_added << " measurements.");
 }
+
+bool ImuAugmentor::ContinuesPrediction(const lc::CombinedNavState& imu_augmented_combined_nav_state,
+                                       const gtsam::imuBias::ConstantBias& bias) const {
+  return latest_prediction_ && start_combined_nav_state_->bias().equals(bias, 0) &&
+         imu_augmented_combined_nav_state.timestamp() == latest_prediction_->timestamp() &&
+         imu_augmented_combined_nav_state.nav_state().equals(latest_prediction_->nav_state(), 0);
+}
+
+void ImuAugmentor::StartPrediction(const lc::CombinedNavState& start_combined_nav_state) {
+  start_combined_nav_state_ = start_combined_nav_state;
+  latest_prediction_ = boost::none;
+  const auto& bias = start_combined_nav_state.bias();
+  const lc::Time start_time = start_combined_nav_state.timestamp();
+  preintegration_.SetBias(bias);
+  const auto start_to_segment_delta = preintegration_.DeltaToSegmentStart(start_time, bias);
+  if (!start_to_segment_delta) {
+    // Measurements after the start time are integrated from scratch
+    preintegration_.Reset(bias, start_time);
+    start_to_segment_delta_ = PreintegratedDelta();
+    return;
+  }
+  start_to_segment_delta_ = *start_to_segment_delta;
+}
 }  // namespace imu_augmentor
@@ -0,0 +1,182 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <imu_augmentor/incremental_preintegration.h>
+#include <imu_integration/utilities.h>
+#include <localization_common/logger.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace imu_augmentor {
+namespace ii = imu_integration;
+namespace lc = localization_common;
+namespace lm = localization_measurements;
+
+PreintegratedDelta::PreintegratedDelta()
+    : position(gtsam::Vector3::Zero()), velocity(gtsam::Vector3::Zero()), dt(0) {}
+
+PreintegratedDelta::PreintegratedDelta(const gtsam::Vector9& delta, const double dt)
+    : rotation(gtsam::Rot3::Expmap(delta.head<3>())),
+      position(delta.segment<3>(3)),
+      velocity(delta.tail<3>()),
+      dt(dt) {}
+
+PreintegratedDelta Compose(const PreintegratedDelta& a, const PreintegratedDelta& b) {
+  PreintegratedDelta composed;
+  composed.rotation = a.rotation * b.rotation;
+  composed.position = a.position + a.velocity * b.dt + a.rotation.rotate(b.position);
+  composed.velocity = a.velocity + a.rotation.rotate(b.velocity);
+  composed.dt = a.dt + b.dt;
+  return composed;
+}
+
+PreintegratedDelta Between(const PreintegratedDelta& a, const PreintegratedDelta& b) {
+  PreintegratedDelta between;
+  between.dt = b.dt - a.dt;
+  between.rotation = a.rotation.inverse() * b.rotation;
+  between.position = a.rotation.unrotate(b.position - a.position - a.velocity * between.dt);
+  between.velocity = a.rotation.unrotate(b.velocity - a.velocity);
+  return between;
+}
+
+lc::CombinedNavState Predict(const lc::CombinedNavState& combined_nav_state, const PreintegratedDelta& delta,
+                             const gtsam::Vector3& gravity) {
+  const gtsam::Rot3& world_R_body = combined_nav_state.nav_state().attitude();
+  const gtsam::Vector3& velocity = combined_nav_state.velocity();
+  const double dt = delta.dt;
+  const gtsam::Rot3 predicted_rotation = world_R_body * delta.rotation;
+  const gtsam::Vector3 predicted_position = combined_nav_state.nav_state().position() + velocity * dt +
+                                            0.5 * gravity * dt * dt + world_R_body.rotate(delta.position);
+  const gtsam::Vector3 predicted_velocity = velocity + gravity * dt + world_R_body.rotate(delta.velocity);
+  return lc::CombinedNavState(gtsam::NavState(predicted_rotation, predicted_position, predicted_velocity),
+                              combined_nav_state.bias(), combined_nav_state.timestamp() + dt);
+}
+
+IncrementalPreintegration::IncrementalPreintegration(
+  const boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params>& params)
+    : params_(params), pim_(params) {}
+
+void IncrementalPreintegration::Reset(const gtsam::imuBias::ConstantBias& bias, const lc::Time start_time) {
+  segments_.clear();
+  StartSegment(bias, start_time);
+}
+
+void IncrementalPreintegration::SetBias(const gtsam::imuBias::ConstantBias& bias) {
+  if (Empty() || segments_.back().bias.equals(bias, 0)) return;
+  StartSegment(bias, LatestTime());
+}
+
+void IncrementalPreintegration::StartSegment(const gtsam::imuBias::ConstantBias& bias, const lc::Time start_time) {
+  pim_.resetIntegrationAndSetBias(bias);
+  segments_.emplace_back();
+  auto& segment = segments_.back();
+  segment.bias = bias;
+  segment.start_time = start_time;
+  segment.snapshots.emplace(start_time, Snapshot(gtsam::Vector9::Zero(), Eigen::Matrix<double, 9, 6>::Zero(),
+                                                 lm::ImuMeasurement(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(),
+                                                                    start_time)));
+}
+
+void IncrementalPreintegration::Integrate(const lm::ImuMeasurement& measurement) {
+  if (Empty()) {
+    LogError("Integrate: No segment started.");
+    return;
+  }
+  if (measurement.timestamp <= LatestTime()) {
+    LogError("Integrate: Measurement not newer than latest integrated measurement.");
+    return;
+  }
+  auto& segment = segments_.back();
+  lc::Time latest_time = LatestTime();
+  ii::AddMeasurement(measurement, latest_time, pim_);
+  Eigen::Matrix<double, 9, 6> d_delta_d_bias;
+  const gtsam::Vector9 delta = pim_.biasCorrectedDelta(segment.bias, d_delta_d_bias);
+  segment.snapshots.emplace(measurement.timestamp, Snapshot(delta, d_delta_d_bias, measurement));
+}
+
+PreintegratedDelta IncrementalPreintegration::Delta(const Segment& segment,
+                                                    const lc::TimeSeries<Snapshot>::value_type& snapshot,
+                                                    const gtsam::imuBias::ConstantBias& bias) const {
+  const gtsam::Vector6 bias_difference = bias.vector() - segment.bias.vector();
+  return PreintegratedDelta(snapshot.second.delta + snapshot.second.d_delta_d_bias * bias_difference,
+                            snapshot.first - segment.start_time);
+}
+
+PreintegratedDelta IncrementalPreintegration::DeltaFromStart(const lc::Time timestamp,
+                                                             const gtsam::imuBias::ConstantBias& bias) const {
+  PreintegratedDelta delta;
+  for (const auto& segment : segments_) {
+    if (timestamp == segment.start_time) return delta;
+    const auto& snapshots = segment.snapshots;
+    if (timestamp > snapshots.back().first) {
+      delta = Compose(delta, Delta(segment, snapshots.back(), bias));
+      continue;
+    }
+    const auto snapshot_it = snapshots.find(timestamp);
+    if (snapshot_it == snapshots.cend()) break;
+    return Compose(delta, Delta(segment, *snapshot_it, bias));
+  }
+  LogError("DeltaFromStart: No integrated measurement at timestamp.");
+  return delta;
+}
+
+boost::optional<PreintegratedDelta> IncrementalPreintegration::DeltaToSegmentStart(
+  const lc::Time start_time, const gtsam::imuBias::ConstantBias& bias) const {
+  if (Empty() || start_time < StartTime() || start_time > LatestTime()) return boost::none;
+  const auto segment_it = std::find_if(segments_.cbegin(), segments_.cend(), [start_time](const Segment& segment) {
+    return segment.snapshots.back().first >= start_time;
+  });
+  // Integrated measurement at or following start_time
+  const auto snapshot_it = segment_it->snapshots.lower_bound(start_time);
+  PreintegratedDelta delta;
+  if (snapshot_it->first != start_time) {
+    auto pim = ii::Pim(bias, params_);
+    lc::Time time = start_time;
+    ii::AddMeasurement(snapshot_it->second.measurement, time, pim);
+    delta = PreintegratedDelta(pim.biasCorrectedDelta(bias), pim.deltaTij());
+  }
+  return Compose(delta, Between(DeltaFromStart(snapshot_it->first, bias), DeltaFromStart(SegmentStartTime(), bias)));
+}
+
+PreintegratedDelta IncrementalPreintegration::SegmentDelta() const {
+  if (Empty()) return PreintegratedDelta();
+  const auto& segment = segments_.back();
+  return Delta(segment, segment.snapshots.back(), segment.bias);
+}
+
+void IncrementalPreintegration::RemoveOldMeasurements(const lc::Time oldest_allowed_time) {
+  while (segments_.size() > 1 && segments_[1].start_time <= oldest_allowed_time) {
+    segments_.pop_front();
+  }
+  if (Empty()) return;
+  // Keep the latest snapshot at or before oldest_allowed_time, deltas are relative to the segment start
+  auto& snapshots = segments_.front().snapshots;
+  const auto next_snapshot_it = snapshots.upper_bound(oldest_allowed_time);
+  if (next_snapshot_it == snapshots.cbegin()) return;
+  snapshots.erase(snapshots.cbegin(), std::prev(next_snapshot_it));
+}
+
+bool IncrementalPreintegration::Empty() const { return segments_.empty(); }
+
+lc::Time IncrementalPreintegration::StartTime() const { return segments_.front().snapshots.front().first; }
+
+lc::Time IncrementalPreintegration::SegmentStartTime() const { return segments_.back().start_time; }
+
+lc::Time IncrementalPreintegration::LatestTime() const { return segments_.back().snapshots.back().first; }
+}  // namespace imu_augmentor
@@ -196,6 +196,87 @@ TEST_F(ConstantAngularVelocityTest, AddAllMeasurementsWithAccelBias) {
   EXPECT_MATRIX_NEAR(imu_augmented_state.pose().rotation(), gtsam::Rot3::identity(), 1e-6);
 }
 
+class ConstantMeasurementsTest : public ::testing::Test {
+ public:
+  ConstantMeasurementsTest()
+      : acceleration_(0.1, -0.2, 0.3),
+        angular_velocity_(0.3, 0.2, -0.1),
+        time_increment_(1.0 / 62.5),
+        num_measurements_(40) {
+    params_ = ia::DefaultImuAugmentorParams();
+    params_.gravity = gtsam::Vector3(0, 0, -9.81);
+  }
+
+  // Augmentor with all measurements up to and including end_time buffered
+  std::unique_ptr<ia::ImuAugmentor> ImuAugmentor(const lc::Time end_time) const {
+    std::unique_ptr<ia::ImuAugmentor> imu_augmentor(new ia::ImuAugmentor(params_));
+    for (const auto& imu_measurement : ia::ConstantMeasurements(acceleration_, angular_velocity_, num_measurements_,
+                                                                time_increment_, time_increment_)) {
+      if (imu_measurement.timestamp <= end_time) imu_augmentor->BufferImuMeasurement(imu_measurement);
+    }
+    return imu_augmentor;
+  }
+
+  double time_increment() const { return time_increment_; }
+
+  double end_time() const { return num_measurements_ * time_increment_; }
+
+ private:
+  ia::ImuAugmentorParams params_;
+  const Eigen::Vector3d acceleration_;
+  const Eigen::Vector3d angular_velocity_;
+  const double time_increment_;
+  const int num_measurements_;
+};
+
+TEST_F(ConstantMeasurementsTest, IncrementalPrediction) {
+  const lc::CombinedNavState initial_state(gtsam::Pose3::identity(), gtsam::Velocity3(0.1, 0, 0),
+                                           gtsam::imuBias::ConstantBias(), 0);
+  auto imu_augmentor = ImuAugmentor(end_time());
+  lc::CombinedNavState imu_augmented_state = initial_state;
+  imu_augmentor->PimPredict(initial_state, imu_augmented_state);
+
+  // Buffer and add measurements one at a time
+  auto incremental_imu_augmentor = ImuAugmentor(time_increment());
+  lc::CombinedNavState incremental_imu_augmented_state = initial_state;
+  incremental_imu_augmentor->PimPredict(initial_state, incremental_imu_augmented_state);
+  auto remaining_imu_augmentor = ImuAugmentor(end_time());
+  for (const auto& imu_measurement : remaining_imu_augmentor->measurements()) {
+    if (imu_measurement.first <= time_increment()) continue;
+    incremental_imu_augmentor->BufferImuMeasurement(imu_measurement.second);
+    incremental_imu_augmentor->PimPredict(initial_state, incremental_imu_augmented_state);
+  }
+
+  EXPECT_NEAR(incremental_imu_augmented_state.timestamp(), end_time(), 1e-6);
+  EXPECT_MATRIX_NEAR(incremental_imu_augmented_state.pose(), imu_augmented_state.pose(), 1e-6);
+  EXPECT_MATRIX_NEAR(incremental_imu_augmented_state.velocity(), imu_augmented_state.velocity(), 1e-6);
+}
+
+TEST_F(ConstantMeasurementsTest, NewStateAndBias) {
+  const lc::CombinedNavState initial_state(gtsam::Pose3::identity(), gtsam::Velocity3::Zero(),
+                                           gtsam::imuBias::ConstantBias(), 0);
+  auto imu_augmentor = ImuAugmentor(end_time());
+  lc::CombinedNavState imu_augmented_state = initial_state;
+  imu_augmentor->PimPredict(initial_state, imu_augmented_state);
+
+  // New state between measurements with a different bias, predicted with already integrated measurements
+  const gtsam::imuBias::ConstantBias bias(gtsam::Vector3(0.001, 0.002, -0.001), gtsam::Vector3(-0.001, 0.0005, 0.001));
+  const lc::CombinedNavState new_state(
+    gtsam::Pose3(gtsam::Rot3::Expmap(gtsam::Vector3(0.1, 0.2, 0.3)), gtsam::Point3(1, 2, 3)),
+    gtsam::Velocity3(0.1, 0.2, -0.1), bias, 10.5 * time_increment());
+  imu_augmented_state = new_state;
+  imu_augmentor->PimPredict(new_state, imu_augmented_state);
+
+  // Integrate measurements after the new state from scratch
+  auto reintegrating_imu_augmentor = ImuAugmentor(end_time());
+  lc::CombinedNavState reintegrated_state = new_state;
+  reintegrating_imu_augmentor->PimPredict(new_state, reintegrated_state);
+
+  EXPECT_NEAR(imu_augmented_state.timestamp(), end_time(), 1e-6);
+  EXPECT_MATRIX_NEAR(imu_augmented_state.pose(), reintegrated_state.pose(), 1e-6);
+  EXPECT_MATRIX_NEAR(imu_augmented_state.velocity(), reintegrated_state.velocity(), 1e-6);
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,185 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Replays a simulated imu stream through the imu augmentor while graph localizer states arrive with varying
+// latency, and compares the per measurement cost and the predictions with re-integrating all measurements since
+// the latest localizer state, as the augmentor used to.
+
+#include <imu_augmentor/imu_augmentor.h>
+#include <imu_integration/imu_integrator.h>
+#include <imu_integration/utilities.h>
+#include <localization_common/combined_nav_state.h>
+#include <localization_measurements/imu_measurement.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace ia = imu_augmentor;
+namespace ii = imu_integration;
+namespace lc = localization_common;
+namespace lm = localization_measurements;
+
+namespace {
+constexpr double kImuRate = 62.5;
+constexpr double kLocStatePeriod = 0.2;
+
+ia::ImuAugmentorParams Params() {
+  ia::ImuAugmentorParams params;
+  params.gravity = gtsam::Vector3::Zero();
+  params.body_T_imu = gtsam::Pose3::identity();
+  params.filter = ii::ImuFilterParams();
+  params.gyro_sigma = 0.1;
+  params.accel_sigma = 0.1;
+  params.accel_bias_sigma = 0.1;
+  params.gyro_bias_sigma = 0.1;
+  params.integration_variance = 0.1;
+  params.bias_acc_omega_int = 0.1;
+  params.standstill_enabled = false;
+  return params;
+}
+
+// Re-integrates every measurement since the latest augmented state, one measurement at a time
+class ReintegratingAugmentor : public ii::ImuIntegrator {
+ public:
+  explicit ReintegratingAugmentor(const ia::ImuAugmentorParams& params) : ii::ImuIntegrator(params) {}
+
+  void PimPredict(const lc::CombinedNavState& latest_combined_nav_state,
+                  lc::CombinedNavState& latest_imu_augmented_combined_nav_state) {
+    if (Empty()) return;
+    auto measurement_it = measurements().upper_bound(latest_imu_augmented_combined_nav_state.timestamp());
+    if (measurement_it == measurements().cend()) return;
+    auto pim = ii::Pim(latest_combined_nav_state.bias(), pim_params());
+    for (; measurement_it != measurements().cend(); ++measurement_it) {
+      pim.resetIntegrationAndSetBias(latest_combined_nav_state.bias());
+      auto time = latest_imu_augmented_combined_nav_state.timestamp();
+      ii::AddMeasurement(measurement_it->second, time, pim);
+      latest_imu_augmented_combined_nav_state = ii::PimPredict(latest_imu_augmented_combined_nav_state, pim);
+    }
+    RemoveOldMeasurements(latest_combined_nav_state.timestamp());
+  }
+};
+
+struct Stats {
+  std::vector<double> times;
+  double Mean() const {
+    double sum = 0;
+    for (const double time : times) sum += time;
+    return times.empty() ? 0 : sum / times.size();
+  }
+  double Percentile(const double p) const {
+    if (times.empty()) return 0;
+    std::vector<double> sorted_times = times;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    return sorted_times[std::min<size_t>(p * sorted_times.size(), sorted_times.size() - 1)];
+  }
+};
+
+template <typename Augmentor>
+void TimedPimPredict(const lc::CombinedNavState& loc_state, lc::CombinedNavState& augmented_state,
+                     Augmentor& augmentor, Stats& stats) {
+  const auto start = std::chrono::steady_clock::now();
+  augmentor.PimPredict(loc_state, augmented_state);
+  const auto end = std::chrono::steady_clock::now();
+  stats.times.emplace_back(std::chrono::duration<double, std::micro>(end - start).count());
+}
+
+// Smooth free flyer motion, measured with a constant bias
+lm::ImuMeasurement Measurement(const lc::Time time, const gtsam::imuBias::ConstantBias& bias) {
+  const Eigen::Vector3d acceleration(0.05 * std::sin(time), 0.03 * std::cos(0.7 * time), 0.02 * std::sin(1.3 * time));
+  const Eigen::Vector3d angular_velocity(0.1 * std::sin(0.5 * time), 0.05, 0.1 * std::cos(0.3 * time));
+  return lm::ImuMeasurement(acceleration + bias.accelerometer(), angular_velocity + bias.gyroscope(), time);
+}
+
+void Run(const double latency, const double duration) {
+  const auto params = Params();
+  ia::ImuAugmentor augmentor(params);
+  ReintegratingAugmentor reintegrating_augmentor(params);
+  // Ground truth states, integrated with the true bias
+  ii::ImuIntegrator truth_integrator(params);
+
+  const gtsam::imuBias::ConstantBias true_bias(gtsam::Vector3(0.01, -0.02, 0.015),
+                                               gtsam::Vector3(0.002, 0.001, -0.003));
+  const lc::CombinedNavState start_state(gtsam::Pose3::identity(), gtsam::Velocity3::Zero(), true_bias, 0);
+  std::mt19937 generator(0);
+  std::normal_distribution<double> bias_noise(0, 1e-3);
+
+  Stats stats, reintegrating_stats;
+  double max_position_difference = 0;
+  double max_rotation_difference = 0;
+  boost::optional<lc::CombinedNavState> loc_state;
+  lc::CombinedNavState augmented_state, reintegrated_state;
+  lc::Time next_loc_state_time = latency + kLocStatePeriod;
+  int num_loc_states = 0;
+  const int num_measurements = duration * kImuRate;
+  for (int i = 1; i <= num_measurements; ++i) {
+    const lc::Time time = i / kImuRate;
+    const auto measurement = Measurement(time, true_bias);
+    augmentor.BufferImuMeasurement(measurement);
+    reintegrating_augmentor.BufferImuMeasurement(measurement);
+    truth_integrator.BufferImuMeasurement(measurement);
+
+    if (time >= next_loc_state_time) {
+      // Localizer state from latency ago, with a slightly wrong bias estimate
+      const lc::Time loc_state_time = next_loc_state_time - latency;
+      auto pim = truth_integrator.IntegratedPim(true_bias, start_state.timestamp(), loc_state_time,
+                                                truth_integrator.pim_params());
+      const auto truth = pim ? ii::PimPredict(start_state, *pim) : start_state;
+      const gtsam::imuBias::ConstantBias estimated_bias(
+        true_bias.accelerometer() + gtsam::Vector3(bias_noise(generator), bias_noise(generator), bias_noise(generator)),
+        true_bias.gyroscope() +
+          0.1 * gtsam::Vector3(bias_noise(generator), bias_noise(generator), bias_noise(generator)));
+      loc_state = lc::CombinedNavState(truth.nav_state(), estimated_bias, loc_state_time);
+      augmented_state = *loc_state;
+      reintegrated_state = *loc_state;
+      next_loc_state_time += kLocStatePeriod;
+      ++num_loc_states;
+    }
+    // Both augmentors integrate from scratch for the first localizer state
+    if (num_loc_states < 2) continue;
+
+    TimedPimPredict(*loc_state, augmented_state, augmentor, stats);
+    TimedPimPredict(*loc_state, reintegrated_state, reintegrating_augmentor, reintegrating_stats);
+    max_position_difference = std::max(
+      max_position_difference, (augmented_state.pose().translation() - reintegrated_state.pose().translation()).norm());
+    max_rotation_difference =
+      std::max(max_rotation_difference,
+               gtsam::Rot3::Logmap(augmented_state.pose().rotation().inverse() * reintegrated_state.pose().rotation())
+                 .norm());
+  }
+
+  std::printf("%7.2f %10.2f %10.2f %10.2f %10.2f %12.2e %12.2e\n", latency, stats.Mean(), stats.Percentile(0.99),
+              reintegrating_stats.Mean(), reintegrating_stats.Percentile(0.99), max_position_difference,
+              max_rotation_difference);
+}
+}  // namespace
+
+// Usage: benchmark_imu_augmentor [duration in seconds]
+int main(int argc, char** argv) {
+  const double duration = argc > 1 ? std::atof(argv[1]) : 60;
+  std::printf("%7s %10s %10s %10s %10s %12s %12s\n", "latency", "mean us", "p99 us", "reint mean", "reint p99",
+              "pos diff m", "rot diff rad");
+  for (const double latency : {0.1, 0.25, 0.5, 1.0, 2.0}) {
+    Run(latency, duration);
+  }
+  return 0;
+}
@@ -24,14 +24,13 @@
 
 #include <localization_common/combined_nav_state.h>
 #include <localization_common/time.h>
+#include <localization_common/time_series.h>
 #include <localization_measurements/fan_speed_mode.h>
 #include <localization_measurements/imu_measurement.h>
 
 #include <gtsam/navigation/CombinedImuFactor.h>
 #include <gtsam/navigation/ImuBias.h>
 
-#include <map>
-
 namespace imu_integration {
 // Integrates imu measurements and propagates uncertainties.
 // Maintains a window of measurements so that any interval of measurements in
@@ -75,12 +74,12 @@ class ImuIntegrator {
 
   bool WithinBounds(const localization_common::Time timestamp);
 
-  const std::map<localization_common::Time, localization_measurements::ImuMeasurement>& measurements() const;
+  const localization_common::TimeSeries<localization_measurements::ImuMeasurement>& measurements() const;
 
  private:
   ImuIntegratorParams params_;
   boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params> pim_params_;
-  std::map<localization_common::Time, localization_measurements::ImuMeasurement> measurements_;
+  localization_common::TimeSeries<localization_measurements::ImuMeasurement> measurements_;
   std::unique_ptr<DynamicImuFilter> imu_filter_;
 };
 }  // namespace imu_integration
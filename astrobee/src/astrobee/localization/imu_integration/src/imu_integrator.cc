@@ -183,7 +183,7 @@ bool ImuIntegrator::WithinBounds(const localization_common::Time timestamp) {
   return (timestamp >= *oldest_time && timestamp <= *latest_time);
 }
 
-const std::map<localization_common::Time, localization_measurements::ImuMeasurement>& ImuIntegrator::measurements()
+const localization_common::TimeSeries<localization_measurements::ImuMeasurement>& ImuIntegrator::measurements()
   const {
   return measurements_;
 }
@@ -0,0 +1,48 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef INTEREST_POINT_HAMMING_H_
+#define INTEREST_POINT_HAMMING_H_
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cv {
+  class DMatch;
+}
+
+namespace interest_point {
+
+  // Number of differing bits between two binary descriptors of the
+  // given length in bytes. Uses AVX-512 or AVX2 if the library was
+  // compiled for them, and 64-bit popcount otherwise.
+  int HammingDistance(const uint8_t* a, const uint8_t* b, int num_bytes);
+
+  // Exact brute force matching of binary (CV_8U) descriptors. A match
+  // is kept only if each descriptor is the other's nearest neighbor
+  // (cross check). Ties are broken in favor of the lower index, so the
+  // result is deterministic. The distances are traversed in blocks
+  // which fit in the cache.
+  void BruteForceHammingMatch(const cv::Mat & query_descriptor_map,
+                              const cv::Mat & train_descriptor_map,
+                              std::vector<cv::DMatch> * matches);
+
+}  // namespace interest_point
+
+#endif  // INTEREST_POINT_HAMMING_H_
@@ -91,6 +91,21 @@ namespace interest_point {
   void FindMatches(const cv::Mat & img1_descriptor_map,
                    const cv::Mat & img2_descriptor_map,
                    std::vector<cv::DMatch> * matches);
+
+  /**
+   * Build once the search index over a fixed set of descriptors, such
+   * as those of a map keyframe, so that it can be queried many times
+   * with the FindMatches() overload below without being rebuilt.
+   **/
+  cv::Ptr<cv::DescriptorMatcher> BuildMatcher(const cv::Mat & descriptor_map);
+
+  /**
+   * Same as above, but the second set of descriptors is the one indexed
+   * by a matcher created with BuildMatcher().
+   **/
+  void FindMatches(const cv::Mat & img1_descriptor_map,
+                   cv::Ptr<cv::DescriptorMatcher> const& img2_matcher,
+                   std::vector<cv::DMatch> * matches);
 }  // namespace interest_point
 
 #endif  // INTEREST_POINT_MATCHING_H_
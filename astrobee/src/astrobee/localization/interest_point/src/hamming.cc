@@ -0,0 +1,144 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <interest_point/hamming.h>
+
+#include <opencv2/features2d/features2d.hpp>
+#include <glog/logging.h>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace interest_point {
+
+  // Descriptors per block. A block of train descriptors of the usual
+  // 64 bytes is then 16 KB, which stays in L1 while the query block
+  // is compared against it.
+  static const int kQueryBlock = 32;
+  static const int kTrainBlock = 256;
+
+  int HammingDistance(const uint8_t* a, const uint8_t* b, int num_bytes) {
+    int dist = 0;
+    int i = 0;
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    __m512i acc512 = _mm512_setzero_si512();
+    for (; i + 64 <= num_bytes; i += 64) {
+      __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+      acc512 = _mm512_add_epi64(acc512, _mm512_popcnt_epi64(x));
+    }
+    dist += static_cast<int>(_mm512_reduce_add_epi64(acc512));
+#endif
+
+#if defined(__AVX2__)
+    // Per-nibble popcount with a lookup table, then horizontal sums
+    // of the bytes with sad.
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i acc256 = _mm256_setzero_si256();
+    for (; i + 32 <= num_bytes; i += 32) {
+      __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+      __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_mask));
+      __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask));
+      acc256 = _mm256_add_epi64(acc256, _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+                                                        _mm256_setzero_si256()));
+    }
+    dist += static_cast<int>(_mm256_extract_epi64(acc256, 0) + _mm256_extract_epi64(acc256, 1) +
+                             _mm256_extract_epi64(acc256, 2) + _mm256_extract_epi64(acc256, 3));
+#endif
+
+    // Portable path, and the tail of the vectorized ones. With -mpopcnt
+    // the builtin is a single instruction.
+    for (; i + 8 <= num_bytes; i += 8) {
+      uint64_t x, y;
+      std::memcpy(&x, a + i, sizeof(x));
+      std::memcpy(&y, b + i, sizeof(y));
+      dist += __builtin_popcountll(x ^ y);
+    }
+    for (; i < num_bytes; i++)
+      dist += __builtin_popcount(static_cast<unsigned int>(a[i] ^ b[i]));
+
+    return dist;
+  }
+
+  void BruteForceHammingMatch(const cv::Mat & query_descriptor_map,
+                              const cv::Mat & train_descriptor_map,
+                              std::vector<cv::DMatch> * matches) {
+    CHECK(query_descriptor_map.depth() == CV_8U &&
+          train_descriptor_map.depth() == CV_8U)
+      << "Hamming matching needs binary descriptors.";
+    CHECK(query_descriptor_map.cols == train_descriptor_map.cols)
+      << "Binary descriptors of different lengths.";
+
+    matches->clear();
+    int num_query = query_descriptor_map.rows;
+    int num_train = train_descriptor_map.rows;
+    int num_bytes = query_descriptor_map.cols * query_descriptor_map.elemSize();
+    if (num_query == 0 || num_train == 0)
+      return;
+
+    // Best distance and index in each direction
+    const int kNone = std::numeric_limits<int>::max();
+    std::vector<int> query_best_dist(num_query, kNone), query_best_idx(num_query, -1);
+    std::vector<int> train_best_dist(num_train, kNone), train_best_idx(num_train, -1);
+
+    // Traversing the indices in increasing order and updating only on
+    // strictly smaller distances keeps the lowest index among ties.
+    for (int q0 = 0; q0 < num_query; q0 += kQueryBlock) {
+      int q1 = std::min(q0 + kQueryBlock, num_query);
+      for (int t0 = 0; t0 < num_train; t0 += kTrainBlock) {
+        int t1 = std::min(t0 + kTrainBlock, num_train);
+        for (int q = q0; q < q1; q++) {
+          const uint8_t* query = query_descriptor_map.ptr<uint8_t>(q);
+          int best_dist = query_best_dist[q], best_idx = query_best_idx[q];
+          for (int t = t0; t < t1; t++) {
+            int dist = HammingDistance(query, train_descriptor_map.ptr<uint8_t>(t), num_bytes);
+            if (dist < best_dist) {
+              best_dist = dist;
+              best_idx = t;
+            }
+            if (dist < train_best_dist[t]) {
+              train_best_dist[t] = dist;
+              train_best_idx[t] = q;
+            }
+          }
+          query_best_dist[q] = best_dist;
+          query_best_idx[q] = best_idx;
+        }
+      }
+    }
+
+    // Cross check
+    matches->reserve(num_query);
+    for (int q = 0; q < num_query; q++) {
+      int t = query_best_idx[q];
+      if (train_best_idx[t] != q)
+        continue;
+      matches->push_back(cv::DMatch(q, t, static_cast<float>(query_best_dist[q])));
+    }
+  }
+
+}  // namespace interest_point
@@ -18,6 +18,7 @@
 
 #include <interest_point/matching.h>
 #include <interest_point/brisk.h>
+#include <interest_point/hamming.h>
 #include <opencv2/xfeatures2d.hpp>
 
 #include <Eigen/Core>
@@ -33,6 +34,8 @@
 // map file, for the localize executable to read them from there.
 DEFINE_int32(hamming_distance, 90,
              "A smaller value keeps fewer but more reliable binary descriptor matches.");
+DEFINE_bool(hamming_brute_force, false,
+            "Match binary descriptors exactly with cross-checked brute force instead of FLANN LSH.");
 DEFINE_double(goodness_ratio, 0.8,
               "A smaller value keeps fewer but more reliable float descriptor matches.");
 DEFINE_int32(orgbrisk_octaves, 4,
@@ -256,6 +259,40 @@ namespace interest_point {
     }
   }
 
+  // Select only inlier matches that meet a BRISK threshold of
+  // of FLAGS_hamming_distance.
+  // TODO(oalexan1) This needs further study.
+  static void FilterHammingMatches(std::vector<cv::DMatch> * matches) {
+    std::vector<cv::DMatch> inlier_matches;
+    inlier_matches.reserve(matches->size());  // This saves time in allocation
+    for (cv::DMatch const& dmatch : *matches) {
+      if (dmatch.distance < FLAGS_hamming_distance) {
+        inlier_matches.push_back(dmatch);
+      }
+    }
+    matches->swap(inlier_matches);  // Doesn't invoke a copy of all elements.
+  }
+
+  cv::Ptr<cv::DescriptorMatcher> BuildMatcher(const cv::Mat & descriptor_map) {
+    cv::Ptr<cv::DescriptorMatcher> matcher;
+    if (descriptor_map.depth() == CV_8U && FLAGS_hamming_brute_force)
+      // Binary descriptor, only held here for BruteForceHammingMatch()
+      matcher = cv::makePtr<cv::BFMatcher>(cv::NORM_HAMMING);
+    else if (descriptor_map.depth() == CV_8U)
+      // Binary descriptor
+      matcher = cv::makePtr<cv::FlannBasedMatcher>(cv::makePtr<cv::flann::LshIndexParams>(3, 18, 2));
+    else
+      // Traditional floating point descriptor
+      matcher = cv::makePtr<cv::FlannBasedMatcher>();
+
+    // Build the index now rather than on the first query
+    if (descriptor_map.rows > 0) {
+      matcher->add(std::vector<cv::Mat>(1, descriptor_map));
+      matcher->train();
+    }
+    return matcher;
+  }
+
   void FindMatches(const cv::Mat & img1_descriptor_map,
                    const cv::Mat & img2_descriptor_map, std::vector<cv::DMatch> * matches) {
     CHECK(img1_descriptor_map.depth() ==
@@ -268,29 +305,43 @@ namespace interest_point {
         img2_descriptor_map.rows == 0)
       return;
 
+    // No index to build for exact matching
+    if (img1_descriptor_map.depth() == CV_8U && FLAGS_hamming_brute_force) {
+      BruteForceHammingMatch(img1_descriptor_map, img2_descriptor_map, matches);
+      FilterHammingMatches(matches);
+      return;
+    }
+
+    FindMatches(img1_descriptor_map, BuildMatcher(img2_descriptor_map), matches);
+  }
+
+  void FindMatches(const cv::Mat & img1_descriptor_map,
+                   cv::Ptr<cv::DescriptorMatcher> const& img2_matcher,
+                   std::vector<cv::DMatch> * matches) {
+    // Check for early exit conditions
+    matches->clear();
+    std::vector<cv::Mat> const& img2_descriptor_maps = img2_matcher->getTrainDescriptors();
+    if (img1_descriptor_map.rows == 0 ||
+        img2_descriptor_maps.empty() ||
+        img2_descriptor_maps[0].rows == 0)
+      return;
+
+    CHECK(img1_descriptor_map.depth() ==
+          img2_descriptor_maps[0].depth())
+      << "Mixed descriptor types. Did you mash BRISK with SIFT/SURF?";
+
     if (img1_descriptor_map.depth() == CV_8U) {
       // Binary descriptor
 
-      // cv::BFMatcher matcher(cv::NORM_HAMMING, true  /* Forward & Backward matching */);
-      cv::FlannBasedMatcher matcher(cv::makePtr<cv::flann::LshIndexParams>(3, 18, 2));
-      matcher.match(img1_descriptor_map, img2_descriptor_map, *matches);
-
-      // Select only inlier matches that meet a BRISK threshold of
-      // of FLAGS_hamming_distance.
-      // TODO(oalexan1) This needs further study.
-      std::vector<cv::DMatch> inlier_matches;
-      inlier_matches.reserve(matches->size());  // This saves time in allocation
-      for (cv::DMatch const& dmatch : *matches) {
-        if (dmatch.distance < FLAGS_hamming_distance) {
-          inlier_matches.push_back(dmatch);
-        }
-      }
-      matches->swap(inlier_matches);  // Doesn't invoke a copy of all elements.
+      if (FLAGS_hamming_brute_force)
+        BruteForceHammingMatch(img1_descriptor_map, img2_descriptor_maps[0], matches);
+      else
+        img2_matcher->match(img1_descriptor_map, *matches);
+      FilterHammingMatches(matches);
     } else {
       // Traditional floating point descriptor
-      cv::FlannBasedMatcher matcher;
       std::vector<std::vector<cv::DMatch> > possible_matches;
-      matcher.knnMatch(img1_descriptor_map, img2_descriptor_map, possible_matches, 2);
+      img2_matcher->knnMatch(img1_descriptor_map, possible_matches, 2);
       matches->clear();
       matches->reserve(possible_matches.size());
       for (std::vector<cv::DMatch> const& best_pair : possible_matches) {
@@ -16,6 +16,7 @@
  * under the License.
  */
 
+#include <interest_point/hamming.h>
 #include <interest_point/matching.h>
 
 #include <Eigen/Geometry>
@@ -74,6 +75,43 @@ TEST_F(MatchingTest, ORGBRISK) {
   EXPECT_LT(50u, matches.size());
 }
 
+TEST_F(MatchingTest, PrebuiltMatcher) {
+  DetectKeyPoints("SURF");
+  cv::Ptr<cv::DescriptorMatcher> matcher = interest_point::BuildMatcher(descriptor2);
+  // The index is reused across queries
+  for (int it = 0; it < 2; it++) {
+    interest_point::FindMatches(descriptor1, matcher, &matches);
+    EXPECT_NEAR(matches.size(), 798u, 10);
+  }
+  // An empty index gives no matches
+  interest_point::FindMatches(descriptor1, interest_point::BuildMatcher(cv::Mat()), &matches);
+  EXPECT_EQ(0u, matches.size());
+}
+
+TEST_F(MatchingTest, BruteForceHamming) {
+  DetectKeyPoints("ORGBRISK");
+  interest_point::BruteForceHammingMatch(descriptor1, descriptor2, &matches);
+  EXPECT_LT(50u, matches.size());
+
+  // Same as the OpenCV cross-checked matcher, up to ties
+  std::vector<cv::DMatch> cv_matches;
+  cv::BFMatcher matcher(cv::NORM_HAMMING, true);
+  matcher.match(descriptor1, descriptor2, cv_matches);
+  EXPECT_NEAR(matches.size(), cv_matches.size(), 5);
+  for (cv::DMatch const& m : matches)
+    EXPECT_EQ(m.distance, cv::norm(descriptor1.row(m.queryIdx), descriptor2.row(m.trainIdx),
+                                   cv::NORM_HAMMING));
+
+  // Deterministic
+  std::vector<cv::DMatch> matches2;
+  interest_point::BruteForceHammingMatch(descriptor1, descriptor2, &matches2);
+  ASSERT_EQ(matches.size(), matches2.size());
+  for (size_t i = 0; i < matches.size(); i++) {
+    EXPECT_EQ(matches[i].queryIdx, matches2[i].queryIdx);
+    EXPECT_EQ(matches[i].trainIdx, matches2[i].trainIdx);
+  }
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
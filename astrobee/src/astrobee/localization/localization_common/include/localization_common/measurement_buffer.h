@@ -20,10 +20,11 @@
 #define LOCALIZATION_COMMON_MEASUREMENT_BUFFER_H_
 
 #include <localization_common/time.h>
+#include <localization_common/time_series.h>
 
 #include <boost/optional.hpp>
 
-#include <map>
+#include <iterator>
 
 namespace localization_common {
 template <typename MeasurementType>
@@ -82,7 +83,7 @@ class MeasurementBuffer {
     measurements_.erase(measurements_.begin(), measurement_it);
   }
 
-  const std::map<Time, MeasurementType>& measurements() const { return measurements_; }
+  const TimeSeries<MeasurementType>& measurements() const { return measurements_; }
 
   size_t size() const { return measurements_.size(); }
 
@@ -91,7 +92,7 @@ class MeasurementBuffer {
                         const double tolerance) {
     return std::abs(time_a - time_b) <= tolerance;
   }
-  std::map<Time, MeasurementType> measurements_;
+  TimeSeries<MeasurementType> measurements_;
 };
 }  // namespace localization_common
 #endif  // LOCALIZATION_COMMON_MEASUREMENT_BUFFER_H_
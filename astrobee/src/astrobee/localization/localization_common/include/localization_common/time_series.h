@@ -0,0 +1,144 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef LOCALIZATION_COMMON_TIME_SERIES_H_
+#define LOCALIZATION_COMMON_TIME_SERIES_H_
+
+#include <localization_common/time.h>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace localization_common {
+// Timestamp sorted sequence of values with unique timestamps and a subset of the std::map<Time, T> interface.
+// Values are stored contiguously, so lookups are binary searches without pointer chasing and appending a
+// value newer than the latest one does not allocate once the buffer has grown to its working size.
+// Removing values from the front only advances the start of the buffer, the removed slots are reclaimed
+// in one move once they outnumber the stored values, so erasing old values is amortized O(1) per value.
+// Inserting or erasing values elsewhere shifts the newer values.
+// Iterators are invalidated by any insertion or erasure.
+template <typename T>
+class TimeSeries {
+ public:
+  using value_type = std::pair<Time, T>;
+  using Buffer = std::vector<value_type, Eigen::aligned_allocator<value_type>>;
+  using iterator = typename Buffer::iterator;
+  using const_iterator = typename Buffer::const_iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // Returns false and leaves the series unchanged if the timestamp is already present.
+  bool emplace(const Time timestamp, const T& value) {
+    if (empty() || timestamp > buffer_.back().first) {
+      buffer_.emplace_back(timestamp, value);
+      return true;
+    }
+    const auto it = lower_bound(timestamp);
+    if (it->first == timestamp) return false;
+    buffer_.emplace(it, timestamp, value);
+    return true;
+  }
+
+  size_t erase(const Time timestamp) {
+    const auto it = find(timestamp);
+    if (it == end()) return 0;
+    erase(it, std::next(it));
+    return 1;
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first != cbegin()) return buffer_.erase(first, last);
+    const auto num_erased = std::distance(first, last);
+    start_ += num_erased;
+    if (empty()) {
+      clear();
+    } else if (start_ >= size()) {
+      buffer_.erase(buffer_.begin(), buffer_.begin() + start_);
+      start_ = 0;
+    }
+    return begin();
+  }
+
+  void clear() {
+    buffer_.clear();
+    start_ = 0;
+  }
+
+  void reserve(const size_t size) { buffer_.reserve(start_ + size); }
+
+  iterator find(const Time timestamp) {
+    const auto it = lower_bound(timestamp);
+    return (it != end() && it->first == timestamp) ? it : end();
+  }
+
+  const_iterator find(const Time timestamp) const {
+    const auto it = lower_bound(timestamp);
+    return (it != cend() && it->first == timestamp) ? it : cend();
+  }
+
+  size_t count(const Time timestamp) const { return find(timestamp) != cend() ? 1 : 0; }
+
+  // First value with timestamp >= query
+  iterator lower_bound(const Time timestamp) { return std::lower_bound(begin(), end(), timestamp, ValueBefore); }
+
+  const_iterator lower_bound(const Time timestamp) const {
+    return std::lower_bound(cbegin(), cend(), timestamp, ValueBefore);
+  }
+
+  // First value with timestamp > query
+  iterator upper_bound(const Time timestamp) { return std::upper_bound(begin(), end(), timestamp, ValueAfter); }
+
+  const_iterator upper_bound(const Time timestamp) const {
+    return std::upper_bound(cbegin(), cend(), timestamp, ValueAfter);
+  }
+
+  iterator begin() { return buffer_.begin() + start_; }
+  iterator end() { return buffer_.end(); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cbegin() const { return buffer_.cbegin() + start_; }
+  const_iterator cend() const { return buffer_.cend(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return crbegin(); }
+  const_reverse_iterator rend() const { return crend(); }
+  const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+  const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+
+  const value_type& front() const { return *cbegin(); }
+  const value_type& back() const { return buffer_.back(); }
+
+  size_t size() const { return buffer_.size() - start_; }
+  bool empty() const { return size() == 0; }
+
+ private:
+  static bool ValueBefore(const value_type& value, const Time timestamp) { return value.first < timestamp; }
+  static bool ValueAfter(const Time timestamp, const value_type& value) { return timestamp < value.first; }
+
+  Buffer buffer_;
+  // Index of the oldest value in buffer_, slots before it have been erased
+  size_t start_ = 0;
+};
+}  // namespace localization_common
+
+#endif  // LOCALIZATION_COMMON_TIME_SERIES_H_
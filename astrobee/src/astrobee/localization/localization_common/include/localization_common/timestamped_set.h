@@ -21,11 +21,15 @@
 
 #include <localization_common/logger.h>
 #include <localization_common/time.h>
+#include <localization_common/time_series.h>
 
 #include <boost/optional.hpp>
+#include <boost/serialization/map.hpp>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/unordered_map.hpp>
 
+#include <iterator>
 #include <map>
 #include <utility>
 #include <vector>
@@ -34,7 +38,7 @@ namespace localization_common {
 template <typename T>
 struct TimestampedValue {
   TimestampedValue(const Time timestamp, const T& value) : timestamp(timestamp), value(value) {}
-  explicit TimestampedValue(const std::pair<const Time, T>& pair) : timestamp(pair.first), value(pair.second) {}
+  explicit TimestampedValue(const std::pair<Time, T>& pair) : timestamp(pair.first), value(pair.second) {}
   Time timestamp;
   T value;
 };
@@ -81,10 +85,14 @@ class TimestampedSet {
 
  private:
   friend class boost::serialization::access;
+  // Serialized as a std::map so archives are independent of the in memory layout
   template <class ARCHIVE>
-  void serialize(ARCHIVE& ar, const unsigned int /*version*/);
+  void save(ARCHIVE& ar, const unsigned int /*version*/) const;
+  template <class ARCHIVE>
+  void load(ARCHIVE& ar, const unsigned int /*version*/);
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
 
-  std::map<Time, T> timestamp_value_map_;
+  TimeSeries<T> timestamp_values_;
 };
 
 // Implementation
@@ -93,6 +101,7 @@ TimestampedSet<T>::TimestampedSet() {}
 
 template <typename T>
 TimestampedSet<T>::TimestampedSet(const std::vector<Time>& timestamps, const std::vector<T>& values) {
+  timestamp_values_.reserve(values.size());
   for (int i = 0; i < values.size(); ++i) {
     Add(timestamps[i], values[i]);
   }
@@ -100,32 +109,29 @@ TimestampedSet<T>::TimestampedSet(const std::vector<Time>& timestamps, const std
 
 template <typename T>
 bool TimestampedSet<T>::Add(const Time timestamp, const T& value) {
-  if (Contains(timestamp)) return false;
-  timestamp_value_map_.emplace(timestamp, value);
-  return true;
+  return timestamp_values_.emplace(timestamp, value);
 }
 
 template <typename T>
 bool TimestampedSet<T>::Remove(const Time timestamp) {
-  if (!Contains(timestamp)) return false;
-  timestamp_value_map_.erase(timestamp);
-  return true;
+  return timestamp_values_.erase(timestamp) > 0;
 }
 
 template <typename T>
 boost::optional<TimestampedValue<T>> TimestampedSet<T>::Get(const Time timestamp) const {
-  if (!Contains(timestamp)) return boost::none;
-  return TimestampedValue<T>(timestamp, timestamp_value_map_.at(timestamp));
+  const auto it = timestamp_values_.find(timestamp);
+  if (it == timestamp_values_.cend()) return boost::none;
+  return TimestampedValue<T>(*it);
 }
 
 template <typename T>
 size_t TimestampedSet<T>::size() const {
-  return timestamp_value_map_.size();
+  return timestamp_values_.size();
 }
 
 template <typename T>
 bool TimestampedSet<T>::empty() const {
-  return timestamp_value_map_.empty();
+  return timestamp_values_.empty();
 }
 
 template <typename T>
@@ -134,7 +140,7 @@ boost::optional<TimestampedValue<T>> TimestampedSet<T>::Oldest() const {
     LogDebug("Oldest: No timestamps available.");
     return boost::none;
   }
-  return TimestampedValue<T>(*timestamp_value_map_.cbegin());
+  return TimestampedValue<T>(*timestamp_values_.cbegin());
 }
 
 template <typename T>
@@ -143,7 +149,7 @@ boost::optional<TimestampedValue<T>> TimestampedSet<T>::Latest() const {
     LogDebug("Latest: No values available.");
     return boost::none;
   }
-  return TimestampedValue<T>(*timestamp_value_map_.crbegin());
+  return TimestampedValue<T>(*timestamp_values_.crbegin());
 }
 
 template <typename T>
@@ -155,11 +161,11 @@ TimestampedSet<T>::LowerAndUpperBound(const Time timestamp) const {
   }
 
   // lower bound returns first it >= query, call this upper bound
-  const auto upper_bound_it = timestamp_value_map_.lower_bound(timestamp);
-  if (upper_bound_it == timestamp_value_map_.cend()) {
+  const auto upper_bound_it = timestamp_values_.lower_bound(timestamp);
+  if (upper_bound_it == timestamp_values_.cend()) {
     LogDebug("LowerAndUpperBoundTimestamps: No upper bound timestamp exists.");
-    return {boost::optional<TimestampedValue<T>>(*(timestamp_value_map_.crbegin())), boost::none};
-  } else if (upper_bound_it == timestamp_value_map_.cbegin()) {
+    return {boost::optional<TimestampedValue<T>>(*(timestamp_values_.crbegin())), boost::none};
+  } else if (upper_bound_it == timestamp_values_.cbegin()) {
     LogDebug("LowerAndUpperBoundTimestamps: No lower bound timestamp exists.");
     return {boost::none, boost::optional<TimestampedValue<T>>(*upper_bound_it)};
   }
@@ -187,7 +193,8 @@ boost::optional<TimestampedValue<T>> TimestampedSet<T>::LowerBoundOrEqual(const
 template <typename T>
 std::vector<Time> TimestampedSet<T>::Timestamps() const {
   std::vector<Time> timestamps;
-  for (const auto& timestamped_value : timestamp_value_map_) {
+  timestamps.reserve(size());
+  for (const auto& timestamped_value : timestamp_values_) {
     timestamps.emplace_back(timestamped_value.first);
   }
   return timestamps;
@@ -227,15 +234,16 @@ boost::optional<TimestampedValue<T>> TimestampedSet<T>::Closest(const Time times
 
 template <typename T>
 bool TimestampedSet<T>::Contains(const Time timestamp) const {
-  return timestamp_value_map_.count(timestamp) > 0;
+  return timestamp_values_.count(timestamp) > 0;
 }
 
 template <typename T>
 std::vector<TimestampedValue<T>> TimestampedSet<T>::OldValues(const Time oldest_allowed_timestamp) const {
   std::vector<TimestampedValue<T>> old_values;
-  for (const auto& timestamped_value : timestamp_value_map_) {
-    if (timestamped_value.first >= oldest_allowed_timestamp) break;
-    old_values.emplace_back(timestamped_value);
+  const auto oldest_allowed_it = timestamp_values_.lower_bound(oldest_allowed_timestamp);
+  old_values.reserve(std::distance(timestamp_values_.cbegin(), oldest_allowed_it));
+  for (auto it = timestamp_values_.cbegin(); it != oldest_allowed_it; ++it) {
+    old_values.emplace_back(*it);
   }
 
   return old_values;
@@ -243,20 +251,29 @@ std::vector<TimestampedValue<T>> TimestampedSet<T>::OldValues(const Time oldest_
 
 template <typename T>
 int TimestampedSet<T>::RemoveOldValues(const Time oldest_allowed_timestamp) {
-  int num_removed_values = 0;
-  for (auto it = timestamp_value_map_.begin(); it != timestamp_value_map_.end();) {
-    if (it->first >= oldest_allowed_timestamp) break;
-    it = timestamp_value_map_.erase(it);
-    ++num_removed_values;
-  }
-
+  const auto oldest_allowed_it = timestamp_values_.lower_bound(oldest_allowed_timestamp);
+  const int num_removed_values = std::distance(timestamp_values_.begin(), oldest_allowed_it);
+  timestamp_values_.erase(timestamp_values_.cbegin(), oldest_allowed_it);
   return num_removed_values;
 }
 
 template <typename T>
 template <class ARCHIVE>
-void TimestampedSet<T>::serialize(ARCHIVE& ar, const unsigned int /*version*/) {
-  ar& BOOST_SERIALIZATION_NVP(timestamp_value_map_);
+void TimestampedSet<T>::save(ARCHIVE& ar, const unsigned int /*version*/) const {
+  const std::map<Time, T> timestamp_value_map(timestamp_values_.cbegin(), timestamp_values_.cend());
+  ar& boost::serialization::make_nvp("timestamp_value_map_", timestamp_value_map);
+}
+
+template <typename T>
+template <class ARCHIVE>
+void TimestampedSet<T>::load(ARCHIVE& ar, const unsigned int /*version*/) {
+  std::map<Time, T> timestamp_value_map;
+  ar& boost::serialization::make_nvp("timestamp_value_map_", timestamp_value_map);
+  timestamp_values_.clear();
+  timestamp_values_.reserve(timestamp_value_map.size());
+  for (const auto& timestamped_value : timestamp_value_map) {
+    timestamp_values_.emplace(timestamped_value.first, timestamped_value.second);
+  }
 }
 }  // namespace localization_common
 
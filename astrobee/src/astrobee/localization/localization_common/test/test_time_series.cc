@@ -0,0 +1,118 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <localization_common/time_series.h>
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <map>
+
+namespace lc = localization_common;
+
+TEST(TimeSeriesTester, EmplaceInOrderAndOutOfOrder) {
+  lc::TimeSeries<int> time_series;
+  EXPECT_TRUE(time_series.empty());
+  EXPECT_TRUE(time_series.emplace(1.0, 1));
+  EXPECT_TRUE(time_series.emplace(3.0, 3));
+  EXPECT_TRUE(time_series.emplace(2.0, 2));
+  EXPECT_TRUE(time_series.emplace(0.0, 0));
+  // Duplicate timestamps are not inserted
+  EXPECT_FALSE(time_series.emplace(2.0, 20));
+  EXPECT_FALSE(time_series.emplace(3.0, 30));
+  ASSERT_EQ(time_series.size(), 4);
+  int i = 0;
+  for (const auto& value : time_series) {
+    EXPECT_EQ(value.first, i);
+    EXPECT_EQ(value.second, i);
+    ++i;
+  }
+  EXPECT_EQ(time_series.front().second, 0);
+  EXPECT_EQ(time_series.back().second, 3);
+  EXPECT_EQ(time_series.crbegin()->second, 3);
+}
+
+TEST(TimeSeriesTester, FindAndBounds) {
+  lc::TimeSeries<int> time_series;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(time_series.emplace(i, i));
+  }
+  EXPECT_EQ(time_series.find(2.0)->second, 2);
+  EXPECT_TRUE(time_series.find(2.5) == time_series.cend());
+  EXPECT_EQ(time_series.count(4.0), 1);
+  EXPECT_EQ(time_series.count(5.0), 0);
+  EXPECT_EQ(time_series.lower_bound(2.0)->second, 2);
+  EXPECT_EQ(time_series.lower_bound(2.5)->second, 3);
+  EXPECT_EQ(time_series.upper_bound(2.0)->second, 3);
+  EXPECT_TRUE(time_series.lower_bound(-1.0) == time_series.cbegin());
+  EXPECT_TRUE(time_series.upper_bound(4.0) == time_series.cend());
+  EXPECT_EQ(std::prev(time_series.upper_bound(2.5))->second, 2);
+}
+
+TEST(TimeSeriesTester, Erase) {
+  lc::TimeSeries<int> time_series;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(time_series.emplace(i, i));
+  }
+  EXPECT_EQ(time_series.erase(2.0), 1);
+  EXPECT_EQ(time_series.erase(2.0), 0);
+  EXPECT_EQ(time_series.size(), 4);
+  EXPECT_EQ(time_series.lower_bound(2.0)->second, 3);
+  time_series.erase(time_series.cbegin(), time_series.lower_bound(3.0));
+  ASSERT_EQ(time_series.size(), 2);
+  EXPECT_EQ(time_series.front().second, 3);
+  // Erasing from the front reuses the erased slots
+  EXPECT_TRUE(time_series.emplace(5.0, 5));
+  EXPECT_EQ(time_series.back().second, 5);
+  time_series.erase(time_series.cbegin(), time_series.cend());
+  EXPECT_TRUE(time_series.empty());
+  EXPECT_TRUE(time_series.emplace(1.0, 1));
+  EXPECT_EQ(time_series.size(), 1);
+}
+
+TEST(TimeSeriesTester, MatchesMap) {
+  // Sliding window of measurements as kept by the imu integrator
+  lc::TimeSeries<int> time_series;
+  std::map<lc::Time, int> map;
+  for (int i = 0; i < 1000; ++i) {
+    const lc::Time timestamp = i * 0.016;
+    time_series.emplace(timestamp, i);
+    map.emplace(timestamp, i);
+    // Occasional late measurement
+    if (i % 7 == 0) {
+      time_series.emplace(timestamp - 0.008, -i);
+      map.emplace(timestamp - 0.008, -i);
+    }
+    if (i % 10 == 0) {
+      const lc::Time oldest_allowed_timestamp = timestamp - 0.5;
+      time_series.erase(time_series.cbegin(), time_series.lower_bound(oldest_allowed_timestamp));
+      map.erase(map.begin(), map.lower_bound(oldest_allowed_timestamp));
+    }
+    ASSERT_EQ(time_series.size(), map.size());
+    ASSERT_TRUE(std::equal(map.cbegin(), map.cend(), time_series.cbegin(),
+                           [](const std::pair<const lc::Time, int>& a, const std::pair<lc::Time, int>& b) {
+                             return a.first == b.first && a.second == b.second;
+                           }));
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef LOCALIZATION_NODE_FRAME_QUEUE_H_
+#define LOCALIZATION_NODE_FRAME_QUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace localization_node {
+
+// What to do with a new item when the queue is full
+enum QueuePolicy {
+  DROP_OLDEST,  // Throw away the oldest item waiting
+  KEEP_LATEST,  // Throw away everything waiting, regardless of capacity
+  WAIT          // Block until there is room
+};
+
+// A bounded queue passing frames from one stage of the localization
+// pipeline to the next.
+template <class T>
+class FrameQueue {
+ public:
+  explicit FrameQueue(size_t capacity = 1, QueuePolicy policy = WAIT) :
+    capacity_(capacity), policy_(policy), closed_(false), num_dropped_(0) {}
+
+  void Configure(size_t capacity, QueuePolicy policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = (capacity < 1) ? 1 : capacity;
+    policy_ = policy;
+    while (policy_ != WAIT && items_.size() > capacity_) {
+      items_.pop_front();
+      num_dropped_++;
+    }
+    not_full_.notify_all();
+  }
+
+  // Add an item, making room for it according to the policy. Returns
+  // false if the queue was closed.
+  bool Push(T const& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (policy_ == WAIT)
+      not_full_.wait(lock, [this] {return closed_ || items_.size() < capacity_;});
+    if (closed_)
+      return false;
+    if (policy_ == KEEP_LATEST) {
+      num_dropped_ += items_.size();
+      items_.clear();
+    } else if (policy_ == DROP_OLDEST && items_.size() >= capacity_) {
+      items_.pop_front();
+      num_dropped_++;
+    }
+    items_.push_back(item);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Wait for the next item. Returns false once the queue is closed.
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] {return closed_ || !items_.empty();});
+    if (closed_)
+      return false;
+    *item = items_.front();
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Throw away all waiting items
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_dropped_ += items_.size();
+    items_.clear();
+    not_full_.notify_all();
+  }
+
+  // Wake up and turn away everybody waiting, for shutting down
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+  // How many items were thrown away to make room so far
+  size_t NumDropped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_dropped_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_, not_full_;
+  std::deque<T> items_;
+  size_t capacity_;
+  QueuePolicy policy_;
+  bool closed_;
+  size_t num_dropped_;
+};
+
+}  // namespace localization_node
+
+#endif  // LOCALIZATION_NODE_FRAME_QUEUE_H_
@@ -26,6 +26,8 @@
 #include <ff_msgs/VisualLandmarks.h>
 #include <sensor_msgs/PointCloud2.h>
 
+#include <vector>
+
 namespace localization_node {
 
 class Localizer {
@@ -35,6 +37,18 @@ class Localizer {
   void ReadParams(config_reader::ConfigReader* config);
   bool Localize(cv_bridge::CvImageConstPtr image_ptr, ff_msgs::VisualLandmarks* vl,
      Eigen::Matrix2Xd* image_keypoints = NULL);
+
+  // The stages of Localize(), which can be run on consecutive images
+  // at the same time, each stage on one image at a time.
+  void DetectFeatures(cv_bridge::CvImageConstPtr image_ptr,
+                      cv::Mat* image_descriptors, Eigen::Matrix2Xd* image_keypoints);
+  void MatchToMap(cv::Mat const& image_descriptors, Eigen::Matrix2Xd const& image_keypoints,
+                  std::vector<Eigen::Vector3d>* landmarks, std::vector<Eigen::Vector2d>* observations);
+  bool EstimatePose(cv_bridge::CvImageConstPtr image_ptr,
+                    std::vector<Eigen::Vector3d> const& landmarks,
+                    std::vector<Eigen::Vector2d> const& observations,
+                    ff_msgs::VisualLandmarks* vl);
+
  private:
   sparse_mapping::SparseMap* map_;
 };
@@ -19,6 +19,7 @@
 #ifndef LOCALIZATION_NODE_LOCALIZATION_NODELET_H_
 #define LOCALIZATION_NODE_LOCALIZATION_NODELET_H_
 
+#include <localization_node/frame_queue.h>
 #include <localization_node/localization.h>
 
 #include <sparse_mapping/sparse_map.h>
@@ -27,11 +28,17 @@
 #include <ff_msgs/ResetMap.h>
 #include <ff_msgs/SetBool.h>
 #include <ff_util/ff_nodelet.h>
+#include <ff_util/perf_timer.h>
 #include <nodelet/nodelet.h>
 #include <image_transport/image_transport.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace localization_node {
 
@@ -46,8 +53,28 @@ class LocalizationNodelet : public ff_util::FreeFlyerNodelet {
  private:
   void ReadParams(void);
   bool ResetMap(const std::string& map_file);
+  // An image on its way through the localization pipeline
+  struct Frame {
+    ros::Time received;
+    int camera_id;
+    cv_bridge::CvImageConstPtr image_ptr;
+    cv::Mat descriptors;
+    Eigen::Matrix2Xd keypoints;
+    std::vector<Eigen::Vector3d> landmarks;
+    std::vector<Eigen::Vector2d> observations;
+  };
+  typedef std::shared_ptr<Frame> FramePtr;
+
   void Run(void);
-  void Localize(void);
+  // Take stage_mutex_ shared, for a stage, or exclusive, to reconfigure
+  std::shared_lock<std::shared_timed_mutex> LockShared(void);
+  std::unique_lock<std::shared_timed_mutex> LockExclusive(void);
+  // The pipeline stages, each in its own thread, passing frames
+  // along through the queues
+  void DetectStage(void);
+  void MatchStage(void);
+  void PoseStage(void);
+  void Publish(Frame const& frame, bool success, ff_msgs::VisualLandmarks const& vl);
   void ImageCallback(const sensor_msgs::ImageConstPtr& msg);
   bool EnableService(ff_msgs::SetBool::Request & req, ff_msgs::SetBool::Response & res);
   bool ResetMapService(ff_msgs::ResetMap::Request & req, ff_msgs::ResetMap::Response & res);
@@ -55,6 +82,7 @@ class LocalizationNodelet : public ff_util::FreeFlyerNodelet {
   std::shared_ptr<Localizer> inst_;
   std::shared_ptr<sparse_mapping::SparseMap> map_;
   std::shared_ptr<std::thread> thread_;
+  std::vector<std::thread> stage_threads_;
   config_reader::ConfigReader config_;
   ros::Timer config_timer_;
 
@@ -63,15 +91,25 @@ class LocalizationNodelet : public ff_util::FreeFlyerNodelet {
   ros::ServiceServer enable_srv_, reset_map_srv_;
   ros::Publisher registration_publisher_, landmark_publisher_,
     detected_features_publisher_, used_features_publisher_, all_features_publisher_;
-  bool enabled_;
+  std::atomic<bool> enabled_;
   int count_;
 
   bool matched_features_on_, all_features_on_;
-  cv_bridge::CvImageConstPtr image_ptr_;
 
-  volatile bool processing_image_;
-  pthread_mutex_t mutex_features_;
-  pthread_cond_t cond_features_;
+  // New images wait in image_queue_, which drops frames according to
+  // the configured policy when localization can't keep up. Past that
+  // queue every frame is processed, as the later queues wait for room.
+  FrameQueue<FramePtr> image_queue_, match_queue_, pose_queue_;
+  std::atomic<int> num_in_flight_;  // frames taken from image_queue_ and not yet published
+  // Each stage holds this shared while it works on a frame. Changing the
+  // parameters or the map takes it exclusively, so that happens between frames.
+  std::shared_timed_mutex stage_mutex_;
+  // Held while taking stage_mutex_ either way. The stages run back to back,
+  // so a reader-preferring stage_mutex_ might never be free of them; with
+  // the gate, a waiting writer only waits for the frames already in progress.
+  std::mutex stage_gate_;
+  ff_util::PerfReporter perf_;
+  ff_util::LatencyHistogram *pt_detect_, *pt_match_, *pt_pose_;
 };
 
 };  // namespace localization_node
@@ -36,8 +36,9 @@ Localizer::~Localizer(void) {
 
 void Localizer::ReadParams(config_reader::ConfigReader* config) {
   int num_similar, ransac_inlier_tolerance, ransac_iterations, early_break_landmarks, histogram_equalization;
-  int min_features, max_features, detection_retries;
+  int min_features, max_features, detection_retries, num_matching_threads;
   double min_brisk_threshold, default_brisk_threshold, max_brisk_threshold;
+  double undistortion_table_spacing;
   camera::CameraParameters cam_params(config, "nav_cam");
   if (!config->GetInt("num_similar", &num_similar))
     ROS_FATAL("num_similar not specified in localization.");
@@ -63,6 +64,12 @@ void Localizer::ReadParams(config_reader::ConfigReader* config) {
     max_brisk_threshold = 110.0;
   if (!config->GetInt("early_break_landmarks", &early_break_landmarks))
     early_break_landmarks = 100;
+  if (!config->GetInt("num_matching_threads", &num_matching_threads))
+    num_matching_threads = 1;
+  if (!config->GetReal("undistortion_table_spacing", &undistortion_table_spacing))
+    undistortion_table_spacing = 0.0;
+  if (undistortion_table_spacing > 0)
+    cam_params.GenerateUndistortionTable(undistortion_table_spacing);
 
   // This check must happen before the histogram_equalization flag is set into the map
   // to compare with what is there already.
@@ -73,6 +80,7 @@ void Localizer::ReadParams(config_reader::ConfigReader* config) {
   map_->SetRansacInlierTolerance(ransac_inlier_tolerance);
   map_->SetRansacIterations(ransac_iterations);
   map_->SetEarlyBreakLandmarks(early_break_landmarks);
+  map_->SetNumMatchingThreads(num_matching_threads);
   map_->SetHistogramEqualization(histogram_equalization);
   map_->SetDetectorParams(min_features, max_features, detection_retries,
                           min_brisk_threshold, default_brisk_threshold, max_brisk_threshold);
@@ -80,26 +88,46 @@ void Localizer::ReadParams(config_reader::ConfigReader* config) {
 
 bool Localizer::Localize(cv_bridge::CvImageConstPtr image_ptr, ff_msgs::VisualLandmarks* vl,
      Eigen::Matrix2Xd* image_keypoints) {
-  bool multithreaded = false;
   cv::Mat image_descriptors;
-
   Eigen::Matrix2Xd keypoints;
   if (image_keypoints == NULL) {
     image_keypoints = &keypoints;
   }
 
+  std::vector<Eigen::Vector3d> landmarks;
+  std::vector<Eigen::Vector2d> observations;
+  DetectFeatures(image_ptr, &image_descriptors, image_keypoints);
+  MatchToMap(image_descriptors, *image_keypoints, &landmarks, &observations);
+  return EstimatePose(image_ptr, landmarks, observations, vl);
+}
+
+void Localizer::DetectFeatures(cv_bridge::CvImageConstPtr image_ptr,
+                               cv::Mat* image_descriptors, Eigen::Matrix2Xd* image_keypoints) {
+  bool multithreaded = false;
+  map_->DetectFeatures(image_ptr->image, multithreaded, image_descriptors, image_keypoints);
+}
+
+void Localizer::MatchToMap(cv::Mat const& image_descriptors, Eigen::Matrix2Xd const& image_keypoints,
+                           std::vector<Eigen::Vector3d>* landmarks,
+                           std::vector<Eigen::Vector2d>* observations) {
+  map_->MatchToMap(image_descriptors, image_keypoints, landmarks, observations);
+}
+
+bool Localizer::EstimatePose(cv_bridge::CvImageConstPtr image_ptr,
+                             std::vector<Eigen::Vector3d> const& all_landmarks,
+                             std::vector<Eigen::Vector2d> const& all_observations,
+                             ff_msgs::VisualLandmarks* vl) {
   vl->header = std_msgs::Header();
   vl->header.stamp = image_ptr->header.stamp;
   vl->header.frame_id = "world";
 
-  map_->DetectFeatures(image_ptr->image, multithreaded, &image_descriptors, image_keypoints);
   camera::CameraModel camera(Eigen::Vector3d(),
                              Eigen::Matrix3d::Identity(),
                              map_->GetCameraParameters());
   std::vector<Eigen::Vector3d> landmarks;
   std::vector<Eigen::Vector2d> observations;
-  if (!map_->Localize(image_descriptors, *image_keypoints,
-                               &camera, &landmarks, &observations)) {
+  if (!map_->EstimatePose(all_landmarks, all_observations,
+                          &camera, &landmarks, &observations)) {
     // LOG(INFO) << "Failed to localize image.";
     return false;
   }
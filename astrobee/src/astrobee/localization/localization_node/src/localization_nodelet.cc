@@ -37,15 +37,17 @@
 namespace localization_node {
 
 LocalizationNodelet::LocalizationNodelet() : ff_util::FreeFlyerNodelet(NODE_MAPPED_LANDMARKS),
-        enabled_(false), count_(0), processing_image_(true) {
-  pthread_mutex_init(&mutex_features_, NULL);
-  pthread_cond_init(&cond_features_, NULL);
+        enabled_(false), count_(0), num_in_flight_(0) {
 }
 
 LocalizationNodelet::~LocalizationNodelet(void) {
-  thread_->join();
-  pthread_mutex_destroy(&mutex_features_);
-  pthread_cond_destroy(&cond_features_);
+  // Close the queues first so no stage is left waiting in Pop or Push
+  image_queue_.Close();
+  match_queue_.Close();
+  pose_queue_.Close();
+  if (thread_) thread_->join();
+  for (std::thread & t : stage_threads_)
+    t.join();
 }
 
 bool LocalizationNodelet::ResetMap(const std::string& map_file) {
@@ -56,11 +58,15 @@ bool LocalizationNodelet::ResetMap(const std::string& map_file) {
   // Disable and wait for localization to finish running if it is running
   // before resetting the localizer
   enabled_ = false;
-  while (processing_image_) {
+  do {
+    image_queue_.Clear();
     usleep(100000);
+  } while (num_in_flight_ > 0 || image_queue_.Size() > 0);
+  {
+    std::unique_lock<std::shared_timed_mutex> lock = LockExclusive();
+    map_.reset(new sparse_mapping::SparseMap(map_file, true));
+    inst_.reset(new Localizer(map_.get()));
   }
-  map_.reset(new sparse_mapping::SparseMap(map_file, true));
-  inst_.reset(new Localizer(map_.get()));
   // Check to see if any params were changed when map was reset
   ReadParams();
   enabled_ = true;
@@ -104,11 +110,19 @@ void LocalizationNodelet::Initialize(ros::NodeHandle* nh) {
     detected_features_publisher_ = nh->advertise<sensor_msgs::Image>("rviz/detected_features", 10);
   }
 
-  // start a new thread to run everything
-  thread_.reset(new std::thread(&localization_node::LocalizationNodelet::Run, this));
+  perf_.Initialize(nh, "localization");
+  pt_detect_ = perf_.AddTimer("detect");
+  pt_match_ = perf_.AddTimer("match");
+  pt_pose_ = perf_.AddTimer("pose");
 
   ReadParams();
 
+  // start a new thread to run everything
+  thread_.reset(new std::thread(&localization_node::LocalizationNodelet::Run, this));
+  stage_threads_.emplace_back(&localization_node::LocalizationNodelet::DetectStage, this);
+  stage_threads_.emplace_back(&localization_node::LocalizationNodelet::MatchStage, this);
+  stage_threads_.emplace_back(&localization_node::LocalizationNodelet::PoseStage, this);
+
   // only do this once, will cause a crash if done in middle of thread execution
   int num_threads;
   if (!config_.GetInt("num_threads", &num_threads))
@@ -127,7 +141,31 @@ void LocalizationNodelet::ReadParams(void) {
     ROS_ERROR("Failed to read config files.");
     return;
   }
-  if (inst_) inst_->ReadParams(&config_);
+  {
+    // Wait for the stages to finish their current frames, as the
+    // localizer reconfigures the map they share
+    std::unique_lock<std::shared_timed_mutex> lock = LockExclusive();
+    if (inst_) inst_->ReadParams(&config_);
+  }
+
+  // How many new images may wait to be localized, and which to drop
+  // when more arrive. Each later stage holds one frame at a time.
+  int queue_size;
+  std::string policy;
+  if (!config_.GetInt("pipeline_queue_size", &queue_size))
+    queue_size = 1;
+  if (!config_.GetStr("pipeline_drop_policy", &policy))
+    policy = "keep_latest";
+  if (policy == "keep_latest") {
+    image_queue_.Configure(queue_size, KEEP_LATEST);
+  } else if (policy == "drop_oldest") {
+    image_queue_.Configure(queue_size, DROP_OLDEST);
+  } else {
+    ROS_ERROR("Unknown pipeline_drop_policy %s, using keep_latest.", policy.c_str());
+    image_queue_.Configure(queue_size, KEEP_LATEST);
+  }
+  match_queue_.Configure(1, WAIT);
+  pose_queue_.Configure(1, WAIT);
 }
 
 bool LocalizationNodelet::EnableService(ff_msgs::SetBool::Request & req, ff_msgs::SetBool::Response & res) {
@@ -151,41 +189,95 @@ bool LocalizationNodelet::ResetMapService(ff_msgs::ResetMap::Request& req, ff_ms
 }
 
 void LocalizationNodelet::ImageCallback(const sensor_msgs::ImageConstPtr& msg) {
-  ros::Time timestamp = ros::Time::now();
-  pthread_mutex_lock(&mutex_features_);
-  bool cont = processing_image_;
-  pthread_mutex_unlock(&mutex_features_);
-  if (cont) return;
-
-  ff_msgs::CameraRegistration r;
-  r.header = std_msgs::Header();
-  r.header.stamp = timestamp;
-  r.camera_id = count_;
-  registration_publisher_.publish(r);
-  ros::spinOnce();
+  if (!enabled_) return;
 
+  FramePtr frame(new Frame);
+  frame->received = ros::Time::now();
   try {
-    image_ptr_ = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::MONO8);
+    frame->image_ptr = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::MONO8);
   } catch (cv_bridge::Exception& e) {
     ROS_ERROR("cv_bridge exception: %s", e.what());
     return;
   }
+  image_queue_.Push(frame);
+}
+
+std::shared_lock<std::shared_timed_mutex> LocalizationNodelet::LockShared(void) {
+  std::lock_guard<std::mutex> gate(stage_gate_);
+  return std::shared_lock<std::shared_timed_mutex>(stage_mutex_);
+}
+
+std::unique_lock<std::shared_timed_mutex> LocalizationNodelet::LockExclusive(void) {
+  // Keep the gate closed to new stages until the current ones are done
+  std::lock_guard<std::mutex> gate(stage_gate_);
+  return std::unique_lock<std::shared_timed_mutex>(stage_mutex_);
+}
+
+void LocalizationNodelet::DetectStage(void) {
+  FramePtr frame;
+  while (image_queue_.Pop(&frame)) {
+    num_in_flight_++;
+    if (!enabled_) {
+      // The map may be getting reset
+      num_in_flight_--;
+      continue;
+    }
+
+    // Register the camera only for images which will be localized
+    frame->camera_id = count_++;
+    ff_msgs::CameraRegistration r;
+    r.header = std_msgs::Header();
+    r.header.stamp = frame->received;
+    r.camera_id = frame->camera_id;
+    registration_publisher_.publish(r);
+
+    {
+      std::shared_lock<std::shared_timed_mutex> lock = LockShared();
+      ff_util::ScopedLatencyTimer timer(pt_detect_);
+      inst_->DetectFeatures(frame->image_ptr, &frame->descriptors, &frame->keypoints);
+    }
+
+    if (!match_queue_.Push(frame))
+      return;
+  }
+}
 
-  pthread_mutex_lock(&mutex_features_);
-  processing_image_ = true;
-  pthread_cond_signal(&cond_features_);
-  pthread_mutex_unlock(&mutex_features_);
+void LocalizationNodelet::MatchStage(void) {
+  FramePtr frame;
+  while (match_queue_.Pop(&frame)) {
+    {
+      std::shared_lock<std::shared_timed_mutex> lock = LockShared();
+      ff_util::ScopedLatencyTimer timer(pt_match_);
+      inst_->MatchToMap(frame->descriptors, frame->keypoints, &frame->landmarks, &frame->observations);
+    }
+
+    if (!pose_queue_.Push(frame))
+      return;
+  }
 }
 
-void LocalizationNodelet::Localize(void) {
-  ff_msgs::VisualLandmarks vl;
-  Eigen::Matrix2Xd image_keypoints;
+void LocalizationNodelet::PoseStage(void) {
+  FramePtr frame;
+  while (pose_queue_.Pop(&frame)) {
+    std::shared_lock<std::shared_timed_mutex> lock = LockShared();
+    ff_msgs::VisualLandmarks vl;
+    bool success;
+    {
+      ff_util::ScopedLatencyTimer timer(pt_pose_);
+      success = inst_->EstimatePose(frame->image_ptr, frame->landmarks, frame->observations, &vl);
+    }
 
-  bool success = inst_->Localize(image_ptr_, &vl, &image_keypoints);
+    // Publish uses the camera parameters of the map too
+    Publish(*frame, success, vl);
+    lock.unlock();
+    num_in_flight_--;
+  }
+}
 
-  vl.camera_id = count_;
+void LocalizationNodelet::Publish(Frame const& frame, bool success, ff_msgs::VisualLandmarks const& vl_in) {
+  ff_msgs::VisualLandmarks vl = vl_in;
+  vl.camera_id = frame.camera_id;
   if (enabled_) landmark_publisher_.publish(vl);
-  ros::spinOnce();
 
   // only send transform if succeeded
   if (!success)
@@ -194,7 +286,7 @@ void LocalizationNodelet::Localize(void) {
   // send rviz feature overlay messages
   sensor_msgs::ImagePtr image_pointer;
   if (matched_features_on_ || all_features_on_) {
-    image_pointer = (*image_ptr_).toImageMsg();
+    image_pointer = (*frame.image_ptr).toImageMsg();
   }
   if (matched_features_on_) {
     cv_bridge::CvImagePtr used_image = cv_bridge::toCvCopy(image_pointer);
@@ -210,10 +302,10 @@ void LocalizationNodelet::Localize(void) {
   }
   if (all_features_on_) {
     cv_bridge::CvImagePtr detected_image = cv_bridge::toCvCopy(image_pointer);
-    for (int i = 0; i < image_keypoints.cols(); i++) {
+    for (int i = 0; i < frame.keypoints.cols(); i++) {
       Eigen::Vector2d undistorted, distorted;
-      undistorted[0] = image_keypoints.col(i)[0];
-      undistorted[1] = image_keypoints.col(i)[1];
+      undistorted[0] = frame.keypoints.col(i)[0];
+      undistorted[1] = frame.keypoints.col(i)[1];
       (map_->GetCameraParameters()).Convert<camera::UNDISTORTED_C, camera::DISTORTED>(undistorted, &distorted);
       cv::circle(detected_image->image, cv::Point(distorted[0], distorted[1]), 10, CV_RGB(255, 255, 255), 3, 8);
       cv::circle(detected_image->image, cv::Point(distorted[0], distorted[1]), 6, CV_RGB(0, 0, 0), 2, 8);
@@ -225,7 +317,7 @@ void LocalizationNodelet::Localize(void) {
   static tf2_ros::TransformBroadcaster br;
   geometry_msgs::TransformStamped transformStamped;
   transformStamped.header.stamp = ros::Time::now();
-  transformStamped.header.seq = count_;
+  transformStamped.header.seq = frame.camera_id;
   transformStamped.header.frame_id = "world";
   transformStamped.child_frame_id = "localization";
   transformStamped.transform.translation.x = vl.pose.position.x;
@@ -236,38 +328,25 @@ void LocalizationNodelet::Localize(void) {
   br.sendTransform(transformStamped);
 }
 
+// Subscribe to the images only while enabled. The stages run in their
+// own threads.
 void LocalizationNodelet::Run(void) {
-  struct timespec ts;
   bool running = false;
+  size_t num_dropped = 0;
   while (ros::ok()) {
     if (!enabled_) {
       image_sub_.shutdown();
       running = false;
     }
-    if (!running) {
-      if (enabled_) {
-        image_sub_ = it_->subscribe(TOPIC_HARDWARE_NAV_CAM, 1, &LocalizationNodelet::ImageCallback, this);
-        running = true;
-      } else {
-        usleep(100000);
-        continue;
-      }
+    if (!running && enabled_) {
+      image_sub_ = it_->subscribe(TOPIC_HARDWARE_NAV_CAM, 1, &LocalizationNodelet::ImageCallback, this);
+      running = true;
     }
-    pthread_mutex_lock(&mutex_features_);
-    processing_image_ = false;  // initialize this here so we don't get images before thread starts
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += 1;
-    pthread_cond_timedwait(&cond_features_, &mutex_features_, &ts);
-    bool ready = processing_image_;
-    pthread_mutex_unlock(&mutex_features_);
-    if (!ready)
-      continue;
-    // unlock the mutex for localizing so we can ignore images we get during this
-    Localize();
-    count_++;
-    pthread_mutex_lock(&mutex_features_);
-    processing_image_ = false;
-    pthread_mutex_unlock(&mutex_features_);
+    if (image_queue_.NumDropped() != num_dropped) {
+      num_dropped = image_queue_.NumDropped();
+      ROS_DEBUG_THROTTLE(10, "Localization dropped %zu images so far.", num_dropped);
+    }
+    usleep(100000);
   }
 }
 
@@ -0,0 +1,171 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <localization_node/frame_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace ln = localization_node;
+
+// Long enough for a blocked thread to have really blocked
+static void Settle() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+TEST(FrameQueueTest, KeepsOrder) {
+  ln::FrameQueue<int> queue(4, ln::WAIT);
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(queue.Push(i));
+  EXPECT_EQ(queue.Size(), 4u);
+  for (int i = 0; i < 4; i++) {
+    int item = -1;
+    EXPECT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_EQ(queue.Size(), 0u);
+  EXPECT_EQ(queue.NumDropped(), 0u);
+}
+
+TEST(FrameQueueTest, DropOldest) {
+  ln::FrameQueue<int> queue(3, ln::DROP_OLDEST);
+  for (int i = 0; i < 5; i++)
+    EXPECT_TRUE(queue.Push(i));
+  EXPECT_EQ(queue.Size(), 3u);
+  EXPECT_EQ(queue.NumDropped(), 2u);
+  for (int i = 2; i < 5; i++) {
+    int item = -1;
+    EXPECT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, i);
+  }
+}
+
+TEST(FrameQueueTest, KeepLatest) {
+  ln::FrameQueue<int> queue(3, ln::KEEP_LATEST);
+  for (int i = 0; i < 5; i++)
+    EXPECT_TRUE(queue.Push(i));
+  // Every push throws away whatever was waiting
+  EXPECT_EQ(queue.Size(), 1u);
+  EXPECT_EQ(queue.NumDropped(), 4u);
+  int item = -1;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, 4);
+}
+
+TEST(FrameQueueTest, ConfigureAndClear) {
+  ln::FrameQueue<int> queue(5, ln::WAIT);
+  for (int i = 0; i < 5; i++)
+    EXPECT_TRUE(queue.Push(i));
+  // Shrinking a waiting queue keeps its items, as nobody chose to drop them
+  queue.Configure(2, ln::WAIT);
+  EXPECT_EQ(queue.Size(), 5u);
+  queue.Configure(2, ln::DROP_OLDEST);
+  EXPECT_EQ(queue.Size(), 2u);
+  EXPECT_EQ(queue.NumDropped(), 3u);
+  int item = -1;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, 3);
+  queue.Clear();
+  EXPECT_EQ(queue.Size(), 0u);
+  EXPECT_EQ(queue.NumDropped(), 4u);
+  // A capacity of zero still lets one item through
+  queue.Configure(0, ln::DROP_OLDEST);
+  EXPECT_TRUE(queue.Push(7));
+  EXPECT_TRUE(queue.Push(8));
+  EXPECT_EQ(queue.Size(), 1u);
+}
+
+TEST(FrameQueueTest, WaitBlocksUntilRoom) {
+  ln::FrameQueue<int> queue(1, ln::WAIT);
+  EXPECT_TRUE(queue.Push(0));
+  std::atomic<bool> pushed(false);
+  std::thread producer([&] {
+    EXPECT_TRUE(queue.Push(1));
+    pushed = true;
+  });
+  Settle();
+  EXPECT_FALSE(pushed);
+  int item = -1;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, 0);
+  producer.join();
+  EXPECT_TRUE(pushed);
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, 1);
+  EXPECT_EQ(queue.NumDropped(), 0u);
+}
+
+TEST(FrameQueueTest, PassesEverythingBetweenThreads) {
+  const int kNumItems = 1000;
+  ln::FrameQueue<int> queue(2, ln::WAIT);
+  std::vector<int> received;
+  std::thread consumer([&] {
+    int item;
+    while (queue.Pop(&item)) {
+      received.push_back(item);
+      if (item == kNumItems - 1) break;
+    }
+  });
+  for (int i = 0; i < kNumItems; i++)
+    EXPECT_TRUE(queue.Push(i));
+  consumer.join();
+  ASSERT_EQ(received.size(), static_cast<size_t>(kNumItems));
+  for (int i = 0; i < kNumItems; i++)
+    EXPECT_EQ(received[i], i);
+}
+
+TEST(FrameQueueTest, CloseWakesPop) {
+  ln::FrameQueue<int> queue(1, ln::WAIT);
+  std::atomic<bool> result(true);
+  std::thread consumer([&] {
+    int item;
+    result = queue.Pop(&item);
+  });
+  Settle();
+  queue.Close();
+  consumer.join();
+  EXPECT_FALSE(result);
+}
+
+TEST(FrameQueueTest, CloseWakesPush) {
+  ln::FrameQueue<int> queue(1, ln::WAIT);
+  EXPECT_TRUE(queue.Push(0));
+  std::atomic<bool> result(true);
+  std::thread producer([&] {
+    result = queue.Push(1);
+  });
+  Settle();
+  queue.Close();
+  producer.join();
+  EXPECT_FALSE(result);
+  // Nothing more goes in or out once closed, even with items left
+  int item = -1;
+  EXPECT_FALSE(queue.Push(2));
+  EXPECT_FALSE(queue.Pop(&item));
+  EXPECT_EQ(item, -1);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef SPARSE_MAPPING_COMPACT_MAP_H_
+#define SPARSE_MAPPING_COMPACT_MAP_H_
+
+#include <Eigen/Core>
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace sparse_mapping {
+
+struct SparseMap;
+
+/**
+ * The fixed-size start of a compact map file. It is followed by the
+ * sections it gives the byte offsets of, each aligned to
+ * kCompactMapAlignment bytes. The features of all frames are stored
+ * back to back, frame after frame, so each per-feature section is
+ * indexed by the frame's first feature plus the feature id.
+ **/
+struct CompactMapHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  int32_t num_frames;
+  int32_t num_landmarks;
+  int64_t num_features;
+  int32_t descriptor_depth;        // as cv::Mat::depth()
+  int32_t descriptor_cols;
+  int32_t descriptor_bytes;        // per feature
+  int32_t histogram_equalization;
+  char detector_name[32];
+  double focal_length[2];
+  double optical_offset[2];
+  int32_t distorted_image_size[2];
+  int32_t undistorted_image_size[2];
+  int32_t num_distortion;
+  int32_t vocab_db_type;           // as sparse_mapping_protobuf::Map::VocabDB
+  double distortion[8];
+  uint64_t feature_offsets_pos;    // int64_t[num_frames + 1], first feature of each frame
+  uint64_t descriptors_pos;        // uint8_t[num_features * descriptor_bytes]
+  uint64_t keypoints_pos;          // double[2 * num_features]
+  uint64_t fid_to_pid_pos;         // int32_t[num_features], -1 if not on a landmark
+  uint64_t landmarks_pos;          // double[3 * num_landmarks]
+  uint64_t filenames_pos;          // num_frames null-terminated strings
+  uint64_t filenames_size;
+  uint64_t vocab_db_pos;           // the vocab db, serialized as in the protobuf map
+  uint64_t vocab_db_size;
+};
+
+const uint64_t kCompactMapAlignment = 64;
+
+/**
+ * A localization-only map, memory-mapped from a file written by
+ * WriteCompactMap() rather than parsed, so it loads in constant time
+ * and the pages of the map not used are never read. The constructor
+ * dies if the header describes sections not within the file.
+ **/
+class CompactMap {
+ public:
+  explicit CompactMap(std::string const& filename);
+  ~CompactMap();
+  CompactMap(const CompactMap&) = delete;
+  CompactMap& operator=(const CompactMap&) = delete;
+
+  // Check the magic number at the start of the file
+  static bool IsCompactMap(std::string const& filename);
+
+  CompactMapHeader const& Header() const {return *header_;}
+  int NumFrames() const {return header_->num_frames;}
+  int NumLandmarks() const {return header_->num_landmarks;}
+  int NumFeatures(int cid) const {
+    return static_cast<int>(feature_offsets_[cid + 1] - feature_offsets_[cid]);
+  }
+
+  // Wrap the mapped memory, which is read-only. Nothing is copied.
+  cv::Mat Descriptors(int cid) const;
+  Eigen::Map<const Eigen::Matrix2Xd> Keypoints(int cid) const {
+    return Eigen::Map<const Eigen::Matrix2Xd>(keypoints_ + 2 * feature_offsets_[cid], 2, NumFeatures(cid));
+  }
+  Eigen::Map<const Eigen::Vector3d> Landmark(int pid) const {
+    return Eigen::Map<const Eigen::Vector3d>(landmarks_ + 3 * pid);
+  }
+
+  // The landmark the given feature is an observation of, or -1 if none
+  int Pid(int cid, int fid) const {
+    return (fid >= 0 && fid < NumFeatures(cid)) ? fid_to_pid_[feature_offsets_[cid] + fid] : -1;
+  }
+
+  const char* Filenames() const {return data_ + header_->filenames_pos;}
+  const char* VocabDB() const {return data_ + header_->vocab_db_pos;}
+
+ private:
+  void CheckSection(const char* name, uint64_t pos, uint64_t count, uint64_t item_size,
+                    std::string const& filename) const;
+
+  int fd_;
+  const char* data_;
+  size_t size_;
+  const CompactMapHeader* header_;
+  const int64_t* feature_offsets_;
+  const double* keypoints_;
+  const int32_t* fid_to_pid_;
+  const double* landmarks_;
+};
+
+/**
+ * Write the parts of a map needed for localization in the compact
+ * format. The map must have been loaded with its keypoints.
+ **/
+void WriteCompactMap(SparseMap const& map, std::string const& filename);
+
+}  // namespace sparse_mapping
+
+#endif  // SPARSE_MAPPING_COMPACT_MAP_H_
@@ -0,0 +1,112 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef SPARSE_MAPPING_FID_TO_PID_H_
+#define SPARSE_MAPPING_FID_TO_PID_H_
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace sparse_mapping {
+
+/**
+ * The landmark (pid) each feature (fid) of one image is an observation
+ * of. Feature ids are dense, from 0 to the number of features in the
+ * image, so this is an array indexed by fid, with -1 for features
+ * which are not on any landmark. A lookup is a bounds check and a
+ * load, rather than a walk down a tree as with std::map, which matters
+ * as localization does one for every match of every candidate image.
+ *
+ * Iteration visits only the features with a landmark, in increasing
+ * order of fid, as (fid, pid) pairs.
+ **/
+class FidToPidMap {
+ public:
+  enum { kNoPid = -1 };
+
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<int, int> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type * pointer;
+    typedef value_type reference;
+
+    const_iterator(const std::vector<int> * pids, int fid) : pids_(pids), fid_(fid) {SkipEmpty();}
+    std::pair<int, int> operator*() const {return std::make_pair(fid_, (*pids_)[fid_]);}
+    const_iterator & operator++() {fid_++; SkipEmpty(); return *this;}
+    bool operator==(const_iterator const& other) const {return fid_ == other.fid_;}
+    bool operator!=(const_iterator const& other) const {return fid_ != other.fid_;}
+
+   private:
+    void SkipEmpty() {
+      while (fid_ < static_cast<int>(pids_->size()) && (*pids_)[fid_] == kNoPid) fid_++;
+    }
+    const std::vector<int> * pids_;
+    int fid_;
+  };
+
+  FidToPidMap() : size_(0) {}
+
+  // The landmark of this feature, or kNoPid
+  int Pid(int fid) const {
+    return (fid >= 0 && fid < static_cast<int>(pids_.size())) ? pids_[fid] : kNoPid;
+  }
+  bool Has(int fid) const {return Pid(fid) != kNoPid;}
+
+  void Set(int fid, int pid) {
+    if (fid >= static_cast<int>(pids_.size()))
+      pids_.resize(fid + 1, static_cast<int>(kNoPid));
+    if (pids_[fid] == kNoPid)
+      size_++;
+    pids_[fid] = pid;
+  }
+  void Erase(int fid) {
+    if (!Has(fid))
+      return;
+    pids_[fid] = kNoPid;
+    size_--;
+  }
+
+  // Make room for this many features up front, to avoid regrowing the
+  // array while filling it.
+  void Reserve(int num_features) {
+    if (num_features > static_cast<int>(pids_.size()))
+      pids_.resize(num_features, static_cast<int>(kNoPid));
+  }
+  void Clear() {pids_.clear(); size_ = 0;}
+
+  // The number of features with a landmark
+  size_t size() const {return size_;}
+  bool empty() const {return size_ == 0;}
+
+  const_iterator begin() const {return const_iterator(&pids_, 0);}
+  const_iterator end() const {return const_iterator(&pids_, pids_.size());}
+
+ private:
+  std::vector<int> pids_;
+  size_t size_;
+};
+
+// For each image, the landmark of each of its features
+typedef std::vector<FidToPidMap> CidFidToPid;
+
+}  // namespace sparse_mapping
+
+#endif  // SPARSE_MAPPING_FID_TO_PID_H_
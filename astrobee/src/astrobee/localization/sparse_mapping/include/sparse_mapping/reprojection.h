@@ -124,6 +124,11 @@ void EstimateCamera(camera::CameraModel * camera_estimate, std::vector<Eigen::Ve
  *
  * After the function is called, camera_estimate is updated to contain the results.
  *
+ * With --ransac_adaptive, num_tries is only an upper bound. The
+ * correspondences should then be sorted from best to worst match, as
+ * samples are drawn from the best ones first. The number of iterations
+ * done is returned in num_iterations_out if not null.
+ *
  * Returns zero on success, nonzero on failure.
  **/
 int RansacEstimateCamera(const std::vector<Eigen::Vector3d> & landmarks,
@@ -131,7 +136,7 @@ int RansacEstimateCamera(const std::vector<Eigen::Vector3d> & landmarks,
                          int num_tries, int inlier_tolerance, camera::CameraModel * camera_estimate,
                          std::vector<Eigen::Vector3d> * inlier_landmarks_out = NULL,
                          std::vector<Eigen::Vector2d> * inlier_observations_out = NULL,
-                         bool verbose = false);
+                         bool verbose = false, int * num_iterations_out = NULL);
 
 // ICP solver that given matching 3D points, finds an affine transform that
 // best fits in to out.
@@ -20,7 +20,9 @@
 #define SPARSE_MAPPING_SPARSE_MAP_H_
 
 #include <ff_common/eigen_vectors.h>
+#include <ff_common/thread.h>
 #include <interest_point/matching.h>
+#include <sparse_mapping/fid_to_pid.h>
 #include <sparse_mapping/vocab_tree.h>
 #include <sparse_mapping/sparse_mapping.h>
 #include <camera/camera_model.h>
@@ -30,6 +32,7 @@
 #include <opencv2/core/core.hpp>
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <set>
@@ -45,11 +48,13 @@ namespace cv {
 
 namespace sparse_mapping {
 
+class CompactMap;
+
 // Non-member function InitializeCidFidToPid() that we will use within
 // this class and outside of it as well.
 void InitializeCidFidToPid(int num_cid,
                            std::vector<std::map<int, int> > const& pid_to_cid_fid,
-                           std::vector<std::map<int, int> > * cid_fid_to_pid);
+                           CidFidToPid * cid_fid_to_pid);
 
 /**
  * Estimate the camera pose for a set of image descriptors and keypoints.
@@ -68,11 +73,13 @@ bool Localize(cv::Mat const& test_descriptors,
               int num_similar,
               std::vector<std::string> const& cid_to_filename,
               std::vector<cv::Mat> const& cid_to_descriptor_map,
+              std::vector<cv::Ptr<cv::DescriptorMatcher> > const& cid_to_matcher,
               std::vector<Eigen::Matrix2Xd > const& cid_to_keypoint_map,
-              std::vector<std::map<int, int> > const& cid_fid_to_pid,
+              CidFidToPid const& cid_fid_to_pid,
               std::vector<Eigen::Vector3d> const& pid_to_xyz,
               int num_ransac_iterations, int ransac_inlier_tolerance,
               int early_break_landmarks, int histogram_equalization,
+              ff_common::ThreadPool * matching_pool,
               std::vector<int> * cid_list);
 
 /**
@@ -140,6 +147,24 @@ struct SparseMap {
                 std::vector<Eigen::Vector3d>* inlier_landmarks,
                 std::vector<Eigen::Vector2d>* inlier_observations,
                 std::vector<int> * cid_list = NULL);
+
+  /**
+   * The two halves of Localize(). Find the map landmarks the features
+   * of an image are observations of, sorted from best to worst match,
+   * then estimate the camera pose from these correspondences with RANSAC. A caller may run the
+   * second half for one image while the first runs for the next one.
+   * MatchToMap() must not be called for two images at the same time.
+   **/
+  void MatchToMap(const cv::Mat & test_descriptors, const Eigen::Matrix2Xd & test_keypoints,
+                  std::vector<Eigen::Vector3d>* landmarks,
+                  std::vector<Eigen::Vector2d>* observations,
+                  std::vector<int> * cid_list = NULL);
+  bool EstimatePose(std::vector<Eigen::Vector3d> const& landmarks,
+                    std::vector<Eigen::Vector2d> const& observations,
+                    camera::CameraModel* pose,
+                    std::vector<Eigen::Vector3d>* inlier_landmarks,
+                    std::vector<Eigen::Vector2d>* inlier_observations) const;
+
   // access map frames
   /**
    * Get the number of keyframes in the map.
@@ -169,7 +194,7 @@ struct SparseMap {
   /**
    * Returns map of feature ids to landmark ids for the specified frame.
    **/
-  const std::map<int, int> & GetFrameFidToPidMap(int frame) const {return cid_fid_to_pid_[frame];}
+  const FidToPidMap & GetFrameFidToPidMap(int frame) const {return cid_fid_to_pid_[frame];}
 
   // access map landmarks
   /**
@@ -210,6 +235,11 @@ struct SparseMap {
    **/
   void SetEarlyBreakLandmarks(int early_break_landmarks) {early_break_landmarks_ = early_break_landmarks;}
   void SetHistogramEqualization(int histogram_equalization) {histogram_equalization_ = histogram_equalization;}
+  /**
+   * Set the number of threads matching an image against the map images in parallel.
+   **/
+  void SetNumMatchingThreads(int num_matching_threads);
+  int GetNumMatchingThreads(void) const {return num_matching_threads_;}
   int GetHistogramEqualization() {return histogram_equalization_;}
   /**
    * Return the parameters of the camera used to construct the map.
@@ -236,12 +266,16 @@ struct SparseMap {
   }
 
   // Load map. If localization is true, load only the parts of the map
-  // needed for localization.
+  // needed for localization. A map in the compact format, which has
+  // only those parts, can be loaded only for localization.
   void Load(const std::string & protobuf_file, bool localization = false);
 
   // construct from pid_to_cid_fid
   void InitializeCidFidToPid();
 
+  // build the per-keyframe search indices used in localization
+  void InitializeMatchers();
+
   // detect features with opencv
   void DetectFeaturesFromFile(std::string const& filename,
                               bool multithreaded,
@@ -270,7 +304,12 @@ struct SparseMap {
   std::vector<Eigen::Affine3d > cid_to_cam_t_global_;
   std::vector<cv::Mat> cid_to_descriptor_map_;
   // generated on load
-  std::vector<std::map<int, int> > cid_fid_to_pid_;
+  CidFidToPid cid_fid_to_pid_;
+  // generated on load in localization mode only, otherwise empty
+  std::vector<cv::Ptr<cv::DescriptorMatcher> > cid_to_matcher_;
+  // if loaded from a compact map, cid_to_descriptor_map_ points into it
+  // and it replaces cid_fid_to_pid_, otherwise null
+  std::shared_ptr<sparse_mapping::CompactMap> compact_map_;
 
   interest_point::FeatureDetector detector_;
   camera::CameraParameters camera_params_;
@@ -280,6 +319,9 @@ struct SparseMap {
   int ransac_inlier_tolerance_;
   int early_break_landmarks_;
   int histogram_equalization_;
+  int num_matching_threads_;
+  // persistent threads for matching in localization, if more than one
+  std::unique_ptr<ff_common::ThreadPool> matching_pool_;
 
   // e.g, 10th db image is 3rd image in cid_to_filename_
   std::map<int, int> db_to_cid_map_;
@@ -309,6 +351,9 @@ struct SparseMap {
 
   // Reorder the images in the map and the rest of the data accordingly
   void reorderMap(std::map<int, int> const& old_cid_to_new_cid);
+
+  // Memory-map a map in the compact format
+  void LoadCompact(const std::string & compact_file);
 };
 }  // namespace sparse_mapping
 
@@ -21,6 +21,7 @@
 
 #include <camera/camera_model.h>
 #include <ff_common/eigen_vectors.h>
+#include <sparse_mapping/fid_to_pid.h>
 #include <Eigen/Geometry>
 #include <ceres/ceres.h>
 
@@ -175,7 +176,7 @@ namespace sparse_mapping {
                    std::vector<Eigen::Matrix2Xd> const& cid_to_keypoint_map,
                    std::vector<std::map<int, int> > * pid_to_cid_fid,
                    std::vector<Eigen::Vector3d> * pid_to_xyz,
-                   std::vector<std::map<int, int> > * cid_fid_to_pid);
+                   CidFidToPid * cid_fid_to_pid);
 
 }  // namespace sparse_mapping
 
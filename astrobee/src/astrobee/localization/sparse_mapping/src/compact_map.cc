@@ -0,0 +1,272 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <sparse_mapping/compact_map.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <glog/logging.h>
+
+#include <sparse_map.pb.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace sparse_mapping {
+
+static const char kCompactMapMagic[8] = {'A', 'S', 'T', 'R', 'O', 'M', 'A', 'P'};
+static const uint32_t kCompactMapVersion = 1;
+
+static uint64_t Align(uint64_t pos) {
+  return (pos + kCompactMapAlignment - 1) / kCompactMapAlignment * kCompactMapAlignment;
+}
+
+bool CompactMap::IsCompactMap(std::string const& filename) {
+  char magic[sizeof(kCompactMapMagic)];
+  FILE* f = fopen(filename.c_str(), "rb");
+  if (f == NULL)
+    return false;
+  bool ret = (fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+              memcmp(magic, kCompactMapMagic, sizeof(magic)) == 0);
+  fclose(f);
+  return ret;
+}
+
+CompactMap::CompactMap(std::string const& filename) {
+  fd_ = open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    LOG(FATAL) << "Failed to open map file: " << filename;
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CompactMapHeader)))
+    LOG(FATAL) << "Compact map file is too short: " << filename;
+  size_ = st.st_size;
+
+  void* data = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED)
+    LOG(FATAL) << "Failed to memory-map file: " << filename;
+  data_ = reinterpret_cast<const char*>(data);
+
+  header_ = reinterpret_cast<const CompactMapHeader*>(data_);
+  if (memcmp(header_->magic, kCompactMapMagic, sizeof(kCompactMapMagic)) != 0)
+    LOG(FATAL) << "Not a compact map file: " << filename;
+  if (header_->version != kCompactMapVersion || header_->header_size != sizeof(CompactMapHeader))
+    LOG(FATAL) << "Unsupported compact map version in: " << filename;
+  if (header_->num_frames < 0 || header_->num_landmarks < 0 || header_->num_features < 0 ||
+      (header_->num_features > 0 &&
+       (header_->descriptor_depth < CV_8U || header_->descriptor_depth > CV_64F || header_->descriptor_cols <= 0 ||
+        header_->descriptor_bytes != header_->descriptor_cols * CV_ELEM_SIZE1(header_->descriptor_depth))))
+    LOG(FATAL) << "Invalid sizes in compact map file: " << filename;
+
+  // Every section must lie within the file, and the arrays must be aligned
+  uint64_t num_frames = header_->num_frames, num_landmarks = header_->num_landmarks;
+  uint64_t num_features = header_->num_features;
+  CheckSection("feature offsets", header_->feature_offsets_pos, num_frames + 1, sizeof(int64_t), filename);
+  CheckSection("descriptors", header_->descriptors_pos, num_features, header_->descriptor_bytes, filename);
+  CheckSection("keypoints", header_->keypoints_pos, num_features, 2 * sizeof(double), filename);
+  CheckSection("fid to pid", header_->fid_to_pid_pos, num_features, sizeof(int32_t), filename);
+  CheckSection("landmarks", header_->landmarks_pos, num_landmarks, 3 * sizeof(double), filename);
+  CheckSection("filenames", header_->filenames_pos, header_->filenames_size, 1, filename);
+  CheckSection("vocab db", header_->vocab_db_pos, header_->vocab_db_size, 1, filename);
+
+  feature_offsets_ = reinterpret_cast<const int64_t*>(data_ + header_->feature_offsets_pos);
+  keypoints_       = reinterpret_cast<const double*>(data_ + header_->keypoints_pos);
+  fid_to_pid_      = reinterpret_cast<const int32_t*>(data_ + header_->fid_to_pid_pos);
+  landmarks_       = reinterpret_cast<const double*>(data_ + header_->landmarks_pos);
+
+  // The features of each frame must follow those of the previous one,
+  // and each frame must have a filename. Only these small sections are read.
+  if (feature_offsets_[0] != 0 || feature_offsets_[num_frames] != header_->num_features)
+    LOG(FATAL) << "Invalid feature offsets in compact map file: " << filename;
+  for (uint64_t cid = 0; cid < num_frames; cid++) {
+    if (feature_offsets_[cid + 1] < feature_offsets_[cid])
+      LOG(FATAL) << "Invalid feature offsets in compact map file: " << filename;
+  }
+  const char* filenames = Filenames();
+  if (static_cast<uint64_t>(std::count(filenames, filenames + header_->filenames_size, '\0')) != num_frames ||
+      (header_->filenames_size > 0 && filenames[header_->filenames_size - 1] != '\0'))
+    LOG(FATAL) << "Invalid filenames in compact map file: " << filename;
+}
+
+// Die unless count items of item_size bytes at pos are within the file
+// and pos is aligned as written
+void CompactMap::CheckSection(const char* name, uint64_t pos, uint64_t count, uint64_t item_size,
+                              std::string const& filename) const {
+  if (pos % kCompactMapAlignment != 0 || pos > size_ ||
+      (item_size > 0 && count > (size_ - pos) / item_size))
+    LOG(FATAL) << "Compact map section " << name << " is out of bounds in: " << filename;
+}
+
+CompactMap::~CompactMap() {
+  munmap(const_cast<char*>(data_), size_);
+  close(fd_);
+}
+
+cv::Mat CompactMap::Descriptors(int cid) const {
+  const char* ptr = data_ + header_->descriptors_pos
+    + feature_offsets_[cid] * header_->descriptor_bytes;
+  return cv::Mat(NumFeatures(cid), header_->descriptor_cols,
+                 CV_MAKETYPE(header_->descriptor_depth, 1),
+                 const_cast<char*>(ptr), header_->descriptor_bytes);
+}
+
+// Write the given bytes at the given position, padding with zeros up to it
+static void WriteAt(FILE* f, uint64_t pos, const void* data, size_t size) {
+  static const char zeros[kCompactMapAlignment] = {0};
+  uint64_t cur = ftell(f);
+  CHECK(cur <= pos) << "Book-keeping failure in writing compact map.";
+  if (pos > cur)
+    fwrite(zeros, 1, pos - cur, f);
+  if (size > 0 && fwrite(data, 1, size, f) != size)
+    LOG(FATAL) << "Failed to write compact map.";
+}
+
+void WriteCompactMap(SparseMap const& map, std::string const& filename) {
+  int num_frames = map.cid_to_filename_.size();
+  int num_landmarks = map.pid_to_xyz_.size();
+  CHECK(static_cast<int>(map.cid_to_keypoint_map_.size()) == num_frames &&
+        static_cast<int>(map.cid_to_descriptor_map_.size()) == num_frames &&
+        static_cast<int>(map.cid_fid_to_pid_.size()) == num_frames)
+    << "The map must be loaded with its keypoints to write it in compact form.";
+
+  CompactMapHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCompactMapMagic, sizeof(kCompactMapMagic));
+  header.version = kCompactMapVersion;
+  header.header_size = sizeof(CompactMapHeader);
+  header.num_frames = num_frames;
+  header.num_landmarks = num_landmarks;
+  header.histogram_equalization = map.histogram_equalization_;
+
+  std::string detector_name = map.detector_.GetDetectorName();
+  CHECK(detector_name.size() < sizeof(header.detector_name)) << "Detector name too long.";
+  strncpy(header.detector_name, detector_name.c_str(), sizeof(header.detector_name) - 1);
+
+  camera::CameraParameters const& params = map.camera_params_;
+  for (int i = 0; i < 2; i++) {
+    header.focal_length[i] = params.GetFocalVector()[i];
+    header.optical_offset[i] = params.GetOpticalOffset()[i];
+    header.distorted_image_size[i] = params.GetDistortedSize()[i];
+    header.undistorted_image_size[i] = params.GetUndistortedSize()[i];
+  }
+  header.num_distortion = params.GetDistortion().size();
+  CHECK(header.num_distortion <= 8) << "Too many distortion coefficients.";
+  for (int i = 0; i < header.num_distortion; i++)
+    header.distortion[i] = params.GetDistortion()[i];
+
+  // Descriptors must be of the same kind in all frames
+  std::vector<int64_t> feature_offsets(num_frames + 1, 0);
+  header.descriptor_depth = CV_8U;
+  for (int cid = 0; cid < num_frames; cid++) {
+    cv::Mat const& descriptors = map.cid_to_descriptor_map_[cid];
+    CHECK(descriptors.rows == map.cid_to_keypoint_map_[cid].cols())
+      << "Number of descriptors and keypoints do not match.";
+    feature_offsets[cid + 1] = feature_offsets[cid] + descriptors.rows;
+    if (descriptors.rows == 0)
+      continue;
+    int bytes = descriptors.cols * descriptors.elemSize();
+    if (header.descriptor_bytes == 0) {
+      header.descriptor_depth = descriptors.depth();
+      header.descriptor_cols = descriptors.cols;
+      header.descriptor_bytes = bytes;
+    }
+    CHECK(descriptors.depth() == header.descriptor_depth && bytes == header.descriptor_bytes)
+      << "Mixed descriptor types in the map.";
+  }
+  header.num_features = feature_offsets[num_frames];
+
+  std::string filenames;
+  for (int cid = 0; cid < num_frames; cid++)
+    filenames += map.cid_to_filename_[cid] + '\0';
+
+  std::string vocab_db;
+  if (map.vocab_db_.binary_db != NULL) {
+    google::protobuf::io::StringOutputStream output(&vocab_db);
+    map.vocab_db_.SaveProtobuf(&output);
+    header.vocab_db_type = sparse_mapping_protobuf::Map::BINARYDB;
+  } else {
+    header.vocab_db_type = sparse_mapping_protobuf::Map::NONE;
+  }
+
+  // Lay out the sections
+  uint64_t num_features = header.num_features;
+  header.feature_offsets_pos = Align(sizeof(CompactMapHeader));
+  header.descriptors_pos = Align(header.feature_offsets_pos + sizeof(int64_t) * (num_frames + 1));
+  header.keypoints_pos = Align(header.descriptors_pos + num_features * header.descriptor_bytes);
+  header.fid_to_pid_pos = Align(header.keypoints_pos + sizeof(double) * 2 * num_features);
+  header.landmarks_pos = Align(header.fid_to_pid_pos + sizeof(int32_t) * num_features);
+  header.filenames_pos = Align(header.landmarks_pos + sizeof(double) * 3 * num_landmarks);
+  header.filenames_size = filenames.size();
+  header.vocab_db_pos = Align(header.filenames_pos + header.filenames_size);
+  header.vocab_db_size = vocab_db.size();
+
+  LOG(INFO) << "Writing: " << filename;
+  FILE* f = fopen(filename.c_str(), "wb");
+  if (f == NULL)
+    LOG(FATAL) << "Failed to open for writing: " << filename;
+
+  WriteAt(f, 0, &header, sizeof(header));
+  WriteAt(f, header.feature_offsets_pos, &feature_offsets[0], sizeof(int64_t) * (num_frames + 1));
+
+  uint64_t pos = header.descriptors_pos;
+  for (int cid = 0; cid < num_frames; cid++) {
+    cv::Mat const& descriptors = map.cid_to_descriptor_map_[cid];
+    for (int fid = 0; fid < descriptors.rows; fid++) {
+      WriteAt(f, pos, descriptors.ptr<uint8_t>(fid), header.descriptor_bytes);
+      pos += header.descriptor_bytes;
+    }
+  }
+
+  pos = header.keypoints_pos;
+  for (int cid = 0; cid < num_frames; cid++) {
+    Eigen::Matrix2Xd const& keypoints = map.cid_to_keypoint_map_[cid];
+    WriteAt(f, pos, keypoints.data(), sizeof(double) * keypoints.size());
+    pos += sizeof(double) * keypoints.size();
+  }
+
+  std::vector<int32_t> fid_to_pid(num_features, -1);
+  for (int cid = 0; cid < num_frames; cid++) {
+    for (std::pair<int, int> const& fid_pid : map.cid_fid_to_pid_[cid]) {
+      CHECK(fid_pid.first < feature_offsets[cid + 1] - feature_offsets[cid])
+        << "Book-keeping failure, landmark observed by a missing feature.";
+      fid_to_pid[feature_offsets[cid] + fid_pid.first] = fid_pid.second;
+    }
+  }
+  WriteAt(f, header.fid_to_pid_pos, fid_to_pid.data(), sizeof(int32_t) * num_features);
+
+  pos = header.landmarks_pos;
+  for (int pid = 0; pid < num_landmarks; pid++) {
+    WriteAt(f, pos, map.pid_to_xyz_[pid].data(), sizeof(double) * 3);
+    pos += sizeof(double) * 3;
+  }
+
+  WriteAt(f, header.filenames_pos, filenames.data(), filenames.size());
+  WriteAt(f, header.vocab_db_pos, vocab_db.data(), vocab_db.size());
+
+  if (fclose(f) != 0)
+    LOG(FATAL) << "Failed to write: " << filename;
+}
+
+}  // namespace sparse_mapping
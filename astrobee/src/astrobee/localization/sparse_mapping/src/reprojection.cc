@@ -27,12 +27,22 @@
 #include <opencv2/core/eigen.hpp>
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 #include <random>
 #include <thread>
 #include <unordered_map>
 
 DEFINE_uint64(num_min_localization_inliers, 10,
               "If fewer than this many number of inliers, localization has failed.");
+DEFINE_bool(ransac_adaptive, false,
+            "In RANSAC, sample the best matches first, stop scoring a pose once it can't "
+            "beat the best one, and stop when confident enough in the best pose, rather "
+            "than always doing the given number of iterations.");
+DEFINE_double(ransac_confidence, 0.999,
+              "With adaptive RANSAC, stop once the probability that a sample made of inliers "
+              "only was drawn exceeds this.");
 
 namespace sparse_mapping {
 
@@ -288,7 +298,7 @@ void EstimateCamera(camera::CameraModel* camera_estimate,
 
 // random intger in [min, max)
 int RandomInt(int min, int max) {
-  static std::mt19937 generator;  // should be thread_local for thread safe, gcc 4.6 doesn't support
+  thread_local std::mt19937 generator;
   std::uniform_int_distribution<int> random_item(min, max - 1);
   return random_item(generator);
 }
@@ -352,14 +362,99 @@ size_t CountInliers(const std::vector<Eigen::Vector3d> & landmarks, const std::v
   return num_inliers;
 }
 
+// Count the landmarks which project within the tolerance of their
+// observations, like CountInliers(), but a block of points at a
+// time, for the projections to be vectorized. Give up as soon as the
+// count can't exceed min_to_beat. If preemptive, also give up if
+// the inlier ratio in the first block is under half of the one of
+// min_to_beat, as then the pose is most likely not better either.
+// The count is exact only if it is more than min_to_beat.
+static size_t ScorePose(Eigen::Matrix3Xd const& landmarks, Eigen::Matrix2Xd const& observations,
+                        Eigen::Affine3d const& cam_t_global, Eigen::Vector2d const& focal_length,
+                        double tolerance_sq, size_t min_to_beat, bool preemptive) {
+  const int kBlock = 32;
+  int num_points = landmarks.cols();
+  size_t inliers = 0;
+  for (int start = 0; start < num_points; start += kBlock) {
+    int len = std::min(kBlock, num_points - start);
+    Eigen::Matrix3Xd in_camera = (cam_t_global.linear() * landmarks.middleCols(start, len)).colwise()
+      + cam_t_global.translation();
+    Eigen::Matrix2Xd pixels = focal_length.asDiagonal() * in_camera.colwise().hnormalized();
+    inliers += ((pixels - observations.middleCols(start, len)).colwise().squaredNorm().array()
+                <= tolerance_sq).count();
+
+    size_t remaining = num_points - start - len;
+    if (inliers + remaining <= min_to_beat)
+      return inliers;
+    if (preemptive && start == 0 && remaining > 0 &&
+        2 * inliers * num_points < min_to_beat * len)
+      return inliers;
+  }
+  return inliers;
+}
+
+// The number of samples of four points to draw for a sample with
+// only inliers to be found with the given confidence, if this
+// fraction of the points are inliers
+static double NumSamplesNeeded(double inlier_ratio, double confidence) {
+  double all_inliers = std::pow(inlier_ratio, 4);
+  if (all_inliers >= 1.0)
+    return 1.0;
+  if (all_inliers <= 0.0)
+    return std::numeric_limits<double>::max();
+  return std::log(1.0 - confidence) / std::log(1.0 - all_inliers);
+}
+
+// Draw samples from a growing set of the best matches first, as in
+// PROSAC. The landmarks and observations must be sorted from best to
+// worst match. At iteration i the sample has the point which was last
+// added to the set and three others from the set. The set grows so
+// that after half of the allowed iterations samples come from all
+// points, as in plain RANSAC.
+static void SelectProgressiveObservations(const std::vector<Eigen::Vector3d> & all_landmarks,
+                                          const std::vector<Eigen::Vector2d> & all_observations,
+                                          int iteration, int num_tries,
+                                          std::vector<cv::Point3d> * landmarks,
+                                          std::vector<cv::Point2d> * observations) {
+  const int kSampleSize = 4;
+  int num_points = all_observations.size();
+  int growth_iterations = std::max(num_tries / 2, 1);
+  int set_size = kSampleSize + static_cast<int>((static_cast<int64_t>(num_points - kSampleSize) *
+                                                 (iteration + 1)) / growth_iterations);
+  set_size = std::min(set_size, num_points);
+
+  int ids[kSampleSize];
+  int num_ids = 0;
+  if (set_size < num_points)
+    ids[num_ids++] = set_size - 1;
+  int draw_from = (set_size < num_points) ? set_size - 1 : set_size;
+  while (num_ids < kSampleSize) {
+    int id = RandomInt(0, draw_from);
+    if (std::find(ids, ids + num_ids, id) != ids + num_ids)
+      continue;
+    ids[num_ids++] = id;
+  }
+
+  landmarks->clear();
+  observations->clear();
+  for (int k = 0; k < kSampleSize; k++) {
+    Eigen::Vector3d const& p = all_landmarks[ids[k]];
+    landmarks->push_back(cv::Point3d(p[0], p[1], p[2]));
+    observations->push_back(cv::Point2d(all_observations[ids[k]][0], all_observations[ids[k]][1]));
+  }
+}
+
 int RansacEstimateCamera(const std::vector<Eigen::Vector3d> & landmarks,
                          const std::vector<Eigen::Vector2d> & observations,
                          int num_tries, int inlier_tolerance, camera::CameraModel * camera_estimate,
                          std::vector<Eigen::Vector3d> * inlier_landmarks_out,
                          std::vector<Eigen::Vector2d> * inlier_observations_out,
-                         bool verbose) {
+                         bool verbose, int * num_iterations_out) {
   size_t best_inliers = 0;
   camera::CameraParameters params = camera_estimate->GetParameters();
+  int num_iterations = 0;
+  if (num_iterations_out)
+    *num_iterations_out = 0;
 
   // Need the minimum number of observations
   if (observations.size() < 4)
@@ -368,11 +463,36 @@ int RansacEstimateCamera(const std::vector<Eigen::Vector3d> & landmarks,
   // RANSAC to find the best camera with P3P
   std::vector<cv::Point3d> subset_landmarks;
   std::vector<cv::Point2d> subset_observations;
-  // TODO(oalexan1): Use multiple threads here?
-  for (int i = 0; i < num_tries; i++) {
+
+  // For adaptive RANSAC, score the points in random order, so that any
+  // block of them is representative of all, as needed to give up
+  // scoring a pose early.
+  int num_points = observations.size();
+  Eigen::Matrix3Xd shuffled_landmarks;
+  Eigen::Matrix2Xd shuffled_observations;
+  if (FLAGS_ransac_adaptive) {
+    std::vector<int> order(num_points);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(num_points));
+    shuffled_landmarks.resize(3, num_points);
+    shuffled_observations.resize(2, num_points);
+    for (int i = 0; i < num_points; i++) {
+      shuffled_landmarks.col(i) = landmarks[order[i]];
+      shuffled_observations.col(i) = observations[order[i]];
+    }
+  }
+  double tolerance_sq = inlier_tolerance * inlier_tolerance;
+  double max_iterations = num_tries;
+
+  for (int i = 0; i < num_tries && i < max_iterations; i++) {
+    num_iterations++;
     subset_landmarks.clear();
     subset_observations.clear();
-    SelectRandomObservations(landmarks, observations, 4, &subset_landmarks, &subset_observations);
+    if (FLAGS_ransac_adaptive)
+      SelectProgressiveObservations(landmarks, observations, i, num_tries,
+                                    &subset_landmarks, &subset_observations);
+    else
+      SelectRandomObservations(landmarks, observations, 4, &subset_landmarks, &subset_observations);
 
     Eigen::Vector3d pos;
     Eigen::Matrix3d rotation;
@@ -383,18 +503,29 @@ int RansacEstimateCamera(const std::vector<Eigen::Vector3d> & landmarks,
     cam_t_global.setIdentity();
     cam_t_global.translate(pos);
     cam_t_global.rotate(rotation);
-    camera::CameraModel guess(cam_t_global, camera_estimate->GetParameters());
 
-    size_t inliers = CountInliers(landmarks, observations, guess, inlier_tolerance, NULL);
+    size_t inliers;
+    if (FLAGS_ransac_adaptive) {
+      inliers = ScorePose(shuffled_landmarks, shuffled_observations, cam_t_global,
+                          params.GetFocalVector(), tolerance_sq, best_inliers, true);
+    } else {
+      camera::CameraModel guess(cam_t_global, params);
+      inliers = CountInliers(landmarks, observations, guess, inlier_tolerance, NULL);
+    }
     if (inliers > best_inliers) {
       best_inliers = inliers;
-      *camera_estimate = guess;
+      *camera_estimate = camera::CameraModel(cam_t_global, params);
+      if (FLAGS_ransac_adaptive)
+        max_iterations = NumSamplesNeeded(static_cast<double>(best_inliers) / num_points,
+                                          FLAGS_ransac_confidence);
     }
   }
+  if (num_iterations_out)
+    *num_iterations_out = num_iterations;
 
   if (verbose)
     std::cout << observations.size() << " Ransac observations "
-              << best_inliers << " inliers\n";
+              << best_inliers << " inliers " << num_iterations << " iterations\n";
 
   // TODO(bcoltin): Return some sort of confidence?
   if (best_inliers < FLAGS_num_min_localization_inliers)
@@ -21,11 +21,13 @@
 #include <ff_common/thread.h>
 #include <ff_common/utils.h>
 #include <interest_point/matching.h>
+#include <sparse_mapping/compact_map.h>
 #include <sparse_mapping/reprojection.h>
 #include <sparse_mapping/sparse_mapping.h>
 #include <sparse_mapping/tensor.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
@@ -40,11 +42,13 @@
 #include<boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <queue>
 #include <set>
 #include <thread>
 #include <limits>
+#include <numeric>
 
 DEFINE_int32(num_similar, 20,
              "Use in localization this many images which "
@@ -59,8 +63,11 @@ DEFINE_bool(histogram_equalization, false,
             "If true, equalize the histogram for images to improve robustness to illumination conditions.");
 DEFINE_int32(num_extra_localization_db_images, 0,
              "Match this many extra images from the Vocab DB, only keep num_similar.");
+DEFINE_int32(num_matching_threads, 1,
+             "Use in localization this many threads to match against the most similar images.");
 DEFINE_bool(verbose_localization, false,
             "If true, list the images most similar to the one being localized.");
+DECLARE_bool(ransac_adaptive);  // its value will be pulled from reprojection.cc
 
 namespace sparse_mapping {
 
@@ -74,6 +81,7 @@ SparseMap::SparseMap(const std::vector<std::string> & filenames,
         ransac_inlier_tolerance_(FLAGS_ransac_inlier_tolerance),
         early_break_landmarks_(FLAGS_early_break_landmarks),
         histogram_equalization_(FLAGS_histogram_equalization) {
+  SetNumMatchingThreads(FLAGS_num_matching_threads);
   cid_to_descriptor_map_.resize(cid_to_filename_.size());
   // TODO(bcoltin): only record scale and orientation for opensift?
   cid_to_keypoint_map_.resize(cid_to_filename_.size());
@@ -87,6 +95,7 @@ SparseMap::SparseMap(const std::string & protobuf_file, bool localization) :
   ransac_inlier_tolerance_(FLAGS_ransac_inlier_tolerance),
   early_break_landmarks_(FLAGS_early_break_landmarks),
   histogram_equalization_(FLAGS_histogram_equalization) {
+  SetNumMatchingThreads(FLAGS_num_matching_threads);
   // The above camera params used bad values because we are expected to reload
   // later.
   Load(protobuf_file, localization);
@@ -103,6 +112,7 @@ SparseMap::SparseMap(const std::vector<Eigen::Affine3d>& cid_to_cam_t,
   ransac_inlier_tolerance_(FLAGS_ransac_inlier_tolerance),
   early_break_landmarks_(FLAGS_early_break_landmarks),
   histogram_equalization_(FLAGS_histogram_equalization) {
+  SetNumMatchingThreads(FLAGS_num_matching_threads);
   if (filenames.size() != cid_to_cam_t.size())
     LOG(FATAL) << "Expecting as many images as cameras";
 
@@ -131,6 +141,7 @@ SparseMap::SparseMap(bool bundler_format, std::string const& filename, std::vect
       ransac_inlier_tolerance_(FLAGS_ransac_inlier_tolerance),
       early_break_landmarks_(FLAGS_early_break_landmarks),
       histogram_equalization_(FLAGS_histogram_equalization) {
+  SetNumMatchingThreads(FLAGS_num_matching_threads);
   std::string ext = ff_common::file_extension(filename);
   boost::to_lower(ext);
 
@@ -268,6 +279,14 @@ void SparseMap::DetectFeatures() {
 }
 
 void SparseMap::Load(const std::string & protobuf_file, bool localization) {
+  if (CompactMap::IsCompactMap(protobuf_file)) {
+    if (!localization)
+      LOG(FATAL) << "A compact map can be loaded only for localization: " << protobuf_file;
+    LoadCompact(protobuf_file);
+    return;
+  }
+  compact_map_.reset();
+
   sparse_mapping_protobuf::Map map;
   int input_fd = open(protobuf_file.c_str(), O_RDONLY);
   if (input_fd < 0)
@@ -374,7 +393,9 @@ void SparseMap::Load(const std::string & protobuf_file, bool localization) {
     } else {
       // Create directly cid_fid_to_pid
       cid_fid_to_pid_.clear();
-      cid_fid_to_pid_.resize(cid_to_filename_.size(), std::map<int, int>());
+      cid_fid_to_pid_.resize(cid_to_filename_.size());
+      for (size_t cid = 0; cid < cid_to_filename_.size(); cid++)
+        cid_fid_to_pid_[cid].Reserve(cid_to_descriptor_map_[cid].rows);
     }
 
     for (int i = 0; i < num_landmarks; i++) {
@@ -389,7 +410,7 @@ void SparseMap::Load(const std::string & protobuf_file, bool localization) {
         if (!localization)
           pid_to_cid_fid_[i][m.camera_id()] = m.feature_id();
         else
-          cid_fid_to_pid_[m.camera_id()][m.feature_id()] = i;
+          cid_fid_to_pid_[m.camera_id()].Set(m.feature_id(), i);
       }
     }
 
@@ -401,6 +422,11 @@ void SparseMap::Load(const std::string & protobuf_file, bool localization) {
     LOG(WARNING) << "There appear to be no landmarks in map file.";
   }
 
+  // Localization queries the same keyframes over and over, so build
+  // their search indices once here rather than on every query.
+  if (localization)
+    InitializeMatchers();
+
   if (map.has_vocab_db())
     vocab_db_.LoadProtobuf(input, map.vocab_db());
 
@@ -422,6 +448,57 @@ void SparseMap::Load(const std::string & protobuf_file, bool localization) {
   close(input_fd);
 }
 
+void SparseMap::LoadCompact(const std::string & compact_file) {
+  compact_map_.reset(new CompactMap(compact_file));
+  CompactMapHeader const& header = compact_map_->Header();
+
+  detector_.Reset(header.detector_name);
+
+  typedef Eigen::Vector2d V2d;
+  typedef Eigen::Vector2i V2i;
+  camera_params_.SetFocalLength(V2d(header.focal_length[0], header.focal_length[1]));
+  camera_params_.SetOpticalOffset(V2d(header.optical_offset[0], header.optical_offset[1]));
+  camera_params_.SetDistortedSize(V2i(header.distorted_image_size[0],
+                                      header.distorted_image_size[1]));
+  camera_params_.SetUndistortedSize(V2i(header.undistorted_image_size[0],
+                                        header.undistorted_image_size[1]));
+  Eigen::VectorXd distortion(header.num_distortion);
+  for (int i = 0; i < header.num_distortion; i++)
+    distortion[i] = header.distortion[i];
+  camera_params_.SetDistortion(distortion);
+
+  // The descriptors are not copied, only wrapped. The landmark
+  // positions are small enough to copy.
+  int num_frames = compact_map_->NumFrames();
+  int num_landmarks = compact_map_->NumLandmarks();
+  cid_to_filename_.resize(num_frames);
+  cid_to_descriptor_map_.resize(num_frames);
+  const char* filename = compact_map_->Filenames();
+  for (int cid = 0; cid < num_frames; cid++) {
+    cid_to_filename_[cid] = filename;
+    filename += cid_to_filename_[cid].size() + 1;
+    cid_to_descriptor_map_[cid] = compact_map_->Descriptors(cid);
+  }
+  pid_to_xyz_.resize(num_landmarks);
+  for (int pid = 0; pid < num_landmarks; pid++)
+    pid_to_xyz_[pid] = compact_map_->Landmark(pid);
+
+  // Only in the full map, or looked up in the compact map directly
+  cid_to_keypoint_map_.clear();
+  cid_to_cam_t_global_.clear();
+  pid_to_cid_fid_.clear();
+  cid_fid_to_pid_.clear();
+
+  if (header.vocab_db_type != sparse_mapping_protobuf::Map::NONE) {
+    google::protobuf::io::ArrayInputStream input(compact_map_->VocabDB(), header.vocab_db_size);
+    vocab_db_.LoadProtobuf(&input, header.vocab_db_type);
+  }
+
+  histogram_equalization_ = header.histogram_equalization;
+
+  InitializeMatchers();
+}
+
 void SparseMap::SetDetectorParams(int min_features, int max_features, int retries,
                                   double min_thresh, double default_thresh, double max_thresh) {
   mutex_detector_.lock();
@@ -430,6 +507,15 @@ void SparseMap::SetDetectorParams(int min_features, int max_features, int retrie
   mutex_detector_.unlock();
 }
 
+void SparseMap::SetNumMatchingThreads(int num_matching_threads) {
+  num_matching_threads_ = std::max(num_matching_threads, 1);
+  // The localizing thread does its share of the matching
+  if (num_matching_threads_ == 1)
+    matching_pool_.reset();
+  else if (!matching_pool_ || matching_pool_->NumThreads() + 1 != num_matching_threads_)
+    matching_pool_.reset(new ff_common::ThreadPool(num_matching_threads_ - 1));
+}
+
 void SparseMap::Save(const std::string & protobuf_file) const {
   // For backward compatibility with old maps, allow a map to have its
   // histogram_equalization flag unspecified, but it is best to avoid
@@ -559,13 +645,13 @@ void SparseMap::Save(const std::string & protobuf_file) const {
 // From pid_to_cid_fid, create cid_fid_to_pid for lookup.
 void InitializeCidFidToPid(int num_cid,
                            std::vector<std::map<int, int> > const& pid_to_cid_fid,
-                           std::vector<std::map<int, int> > * cid_fid_to_pid) {
+                           CidFidToPid * cid_fid_to_pid) {
   cid_fid_to_pid->clear();
-  cid_fid_to_pid->resize(num_cid, std::map<int, int>());
+  cid_fid_to_pid->resize(num_cid);
 
   for (size_t pid = 0; pid < pid_to_cid_fid.size(); pid++) {
     for (std::pair<int, int> const& cid_fid : pid_to_cid_fid[pid]) {
-      (*cid_fid_to_pid)[cid_fid.first][cid_fid.second] = pid;
+      (*cid_fid_to_pid)[cid_fid.first].Set(cid_fid.second, pid);
     }
   }
 }
@@ -576,6 +662,13 @@ void SparseMap::InitializeCidFidToPid() {
                                         &cid_fid_to_pid_);
 }
 
+void SparseMap::InitializeMatchers() {
+  cid_to_matcher_.clear();
+  cid_to_matcher_.reserve(cid_to_descriptor_map_.size());
+  for (size_t cid = 0; cid < cid_to_descriptor_map_.size(); cid++)
+    cid_to_matcher_.push_back(interest_point::BuildMatcher(cid_to_descriptor_map_[cid]));
+}
+
 void SparseMap::DetectFeaturesFromFile(std::string const& filename,
                                        bool multithreaded,
                                        cv::Mat* descriptors,
@@ -634,36 +727,43 @@ void SparseMap::DetectFeatures(const cv::Mat& image,
   if (FLAGS_verbose_localization)
     std::cout << "Features detected " << storage.size() << std::endl;
 
-  keypoints->resize(2, storage.size());
-  Eigen::Vector2d output;
+  // Undistort all keypoints in one pass
+  Eigen::Matrix2Xd distorted(2, storage.size());
+  for (size_t j = 0; j < storage.size(); j++)
+    distorted.col(j) << storage[j].pt.x, storage[j].pt.y;
+  camera_params_.Convert<camera::DISTORTED_C, camera::UNDISTORTED_C>(distorted, keypoints);
+}
 
-  for (size_t j = 0; j < storage.size(); j++) {
-    camera_params_.Convert<camera::DISTORTED_C, camera::UNDISTORTED_C>
-      (Eigen::Vector2d(storage[j].pt.x, storage[j].pt.y), &output);
-    keypoints->col(j) = output;
-  }
+// The landmark a feature is an observation of, or -1 if none, for each
+// way of storing this.
+static int FidToPid(CidFidToPid const& cid_fid_to_pid, int cid, int fid) {
+  return cid_fid_to_pid[cid].Pid(fid);
+}
+static int FidToPid(CompactMap const& compact_map, int cid, int fid) {
+  return compact_map.Pid(cid, fid);
 }
 
-// A non-member Localize() function that can be invoked for a non-fully
-// formed map.
-bool Localize(cv::Mat const& test_descriptors,
-              Eigen::Matrix2Xd const& test_keypoints,
-              camera::CameraParameters const& camera_params,
-              camera::CameraModel* pose,
-              std::vector<Eigen::Vector3d>* inlier_landmarks,
-              std::vector<Eigen::Vector2d>* inlier_observations,
-              int num_cid,
-              std::string const& detector_name,
-              sparse_mapping::VocabDB * vocab_db,
-              int num_similar,
-              std::vector<std::string> const& cid_to_filename,
-              std::vector<cv::Mat> const& cid_to_descriptor_map,
-              std::vector<Eigen::Matrix2Xd > const& cid_to_keypoint_map,
-              std::vector<std::map<int, int> > const& cid_fid_to_pid,
-              std::vector<Eigen::Vector3d> const& pid_to_xyz,
-              int num_ransac_iterations, int ransac_inlier_tolerance,
-              int early_break_landmarks, int histogram_equalization,
-              std::vector<int> * cid_list) {
+// The first half of localization, finding the landmarks that the
+// features of the image are observations of.
+template <class FidToPidLookup>
+static void MatchToMapImpl(cv::Mat const& test_descriptors,
+                           Eigen::Matrix2Xd const& test_keypoints,
+                           int num_cid,
+                           std::string const& detector_name,
+                           sparse_mapping::VocabDB * vocab_db,
+                           int num_similar,
+                           std::vector<std::string> const& cid_to_filename,
+                           std::vector<cv::Mat> const& cid_to_descriptor_map,
+                           std::vector<cv::Ptr<cv::DescriptorMatcher> > const& cid_to_matcher,
+                           FidToPidLookup const& cid_fid_to_pid,
+                           std::vector<Eigen::Vector3d> const& pid_to_xyz,
+                           int early_break_landmarks,
+                           ff_common::ThreadPool * matching_pool,
+                           std::vector<int> * cid_list,
+                           std::vector<Eigen::Vector3d> * landmarks,
+                           std::vector<Eigen::Vector2d> * observations) {
+  landmarks->clear();
+  observations->clear();
   std::vector<int> indices;
   // Query the vocab tree.
   if (cid_list == NULL)
@@ -696,34 +796,64 @@ bool Localize(cv::Mat const& test_descriptors,
   // which have most observations in common with the current one.
   std::vector<int> similarity_rank(indices.size(), 0);
   std::vector<std::vector<cv::DMatch> > all_matches(indices.size());
-  int total = 0;
-  // TODO(oalexan1): Use multiple threads here?
-  for (size_t i = 0; i < indices.size(); i++) {
+  auto match_image = [&](int i) {
     int cid = indices[i];
-    interest_point::FindMatches(test_descriptors,
-                                cid_to_descriptor_map[cid],
-                                &all_matches[i]);
+    // Use the prebuilt search index for this image if the map has one
+    if (!cid_to_matcher.empty())
+      interest_point::FindMatches(test_descriptors,
+                                  cid_to_matcher[cid],
+                                  &all_matches[i]);
+    else
+      interest_point::FindMatches(test_descriptors,
+                                  cid_to_descriptor_map[cid],
+                                  &all_matches[i]);
 
     for (size_t j = 0; j < all_matches[i].size(); j++) {
-      if (cid_fid_to_pid[cid].count(all_matches[i][j].trainIdx) == 0)
+      if (FidToPid(cid_fid_to_pid, cid, all_matches[i][j].trainIdx) < 0)
         continue;
       similarity_rank[i]++;
     }
-    if (FLAGS_verbose_localization)
-      std::cout << "Overall matches and validated matches to: "
-                << cid_to_filename[cid] << ": "
-                << all_matches[i].size() << " "
-                << similarity_rank[i] << "\n";
-    total += similarity_rank[i];
-    if (total >= early_break_landmarks)
-      break;
+  };
+
+  // Match against as many images at a time as there are threads. Then
+  // tally them in order, so that we break early after the same image
+  // as when matching one image at a time.
+  int num_threads = (matching_pool == NULL) ? 1 : matching_pool->NumThreads() + 1;
+  int num_images = indices.size();
+  int total = 0;
+  bool early_break = false;
+  for (int start = 0; start < num_images && !early_break; start += num_threads) {
+    int end = std::min(start + num_threads, num_images);
+    if (matching_pool == NULL)
+      match_image(start);
+    else
+      matching_pool->ParallelFor(start, end, 1, [&](size_t chunk_begin, size_t chunk_end) {
+          for (size_t i = chunk_begin; i < chunk_end; i++)
+            match_image(i);
+        });
+
+    for (int i = start; i < end; i++) {
+      if (early_break) {
+        // Forget the matches made past the cutoff
+        all_matches[i].clear();
+        similarity_rank[i] = 0;
+        continue;
+      }
+      if (FLAGS_verbose_localization)
+        std::cout << "Overall matches and validated matches to: "
+                  << cid_to_filename[indices[i]] << ": "
+                  << all_matches[i].size() << " "
+                  << similarity_rank[i] << "\n";
+      total += similarity_rank[i];
+      if (total >= early_break_landmarks)
+        early_break = true;
+    }
   }
 
-  std::vector<Eigen::Vector2d> observations;
-  std::vector<Eigen::Vector3d> landmarks;
   std::vector<int> highly_ranked = ff_common::rv_order(similarity_rank);
   int end = std::min(static_cast<int>(highly_ranked.size()), num_similar);
   std::set<int> seen_landmarks;
+  std::vector<float> distances;  // of the descriptors of each correspondence
   if (FLAGS_verbose_localization)
     std::cout << "Similar images: ";
   for (int i = 0; i < end; i++) {
@@ -731,15 +861,16 @@ bool Localize(cv::Mat const& test_descriptors,
     std::vector<cv::DMatch>* matches = &all_matches[highly_ranked[i]];
     int num_matches = 0;
     for (size_t j = 0; j < matches->size(); j++) {
-      if (cid_fid_to_pid[cid].count(matches->at(j).trainIdx) == 0)
+      const int landmark_id = FidToPid(cid_fid_to_pid, cid, matches->at(j).trainIdx);
+      if (landmark_id < 0)
         continue;
-      const int landmark_id = cid_fid_to_pid.at(cid).at(matches->at(j).trainIdx);
       if (seen_landmarks.count(landmark_id) > 0)
         continue;
       Eigen::Vector2d obs(test_keypoints.col(matches->at(j).queryIdx)[0],
                           test_keypoints.col(matches->at(j).queryIdx)[1]);
-      observations.push_back(obs);
-      landmarks.push_back(pid_to_xyz[landmark_id]);
+      observations->push_back(obs);
+      landmarks->push_back(pid_to_xyz[landmark_id]);
+      distances.push_back(matches->at(j).distance);
       seen_landmarks.insert(landmark_id);
       num_matches++;
     }
@@ -748,6 +879,52 @@ bool Localize(cv::Mat const& test_descriptors,
   }
   if (FLAGS_verbose_localization) std::cout << std::endl;
 
+  // Adaptive RANSAC tries the best matches first, so sort them by
+  // distance. A stable sort keeps the order of equally good matches.
+  if (!FLAGS_ransac_adaptive)
+    return;
+  std::vector<int> order(distances.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&distances](int a, int b) {return distances[a] < distances[b];});
+  std::vector<Eigen::Vector3d> sorted_landmarks(order.size());
+  std::vector<Eigen::Vector2d> sorted_observations(order.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    sorted_landmarks[k] = (*landmarks)[order[k]];
+    sorted_observations[k] = (*observations)[order[k]];
+  }
+  landmarks->swap(sorted_landmarks);
+  observations->swap(sorted_observations);
+}
+
+template <class FidToPidLookup>
+static bool LocalizeImpl(cv::Mat const& test_descriptors,
+                         Eigen::Matrix2Xd const& test_keypoints,
+                         camera::CameraParameters const& camera_params,
+                         camera::CameraModel* pose,
+                         std::vector<Eigen::Vector3d>* inlier_landmarks,
+                         std::vector<Eigen::Vector2d>* inlier_observations,
+                         int num_cid,
+                         std::string const& detector_name,
+                         sparse_mapping::VocabDB * vocab_db,
+                         int num_similar,
+                         std::vector<std::string> const& cid_to_filename,
+                         std::vector<cv::Mat> const& cid_to_descriptor_map,
+                         std::vector<cv::Ptr<cv::DescriptorMatcher> > const& cid_to_matcher,
+                         std::vector<Eigen::Matrix2Xd > const& cid_to_keypoint_map,
+                         FidToPidLookup const& cid_fid_to_pid,
+                         std::vector<Eigen::Vector3d> const& pid_to_xyz,
+                         int num_ransac_iterations, int ransac_inlier_tolerance,
+                         int early_break_landmarks, int histogram_equalization,
+                         ff_common::ThreadPool * matching_pool,
+                         std::vector<int> * cid_list) {
+  std::vector<Eigen::Vector3d> landmarks;
+  std::vector<Eigen::Vector2d> observations;
+  MatchToMapImpl(test_descriptors, test_keypoints, num_cid, detector_name, vocab_db,
+                 num_similar, cid_to_filename, cid_to_descriptor_map, cid_to_matcher,
+                 cid_fid_to_pid, pid_to_xyz, early_break_landmarks, matching_pool,
+                 cid_list, &landmarks, &observations);
+
   int ret = RansacEstimateCamera(landmarks, observations,
                                  num_ransac_iterations,
                                  ransac_inlier_tolerance, pose,
@@ -756,6 +933,38 @@ bool Localize(cv::Mat const& test_descriptors,
   return (ret == 0);
 }
 
+
+// A non-member Localize() function that can be invoked for a non-fully
+// formed map.
+bool Localize(cv::Mat const& test_descriptors,
+              Eigen::Matrix2Xd const& test_keypoints,
+              camera::CameraParameters const& camera_params,
+              camera::CameraModel* pose,
+              std::vector<Eigen::Vector3d>* inlier_landmarks,
+              std::vector<Eigen::Vector2d>* inlier_observations,
+              int num_cid,
+              std::string const& detector_name,
+              sparse_mapping::VocabDB * vocab_db,
+              int num_similar,
+              std::vector<std::string> const& cid_to_filename,
+              std::vector<cv::Mat> const& cid_to_descriptor_map,
+              std::vector<cv::Ptr<cv::DescriptorMatcher> > const& cid_to_matcher,
+              std::vector<Eigen::Matrix2Xd > const& cid_to_keypoint_map,
+              CidFidToPid const& cid_fid_to_pid,
+              std::vector<Eigen::Vector3d> const& pid_to_xyz,
+              int num_ransac_iterations, int ransac_inlier_tolerance,
+              int early_break_landmarks, int histogram_equalization,
+              ff_common::ThreadPool * matching_pool,
+              std::vector<int> * cid_list) {
+  return LocalizeImpl(test_descriptors, test_keypoints, camera_params, pose,
+                      inlier_landmarks, inlier_observations, num_cid, detector_name,
+                      vocab_db, num_similar, cid_to_filename, cid_to_descriptor_map,
+                      cid_to_matcher, cid_to_keypoint_map, cid_fid_to_pid, pid_to_xyz,
+                      num_ransac_iterations, ransac_inlier_tolerance,
+                      early_break_landmarks, histogram_equalization,
+                      matching_pool, cid_list);
+}
+
 bool SparseMap::Localize(std::string const& img_file,
                          camera::CameraModel* pose,
                          std::vector<Eigen::Vector3d>* inlier_landmarks,
@@ -765,24 +974,8 @@ bool SparseMap::Localize(std::string const& img_file,
   Eigen::Matrix2Xd test_keypoints;
   bool multithreaded = false;
   DetectFeaturesFromFile(img_file, multithreaded, &test_descriptors, &test_keypoints);
-  return sparse_mapping::Localize(test_descriptors, test_keypoints,
-                                  std::cref(camera_params_),
-                                  pose,
-                                  inlier_landmarks, inlier_observations,
-                                  cid_to_filename_.size(),
-                                  detector_.GetDetectorName(),
-                                  &vocab_db_,
-                                  num_similar_,
-                                  cid_to_filename_,
-                                  cid_to_descriptor_map_,
-                                  cid_to_keypoint_map_,
-                                  cid_fid_to_pid_,
-                                  pid_to_xyz_,
-                                  num_ransac_iterations_,
-                                  ransac_inlier_tolerance_,
-                                  early_break_landmarks_,
-                                  histogram_equalization_,
-                                  cid_list);
+  return Localize(test_descriptors, test_keypoints, pose,
+                  inlier_landmarks, inlier_observations, cid_list);
 }
 
 // delete all the features that do not match to a landmark but are still around!
@@ -791,9 +984,9 @@ void SparseMap::PruneMap(void) {
   // This is a good sanity check, print things before we start pruning
   for (unsigned int cid = 0; cid < cid_fid_to_pid_.size(); cid++) {
     for (int fid = 0; fid < cid_to_descriptor_map_[cid].rows; fid++) {
-      if (cid_fid_to_pid_[cid].count(fid) == 0)
+      if (!cid_fid_to_pid_[cid].Has(fid))
         continue;
-      int pid = cid_fid_to_pid_[cid][fid];
+      int pid = cid_fid_to_pid_[cid].Pid(fid);
       int rows = cid_to_keypoint_map_[cid].rows();  // must be equal to 2
       std::cout << "Value before: "
                 << cid << ' ' << fid << ' ' << cid_to_descriptor_map_[cid].row(fid) << ' '
@@ -807,7 +1000,7 @@ void SparseMap::PruneMap(void) {
     std::vector<int> deleted_features;
     for (int fid = 0; fid < cid_to_descriptor_map_[cid].rows; fid++) {
       // delete if no matching landmark!
-      if (cid_fid_to_pid_[cid].count(fid) == 0) {
+      if (!cid_fid_to_pid_[cid].Has(fid)) {
         deleted_features.push_back(fid);
       }
     }
@@ -820,18 +1013,18 @@ void SparseMap::PruneMap(void) {
     int new_fid = 0;
     for (int fid = 0; fid < cid_to_descriptor_map_[cid].rows; fid++) {
       // delete if no matching landmark!
-      if (cid_fid_to_pid_[cid].count(fid) == 0) {
+      if (!cid_fid_to_pid_[cid].Has(fid)) {
         continue;
       } else {
         cid_to_descriptor_map_[cid].row(fid).copyTo(next_descriptor_map.row(new_fid));
         // fix indexing
         if (new_fid < fid) {
-          int pid = cid_fid_to_pid_[cid][fid];
+          int pid = cid_fid_to_pid_[cid].Pid(fid);
           // in localization mode this is empty
           if (pid_to_cid_fid_.size() > 0)
             pid_to_cid_fid_[pid][cid] = new_fid;
-          cid_fid_to_pid_[cid][new_fid] = pid;
-          cid_fid_to_pid_[cid].erase(fid);
+          cid_fid_to_pid_[cid].Set(new_fid, pid);
+          cid_fid_to_pid_[cid].Erase(fid);
         }
         new_fid++;
       }
@@ -859,13 +1052,17 @@ void SparseMap::PruneMap(void) {
   // This is not strictly necessary as all book-keeping was already done
   InitializeCidFidToPid();
 
+  // The search indices, if any, refer to the old descriptors
+  if (!cid_to_matcher_.empty())
+    InitializeMatchers();
+
 #if 0
   // We must get everything same as before, except fid
   for (unsigned int cid = 0; cid < cid_fid_to_pid_.size(); cid++) {
     for (int fid = 0; fid < cid_to_descriptor_map_[cid].rows; fid++) {
-      if (cid_fid_to_pid_[cid].count(fid) == 0)
+      if (!cid_fid_to_pid_[cid].Has(fid))
         continue;
-      int pid = cid_fid_to_pid_[cid][fid];
+      int pid = cid_fid_to_pid_[cid].Pid(fid);
       int rows = cid_to_keypoint_map_[cid].rows();  // must be equal to 2
       std::cout << "Value after: "
                 << cid << ' ' << fid << ' ' << cid_to_descriptor_map_[cid].row(fid) << ' '
@@ -896,6 +1093,7 @@ void SparseMap::reorderMap(std::map<int, int> const& old_cid_to_new_cid) {
   user_pid_to_cid_fid_.clear();
   user_pid_to_xyz_.clear();
   cid_fid_to_pid_.clear();  // Will recreate this later
+  cid_to_matcher_.clear();
 
   // Must create temporary structures
   std::vector<std::string>        new_cid_to_filename(num_cid);
@@ -957,24 +1155,8 @@ bool SparseMap::Localize(const cv::Mat & image, camera::CameraModel* pose,
   cv::Mat test_descriptors;
   Eigen::Matrix2Xd test_keypoints;
   DetectFeatures(image, multithreaded, &test_descriptors, &test_keypoints);
-  return sparse_mapping::Localize(test_descriptors, test_keypoints,
-                                  std::cref(camera_params_),
-                                  pose,
-                                  inlier_landmarks, inlier_observations,
-                                  cid_to_filename_.size(),
-                                  detector_.GetDetectorName(),
-                                  &vocab_db_,
-                                  num_similar_,
-                                  cid_to_filename_,
-                                  cid_to_descriptor_map_,
-                                  cid_to_keypoint_map_,
-                                  cid_fid_to_pid_,
-                                  pid_to_xyz_,
-                                  num_ransac_iterations_,
-                                  ransac_inlier_tolerance_,
-                                  early_break_landmarks_,
-                                  histogram_equalization_,
-                                  cid_list);
+  return Localize(test_descriptors, test_keypoints, pose,
+                  inlier_landmarks, inlier_observations, cid_list);
 }
 
 bool SparseMap::Localize(const cv::Mat & test_descriptors, const Eigen::Matrix2Xd & test_keypoints,
@@ -982,24 +1164,60 @@ bool SparseMap::Localize(const cv::Mat & test_descriptors, const Eigen::Matrix2X
                          std::vector<Eigen::Vector3d>* inlier_landmarks,
                          std::vector<Eigen::Vector2d>* inlier_observations,
                          std::vector<int> * cid_list) {
-  return sparse_mapping::Localize(test_descriptors, test_keypoints,
-                                  std::cref(camera_params_),
-                                  pose,
-                                  inlier_landmarks, inlier_observations,
-                                  cid_to_filename_.size(),
-                                  detector_.GetDetectorName(),
-                                  &vocab_db_,
-                                  num_similar_,
-                                  cid_to_filename_,
-                                  cid_to_descriptor_map_,
-                                  cid_to_keypoint_map_,
-                                  cid_fid_to_pid_,
-                                  pid_to_xyz_,
-                                  num_ransac_iterations_,
-                                  ransac_inlier_tolerance_,
-                                  early_break_landmarks_,
-                                  histogram_equalization_,
-                                  cid_list);
+  std::vector<Eigen::Vector3d> landmarks;
+  std::vector<Eigen::Vector2d> observations;
+  MatchToMap(test_descriptors, test_keypoints, &landmarks, &observations, cid_list);
+  return EstimatePose(landmarks, observations, pose, inlier_landmarks, inlier_observations);
+}
+
+void SparseMap::MatchToMap(const cv::Mat & test_descriptors, const Eigen::Matrix2Xd & test_keypoints,
+                           std::vector<Eigen::Vector3d>* landmarks,
+                           std::vector<Eigen::Vector2d>* observations,
+                           std::vector<int> * cid_list) {
+  // A compact map has the landmark of each feature in place of cid_fid_to_pid_
+  if (compact_map_)
+    MatchToMapImpl(test_descriptors, test_keypoints,
+                   cid_to_filename_.size(),
+                   detector_.GetDetectorName(),
+                   &vocab_db_,
+                   num_similar_,
+                   cid_to_filename_,
+                   cid_to_descriptor_map_,
+                   cid_to_matcher_,
+                   *compact_map_,
+                   pid_to_xyz_,
+                   early_break_landmarks_,
+                   matching_pool_.get(),
+                   cid_list,
+                   landmarks, observations);
+  else
+    MatchToMapImpl(test_descriptors, test_keypoints,
+                   cid_to_filename_.size(),
+                   detector_.GetDetectorName(),
+                   &vocab_db_,
+                   num_similar_,
+                   cid_to_filename_,
+                   cid_to_descriptor_map_,
+                   cid_to_matcher_,
+                   cid_fid_to_pid_,
+                   pid_to_xyz_,
+                   early_break_landmarks_,
+                   matching_pool_.get(),
+                   cid_list,
+                   landmarks, observations);
+}
+
+bool SparseMap::EstimatePose(std::vector<Eigen::Vector3d> const& landmarks,
+                             std::vector<Eigen::Vector2d> const& observations,
+                             camera::CameraModel* pose,
+                             std::vector<Eigen::Vector3d>* inlier_landmarks,
+                             std::vector<Eigen::Vector2d>* inlier_observations) const {
+  int ret = RansacEstimateCamera(landmarks, observations,
+                                 num_ransac_iterations_,
+                                 ransac_inlier_tolerance_, pose,
+                                 inlier_landmarks, inlier_observations,
+                                 FLAGS_verbose_localization);
+  return (ret == 0);
 }
 
 }  // namespace sparse_mapping
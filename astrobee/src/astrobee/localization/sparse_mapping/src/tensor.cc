@@ -397,7 +397,7 @@ void IncrementalBA(std::string const& essential_file,
   std::vector<std::map<int, int> > pid_to_cid_fid_local;
   std::vector<Eigen::Affine3d > cid_to_cam_t_local;
   std::vector<Eigen::Vector3d> pid_to_xyz_local;
-  std::vector<std::map<int, int> > cid_fid_to_pid_local;
+  CidFidToPid cid_fid_to_pid_local;
 
   bool rm_invalid_xyz = true;
 
@@ -435,7 +435,7 @@ void IncrementalBA(std::string const& essential_file,
     // Perform triangulation of all points. Multiview triangulation is
     // used.
     pid_to_xyz_local.clear();
-    std::vector<std::map<int, int> > cid_fid_to_pid_local;
+    CidFidToPid cid_fid_to_pid_local;
     sparse_mapping::Triangulate(rm_invalid_xyz,
                                 s->camera_params_.GetFocalLength(),
                                 cid_to_cam_t_local,
@@ -827,8 +827,8 @@ void TransformTracks(std::map<int, int> const& cid2cid,
 // just one candidate from each map, based on who got most votes. Note
 // that here it is easier to work with A.cid_fid_to_pid_ rather than
 // A.pid_to_cid_fid_.
-void FindPidCorrespondences(std::vector<std::map<int, int> > const& A_cid_fid_to_pid,
-                            std::vector<std::map<int, int> > const& B_cid_fid_to_pid,
+void FindPidCorrespondences(CidFidToPid const& A_cid_fid_to_pid,
+                            CidFidToPid const& B_cid_fid_to_pid,
                             std::vector<std::map<int, int> > const& C_pid_to_cid_fid,
                             int num_acid,  // How many images are in A
                             std::map<int, int> * A2B, std::map<int, int> * B2A) {
@@ -850,14 +850,11 @@ void FindPidCorrespondences(std::vector<std::map<int, int> > const& A_cid_fid_to
         // Subtract num_acid from cid_b so it becomes a cid in B.
         cid_b -= num_acid;
 
-        auto it_fida = A_cid_fid_to_pid[cid_a].find(fid_a);
-        if (it_fida == A_cid_fid_to_pid[cid_a].end()) continue;
+        int pid_a = A_cid_fid_to_pid[cid_a].Pid(fid_a);
+        if (pid_a == FidToPidMap::kNoPid) continue;
 
-        auto it_fidb = B_cid_fid_to_pid[cid_b].find(fid_b);
-        if (it_fidb == B_cid_fid_to_pid[cid_b].end()) continue;
-
-        int pid_a = it_fida->second;
-        int pid_b = it_fidb->second;
+        int pid_b = B_cid_fid_to_pid[cid_b].Pid(fid_b);
+        if (pid_b == FidToPidMap::kNoPid) continue;
 
         VoteMap[pid_a][pid_b]++;
       }
@@ -1019,22 +1016,20 @@ void findTracksForSharedImages(sparse_mapping::SparseMap * A_in,
     if (A.cid_to_keypoint_map_[cid_a] != B.cid_to_keypoint_map_[cid_b])
       LOG(FATAL) << "The input maps don't have the same features. They need to be rebuilt.";
 
-    auto a_fid_to_pid = A.cid_fid_to_pid_[cid_a];
-    auto b_fid_to_pid = B.cid_fid_to_pid_[cid_b];
+    FidToPidMap const& a_fid_to_pid = A.cid_fid_to_pid_[cid_a];
+    FidToPidMap const& b_fid_to_pid = B.cid_fid_to_pid_[cid_b];
 
     // Find tracks corresponding to same cid_fid
-    for (auto it_a = a_fid_to_pid.begin(); it_a != a_fid_to_pid.end(); it_a++) {
-      int pid_a = it_a->second;
-      int fid = it_a->first;  // shared fid
-      auto it_b = b_fid_to_pid.find(fid);
-      if (it_b == b_fid_to_pid.end()) {
+    for (std::pair<int, int> const& fid_pid_a : a_fid_to_pid) {
+      int pid_a = fid_pid_a.second;
+      int fid = fid_pid_a.first;  // shared fid
+      int pid_b = b_fid_to_pid.Pid(fid);
+      if (pid_b == FidToPidMap::kNoPid) {
         // This fid is not in second image. This is fine. A feature in a current image
         // may match to features in one image but not in another.
         continue;
       }
 
-      int pid_b = it_b->second;
-
       A2B[pid_a] = pid_b;
     }
   }
@@ -1398,7 +1393,7 @@ void MergeMaps(sparse_mapping::SparseMap * A_in,
   if (!FLAGS_skip_adding_new_matches_on_merging) {
     // Form merged_cid_fid_to_pid
     int num_cid = C.cid_to_filename_.size();
-    std::vector<std::map<int, int> > merged_cid_fid_to_pid;
+    CidFidToPid merged_cid_fid_to_pid;
     InitializeCidFidToPid(num_cid, merged_pid_to_cid_fid, &merged_cid_fid_to_pid);
 
     LOG(INFO) << "Number of tracks found as result of matching images between the maps: "
@@ -1408,13 +1403,12 @@ void MergeMaps(sparse_mapping::SparseMap * A_in,
     std::set<int> new_pid_set;
     // See which tracks obtained during merging are new
     for (size_t cid = 0; cid < merged_cid_fid_to_pid.size(); cid++) {
-      for (auto it = merged_cid_fid_to_pid[cid].begin();
-           it != merged_cid_fid_to_pid[cid].end(); it++) {
+      for (std::pair<int, int> const& fid_pid : merged_cid_fid_to_pid[cid]) {
         if (cid >= C.cid_fid_to_pid_.size()) continue;  // out of range
-        int fid = it->first;
-        if (C.cid_fid_to_pid_[cid].find(fid) != C.cid_fid_to_pid_[cid].end())
+        int fid = fid_pid.first;
+        if (C.cid_fid_to_pid_[cid].Has(fid))
           continue;  // not new
-        int new_pid = it->second;
+        int new_pid = fid_pid.second;
         if (new_pid_set.find(new_pid) != new_pid_set.end()) continue;  // inserted already
 
         // Add this new track
@@ -1425,7 +1419,7 @@ void MergeMaps(sparse_mapping::SparseMap * A_in,
 
     // Triangulate to find the xyz coordinates of the new tracks
     std::vector<Eigen::Vector3d> new_pid_to_xyz;
-    std::vector<std::map<int, int> > new_cid_fid_to_pid;
+    CidFidToPid new_cid_fid_to_pid;
     bool rm_invalid_xyz = true;  // don't remove anything, as cameras are pretty unreliable now
     sparse_mapping::Triangulate(rm_invalid_xyz,
                                 C.camera_params_.GetFocalLength(),
@@ -1725,7 +1719,7 @@ double RegistrationOrVerification(std::vector<std::string> const& data_files,
   // Triangulate to find the coordinates of the current points
   // in the virtual coordinate system
   std::vector<Eigen::Vector3d> pid_to_xyz;
-  std::vector<std::map<int, int> > cid_fid_to_pid_local;
+  CidFidToPid cid_fid_to_pid_local;
   bool rm_invalid_xyz = false;  // there should be nothing to remove hopefully
   sparse_mapping::Triangulate(rm_invalid_xyz,
                               map->camera_params_.GetFocalLength(),
@@ -2167,7 +2161,7 @@ void Triangulate(bool rm_invalid_xyz, double focal_length,
                  std::vector<Eigen::Matrix2Xd> const& cid_to_keypoint_map,
                  std::vector<std::map<int, int> > * pid_to_cid_fid,
                  std::vector<Eigen::Vector3d> * pid_to_xyz,
-                 std::vector<std::map<int, int> > * cid_fid_to_pid) {
+                 CidFidToPid * cid_fid_to_pid) {
   Eigen::Matrix3d k;
   k << focal_length, 0, 0,
     0, focal_length, 0,
@@ -0,0 +1,210 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <camera/camera_params.h>
+#include <sparse_mapping/compact_map.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <opencv2/core/core.hpp>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// A small map with random features, a frame without any, and features
+// observing landmarks in every other frame
+class CompactMapTest : public ::testing::Test {
+ protected:
+  CompactMapTest()
+      : params_(Eigen::Vector2i(640, 480), Eigen::Vector2d(300, 310), Eigen::Vector2d(320, 240)),
+        map_(std::vector<std::string>{"frame_a.jpg", "b.jpg", "frame_with_longer_name_c.jpg", "d.jpg"}, "ORGBRISK",
+             params_) {
+    Eigen::VectorXd distortion(1);
+    distortion << 0.9;
+    map_.camera_params_.SetDistortion(distortion);
+
+    cv::RNG rng(0);
+    const int num_features[] = {40, 0, 25, 31};
+    for (int cid = 0; cid < 4; cid++) {
+      map_.cid_to_keypoint_map_[cid] = Eigen::Matrix2Xd::Random(2, num_features[cid]) * 300;
+      map_.cid_to_descriptor_map_[cid].create(num_features[cid], 64, CV_8U);
+      if (num_features[cid] > 0)
+        rng.fill(map_.cid_to_descriptor_map_[cid], cv::RNG::UNIFORM, 0, 256);
+    }
+    for (int pid = 0; pid < 20; pid++) {
+      std::map<int, int> cid_fid;
+      cid_fid[0] = 2 * pid;
+      if (pid % 2 == 0) cid_fid[2] = pid;
+      cid_fid[3] = 30 - pid;
+      map_.pid_to_cid_fid_.push_back(cid_fid);
+      map_.pid_to_xyz_.push_back(Eigen::Vector3d::Random());
+    }
+    map_.InitializeCidFidToPid();
+  }
+
+  // Write the map, then a copy of it with the header changed by modify
+  template <typename Modify>
+  std::string WriteModified(std::string const& name, Modify modify) {
+    sparse_mapping::WriteCompactMap(map_, kFile);
+    std::ifstream in(kFile, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    sparse_mapping::CompactMapHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    modify(&header, &data);
+    memcpy(&data[0], &header, sizeof(header));
+    const std::string filename = "compact_map_" + name + ".map";
+    std::ofstream out(filename, std::ios::binary);
+    out.write(data.data(), data.size());
+    return filename;
+  }
+
+  static const char kFile[];
+  camera::CameraParameters params_;
+  sparse_mapping::SparseMap map_;
+};
+
+const char CompactMapTest::kFile[] = "compact_map_test.map";
+
+TEST_F(CompactMapTest, RoundTrip) {
+  sparse_mapping::WriteCompactMap(map_, kFile);
+  ASSERT_TRUE(sparse_mapping::CompactMap::IsCompactMap(kFile));
+
+  sparse_mapping::CompactMap compact(kFile);
+  ASSERT_EQ(static_cast<int>(map_.GetNumFrames()), compact.NumFrames());
+  ASSERT_EQ(static_cast<int>(map_.GetNumLandmarks()), compact.NumLandmarks());
+  EXPECT_STREQ("ORGBRISK", compact.Header().detector_name);
+  const char* filename = compact.Filenames();
+  for (int cid = 0; cid < compact.NumFrames(); cid++) {
+    EXPECT_EQ(map_.GetFrameFilename(cid), filename);
+    filename += strlen(filename) + 1;
+
+    Eigen::Matrix2Xd const& keypoints = map_.GetFrameKeypoints(cid);
+    ASSERT_EQ(keypoints.cols(), compact.NumFeatures(cid));
+    EXPECT_TRUE(keypoints == compact.Keypoints(cid)) << "Frame " << cid;
+
+    cv::Mat const& descriptors = map_.cid_to_descriptor_map_[cid];
+    cv::Mat compact_descriptors = compact.Descriptors(cid);
+    ASSERT_EQ(descriptors.rows, compact_descriptors.rows);
+    ASSERT_EQ(descriptors.type(), compact_descriptors.type());
+    if (descriptors.rows > 0) {
+      ASSERT_EQ(descriptors.cols, compact_descriptors.cols);
+      EXPECT_EQ(0, cv::countNonZero(descriptors != compact_descriptors)) << "Frame " << cid;
+    }
+
+    // Every feature, with or without a landmark, and a few past the end
+    for (int fid = -1; fid < keypoints.cols() + 2; fid++)
+      EXPECT_EQ(map_.GetFrameFidToPidMap(cid).Pid(fid), compact.Pid(cid, fid)) << "Frame " << cid << " " << fid;
+  }
+  for (int pid = 0; pid < compact.NumLandmarks(); pid++)
+    EXPECT_TRUE(map_.GetLandmarkPosition(pid) == compact.Landmark(pid)) << "Landmark " << pid;
+
+  // Loaded for localization, the map has the same frames and camera
+  sparse_mapping::SparseMap loaded(kFile, true);
+  ASSERT_EQ(map_.GetNumFrames(), loaded.GetNumFrames());
+  ASSERT_EQ(map_.GetNumLandmarks(), loaded.GetNumLandmarks());
+  for (size_t cid = 0; cid < map_.GetNumFrames(); cid++) {
+    EXPECT_EQ(map_.GetFrameFilename(cid), loaded.GetFrameFilename(cid));
+    cv::Mat const& descriptors = map_.cid_to_descriptor_map_[cid];
+    ASSERT_EQ(descriptors.rows, loaded.cid_to_descriptor_map_[cid].rows);
+    if (descriptors.rows > 0)
+      EXPECT_EQ(0, cv::countNonZero(descriptors != loaded.cid_to_descriptor_map_[cid])) << "Frame " << cid;
+  }
+  for (size_t pid = 0; pid < map_.GetNumLandmarks(); pid++)
+    EXPECT_TRUE(map_.GetLandmarkPosition(pid) == loaded.GetLandmarkPosition(pid));
+  camera::CameraParameters const& expected_camera = map_.GetCameraParameters();
+  camera::CameraParameters const& camera = loaded.GetCameraParameters();
+  EXPECT_TRUE(expected_camera.GetFocalVector() == camera.GetFocalVector());
+  EXPECT_TRUE(expected_camera.GetOpticalOffset() == camera.GetOpticalOffset());
+  EXPECT_TRUE(expected_camera.GetDistortedSize() == camera.GetDistortedSize());
+  EXPECT_TRUE(expected_camera.GetUndistortedSize() == camera.GetUndistortedSize());
+  EXPECT_TRUE(expected_camera.GetDistortion() == camera.GetDistortion());
+}
+
+TEST_F(CompactMapTest, NotACompactMap) {
+  const std::string filename = WriteModified("bad_magic", [](sparse_mapping::CompactMapHeader* header,
+                                                             std::string*) { header->magic[0] = 'X'; });
+  EXPECT_FALSE(sparse_mapping::CompactMap::IsCompactMap(filename));
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "Not a compact map");
+}
+
+// Each section, moved or grown past the end of the file, is rejected
+TEST_F(CompactMapTest, SectionsOutOfBounds) {
+  typedef uint64_t sparse_mapping::CompactMapHeader::*Field;
+  const std::map<std::string, Field> positions = {
+    {"feature_offsets", &sparse_mapping::CompactMapHeader::feature_offsets_pos},
+    {"descriptors", &sparse_mapping::CompactMapHeader::descriptors_pos},
+    {"keypoints", &sparse_mapping::CompactMapHeader::keypoints_pos},
+    {"fid_to_pid", &sparse_mapping::CompactMapHeader::fid_to_pid_pos},
+    {"landmarks", &sparse_mapping::CompactMapHeader::landmarks_pos},
+    {"filenames", &sparse_mapping::CompactMapHeader::filenames_pos},
+    {"vocab_db", &sparse_mapping::CompactMapHeader::vocab_db_pos}};
+  for (auto const& position : positions) {
+    const Field field = position.second;
+    const std::string filename = WriteModified(position.first, [field](sparse_mapping::CompactMapHeader* header,
+                                                                       std::string* data) {
+      // Aligned and just past the end
+      header->*field = (data->size() / sparse_mapping::kCompactMapAlignment + 1) * sparse_mapping::kCompactMapAlignment;
+    });
+    EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "out of bounds") << position.first;
+  }
+
+  // More landmarks than were written
+  std::string filename = WriteModified("num_landmarks", [](sparse_mapping::CompactMapHeader* header, std::string*) {
+    header->num_landmarks = 1 << 30;
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "out of bounds");
+
+  // A truncated file
+  filename = WriteModified("truncated", [](sparse_mapping::CompactMapHeader* header, std::string* data) {
+    data->resize(header->landmarks_pos + 8);
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "out of bounds");
+
+  // A section not aligned as written
+  filename = WriteModified("unaligned", [](sparse_mapping::CompactMapHeader* header, std::string*) {
+    header->keypoints_pos += 4;
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "out of bounds");
+}
+
+TEST_F(CompactMapTest, InvalidContents) {
+  std::string filename = WriteModified("num_features", [](sparse_mapping::CompactMapHeader* header, std::string*) {
+    header->num_features--;
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "Invalid feature offsets");
+
+  filename = WriteModified("descriptor_bytes", [](sparse_mapping::CompactMapHeader* header, std::string*) {
+    header->descriptor_bytes++;
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "Invalid sizes");
+
+  filename = WriteModified("num_frames", [](sparse_mapping::CompactMapHeader* header, std::string*) {
+    header->num_frames--;
+  });
+  EXPECT_DEATH(sparse_mapping::CompactMap compact(filename), "Invalid");
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -20,10 +20,13 @@
 #include <camera/camera_model.h>
 
 #include <Eigen/Geometry>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include <vector>
 
+DECLARE_bool(ransac_adaptive);
+
 TEST(reprojection, pose_estimation) {
   // create camera model
   Eigen::Vector3d true_camera_pos(0, 0, 0);
@@ -91,6 +94,48 @@ TEST(reprojection, pose_estimation) {
   EXPECT_NEAR(acos(observed_angle.dot(orig_angle)), 0, 0.05);
 }
 
+TEST(reprojection, adaptive_ransac) {
+  camera::CameraModel camera(Eigen::Vector3d(0.5, -0.2, -1), Eigen::Matrix3d::Identity(),
+                             90 * M_PI / 180.0, 640, 480);
+
+  // Matches sorted from best to worst, with the outliers last
+  std::vector<Eigen::Vector3d> landmarks;
+  std::vector<Eigen::Vector2d> observations;
+  for (int row = 0; row < 6; row++) {
+    for (int col = 0; col < 8; col++) {
+      landmarks.push_back(Eigen::Vector3d(col - 3.5, row - 2.5, 5 + 0.3 * ((row + col) % 4)));
+      observations.push_back(camera.ImageCoordinates(landmarks.back()));
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    landmarks.push_back(Eigen::Vector3d(i - 2, 1 - i, 6));
+    observations.push_back(Eigen::Vector2d(300 - 50 * i, 20 + 60 * i));
+  }
+
+  // Restore the flag for the tests which follow
+  gflags::FlagSaver flag_saver;
+  const int kNumTries = 200;
+  for (bool adaptive : {false, true}) {
+    FLAGS_ransac_adaptive = adaptive;
+    camera::CameraModel estimate(Eigen::Vector3d(0, 0, 0), Eigen::Matrix3d::Identity(),
+                                 camera.GetParameters());
+    std::vector<Eigen::Vector3d> inlier_landmarks;
+    std::vector<Eigen::Vector2d> inlier_observations;
+    int num_iterations = 0;
+    EXPECT_EQ(0, sparse_mapping::RansacEstimateCamera(landmarks, observations, kNumTries, 4,
+                                                      &estimate, &inlier_landmarks,
+                                                      &inlier_observations, false,
+                                                      &num_iterations));
+    EXPECT_NEAR((camera.GetPosition() - estimate.GetPosition()).norm(), 0, 0.1);
+    EXPECT_EQ(48u, inlier_landmarks.size());
+    // With 92% inliers a few samples are enough for the default confidence
+    if (adaptive)
+      EXPECT_LT(num_iterations, 20);
+    else
+      EXPECT_EQ(kNumTries, num_iterations);
+  }
+}
+
 TEST(reprojection, affine_estimation) {
   // Test solving for affine transform between two datatsets
 
@@ -215,13 +215,12 @@ TEST_P(SparseMapTest, MapBuilding) {
           map_loopback2.GetFrameGlobalTransform(frame).matrix()));
 
     // Check that FidToPidMaps are the same
-    std::map<int, int>
+    sparse_mapping::FidToPidMap const&
       fidpid1 = map_loopback.GetFrameFidToPidMap(frame),
       fidpid2 = map_loopback2.GetFrameFidToPidMap(frame);
     ASSERT_EQ(fidpid1.size(), fidpid2.size());
-    for (std::map<int, int>::iterator it = fidpid1.begin();
-        it != fidpid1.end(); it++) {
-      EXPECT_EQ(fidpid2[it->first], it->second);
+    for (std::pair<int, int> const& fid_pid : fidpid1) {
+      EXPECT_EQ(fidpid2.Pid(fid_pid.first), fid_pid.second);
     }
   }
   // Check that landmarks are the same
@@ -293,6 +292,38 @@ TEST_P(SparseMapTest, MapExtractMerge) {
   EXPECT_EQ(merged_map.GetNumFrames(), 3);
 }
 
+TEST(SparseMapTest, FidToPidMap) {
+  sparse_mapping::FidToPidMap fid_to_pid;
+  EXPECT_TRUE(fid_to_pid.empty());
+  EXPECT_EQ(fid_to_pid.Pid(0), sparse_mapping::FidToPidMap::kNoPid);
+
+  fid_to_pid.Set(7, 3);
+  fid_to_pid.Set(2, 5);
+  fid_to_pid.Set(7, 4);  // overwrite
+  EXPECT_EQ(fid_to_pid.size(), 2u);
+  EXPECT_EQ(fid_to_pid.Pid(7), 4);
+  EXPECT_TRUE(fid_to_pid.Has(2));
+  EXPECT_FALSE(fid_to_pid.Has(3));
+  EXPECT_FALSE(fid_to_pid.Has(-1));
+  EXPECT_FALSE(fid_to_pid.Has(100));
+
+  // Must visit the features with a landmark in increasing order
+  std::map<int, int> expected = {{2, 5}, {7, 4}};
+  std::map<int, int> visited;
+  int prev_fid = -1;
+  for (std::pair<int, int> const& fid_pid : fid_to_pid) {
+    EXPECT_GT(fid_pid.first, prev_fid);
+    prev_fid = fid_pid.first;
+    visited[fid_pid.first] = fid_pid.second;
+  }
+  EXPECT_EQ(visited, expected);
+
+  fid_to_pid.Erase(2);
+  fid_to_pid.Erase(3);  // not there, no-op
+  EXPECT_EQ(fid_to_pid.size(), 1u);
+  EXPECT_FALSE(fid_to_pid.Has(2));
+}
+
 const Parameters test_parameters[] = {
   // Detector,  not used,       closeLoop
   {"SURF",     "ORGBRISK",      false},
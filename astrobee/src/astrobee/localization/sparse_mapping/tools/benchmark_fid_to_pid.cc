@@ -0,0 +1,119 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Compare the cost of looking up the landmark of a feature with the
+// flat per-image arrays now used by SparseMap and with the per-image
+// std::map used before. The queries are drawn the way localization
+// makes them: random features of the map images, most of which are
+// not on any landmark.
+
+#include <ff_common/init.h>
+#include <sparse_mapping/fid_to_pid.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+DEFINE_int32(num_queries, 10000000,
+             "Look up the landmarks of this many features.");
+DEFINE_int32(random_seed, 0,
+             "The seed for picking the features to look up.");
+
+static double Seconds(struct timeval const& a, struct timeval const& b) {
+  return b.tv_sec - a.tv_sec + (b.tv_usec - a.tv_usec) / 1000000.0;
+}
+
+static int Lookup(std::vector<std::map<int, int> > const& cid_fid_to_pid, int cid, int fid) {
+  auto it = cid_fid_to_pid[cid].find(fid);
+  return (it == cid_fid_to_pid[cid].end()) ? -1 : it->second;
+}
+
+static int Lookup(sparse_mapping::CidFidToPid const& cid_fid_to_pid, int cid, int fid) {
+  return cid_fid_to_pid[cid].Pid(fid);
+}
+
+// Time the lookups, returning the time and a checksum of the results
+// so the work can't be optimized away and the two can be compared.
+template <class T>
+static double TimeLookups(T const& cid_fid_to_pid,
+                          std::vector<std::pair<int, int> > const& queries,
+                          int64_t * checksum) {
+  struct timeval a, b;
+  gettimeofday(&a, NULL);
+  int64_t sum = 0;
+  for (std::pair<int, int> const& q : queries)
+    sum += Lookup(cid_fid_to_pid, q.first, q.second);
+  gettimeofday(&b, NULL);
+  *checksum = sum;
+  return Seconds(a, b);
+}
+
+int main(int argc, char** argv) {
+  ff_common::InitFreeFlyerApplication(&argc, &argv);
+  if (argc < 2) {
+    std::cerr << "Usage: benchmark_fid_to_pid map.map\n";
+    std::exit(0);
+  }
+
+  sparse_mapping::SparseMap map(argv[1]);
+  int num_cid = map.GetNumFrames();
+  if (num_cid == 0)
+    LOG(FATAL) << "The map has no images.";
+
+  // The old way of storing this, for comparison
+  std::vector<std::map<int, int> > tree_cid_fid_to_pid(num_cid);
+  for (size_t pid = 0; pid < map.pid_to_cid_fid_.size(); pid++) {
+    for (std::pair<int, int> const& cid_fid : map.pid_to_cid_fid_[pid])
+      tree_cid_fid_to_pid[cid_fid.first][cid_fid.second] = pid;
+  }
+
+  std::mt19937 gen(FLAGS_random_seed);
+  std::uniform_int_distribution<int> cid_dist(0, num_cid - 1);
+  std::vector<std::pair<int, int> > queries(FLAGS_num_queries);
+  size_t num_features = 0;
+  for (int cid = 0; cid < num_cid; cid++)
+    num_features += map.cid_to_descriptor_map_[cid].rows;
+  for (std::pair<int, int> & q : queries) {
+    q.first = cid_dist(gen);
+    int num_fid = std::max(map.cid_to_descriptor_map_[q.first].rows, 1);
+    q.second = std::uniform_int_distribution<int>(0, num_fid - 1)(gen);
+  }
+
+  int64_t tree_sum = 0, flat_sum = 0;
+  double tree_time = TimeLookups(tree_cid_fid_to_pid, queries, &tree_sum);
+  double flat_time = TimeLookups(map.cid_fid_to_pid_, queries, &flat_sum);
+  if (tree_sum != flat_sum)
+    LOG(FATAL) << "The two lookups disagree.";
+
+  printf("Images: %d, features: %zu, landmarks: %zu\n", num_cid, num_features,
+         map.pid_to_xyz_.size());
+  printf("std::map:   %g ns per lookup\n", 1e9 * tree_time / queries.size());
+  printf("flat array: %g ns per lookup\n", 1e9 * flat_time / queries.size());
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Compare the speed and the output of the FLANN LSH and the brute
+// force Hamming matchers on pairs of consecutive images of a map
+// with binary descriptors.
+
+#include <ff_common/init.h>
+#include <interest_point/hamming.h>
+#include <interest_point/matching.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <sys/time.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+DEFINE_int32(num_pairs, 100,
+             "Benchmark this many pairs of consecutive map images.");
+DEFINE_int32(num_repeats, 5,
+             "Match each pair this many times.");
+DECLARE_bool(hamming_brute_force);  // its value will be pulled from matching.cc
+
+static double Seconds(struct timeval const& a, struct timeval const& b) {
+  return b.tv_sec - a.tv_sec + (b.tv_usec - a.tv_usec) / 1000000.0;
+}
+
+// Time FindMatches() on all pairs, returning the total time and the matches.
+static double TimeMatching(std::vector<std::pair<int, int> > const& pairs,
+                           sparse_mapping::SparseMap const& map,
+                           std::vector<std::vector<cv::DMatch> > * all_matches) {
+  all_matches->resize(pairs.size());
+  struct timeval a, b;
+  gettimeofday(&a, NULL);
+  for (int it = 0; it < FLAGS_num_repeats; it++) {
+    for (size_t i = 0; i < pairs.size(); i++)
+      interest_point::FindMatches(map.cid_to_descriptor_map_[pairs[i].first],
+                                  map.cid_to_descriptor_map_[pairs[i].second],
+                                  &(*all_matches)[i]);
+  }
+  gettimeofday(&b, NULL);
+  return Seconds(a, b);
+}
+
+int main(int argc, char** argv) {
+  ff_common::InitFreeFlyerApplication(&argc, &argv);
+  if (argc < 2) {
+    std::cerr << "Usage: benchmark_matching map.map\n";
+    std::exit(0);
+  }
+
+  sparse_mapping::SparseMap map(argv[1], true);
+  if (map.cid_to_descriptor_map_.empty() ||
+      map.cid_to_descriptor_map_[0].depth() != CV_8U)
+    LOG(FATAL) << "Expecting a map with binary descriptors.";
+
+  std::vector<std::pair<int, int> > pairs;
+  for (int cid = 0; cid + 1 < static_cast<int>(map.GetNumFrames()) &&
+         static_cast<int>(pairs.size()) < FLAGS_num_pairs; cid++)
+    pairs.push_back(std::make_pair(cid, cid + 1));
+  if (pairs.empty())
+    LOG(FATAL) << "Need at least two images in the map.";
+
+  std::vector<std::vector<cv::DMatch> > lsh_matches, exact_matches;
+  FLAGS_hamming_brute_force = false;
+  double lsh_time = TimeMatching(pairs, map, &lsh_matches);
+  FLAGS_hamming_brute_force = true;
+  double exact_time = TimeMatching(pairs, map, &exact_matches);
+
+  // How many of the approximate matches the exact matcher also found
+  size_t num_lsh = 0, num_exact = 0, num_common = 0, num_features = 0;
+  for (size_t i = 0; i < pairs.size(); i++) {
+    num_features += map.cid_to_descriptor_map_[pairs[i].first].rows;
+    num_lsh += lsh_matches[i].size();
+    num_exact += exact_matches[i].size();
+    std::set<std::pair<int, int> > exact;
+    for (cv::DMatch const& m : exact_matches[i])
+      exact.insert(std::make_pair(m.queryIdx, m.trainIdx));
+    for (cv::DMatch const& m : lsh_matches[i])
+      num_common += exact.count(std::make_pair(m.queryIdx, m.trainIdx));
+  }
+
+  double num_calls = pairs.size() * FLAGS_num_repeats;
+  printf("Image pairs: %zu, average features per image: %g\n",
+         pairs.size(), static_cast<double>(num_features) / pairs.size());
+  printf("FLANN LSH:   %g ms per pair, %g matches per pair\n",
+         1000.0 * lsh_time / num_calls, static_cast<double>(num_lsh) / pairs.size());
+  printf("Brute force: %g ms per pair, %g matches per pair\n",
+         1000.0 * exact_time / num_calls, static_cast<double>(num_exact) / pairs.size());
+  printf("LSH matches also found by brute force: %g%%\n",
+         num_lsh > 0 ? 100.0 * num_common / num_lsh : 0.0);
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Compare plain RANSAC with a fixed number of iterations and adaptive
+// RANSAC on the matches of a set of query images against a map. Report
+// the iterations, time and inliers of each, and how far apart the
+// resulting poses are.
+
+#include <camera/camera_model.h>
+#include <ff_common/init.h>
+#include <sparse_mapping/reprojection.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <sys/time.h>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+DEFINE_int32(num_repeats, 10,
+             "Estimate the pose of each image this many times with each method.");
+DECLARE_bool(ransac_adaptive);  // its value will be pulled from reprojection.cc
+
+static double Seconds(struct timeval const& a, struct timeval const& b) {
+  return b.tv_sec - a.tv_sec + (b.tv_usec - a.tv_usec) / 1000000.0;
+}
+
+struct RansacStats {
+  RansacStats() : time(0), iterations(0), inliers(0), failures(0) {}
+  double time, iterations, inliers;
+  int failures;
+};
+
+// Run RANSAC repeatedly on the matches of one image, accumulating the
+// statistics and returning the pose found in the last run.
+static camera::CameraModel TimeRansac(sparse_mapping::SparseMap const& map,
+                                      std::vector<Eigen::Vector3d> const& landmarks,
+                                      std::vector<Eigen::Vector2d> const& observations,
+                                      RansacStats * stats) {
+  camera::CameraModel camera(map.GetCameraParameters());
+  for (int it = 0; it < FLAGS_num_repeats; it++) {
+    std::vector<Eigen::Vector3d> inlier_landmarks;
+    std::vector<Eigen::Vector2d> inlier_observations;
+    int num_iterations = 0;
+    struct timeval a, b;
+    gettimeofday(&a, NULL);
+    int ret = sparse_mapping::RansacEstimateCamera(landmarks, observations,
+                                                   map.GetRansacIterations(),
+                                                   map.GetRansacInlierTolerance(), &camera,
+                                                   &inlier_landmarks, &inlier_observations,
+                                                   false, &num_iterations);
+    gettimeofday(&b, NULL);
+    stats->time += Seconds(a, b);
+    stats->iterations += num_iterations;
+    stats->inliers += inlier_landmarks.size();
+    if (ret != 0)
+      stats->failures++;
+  }
+  return camera;
+}
+
+static void Print(std::string const& name, RansacStats const& stats, int num_runs) {
+  printf("%-9s %8.3f ms %8.1f iterations %8.1f inliers %4d failures\n", name.c_str(),
+         1000.0 * stats.time / num_runs, stats.iterations / num_runs,
+         stats.inliers / num_runs, stats.failures);
+}
+
+int main(int argc, char** argv) {
+  ff_common::InitFreeFlyerApplication(&argc, &argv);
+  if (argc < 3) {
+    std::cerr << "Usage: benchmark_ransac map.map image1.jpg image2.jpg ...\n";
+    std::exit(0);
+  }
+
+  sparse_mapping::SparseMap map(argv[1], true);
+
+  RansacStats plain, adaptive;
+  double position_diff = 0, angle_diff = 0;
+  int num_images = 0;
+  for (int i = 2; i < argc; i++) {
+    cv::Mat descriptors;
+    Eigen::Matrix2Xd keypoints;
+    map.DetectFeaturesFromFile(argv[i], false, &descriptors, &keypoints);
+    std::vector<Eigen::Vector3d> landmarks;
+    std::vector<Eigen::Vector2d> observations;
+    map.MatchToMap(descriptors, keypoints, &landmarks, &observations);
+    if (observations.size() < 4) {
+      LOG(WARNING) << "Too few matches for " << argv[i] << ", skipping it.";
+      continue;
+    }
+
+    FLAGS_ransac_adaptive = false;
+    camera::CameraModel plain_camera = TimeRansac(map, landmarks, observations, &plain);
+    FLAGS_ransac_adaptive = true;
+    camera::CameraModel adaptive_camera = TimeRansac(map, landmarks, observations, &adaptive);
+
+    position_diff += (plain_camera.GetPosition() - adaptive_camera.GetPosition()).norm();
+    angle_diff += Eigen::AngleAxisd(plain_camera.GetRotation().transpose() *
+                                    adaptive_camera.GetRotation()).angle();
+    num_images++;
+  }
+  if (num_images == 0)
+    LOG(FATAL) << "No image could be matched to the map.";
+
+  int num_runs = num_images * FLAGS_num_repeats;
+  printf("Images: %d, RANSAC iterations allowed: %d, inlier tolerance: %d\n",
+         num_images, map.GetRansacIterations(), map.GetRansacInlierTolerance());
+  Print("Plain:", plain, num_runs);
+  Print("Adaptive:", adaptive, num_runs);
+  printf("Pose agreement: %g m mean position difference, %g deg mean rotation difference\n",
+         position_diff / num_images, angle_diff / num_images * 180.0 / M_PI);
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Convert a map to the compact format, which can be memory-mapped for
+// localization, and compare how long each format takes to load for
+// localization and how much memory it then takes.
+
+#include <ff_common/init.h>
+#include <sparse_mapping/compact_map.h>
+#include <sparse_mapping/sparse_map.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <sys/time.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+DEFINE_string(input_map, "",
+              "Input sparse map in the protobuf format.");
+DEFINE_string(output_map, "output.cmap",
+              "Output sparse map in the compact format.");
+DEFINE_bool(compare_load, true,
+            "Load the input and output maps for localization and print the time and memory used.");
+
+namespace {
+  // Keep these utilities in a local namespace
+
+  // Resident set size of this process, in MB
+  double ResidentMB() {
+    std::ifstream ifs("/proc/self/status");
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.compare(0, 6, "VmRSS:") == 0)
+        return std::stod(line.substr(6)) / 1024.0;
+    }
+    return 0.0;
+  }
+
+  void CompareLoad(std::string const& map_file) {
+    double rss_before = ResidentMB();
+    struct timeval a, b;
+    gettimeofday(&a, NULL);
+    sparse_mapping::SparseMap map(map_file, true);
+    gettimeofday(&b, NULL);
+    double t = b.tv_sec - a.tv_sec + (b.tv_usec - a.tv_usec) / 1000000.0;
+    printf("%s: load time %g s, resident memory %g MB\n",
+           map_file.c_str(), t, ResidentMB() - rss_before);
+  }
+}  // namespace
+
+int main(int argc, char** argv) {
+  ff_common::InitFreeFlyerApplication(&argc, &argv);
+
+  if (FLAGS_input_map == "")
+    LOG(FATAL) << "The input map was not specified.";
+
+  {
+    // All of the map is needed to write it
+    sparse_mapping::SparseMap map(FLAGS_input_map);
+    sparse_mapping::WriteCompactMap(map, FLAGS_output_map);
+  }
+
+  if (FLAGS_compare_load) {
+    CompareLoad(FLAGS_input_map);
+    CompareLoad(FLAGS_output_map);
+  }
+
+  return 0;
+}
@@ -152,9 +152,8 @@ bool LocalizeFrame(MapViewerState* state, int frame) {
     } else {  // display map
       image = cv::imread(state->map->GetFrameFilename(frame), cv::IMREAD_GRAYSCALE);
       camera_pose = EigenToCVAffine(state->map->GetFrameGlobalTransform(frame).inverse());
-      std::map<int, int> fid_to_pid = state->map->GetFrameFidToPidMap(frame);
-      for (std::map<int, int>::iterator it = fid_to_pid.begin(); it != fid_to_pid.end(); it++)
-        landmarks.push_back(state->map->GetLandmarkPosition(it->second));
+      for (std::pair<int, int> const& fid_pid : state->map->GetFrameFidToPidMap(frame))
+        landmarks.push_back(state->map->GetLandmarkPosition(fid_pid.second));
     }
 
     // update the viewer pose with the new frame
@@ -0,0 +1,86 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef CHOREOGRAPHER_DISTANCE_FIELD_H_
+#define CHOREOGRAPHER_DISTANCE_FIELD_H_
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace choreographer {
+
+// Euclidean signed distance field of a region, sampled at the centers
+// of the cells of a regular grid. A cell is inside when all of it lies
+// in the region. The distances between the centers of the cells inside
+// and outside are exact, computed with the separable transform of
+// Felzenszwalb and Huttenlocher in time linear in the number of cells,
+// and the zero level is put halfway between them.
+//
+// Every point outside the region is in a cell outside, within half a
+// cell diagonal of its center, so the field never exceeds the distance
+// to the region boundary by more than kMargin cells. It may fall short
+// of it by about a cell, which errs on the side of safety.
+class DistanceField {
+ public:
+  // Compute the field, given whether each cell lies entirely in the
+  // region. Cell (i, j, k) spans origin + res * [(i, j, k), (i, j, k) + 1]
+  // and is inside[Index(dim, i, j, k)].
+  void Compute(Eigen::Vector3d const& origin, Eigen::Vector3i const& dim,
+    double res, std::vector<bool> const& inside);
+
+  static int Index(Eigen::Vector3i const& dim, int i, int j, int k) {
+    return i + dim(0) * (j + dim(1) * k);
+  }
+
+  // Distance from a point to the boundary of the region, positive inside
+  // and negative outside, interpolated trilinearly between the cell
+  // centers. Points off the grid take the value of the closest border.
+  // Like the distance itself, it changes by at most sqrt(3) times the
+  // distance between two points.
+  double Distance(Eigen::Vector3d const& p) const;
+
+  // Bound on the excess of Distance() over the true distance, in units
+  // of the resolution: half a cell diagonal for the cell centers, minus
+  // the half cell of the zero level, plus half a cell diagonal for the
+  // interpolation between them
+  static constexpr double kMargin = 1.2320508075688772;  // sqrt(3) - 1/2
+
+  double Resolution() const { return res_; }
+  bool Empty() const { return field_.empty(); }
+
+ private:
+  // Squared distance transform of n samples spaced by stride, in place
+  void Transform(float * f, int n, int stride);
+
+  // Squared distance of every cell, in cells, to the closest cell whose
+  // inside flag is the opposite of its own
+  void Transform(std::vector<bool> const& inside, bool from_inside, std::vector<float> * f);
+
+  Eigen::Vector3d origin_;
+  Eigen::Vector3i dim_;
+  double res_ = 0.0;
+  std::vector<float> field_;
+  // Scratch space of the transform
+  std::vector<double> g_, z_;
+  std::vector<int> v_;
+};
+
+}  // namespace choreographer
+
+#endif  // CHOREOGRAPHER_DISTANCE_FIELD_H_
@@ -40,6 +40,9 @@
 // Voxel map
 #include <jps3d/planner/jps_3d_util.h>
 
+// Zone distance fields
+#include <choreographer/distance_field.h>
+
 // STL includes
 #include <string>
 #include <vector>
@@ -69,9 +72,13 @@ class Validator {
   // Load the keep in the keeo out zones and return if successful
   bool Init(ros::NodeHandle *nh, ff_util::ConfigServer & cfg);
 
-  // If the check fails, then the info block is populated
+  // If the check fails, then the info block is populated. The smallest
+  // clearance between the robot and the zones along the segment, beyond
+  // the inflation radius, is returned in min_clearance when given; it is
+  // negative if the segment violates a zone.
   Response CheckSegment(ff_util::Segment const& msg,
-    ff_msgs::FlightMode const& flight_mode, bool face_forward);
+    ff_msgs::FlightMode const& flight_mode, bool face_forward,
+    double * min_clearance = nullptr);
 
  protected:
   // Markers for keep in / keep out zones
@@ -83,6 +90,12 @@ class Validator {
   // Build the occupancy map
   bool GetZonesMap();
 
+  // Build the distance fields of the zones over the occupancy map grid
+  void ComputeDistanceFields(Vec3f const& origin, Vec3i const& dim);
+
+  // Clearance of the robot at a position, and the zone it is closest to
+  double Clearance(Vec3f const& p, Response * zone) const;
+
   // Callback to get the keep in/out zones
   bool GetZonesCallback(ff_msgs::GetZones::Request& req,
                        ff_msgs::GetZones::Response& res);
@@ -106,6 +119,14 @@ class Validator {
   ros::ServiceClient get_resolution_;                 // Get the zones map resolution
   ros::ServiceClient get_map_inflation_;              // Get the zones map inflation
 
+  ff_util::Segment resampled_;                        // Reused for each check
+
+  // Signed distances to the boundary of the keep-in zones, positive
+  // inside them, and to the keep-out zones, positive outside them
+  DistanceField keepin_field_, keepout_field_;
+  double inflation_ = 0.0;                            // Robot radius and margin
+  double field_margin_ = 0.0;                         // Field error allowance, in cells
+
   double map_res_ = 0.08;
   std::shared_ptr<JPS::VoxelMapUtil> jps_map_util_;
 
@@ -61,6 +61,7 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <limits>
 #include <map>
 #include <utility>
 
@@ -138,7 +139,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
           // If we need to validate
           if (cfg_.Get<bool>("enable_validation")) {
             Validator::Response result = validator_.CheckSegment(segment_,
-              flight_mode_, cfg_.Get<bool>("enable_faceforward"));
+              flight_mode_, cfg_.Get<bool>("enable_faceforward"), &min_clearance_);
             if (result != Validator::SUCCESS)
               return ValidateResult(result);
           }
@@ -178,7 +179,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
         // If we need to validate
         if (cfg_.Get<bool>("enable_validation")) {
           Validator::Response result = validator_.CheckSegment(segment_,
-            flight_mode_, cfg_.Get<bool>("enable_faceforward"));
+            flight_mode_, cfg_.Get<bool>("enable_faceforward"), &min_clearance_);
           if (result != Validator::SUCCESS)
             return ValidateResult(result);
         }
@@ -229,7 +230,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
         // If we need to validate
         if (cfg_.Get<bool>("enable_validation")) {
           Validator::Response result = validator_.CheckSegment(segment_,
-            flight_mode_, cfg_.Get<bool>("enable_faceforward"));
+            flight_mode_, cfg_.Get<bool>("enable_faceforward"), &min_clearance_);
           if (result != Validator::SUCCESS)
             return ValidateResult(result);
         }
@@ -256,7 +257,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
         // If we need to validate the segment
         if (cfg_.Get<bool>("enable_validation")) {
           Validator::Response result = validator_.CheckSegment(segment_,
-            flight_mode_, cfg_.Get<bool>("enable_faceforward"));
+            flight_mode_, cfg_.Get<bool>("enable_faceforward"), &min_clearance_);
           if (result != Validator::SUCCESS)
             return ValidateResult(result);
         }
@@ -836,6 +837,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
     result.response = response;
     result.segment = segment_;
     result.flight_mode = flight_mode_;
+    result.min_clearance = min_clearance_;
     if (response > 0)
       server_.SendResult(ff_util::FreeFlyerActionState::SUCCESS, result);
     else if (response < 0)
@@ -1299,6 +1301,8 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
       server_.SendResult(ff_util::FreeFlyerActionState::ABORTED, result);
       return;
     }
+    // Not known until a segment is validated
+    min_clearance_ = std::numeric_limits<double>::quiet_NaN();
     // If the specified flight mode string is empty then we wont try and
     // change the flight mode from what it currently is.
     goal_flight_mode_ = flight_mode_;
@@ -1413,6 +1417,7 @@ class ChoreographerNodelet : public ff_util::FreeFlyerNodelet {
   ff_msgs::FlightMode flight_mode_, goal_flight_mode_;  // Flight mode
   std::vector<geometry_msgs::PoseStamped> states_;      // Plan request
   ff_util::Segment segment_;                            // Segment
+  double min_clearance_ = std::numeric_limits<double>::quiet_NaN();  // To zones
   geometry_msgs::PointStamped obstacle_;                // Obstacle
   // Tolerance check Timers
   double tolerance_max_time_;
@@ -0,0 +1,126 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <choreographer/distance_field.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace choreographer {
+
+constexpr double DistanceField::kMargin;
+
+// Squared distance standing for no site, larger than any in the grid
+static const float kFar = 1e20f;
+
+void DistanceField::Compute(Eigen::Vector3d const& origin, Eigen::Vector3i const& dim,
+  double res, std::vector<bool> const& inside) {
+  origin_ = origin;
+  dim_ = dim;
+  res_ = res;
+  int num = dim(0) * dim(1) * dim(2);
+  int n = std::max(dim(0), std::max(dim(1), dim(2)));
+  g_.resize(n);
+  z_.resize(n + 1);
+  v_.resize(n);
+  // The cells inside from the closest center outside, then the other way
+  // around, reusing the buffer as the field fills up
+  std::vector<float> f;
+  field_.resize(num);
+  Transform(inside, true, &f);
+  for (int c = 0; c < num; c++)
+    if (inside[c])
+      field_[c] = res * (std::sqrt(f[c]) - 0.5);
+  Transform(inside, false, &f);
+  for (int c = 0; c < num; c++)
+    if (!inside[c])
+      field_[c] = res * (0.5 - std::sqrt(f[c]));
+}
+
+void DistanceField::Transform(std::vector<bool> const& inside, bool from_inside,
+  std::vector<float> * f) {
+  int num = dim_(0) * dim_(1) * dim_(2);
+  f->resize(num);
+  for (int c = 0; c < num; c++)
+    (*f)[c] = (inside[c] == from_inside ? kFar : 0.0);
+  float * data = f->data();
+  for (int k = 0; k < dim_(2); k++)
+    for (int j = 0; j < dim_(1); j++)
+      Transform(data + Index(dim_, 0, j, k), dim_(0), 1);
+  for (int k = 0; k < dim_(2); k++)
+    for (int i = 0; i < dim_(0); i++)
+      Transform(data + Index(dim_, i, 0, k), dim_(1), dim_(0));
+  for (int j = 0; j < dim_(1); j++)
+    for (int i = 0; i < dim_(0); i++)
+      Transform(data + Index(dim_, i, j, 0), dim_(2), dim_(0) * dim_(1));
+}
+
+// Lower envelope of the parabolas rooted at the samples
+void DistanceField::Transform(float * f, int n, int stride) {
+  for (int q = 0; q < n; q++)
+    g_[q] = f[q * stride];
+  int k = 0;
+  v_[0] = 0;
+  z_[0] = -std::numeric_limits<double>::infinity();
+  z_[1] = std::numeric_limits<double>::infinity();
+  for (int q = 1; q < n; q++) {
+    double s;
+    while (true) {
+      int p = v_[k];
+      s = ((g_[q] + q * q) - (g_[p] + p * p)) / (2.0 * (q - p));
+      if (s > z_[k])
+        break;
+      k--;
+    }
+    k++;
+    v_[k] = q;
+    z_[k] = s;
+    z_[k + 1] = std::numeric_limits<double>::infinity();
+  }
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z_[k + 1] < q)
+      k++;
+    int p = v_[k];
+    f[q * stride] = (q - p) * (q - p) + g_[p];
+  }
+}
+
+double DistanceField::Distance(Eigen::Vector3d const& p) const {
+  Eigen::Vector3d u = (p - origin_) / res_ - Eigen::Vector3d::Constant(0.5);
+  int idx[3];
+  double w[3];
+  for (int a = 0; a < 3; a++) {
+    double c = std::min(std::max(u(a), 0.0), dim_(a) - 1.0);
+    idx[a] = std::min(static_cast<int>(c), std::max(dim_(a) - 2, 0));
+    w[a] = std::min(c - idx[a], 1.0);
+  }
+  double d = 0.0;
+  for (int corner = 0; corner < 8; corner++) {
+    int i = idx[0] + (corner & 1), j = idx[1] + ((corner >> 1) & 1), k = idx[2] + (corner >> 2);
+    double weight = ((corner & 1) ? w[0] : 1.0 - w[0]) * (((corner >> 1) & 1) ? w[1] : 1.0 - w[1])
+      * ((corner >> 2) ? w[2] : 1.0 - w[2]);
+    if (weight > 0.0)
+      d += weight * field_[Index(dim_, i, j, k)];
+  }
+  return d;
+}
+
+}  // namespace choreographer
@@ -18,10 +18,20 @@
 
 #include <choreographer/validator.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 namespace choreographer {
 
+// Sphere tracing along a segment. The robot moves at least this far
+// between two clearance queries, which is how deep it could graze a
+// zone unnoticed. The interpolated distance fields change by at most
+// kLipschitz times the distance moved.
+static const double kMinStep = 0.001;
+static const double kLipschitz = std::sqrt(3.0);
+
 
 // Process zone
   void Validator::ProcessZone(std::vector<signed char> &map, int type, char cell_value, bool surface) {
@@ -154,17 +164,88 @@ bool Validator::GetZonesMap() {
     }
     jps_map_util_->dilate(inflation, inflation);     // sets dilating radius
     jps_map_util_->dilating();                       // this dilates the entire map
+
+    // 7) Distance fields for validating segments, on the same grid
+    inflation_ = inflation;
+    ComputeDistanceFields(origin, dim);
   return true;
 }
 
+// Distance fields of the zones
+void Validator::ComputeDistanceFields(Vec3f const& origin, Vec3i const& dim) {
+  // A cell is in the keep-in zones when its eight corners are, which
+  // joins zones that touch or overlap. Gaps between keep-in zones that
+  // fall between grid corners are not seen.
+  Vec3i corner_dim = dim + Vec3i::Ones();
+  std::vector<bool> in_keepin(corner_dim.prod(), false);
+  for (auto &zone : zones_.zones) {
+    if (zone.type != ff_msgs::Zone::KEEPIN)
+      continue;
+    Vec3f zmin(std::min(zone.min.x, zone.max.x), std::min(zone.min.y, zone.max.y),
+               std::min(zone.min.z, zone.max.z));
+    Vec3f zmax(std::max(zone.min.x, zone.max.x), std::max(zone.min.y, zone.max.y),
+               std::max(zone.min.z, zone.max.z));
+    Vec3i lo, hi;
+    for (int a = 0; a < 3; a++) {
+      lo(a) = std::max(static_cast<int>(std::ceil((zmin(a) - origin(a)) / map_res_)), 0);
+      hi(a) = std::min(static_cast<int>(std::floor((zmax(a) - origin(a)) / map_res_)), dim(a));
+    }
+    for (int k = lo(2); k <= hi(2); k++)
+      for (int j = lo(1); j <= hi(1); j++)
+        for (int i = lo(0); i <= hi(0); i++)
+          in_keepin[DistanceField::Index(corner_dim, i, j, k)] = true;
+  }
+  std::vector<bool> inside(dim.prod());
+  for (int k = 0; k < dim(2); k++)
+    for (int j = 0; j < dim(1); j++)
+      for (int i = 0; i < dim(0); i++) {
+        bool all = true;
+        for (int c = 0; c < 8 && all; c++)
+          all = in_keepin[DistanceField::Index(corner_dim,
+            i + (c & 1), j + ((c >> 1) & 1), k + (c >> 2))];
+        inside[DistanceField::Index(dim, i, j, k)] = all;
+      }
+  keepin_field_.Compute(origin, dim, map_res_, inside);
+
+  // A cell is clear of the keep-out zones when it touches none of them
+  std::fill(inside.begin(), inside.end(), true);
+  for (auto &zone : zones_.zones) {
+    if (zone.type != ff_msgs::Zone::KEEPOUT)
+      continue;
+    Vec3f zmin(std::min(zone.min.x, zone.max.x), std::min(zone.min.y, zone.max.y),
+               std::min(zone.min.z, zone.max.z));
+    Vec3f zmax(std::max(zone.min.x, zone.max.x), std::max(zone.min.y, zone.max.y),
+               std::max(zone.min.z, zone.max.z));
+    Vec3i lo, hi;
+    for (int a = 0; a < 3; a++) {
+      lo(a) = std::max(static_cast<int>(std::floor((zmin(a) - origin(a)) / map_res_)), 0);
+      hi(a) = std::min(static_cast<int>(std::floor((zmax(a) - origin(a)) / map_res_)), dim(a) - 1);
+    }
+    for (int k = lo(2); k <= hi(2); k++)
+      for (int j = lo(1); j <= hi(1); j++)
+        for (int i = lo(0); i <= hi(0); i++)
+          inside[DistanceField::Index(dim, i, j, k)] = false;
+  }
+  keepout_field_.Compute(origin, dim, map_res_, inside);
+}
+
+// Clearance beyond the inflation radius, less the configured margin for
+// the error of the fields
+double Validator::Clearance(Vec3f const& p, Response * zone) const {
+  double keepin = keepin_field_.Distance(p);
+  double keepout = keepout_field_.Distance(p);
+  *zone = (keepin < keepout ? VIOLATES_KEEP_IN : VIOLATES_KEEP_OUT);
+  return std::min(keepin, keepout) - field_margin_ * map_res_ - inflation_;
+}
+
 // Check that we are within a keep in and outside all keep out zones
 Validator::Response Validator::CheckSegment(ff_util::Segment const& msg,
-  ff_msgs::FlightMode const& flight_mode, bool face_forward) {
-  // Calculate a resample rate that ensures we will never have a large enough
-  // stride between setpoints that we could pass through an object. At half a
-  // meter per second -- the max velocity -- a 10Hz check would cover 5cm,
-  // which is smaller than the radius of the freeflyer.
-  ff_util::Segment seg;
+  ff_msgs::FlightMode const& flight_mode, bool face_forward, double * min_clearance) {
+  if (min_clearance)
+    *min_clearance = std::numeric_limits<double>::quiet_NaN();
+  // Resample to check the limits and the setpoint rate at 10Hz. The zones
+  // are checked along the continuous path, further below.
+  ff_util::Segment & seg = resampled_;
   if (ff_util::FlightUtil::Resample(msg, seg, 10.0) != ff_util::SUCCESS) {
     ROS_DEBUG("Could not resample segment at 10Hz");
     return VIOLATES_RESAMPLING;
@@ -192,23 +273,34 @@ Validator::Response Validator::CheckSegment(ff_util::Segment const& msg,
   default:
     break;
   }
-  // Now, check each setpoint in the segment against the zones
-  ff_util::Segment::iterator it;
-  Vec3f tmp = Vec3f::Zero();
-  // Check if the robot is going outside a keepin zone
-  tmp << seg.back().pose.position.x, seg.back().pose.position.y, seg.back().pose.position.z;
-  if (jps_map_util_->isUnKnown(jps_map_util_->floatToInt(tmp)) ||
-            jps_map_util_->isOutSide(jps_map_util_->floatToInt(tmp)))
+  // Now, sweep the robot along the segment. Each piece has a constant
+  // acceleration, and the robot cannot reach a zone before it has moved
+  // by its clearance, so that is how far it is moved between queries.
+  if (keepin_field_.Empty() || keepout_field_.Empty())
     return VIOLATES_KEEP_IN;
-
-  for (it = seg.begin(); it != seg.end(); it++) {
-    tmp << it->pose.position.x, it->pose.position.y, it->pose.position.z;
-    if (jps_map_util_->isOccupied(jps_map_util_->floatToInt(tmp)))
-      return VIOLATES_KEEP_OUT;
-    else if (jps_map_util_->isUnKnown(jps_map_util_->floatToInt(tmp)) ||
-              jps_map_util_->isOutSide(jps_map_util_->floatToInt(tmp)))
-      return VIOLATES_KEEP_IN;
+  double clearance_min = std::numeric_limits<double>::infinity();
+  Response closest = SUCCESS;
+  for (size_t i = 0; i < msg.size() && clearance_min >= 0.0; i++) {
+    ff_util::State s(msg[i]);
+    double duration = (i + 1 < msg.size() ? msg[i + 1].when.toSec() - s.t : 0.0);
+    double speed = std::max(s.v.norm(), (s.v + s.a * duration).norm());
+    double t = 0.0;
+    while (true) {
+      Response zone;
+      double clearance = Clearance(s.p + s.v * t + 0.5 * s.a * t * t, &zone);
+      if (clearance < clearance_min) {
+        clearance_min = clearance;
+        closest = zone;
+      }
+      if (clearance < 0.0 || t >= duration || speed <= 0.0)
+        break;
+      t = std::min(duration, t + std::max(clearance, kMinStep) / (kLipschitz * speed));
+    }
   }
+  if (min_clearance)
+    *min_clearance = clearance_min;
+  if (clearance_min < 0.0)
+    return closest;
   return SUCCESS;
 }
 
@@ -239,6 +331,7 @@ bool Validator::Init(ros::NodeHandle *nh, ff_util::ConfigServer & cfg) {
   // Check if overwriting is allowed
   zone_file_ = cfg.Get<std::string>("zone_file");
   overwrite_ = cfg.Get<bool>("zone_overwrite");
+  field_margin_ = cfg.Get<double>("zone_field_margin");
   // Try and open the zone file. If this doesn't work, that's OK. It just means
   // that we need to wait for them to be updated.
   if (!ff_util::Serialization::ReadFile(zone_file_, zones_)) {
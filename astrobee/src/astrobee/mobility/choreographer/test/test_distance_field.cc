@@ -0,0 +1,137 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Checks the distance fields of the zones against hand computed distances
+
+#include <choreographer/distance_field.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using choreographer::DistanceField;
+
+static const double kRes = 0.1;
+static const int kDim = 21;
+
+// Center of cell (i, j, k) of the grid, which starts at the origin
+static Eigen::Vector3d Center(int i, int j, int k) {
+  return kRes * Eigen::Vector3d(i + 0.5, j + 0.5, k + 0.5);
+}
+
+// A grid of kDim cells along each axis, with the cells in [lo, hi]
+// along each axis inside the region
+static void ComputeBox(int lo, int hi, DistanceField * field) {
+  Eigen::Vector3i dim = Eigen::Vector3i::Constant(kDim);
+  std::vector<bool> inside(kDim * kDim * kDim, false);
+  for (int k = lo; k <= hi; k++)
+    for (int j = lo; j <= hi; j++)
+      for (int i = lo; i <= hi; i++)
+        inside[DistanceField::Index(dim, i, j, k)] = true;
+  field->Compute(Eigen::Vector3d::Zero(), dim, kRes, inside);
+}
+
+// Keep-in box of the cells 5 to 14, spanning [0.5, 1.5] along each axis
+TEST(distance_field, box) {
+  DistanceField field;
+  ComputeBox(5, 14, &field);
+  // Inside, from the closest cell center outside less half a cell
+  EXPECT_NEAR(0.45, field.Distance(Center(9, 9, 9)), 1e-6);
+  EXPECT_NEAR(0.05, field.Distance(Center(5, 9, 9)), 1e-6);
+  EXPECT_NEAR(0.25, field.Distance(Center(7, 12, 10)), 1e-6);
+  // Outside, from the closest cell center inside less half a cell
+  EXPECT_NEAR(-0.05, field.Distance(Center(4, 9, 9)), 1e-6);
+  EXPECT_NEAR(-0.25, field.Distance(Center(2, 9, 9)), 1e-6);
+  EXPECT_NEAR(0.05 - 0.1 * std::sqrt(8.0), field.Distance(Center(3, 3, 9)), 1e-6);
+  EXPECT_NEAR(0.05 - 0.1 * std::sqrt(12.0), field.Distance(Center(3, 3, 3)), 1e-6);
+  // Halfway between the centers on either side of the boundary
+  EXPECT_NEAR(0.0, field.Distance(Eigen::Vector3d(0.5, 0.95, 0.95)), 1e-6);
+
+  // Everywhere within the documented error of the distance to the box
+  for (int n = 0; n < 10000; n++) {
+    Eigen::Vector3d p = (Eigen::Vector3d::Random() + Eigen::Vector3d::Ones()) * 0.5 * kDim * kRes;
+    Eigen::Vector3d outside = ((p.array() - 1.0).abs() - 0.5).matrix();
+    double exact = outside.maxCoeff() < 0.0 ? -outside.maxCoeff()
+      : -outside.cwiseMax(0.0).norm();
+    EXPECT_LE(field.Distance(p), exact + DistanceField::kMargin * kRes + 1e-6);
+    EXPECT_GE(field.Distance(p), exact - 1.5 * kRes);
+  }
+}
+
+// Keep-out zone of a single cell, at the center of the grid
+TEST(distance_field, point) {
+  Eigen::Vector3i dim = Eigen::Vector3i::Constant(kDim);
+  std::vector<bool> inside(kDim * kDim * kDim, true);
+  inside[DistanceField::Index(dim, 10, 10, 10)] = false;
+  DistanceField field;
+  field.Compute(Eigen::Vector3d::Zero(), dim, kRes, inside);
+  EXPECT_NEAR(-0.05, field.Distance(Center(10, 10, 10)), 1e-6);
+  EXPECT_NEAR(0.05, field.Distance(Center(11, 10, 10)), 1e-6);
+  EXPECT_NEAR(0.25, field.Distance(Center(10, 13, 10)), 1e-6);
+  EXPECT_NEAR(0.1 * (std::sqrt(5.0) - 0.5), field.Distance(Center(12, 11, 10)), 1e-6);
+  EXPECT_NEAR(0.1 * (std::sqrt(29.0) - 0.5), field.Distance(Center(14, 8, 7)), 1e-6);
+  EXPECT_NEAR(0.1 * (std::sqrt(300.0) - 0.5), field.Distance(Center(0, 0, 0)), 1e-6);
+  // Points off the grid take the value of the closest border
+  EXPECT_NEAR(field.Distance(Center(0, 10, 10)), field.Distance(Eigen::Vector3d(-1.0, 1.05, 1.05)), 1e-6);
+}
+
+// Sphere tracing as the validator does it, moving by the distance over
+// the Lipschitz constant of the field between two queries, returns the
+// smallest distance along the segment
+static double Trace(DistanceField const& field, Eigen::Vector3d const& a, Eigen::Vector3d const& b) {
+  const double kMinStep = 0.001, kLipschitz = std::sqrt(3.0);
+  double length = (b - a).norm(), s = 0.0, min_distance = field.Distance(a);
+  while (min_distance >= 0.0 && s < length) {
+    s = std::min(length, s + std::max(min_distance, kMinStep) / kLipschitz);
+    min_distance = std::min(min_distance, field.Distance(a + (b - a) * s / length));
+  }
+  return min_distance;
+}
+
+// A wall one cell thick in the middle of the grid, which is negative
+// only over half a cell, is found from any direction
+TEST(distance_field, thin_obstacle) {
+  Eigen::Vector3i dim = Eigen::Vector3i::Constant(kDim);
+  std::vector<bool> inside(kDim * kDim * kDim, true);
+  for (int k = 0; k < kDim; k++)
+    for (int j = 0; j < kDim; j++)
+      inside[DistanceField::Index(dim, 10, j, k)] = false;
+  DistanceField field;
+  field.Compute(Eigen::Vector3d::Zero(), dim, kRes, inside);
+  EXPECT_NEAR(0.05, field.Distance(Center(9, 4, 4)), 1e-6);
+  EXPECT_NEAR(-0.05, field.Distance(Center(10, 4, 4)), 1e-6);
+  EXPECT_NEAR(0.45, field.Distance(Center(15, 4, 4)), 1e-6);
+
+  for (int n = 0; n < 1000; n++) {
+    Eigen::Vector3d a = (Eigen::Vector3d::Random() + Eigen::Vector3d::Ones()) * 0.5 * kDim * kRes;
+    Eigen::Vector3d b = (Eigen::Vector3d::Random() + Eigen::Vector3d::Ones()) * 0.5 * kDim * kRes;
+    a(0) = 0.05 + 0.9 * a(0) / (kDim * kRes);
+    b(0) = 1.15 + 0.9 * b(0) / (kDim * kRes);
+    EXPECT_LT(Trace(field, a, b), 0.0);
+  }
+  // Parallel to the wall and clear of it
+  EXPECT_NEAR(0.05, Trace(field, Center(9, 0, 0), Center(9, 20, 20)), 1e-6);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
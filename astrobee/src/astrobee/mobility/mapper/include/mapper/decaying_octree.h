@@ -0,0 +1,121 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef MAPPER_DECAYING_OCTREE_H_
+#define MAPPER_DECAYING_OCTREE_H_
+
+#include <octomap/octomap.h>
+#include <octomap/OcTreeNode.h>
+#include <octomap/OccupancyOcTreeBase.h>
+
+#include <string>
+
+namespace octoclass {
+
+// Occupancy node that remembers when it was last updated
+class DecayingOcTreeNode : public octomap::OcTreeNode {
+ public:
+  DecayingOcTreeNode() : octomap::OcTreeNode(), timestamp_(0) {}
+  DecayingOcTreeNode(const DecayingOcTreeNode &rhs) : octomap::OcTreeNode(rhs), timestamp_(rhs.timestamp_) {}
+
+  bool operator==(const DecayingOcTreeNode &rhs) const {
+    return (rhs.value == value && rhs.timestamp_ == timestamp_);
+  }
+
+  void copyData(const DecayingOcTreeNode &from) {
+    octomap::OcTreeNode::copyData(from);
+    timestamp_ = from.getTimestamp();
+  }
+
+  inline double getTimestamp() const {return timestamp_;}
+  inline void setTimestamp(const double timestamp) {timestamp_ = timestamp;}
+
+  // Inner nodes take the maximum occupancy and the latest timestamp of their children
+  void updateOccupancyChildren();
+
+ protected:
+  double timestamp_;  // Seconds, in ROS time
+};
+
+// Occupancy octree whose nodes fade towards unknown as time passes since
+// their last update. Nothing is done when time passes: the faded value
+// of a node is computed when it is read or updated, and a node whose
+// faded value crosses the occupancy threshold is considered unknown.
+// Expired nodes are deleted by RemoveExpiredNodes, which sweeps one slab
+// of the mapped volume per call.
+class DecayingOcTree : public octomap::OccupancyOcTreeBase<DecayingOcTreeNode> {
+ public:
+  explicit DecayingOcTree(const double resolution);
+
+  DecayingOcTree* create() const {return new DecayingOcTree(resolution);}
+  std::string getTreeType() const {return "DecayingOcTree";}
+
+  // Log-odds lost per second by occupied nodes and gained by free ones.
+  // Zero disables fading.
+  void SetDecayRates(const float occupied_rate, const float free_rate);
+
+  // Timestamp given to the nodes updated from now on. A batch of
+  // updates shares one timestamp, so that the nodes can still be pruned.
+  void SetUpdateTime(const double time) {update_time_ = time;}
+
+  // Log-odds of a node, faded until the given time
+  float DecayedLogOdds(const DecayingOcTreeNode *node, const double now) const;
+
+  // Whether a node has faded into unknown space
+  bool IsNodeExpired(const DecayingOcTreeNode *node) const;
+  bool IsNodeExpired(const DecayingOcTreeNode *node, const double now) const;
+
+  // Node with the given key, or NULL if it is unknown or expired
+  DecayingOcTreeNode* SearchLive(const octomap::OcTreeKey &key, unsigned int depth = 0) const;
+
+  // Occupancy of a node that has not expired. Fading never changes a
+  // node from free to occupied or back without it expiring first.
+  bool isNodeOccupied(const DecayingOcTreeNode *node) const {
+    return node->getLogOdds() >= occ_prob_thres_log;
+  }
+  bool isNodeOccupied(const DecayingOcTreeNode &node) const {
+    return node.getLogOdds() >= occ_prob_thres_log;
+  }
+
+  // Delete the expired leaves in the next of num_slices slabs of the
+  // mapped volume. Returns the number of deleted leaves.
+  size_t RemoveExpiredNodes(const unsigned int num_slices);
+
+  // Updates also track the extent of the mapped volume
+  using octomap::OccupancyOcTreeBase<DecayingOcTreeNode>::updateNode;
+  DecayingOcTreeNode* updateNode(const octomap::OcTreeKey &key, float log_odds_update, bool lazy_eval = false);
+
+  // Apply the fading accumulated since the last update before the new one
+  void updateNodeLogOdds(DecayingOcTreeNode *node, const float &update) const;
+
+  // Children with different timestamps are not merged
+  bool isNodeCollapsible(const DecayingOcTreeNode *node) const;
+
+  void clear();
+
+ protected:
+  float occupied_rate_, free_rate_;
+  double update_time_;
+  bool has_extent_;
+  octomap::OcTreeKey min_key_, max_key_;  // Extent of the updated keys
+  unsigned int next_slice_;
+};
+
+}  // namespace octoclass
+
+#endif  // MAPPER_DECAYING_OCTREE_H_
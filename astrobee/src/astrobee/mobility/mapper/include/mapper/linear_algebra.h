@@ -20,6 +20,7 @@
 #define MAPPER_LINEAR_ALGEBRA_H_
 
 #include <msg_conversions/msg_conversions.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include "mapper/visualization_functions.h"
@@ -172,6 +173,15 @@ class FrustumPlanes{
     transformed_frustum->DR_ = transform*DR_;
   }
 
+  // Signed distance from a point to the closest side plane of the
+  // frustum, positive inside
+  double DistanceToFrustum(const Eigen::Vector3d &pt) const {
+    return std::min(std::min((pt - left_plane_.origin_).dot(left_plane_.normal_),
+                             (pt - right_plane_.origin_).dot(right_plane_.normal_)),
+                    std::min((pt - up_plane_.origin_).dot(up_plane_.normal_),
+                             (pt - down_plane_.origin_).dot(down_plane_.normal_)));
+  }
+
   bool IsPointWithinFrustum(const Eigen::Vector3d &pt) const {
     if ((pt - left_plane_.origin_).dot(left_plane_.normal_) < 0)
       return false;
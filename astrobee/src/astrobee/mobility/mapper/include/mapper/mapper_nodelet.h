@@ -46,6 +46,7 @@
 #include <ff_util/ff_flight.h>
 #include <ff_util/ff_serialization.h>
 #include <ff_util/config_server.h>
+#include <ff_util/perf_timer.h>
 
 // Service definition for zone registration
 #include <ff_msgs/Hazard.h>
@@ -66,6 +67,7 @@
 #include <thread>         // std::thread
 #include <mutex>
 #include <atomic>
+#include <condition_variable>   // NOLINT
 
 // Astrobee message types
 #include "ff_msgs/Segment.h"
@@ -98,7 +100,11 @@ class MapperNodelet : public ff_util::FreeFlyerNodelet {
 
   // Callbacks (see callbacks.cpp for implementation) ----------------
   // Callback for handling incoming point cloud messages
-  void PclCallback(ros::TimerEvent const& event);
+  void PclCallback(const sensor_msgs::PointCloud2::ConstPtr &msg, std::string const& frame);
+
+  // Subscribe to or shut down the depth cameras enabled in the config
+  void StartDepthSubscribers();
+  void StopDepthSubscribers();
 
   // Callback for handling incoming new trajectory messages
   void SegmentCallback(const ff_msgs::Segment::ConstPtr &msg);
@@ -160,8 +166,11 @@ class MapperNodelet : public ff_util::FreeFlyerNodelet {
   // Collision checking
   void CollisionCheckTask();
 
-  // Timer for getting pcl data and populating the octomap
-  void OctomappingTask();
+  // Thread draining the point cloud queue into the octomap
+  void OctomappingThread();
+
+  // Integrate one point cloud into the octomap
+  void OctomappingTask(StampedPcl const& stamped_pcl);
 
   // Initialize fault management
   void InitFault(std::string const& msg);
@@ -172,14 +181,23 @@ class MapperNodelet : public ff_util::FreeFlyerNodelet {
   // Declare global variables (structures defined in structs.h)
   GlobalVariables globals_;
 
+  // Octomapping thread
+  std::thread octomap_thread_;
+  std::atomic<bool> octomap_running_{false};
+
   // Timer variables
-  ros::Timer timer_o_;  // Octomapping Task
   ros::Timer timer_d_;  // Diagnostics
   ros::Timer timer_f_;  // Fade Task
 
+  // Latency of the callbacks and tasks, published on /performance/mapper/latency
+  ff_util::PerfReporter perf_;
+  ff_util::LatencyHistogram *pt_pcl_ = nullptr, *pt_octomap_ = nullptr;
+  ff_util::LatencyHistogram *pt_fade_ = nullptr, *pt_collision_ = nullptr;
+
   // Subscriber variables
   bool use_haz_cam_, use_perch_cam_;
   ros::Subscriber segment_sub_, reset_sub_;
+  ros::Subscriber haz_cam_sub_, perch_cam_sub_;
 
   // Octomap services
   ros::ServiceServer set_resolution_srv_, set_memory_time_srv_, set_collision_distance_srv_;
@@ -187,7 +205,10 @@ class MapperNodelet : public ff_util::FreeFlyerNodelet {
   ros::ServiceServer reset_map_srv_;
 
   // Timer rates (hz)
-  double octomap_update_rate_, tf_update_rate_, fading_memory_update_rate_;
+  double fading_memory_update_rate_;
+
+  // How long to wait for the pose at the capture time of a cloud (seconds)
+  std::atomic<double> tf_timeout_;
 
   // Trajectory validation variables -----------------------------
   State state_;                                       // State of the mapper (structure defined in struct.h)
@@ -19,6 +19,7 @@
 #ifndef MAPPER_OCTOCLASS_H_
 #define MAPPER_OCTOCLASS_H_
 
+#include <ff_common/thread.h>
 #include <octomap/octomap.h>
 #include <octomap/OcTree.h>
 #include <pcl/point_cloud.h>
@@ -26,8 +27,13 @@
 #include <pcl/point_types.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <visualization_msgs/MarkerArray.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <iostream>
+#include "mapper/decaying_octree.h"
 #include "mapper/indexed_octree_key.h"
 #include "mapper/linear_algebra.h"
 
@@ -36,9 +42,9 @@ namespace octoclass {
 // 3D occupancy grid
 class OctoClass{
  public:
-  octomap::OcTree tree_ = octomap::OcTree(0.1);  // create empty tree with resolution 0.1
-  octomap::OcTree tree_inflated_ = octomap::OcTree(0.1);  // create empty tree with resolution 0.1
-  double memory_time_;  // Fading memory of the tree in seconds
+  DecayingOcTree tree_ = DecayingOcTree(0.1);  // create empty tree with resolution 0.1
+  DecayingOcTree tree_inflated_ = DecayingOcTree(0.1);  // create empty tree with resolution 0.1
+  double memory_time_ = 0;  // Fading memory of the tree in seconds
   algebra_3d::FrustumPlanes cam_frustum_;
 
   // Constructor
@@ -71,14 +77,15 @@ class OctoClass{
   void PclToRayOctomap(const pcl::PointCloud< pcl::PointXYZ > &cloud,
                         const geometry_msgs::TransformStamped &tf_cam2world,
                         const algebra_3d::FrustumPlanes &frustum);    // Map obstacles and free area
-  void ComputeUpdate(const octomap::KeySet &occ_inflated,  // Inflated endpoints
-                     const octomap::KeySet &occ_slim,      // Non-inflated endpoints
+  void ComputeUpdate(const std::vector<uint64_t> &occ_inflated,  // Inflated endpoints (sorted packed keys)
+                     const std::vector<uint64_t> &occ_slim,      // Non-inflated endpoints (sorted packed keys)
                      const octomap::point3d& origin,
                      const double &maxrange,
-                     octomap::KeySet *occ_slim_in_range,
-                     octomap::KeySet *free_slim,
-                     octomap::KeySet *free_inflated);  // Raycasting method for inflated maps
-  void FadeMemory(const double &rate);  // Run fading memory method
+                     std::vector<uint64_t> *occ_slim_in_range,
+                     std::vector<uint64_t> *free_slim,
+                     std::vector<uint64_t> *free_inflated);  // Raycasting method for inflated maps
+  void SetNumThreads(const int num_threads);  // Threads used to cast the rays of a point cloud
+  void FadeMemory();  // Free the nodes of one slab of the map that have faded away
   // DEPRECATED: it was used to inflate the whole map (too expensive)
   // void InflateObstacles(const double &thickness);
   // DEPRECATED: Returns all colliding nodes in the pcl
@@ -150,11 +157,32 @@ class OctoClass{
   int tree_depth_;
   double resolution_;
   double max_range_, min_range_;
-  float inflate_radius_;
-  std::vector<Eigen::Vector3d> sphere_;  // Discretized sphere used in map inflation
+  float inflate_radius_ = 0;
+  int num_threads_ = 1;
+  std::unique_ptr<ff_common::ThreadPool> pool_;  // Workers helping the calling thread in ParallelFor
+  static const unsigned int kFadeSlices = 8;  // FadeMemory calls to sweep the whole map
+  typedef std::array<int, 3> KeyOffset;
+  std::vector<KeyOffset> sphere_;        // Discretized sphere used in map inflation, as key offsets
+  double stencil_radius_ = 0;            // Radius of the farthest node in sphere_
   std::vector<double> depth_volumes_;     // Volume per depth in the tree
 
   // Methods
+  void ComputeInflationStencil();
+  void UpdateDecayRates();  // Fading speed, from the memory time and the thresholds
+  // Mark the nodes with the given packed keys occupied, then free
+  static void UpdateNodes(const std::vector<uint64_t> &occupied,
+                          const std::vector<uint64_t> &free,
+                          DecayingOcTree *tree);
+  static uint64_t PackKey(const octomap::OcTreeKey &key);
+  static octomap::OcTreeKey UnpackKey(const uint64_t packed);
+  // Split [0, num_items) into one contiguous range per thread and run
+  // job(thread, begin, end) on each range, the first on the calling
+  // thread and the others on pool_
+  void ParallelFor(const size_t num_items,
+                   std::function<void(int, size_t, size_t)> const& job) const;
+  // Concatenate the per-thread buffers into sorted, unique keys and clear them
+  static void MergeKeys(std::vector<std::vector<uint64_t> > *buffers,
+                        std::vector<uint64_t> *keys);
   double VectorNormSquared(const double &x,
                            const double &y,
                            const double &z);
@@ -26,6 +26,7 @@
 #include <pcl/point_types.h>
 
 // Locally defined libraries
+#include <mapper/lock_free_queue.h>
 #include <mapper/octoclass.h>
 #include <mapper/sampled_trajectory.h>
 
@@ -33,17 +34,21 @@
 #include <ff_msgs/ControlGoal.h>
 
 // c++ libraries
-#include <queue>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <mutex>
 #include <condition_variable>   // NOLINT
 
 namespace mapper {
 
+// A depth cloud and the camera pose at the time it was captured
 struct StampedPcl {
   pcl::PointCloud<pcl::PointXYZ> cloud;
   geometry_msgs::TransformStamped tf_cam2world;
 };
+typedef std::shared_ptr<StampedPcl> StampedPclPtr;
 
 enum State {
   IDLE,
@@ -51,12 +56,22 @@ enum State {
 };
 
 struct GlobalVariables {
-  geometry_msgs::TransformStamped tf_cam2world;
-  geometry_msgs::TransformStamped tf_perch2world;
-  geometry_msgs::TransformStamped tf_body2world;
   octoclass::OctoClass octomap = octoclass::OctoClass(0.05);
   sampled_traj::SampledTrajectory3D sampled_traj;
-  std::queue<StampedPcl> pcl_queue;
+  // The octomap and the trajectory are shared by the octomapping thread
+  // and the ROS callbacks. When both are needed, sampled_traj_mutex is
+  // locked first.
+  std::mutex octomap_mutex;
+  std::mutex sampled_traj_mutex;
+  // Clouds waiting to be integrated, filled by the depth subscribers
+  // and drained by the octomapping thread, which sleeps on pcl_cv
+  std::unique_ptr<LockFreeQueue<StampedPclPtr>> pcl_queue;
+  std::mutex pcl_mutex;
+  std::condition_variable pcl_cv;
+  // Ingestion statistics, reported in the diagnostics
+  std::atomic<uint64_t> pcls_received{0};
+  std::atomic<uint64_t> pcls_dropped{0};
+  std::atomic<uint64_t> tf_failures{0};
 };
 
 }  // namespace mapper
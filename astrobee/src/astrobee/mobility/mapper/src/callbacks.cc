@@ -19,64 +19,62 @@
 #include <mapper/mapper_nodelet.h>
 #include <vector>
 #include <string>
+#include <utility>
 #include "mapper/pcl_conversions.h"
 
 namespace mapper {
 
-void MapperNodelet::PclCallback(ros::TimerEvent const& event) {
-  // Get messages
+void MapperNodelet::PclCallback(const sensor_msgs::PointCloud2::ConstPtr &msg, std::string const& frame) {
+  ff_util::ScopedLatencyTimer timer(pt_pcl_);
+  globals_.pcls_received++;
+
+  // Structure to include pcl and the camera pose when it was captured
+  StampedPclPtr new_pcl(new StampedPcl);
+  try {
+    new_pcl->tf_cam2world = buffer_.lookupTransform(FRAME_NAME_WORLD,
+      GetTransform(frame), msg->header.stamp, ros::Duration(tf_timeout_));
+  } catch (tf2::TransformException &ex) {
+    // Integrating with a pose from another time would smear the map
+    globals_.tf_failures++;
+    ROS_DEBUG_STREAM("Dropping point cloud, no transform at its stamp: " << ex.what());
+    return;
+  }
+
+  // Convert message into pcl type
+  pcl::fromROSMsg(*msg, new_pcl->cloud);
+
+  // Save into the queue. If the octomapping thread fell behind, the
+  // oldest cloud is dropped, as the newest one describes the scene best.
+  while (!globals_.pcl_queue->TryPush(std::move(new_pcl))) {
+    StampedPclPtr oldest;
+    if (globals_.pcl_queue->TryPop(&oldest))
+      globals_.pcls_dropped++;
+  }
+  globals_.pcl_cv.notify_one();
+}
+
+void MapperNodelet::StartDepthSubscribers() {
+  // Subscribe on the multithreaded handle, so that waiting for a
+  // transform does not hold back the other callbacks
   std::string cam_prefix = TOPIC_HARDWARE_PICOFLEXX_PREFIX;
   std::string cam_suffix = TOPIC_HARDWARE_PICOFLEXX_SUFFIX;
-
+  ros::NodeHandle *nh_mt = GetPlatformHandle(true);
   if (use_haz_cam_) {
-    std::string cam = TOPIC_HARDWARE_NAME_HAZ_CAM;
-    // Get depth message
-    boost::shared_ptr<sensor_msgs::PointCloud2 const> msg;
-    msg = ros::topic::waitForMessage<sensor_msgs::PointCloud2>(
-                      cam_prefix + cam + cam_suffix, ros::Duration(0.5));
-    if (msg == NULL) {
-      ROS_INFO("No point clound message received");
-    } else {
-      // Structure to include pcl and its frame
-      StampedPcl new_pcl;
-
-      // Convert message into pcl type
-      pcl::PointCloud<pcl::PointXYZ> cloud;
-      pcl::fromROSMsg(*msg, cloud);
-      new_pcl.cloud = cloud;
-      new_pcl.tf_cam2world = globals_.tf_cam2world;
-
-      // save into global variables
-      globals_.pcl_queue.push(new_pcl);
-    }
+    haz_cam_sub_ = nh_mt->subscribe<sensor_msgs::PointCloud2>(
+      cam_prefix + TOPIC_HARDWARE_NAME_HAZ_CAM + cam_suffix, 1,
+      boost::bind(&MapperNodelet::PclCallback, this, _1, std::string(FRAME_NAME_HAZ_CAM)));
   }
   if (use_perch_cam_) {
-    std::string cam = TOPIC_HARDWARE_NAME_PERCH_CAM;
-    // Get depth message
-    boost::shared_ptr<sensor_msgs::PointCloud2 const> msg;
-
-    msg = ros::topic::waitForMessage<sensor_msgs::PointCloud2>(
-                      cam_prefix + cam + cam_suffix, ros::Duration(0.5));
-    if (msg == NULL) {
-      ROS_INFO("No point clound message received");
-    } else {
-    // Structure to include pcl and its frame
-    StampedPcl new_pcl;
-
-    // Convert message into pcl type
-    pcl::PointCloud<pcl::PointXYZ> cloud;
-    pcl::fromROSMsg(*msg, cloud);
-    new_pcl.cloud = cloud;
-    new_pcl.tf_cam2world = globals_.tf_perch2world;
-
-    // save into global variables
-    globals_.pcl_queue.push(new_pcl);
-    }
+    perch_cam_sub_ = nh_mt->subscribe<sensor_msgs::PointCloud2>(
+      cam_prefix + TOPIC_HARDWARE_NAME_PERCH_CAM + cam_suffix, 1,
+      boost::bind(&MapperNodelet::PclCallback, this, _1, std::string(FRAME_NAME_PERCH_CAM)));
   }
-
-  OctomappingTask();
 }
 
+void MapperNodelet::StopDepthSubscribers() {
+  haz_cam_sub_.shutdown();
+  perch_cam_sub_.shutdown();
+}
 
 void MapperNodelet::SegmentCallback(const ff_msgs::Segment::ConstPtr &msg) {
   // Check for empty trajectory
@@ -97,6 +95,7 @@ void MapperNodelet::SegmentCallback(const ff_msgs::Segment::ConstPtr &msg) {
   double ts = 0.1;
   sampled_traj::SampledTrajectory3D sampled_traj(ts, poly_trajectories);
 
+  std::lock_guard<std::mutex> traj_lock(globals_.sampled_traj_mutex);
   globals_.sampled_traj.pos_ = sampled_traj.pos_;
   globals_.sampled_traj.time_ = sampled_traj.time_;
   globals_.sampled_traj.n_points_ = sampled_traj.n_points_;
@@ -119,6 +118,7 @@ void MapperNodelet::SegmentCallback(const ff_msgs::Segment::ConstPtr &msg) {
   globals_.sampled_traj.CreateKdTree();
 
   // Notify the collision checker to check for collision
+  std::lock_guard<std::mutex> octomap_lock(globals_.octomap_mutex);
   CollisionCheckTask();
 
   ros::Duration solver_time = ros::Time::now() - t0;
@@ -127,7 +127,21 @@ void MapperNodelet::SegmentCallback(const ff_msgs::Segment::ConstPtr &msg) {
 
 // Send diagnostics
 void MapperNodelet::DiagnosticsCallback(const ros::TimerEvent &event) {
-  SendDiagnostics(cfg_.Dump());
+  std::vector<diagnostic_msgs::KeyValue> keyval = cfg_.Dump();
+  diagnostic_msgs::KeyValue kv;
+  kv.key = "pcl_queue_backlog";
+  kv.value = std::to_string(globals_.pcl_queue->Size());
+  keyval.push_back(kv);
+  kv.key = "pcls_received";
+  kv.value = std::to_string(globals_.pcls_received.load());
+  keyval.push_back(kv);
+  kv.key = "pcls_dropped";
+  kv.value = std::to_string(globals_.pcls_dropped.load());
+  keyval.push_back(kv);
+  kv.key = "pcl_tf_failures";
+  kv.value = std::to_string(globals_.tf_failures.load());
+  keyval.push_back(kv);
+  SendDiagnostics(keyval);
 }
 
 // Configure callback
@@ -135,12 +149,13 @@ bool MapperNodelet::ReconfigureCallback(dynamic_reconfigure::Config &config) {
   if (state_ != IDLE)
     return false;
   cfg_.Reconfigure(config);
+  tf_timeout_ = cfg_.Get<double>("tf_timeout");
   // Turn on mapper
   if (disable_mapper_ && !cfg_.Get<bool>("disable_mapper")) {
     // Timers
-    timer_o_.start();
     timer_f_.start();
     // Subscribers
+    StartDepthSubscribers();
     segment_sub_ = nh_->subscribe(TOPIC_GNC_CTL_SEGMENT, 1,
       &MapperNodelet::SegmentCallback, this);
     reset_sub_ = nh_->subscribe(TOPIC_GNC_EKF_RESET, 1,
@@ -148,9 +163,9 @@ bool MapperNodelet::ReconfigureCallback(dynamic_reconfigure::Config &config) {
   // Turn off mapper
   } else if (!disable_mapper_ && cfg_.Get<bool>("disable_mapper")) {
     // Timers
-    timer_o_.stop();
     timer_f_.stop();
     // Subscribers
+    StopDepthSubscribers();
     segment_sub_.shutdown();
     reset_sub_.shutdown();
   }
@@ -160,6 +175,7 @@ bool MapperNodelet::ReconfigureCallback(dynamic_reconfigure::Config &config) {
 }
 
 void MapperNodelet::ResetCallback(std_msgs::EmptyConstPtr const& msg) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.ResetMap();
 }
 
@@ -0,0 +1,148 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ *
+ * All rights reserved.
+ *
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <mapper/decaying_octree.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace octoclass {
+
+void DecayingOcTreeNode::updateOccupancyChildren() {
+  setLogOdds(getMaxChildLogOdds());
+  if (children == NULL)
+    return;
+  for (unsigned int i = 0; i < 8; i++) {
+    if (children[i] != NULL)
+      timestamp_ = std::max(timestamp_, static_cast<DecayingOcTreeNode*>(children[i])->getTimestamp());
+  }
+}
+
+DecayingOcTree::DecayingOcTree(const double resolution)
+  : octomap::OccupancyOcTreeBase<DecayingOcTreeNode>(resolution),
+    occupied_rate_(0), free_rate_(0), update_time_(0), has_extent_(false), next_slice_(0) {}
+
+void DecayingOcTree::SetDecayRates(const float occupied_rate, const float free_rate) {
+  occupied_rate_ = occupied_rate;
+  free_rate_ = free_rate;
+}
+
+float DecayingOcTree::DecayedLogOdds(const DecayingOcTreeNode *node, const double now) const {
+  const float elapsed = std::max(0.0, now - node->getTimestamp());
+  if (isNodeOccupied(node))
+    return node->getLogOdds() - elapsed * occupied_rate_;
+  return node->getLogOdds() + elapsed * free_rate_;
+}
+
+bool DecayingOcTree::IsNodeExpired(const DecayingOcTreeNode *node) const {
+  return IsNodeExpired(node, ros::Time::now().toSec());
+}
+
+bool DecayingOcTree::IsNodeExpired(const DecayingOcTreeNode *node, const double now) const {
+  if (occupied_rate_ <= 0 && free_rate_ <= 0)
+    return false;
+  return isNodeOccupied(node) != (DecayedLogOdds(node, now) >= occ_prob_thres_log);
+}
+
+DecayingOcTreeNode* DecayingOcTree::SearchLive(const octomap::OcTreeKey &key, unsigned int depth) const {
+  DecayingOcTreeNode* node = search(key, depth);
+  if (node == NULL || IsNodeExpired(node))
+    return NULL;
+  return node;
+}
+
+size_t DecayingOcTree::RemoveExpiredNodes(const unsigned int num_slices) {
+  if (!has_extent_ || root == NULL)
+    return 0;
+
+  // Slab of the mapped volume along x swept by this call
+  const unsigned int slice = next_slice_++ % std::max(1u, num_slices);
+  const unsigned int width = max_key_[0] - min_key_[0] + 1;
+  octomap::OcTreeKey slab_min = min_key_, slab_max = max_key_;
+  slab_min[0] = min_key_[0] + width * slice / num_slices;
+  slab_max[0] = min_key_[0] + width * (slice + 1) / num_slices - 1;
+  if (slab_max[0] < slab_min[0])
+    return 0;
+
+  // Collect first, as deleting invalidates the iterator
+  const double now = ros::Time::now().toSec();
+  std::vector<octomap::OcTreeKey> keys;
+  std::vector<unsigned int> depths;
+  for (leaf_bbx_iterator it = begin_leafs_bbx(slab_min, slab_max), end = end_leafs_bbx(); it != end; ++it) {
+    if (IsNodeExpired(&(*it), now)) {
+      keys.push_back(it.getKey());
+      depths.push_back(it.getDepth());
+    }
+  }
+  for (size_t i = 0; i < keys.size(); i++)
+    deleteNode(keys[i], depths[i]);
+  return keys.size();
+}
+
+DecayingOcTreeNode* DecayingOcTree::updateNode(const octomap::OcTreeKey &key, float log_odds_update,
+                                               bool lazy_eval) {
+  if (!has_extent_) {
+    min_key_ = max_key_ = key;
+    has_extent_ = true;
+  }
+  for (unsigned int i = 0; i < 3; i++) {
+    min_key_[i] = std::min(min_key_[i], key[i]);
+    max_key_[i] = std::max(max_key_[i], key[i]);
+  }
+
+  // The base class skips nodes already at the clamping threshold, which
+  // would not refresh their timestamp
+  DecayingOcTreeNode* leaf = search(key);
+  if (leaf != NULL &&
+      ((log_odds_update >= 0 && leaf->getLogOdds() >= clamping_thres_max) ||
+       (log_odds_update <= 0 && leaf->getLogOdds() <= clamping_thres_min))) {
+    updateNodeLogOdds(leaf, log_odds_update);
+    return leaf;
+  }
+  return octomap::OccupancyOcTreeBase<DecayingOcTreeNode>::updateNode(key, log_odds_update, lazy_eval);
+}
+
+void DecayingOcTree::updateNodeLogOdds(DecayingOcTreeNode *node, const float &update) const {
+  // An expired node, or a new one, starts from unknown
+  if (IsNodeExpired(node, update_time_) || node->getTimestamp() == 0)
+    node->setLogOdds(0);
+  else
+    node->setLogOdds(DecayedLogOdds(node, update_time_));
+  octomap::OccupancyOcTreeBase<DecayingOcTreeNode>::updateNodeLogOdds(node, update);
+  node->setTimestamp(update_time_);
+}
+
+bool DecayingOcTree::isNodeCollapsible(const DecayingOcTreeNode *node) const {
+  if (!octomap::OccupancyOcTreeBase<DecayingOcTreeNode>::isNodeCollapsible(node))
+    return false;
+  const double timestamp = getNodeChild(node, 0)->getTimestamp();
+  for (unsigned int i = 1; i < 8; i++) {
+    if (getNodeChild(node, i)->getTimestamp() != timestamp)
+      return false;
+  }
+  return true;
+}
+
+void DecayingOcTree::clear() {
+  octomap::OccupancyOcTreeBase<DecayingOcTreeNode>::clear();
+  has_extent_ = false;
+  next_slice_ = 0;
+}
+
+}  // namespace octoclass
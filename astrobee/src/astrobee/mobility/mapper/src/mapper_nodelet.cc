@@ -28,7 +28,13 @@ MapperNodelet::MapperNodelet() :
     ff_util::FreeFlyerNodelet(NODE_MAPPER), state_(IDLE) {
 }
 
-MapperNodelet::~MapperNodelet() {}
+MapperNodelet::~MapperNodelet() {
+  // Stop the octomapping thread
+  octomap_running_ = false;
+  globals_.pcl_cv.notify_one();
+  if (octomap_thread_.joinable())
+    octomap_thread_.join();
+}
 
 void MapperNodelet::Initialize(ros::NodeHandle *nh) {
   // Store the node handle for future use
@@ -44,6 +50,16 @@ void MapperNodelet::Initialize(ros::NodeHandle *nh) {
     return;
   }
 
+  // Queue of point clouds waiting to be integrated into the octomap
+  globals_.pcl_queue.reset(new LockFreeQueue<StampedPclPtr>(cfg_.Get<int>("pcl_queue_size")));
+
+  // Latency instrumentation
+  perf_.Initialize(nh, "mapper");
+  pt_pcl_ = perf_.AddTimer("pcl_callback");
+  pt_octomap_ = perf_.AddTimer("octomapping");
+  pt_fade_ = perf_.AddTimer("fade");
+  pt_collision_ = perf_.AddTimer("collision_check");
+
   // Setup a timer to forward diagnostics
   timer_d_ = nh->createTimer(
     ros::Duration(ros::Rate(DEFAULT_DIAGNOSTICS_RATE)),
@@ -71,10 +87,10 @@ void MapperNodelet::Initialize(ros::NodeHandle *nh) {
   clamping_threshold_max = cfg_.Get<double>("clamping_threshold_max");
   compression_max_dev = cfg_.Get<double>("traj_compression_max_dev");
   traj_resolution = cfg_.Get<double>("traj_compression_resolution");
-  octomap_update_rate_ = cfg_.Get<double>("octomap_update_rate");
   fading_memory_update_rate_ = cfg_.Get<double>("fading_memory_update_rate");
   use_haz_cam_ = cfg_.Get<bool>("use_haz_cam");
   use_perch_cam_ = cfg_.Get<bool>("use_perch_cam");
+  tf_timeout_ = cfg_.Get<double>("tf_timeout");
 
   // update tree parameters
   globals_.octomap.SetResolution(map_resolution);
@@ -87,6 +103,7 @@ void MapperNodelet::Initialize(ros::NodeHandle *nh) {
   globals_.octomap.SetHitMissProbabilities(probability_hit, probability_miss);
   globals_.octomap.SetClampingThresholds(
     clamping_threshold_min, clamping_threshold_max);
+  globals_.octomap.SetNumThreads(cfg_.Get<int>("ray_casting_threads"));
 
   // update trajectory discretization parameters (used in collision check)
   globals_.sampled_traj.SetMaxDev(compression_max_dev);
@@ -116,10 +133,11 @@ void MapperNodelet::Initialize(ros::NodeHandle *nh) {
   hazard_pub_ = nh->advertise<ff_msgs::Hazard>(
     TOPIC_MOBILITY_HAZARD, 1);
 
+  // Start the thread draining the point cloud queue into the octomap
+  octomap_running_ = true;
+  octomap_thread_ = std::thread(&MapperNodelet::OctomappingThread, this);
+
     // Timers
-    timer_o_ = nh->createTimer(
-      ros::Duration(ros::Rate(octomap_update_rate_)),
-        &MapperNodelet::PclCallback, this, false, false);
     timer_f_ = nh->createTimer(
       ros::Duration(ros::Rate(fading_memory_update_rate_)),
         &MapperNodelet::FadeTask, this, false, false);
@@ -128,9 +146,9 @@ void MapperNodelet::Initialize(ros::NodeHandle *nh) {
     NODELET_WARN("Mapper disabled, obstacle avoidance not working!");
   } else {
     // Start timers
-    timer_o_.start();
     timer_f_.start();
     // Subscribers
+    StartDepthSubscribers();
     segment_sub_ = nh->subscribe(TOPIC_GNC_CTL_SEGMENT, 1,
       &MapperNodelet::SegmentCallback, this);
     reset_sub_ = nh->subscribe(TOPIC_GNC_EKF_RESET, 1,
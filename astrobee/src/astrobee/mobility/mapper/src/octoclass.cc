@@ -21,6 +21,7 @@
 
 #include <utility>
 #include <algorithm>
+#include <functional>
 #include <vector>
 #include <limits>
 
@@ -35,8 +36,19 @@ OctoClass::OctoClass(const double resolution) {
 
 OctoClass::OctoClass() {}
 
+// Octree keys are three 16 bit coordinates. Packed into one integer,
+// key sets can be sorted and deduplicated without hashing.
+uint64_t OctoClass::PackKey(const octomap::OcTreeKey &key) {
+  return (static_cast<uint64_t>(key[0]) << 32) | (static_cast<uint64_t>(key[1]) << 16) | key[2];
+}
+
+octomap::OcTreeKey OctoClass::UnpackKey(const uint64_t packed) {
+  return octomap::OcTreeKey((packed >> 32) & 0xffff, (packed >> 16) & 0xffff, packed & 0xffff);
+}
+
 void OctoClass::SetMemoryTime(const double memory) {
   memory_time_ = memory;
+  UpdateDecayRates();
   ROS_DEBUG("Fading memory time: %f seconds", memory_time_);
 }
 
@@ -65,21 +77,7 @@ void OctoClass::SetResolution(const double resolution_in) {
   for (unsigned i= 0; i < depth_volumes_.size(); ++i)
     depth_volumes_[i] = pow(tree_inflated_.getNodeSize(i), 3);
 
-  sphere_.clear();
-  static Eigen::Vector3d xyz;
-  const int max_xyz = static_cast<int>(round(inflate_radius_/resolution_));
-  const float max_dist = inflate_radius_*inflate_radius_;
-  static float d_origin;
-  for (int x = -max_xyz; x <= max_xyz; x++) {
-    for (int y = -max_xyz; y <= max_xyz; y++) {
-      for (int z = -max_xyz; z <= max_xyz; z++) {
-        xyz << x*resolution_, y*resolution_, z*resolution_;
-        d_origin = xyz.dot(xyz);  // distance from origin squared
-        if (d_origin <= max_dist)
-          sphere_.push_back(xyz);
-      }
-    }
-  }
+  ComputeInflationStencil();
   ROS_DEBUG("Map resolution: %f meters", resolution_);
 }
 
@@ -90,20 +88,23 @@ double OctoClass::GetResolution() {
 void OctoClass::SetMapInflation(const double inflate_radius) {
   inflate_radius_ = inflate_radius;
   ResetMap();
-  sphere_.clear();
-  static Eigen::Vector3d xyz;
-  // if (inflateMap) {
   ROS_DEBUG("The map is being inflated by a radius of %f!", inflate_radius_);
+  ComputeInflationStencil();
+}
+
+// Key offsets of all nodes within the inflation radius from a node
+void OctoClass::ComputeInflationStencil() {
+  sphere_.clear();
+  stencil_radius_ = 0.0;
   const int max_xyz = static_cast<int>(round(inflate_radius_/resolution_));
-  const float max_dist = inflate_radius_*inflate_radius_;
-  static float d_origin;
+  const double max_dist = inflate_radius_*inflate_radius_;
   for (int x = -max_xyz; x <= max_xyz; x++) {
     for (int y = -max_xyz; y <= max_xyz; y++) {
       for (int z = -max_xyz; z <= max_xyz; z++) {
-        xyz << x*resolution_, y*resolution_, z*resolution_;
-        d_origin = xyz.dot(xyz);  // distance from origin squared
+        const double d_origin = (x*x + y*y + z*z)*resolution_*resolution_;  // distance from origin squared
         if (d_origin <= max_dist) {
-            sphere_.push_back(xyz);
+          sphere_.push_back(KeyOffset{{x, y, z}});
+          stencil_radius_ = std::max(stencil_radius_, sqrt(d_origin));
         }
       }
     }
@@ -129,6 +130,7 @@ void OctoClass::ResetMap() {
 void OctoClass::SetOccupancyThreshold(const double occupancy_threshold) {
   tree_.setOccupancyThres(occupancy_threshold);
   tree_inflated_.setOccupancyThres(occupancy_threshold);
+  UpdateDecayRates();
   ROS_DEBUG("Occupancy probability threshold: %f", occupancy_threshold);
 }
 
@@ -148,6 +150,7 @@ void OctoClass::SetClampingThresholds(const double clamping_threshold_min,
   tree_.setClampingThresMax(clamping_threshold_max);
   tree_inflated_.setClampingThresMin(clamping_threshold_min);
   tree_inflated_.setClampingThresMax(clamping_threshold_max);
+  UpdateDecayRates();
   ROS_DEBUG("Clamping threshold minimum: %f", clamping_threshold_min);
   ROS_DEBUG("Clamping threshold maximum: %f", clamping_threshold_max);
 }
@@ -180,171 +183,216 @@ void OctoClass::PclToRayOctomap(const pcl::PointCloud< pcl::PointXYZ > &cloud,
     tf_cam2world.transform.translation.y,
     tf_cam2world.transform.translation.z);
   const double min_threshold_sqr = min_range_*min_range_;
+  const double max_range_sqr = max_range_*max_range_;
   const uint32_t width = cloud.width;
   const uint32_t height = cloud.height;
-  static double range_sqr;
-
-  // discretize point cloud
-  // octomap::Pointcloud octoCloud, inflatedSafeCloud;
-  // octoCloud.reserve(cloud.height*cloud.width);
-  octomap::KeySet endpoints, endpoints_inflated;
-  static octomap::point3d central_point, cur_point;
-  const double max_range_sqr = max_range_*max_range_;
-  pcl::PointXYZ point;
-  for (uint32_t i = 0; i < height; i++) {
-    for (uint32_t j = 0; j < width; j++) {
-      point = cloud.at(j, i);
-
-      // Check if the point is invalid
-      if (std::isnan(point.x) || std::isnan(point.y) || std::isnan(point.z))
-        continue;
-
-      // Check if point is within camera frustum
-      if (!frustum.IsPointWithinFrustum(Eigen::Vector3d(point.x, point.y, point.z)))
+  const int num_threads = std::max(1, num_threads_);
+  std::vector<std::vector<uint64_t> > buffers(num_threads);
+
+  // discretize point cloud, one band of rows per thread. The lowest bit
+  // of each packed key tells whether the point is within max range.
+  ParallelFor(height, [&](int thread, size_t begin, size_t end) {
+    std::vector<uint64_t> &keys = buffers[thread];
+    keys.reserve((end - begin) * width);
+    for (uint32_t i = begin; i < end; i++) {
+      for (uint32_t j = 0; j < width; j++) {
+        const pcl::PointXYZ &point = cloud.at(j, i);
+
+        // Check if the point is invalid
+        if (std::isnan(point.x) || std::isnan(point.y) || std::isnan(point.z))
+          continue;
+
+        // Check if point is within camera frustum
+        if (!frustum.IsPointWithinFrustum(Eigen::Vector3d(point.x, point.y, point.z)))
+          continue;
+
+        // points too close to origin of camera are not added
+        const double range_sqr = VectorNormSquared(
+          tf_cam2world.transform.translation.x - point.x,
+          tf_cam2world.transform.translation.y - point.y,
+          tf_cam2world.transform.translation.z - point.z);
+        if ((range_sqr < min_threshold_sqr))
+          continue;
+
+        octomap::OcTreeKey k = tree_.coordToKey(octomap::point3d(point.x, point.y, point.z));
+        keys.push_back((PackKey(k) << 1) | (range_sqr < max_range_sqr));
+      }
+    }
+  });
+
+  // Non-repeated endpoints. A node is inflated if any of its points is in range.
+  std::vector<uint64_t> endpoints;
+  std::vector<char> endpoint_in_range;
+  MergeKeys(&buffers, &endpoints);
+  size_t num_endpoints = 0;
+  for (size_t i = 0; i < endpoints.size(); i++) {
+    const uint64_t key = endpoints[i] >> 1;
+    const bool in_range = endpoints[i] & 1;
+    if (num_endpoints > 0 && endpoints[num_endpoints - 1] == key) {
+      endpoint_in_range[num_endpoints - 1] |= in_range;
+    } else {
+      endpoints[num_endpoints++] = key;
+      endpoint_in_range.push_back(in_range);
+    }
+  }
+  endpoints.resize(num_endpoints);
+
+  // insert points in inflated octomap. The frustum is tested once per
+  // endpoint against the bounding sphere of the stencil, and only the
+  // stencils crossing its boundary are tested node by node.
+  ParallelFor(num_endpoints, [&](int thread, size_t begin, size_t end) {
+    std::vector<uint64_t> &keys = buffers[thread];
+    for (size_t i = begin; i < end; i++) {
+      if (!endpoint_in_range[i])
         continue;
-
-      // points too close to origin of camera are not added
-      range_sqr = this->VectorNormSquared(
-        tf_cam2world.transform.translation.x - point.x,
-        tf_cam2world.transform.translation.y - point.y,
-        tf_cam2world.transform.translation.z - point.z);
-      if ((range_sqr < min_threshold_sqr))
+      const octomap::OcTreeKey center = UnpackKey(endpoints[i]);
+      const octomap::point3d central_point = tree_.keyToCoord(center);
+      const double distance = frustum.DistanceToFrustum(
+        Eigen::Vector3d(central_point.x(), central_point.y(), central_point.z()));
+      if (distance < -stencil_radius_)
         continue;
-
-      // create discretized octocloud
-      octomap::OcTreeKey k = tree_.coordToKey(
-        octomap::point3d(point.x, point.y, point.z));
-      // Add non-repeated nodes to keysets (inflated and non-inflated)
-      std::pair<octomap::KeySet::iterator, bool> ret = endpoints.insert(k);
-      octomap::OcTreeKey key;
-      if (ret.second) {  // insertion took place => k was not in set
-        // insert points in inflated octomap
-        if (range_sqr < max_range_sqr) {
-          central_point = tree_.keyToCoord(k);
-          for (uint j = 0; j < sphere_.size(); j++) {
-            cur_point = central_point + octomap::point3d(sphere_[j][0], sphere_[j][1], sphere_[j][2]);
-            if (!frustum.IsPointWithinFrustum(Eigen::Vector3d(cur_point.x(),
-                                                              cur_point.y(),
-                                                              cur_point.z())))
-                continue;
-            if (tree_.coordToKeyChecked(cur_point, key))
-               endpoints_inflated.insert(key);
-          }
+      const bool inside = distance >= stencil_radius_;
+      for (uint j = 0; j < sphere_.size(); j++) {
+        const int x = center[0] + sphere_[j][0];
+        const int y = center[1] + sphere_[j][1];
+        const int z = center[2] + sphere_[j][2];
+        if (x < 0 || y < 0 || z < 0 || x > 0xffff || y > 0xffff || z > 0xffff)
+          continue;
+        const octomap::OcTreeKey key(x, y, z);
+        if (!inside) {
+          const octomap::point3d cur_point = tree_.keyToCoord(key);
+          if (!frustum.IsPointWithinFrustum(Eigen::Vector3d(cur_point.x(), cur_point.y(), cur_point.z())))
+            continue;
         }
+        keys.push_back(PackKey(key));
       }
     }
-  }
+  });
+  std::vector<uint64_t> endpoints_inflated;
+  MergeKeys(&buffers, &endpoints_inflated);
 
   // Calculate free nodes
-  octomap::KeySet occ_cells_in_range, free_cells, inflated_free_cells;
+  std::vector<uint64_t> occ_cells_in_range, free_cells, inflated_free_cells;
   ComputeUpdate(endpoints_inflated, endpoints, cam_origin, max_range_,
                 &occ_cells_in_range, &free_cells, &inflated_free_cells);
 
-  for (octomap::KeySet::iterator it = endpoints_inflated.begin(); it != endpoints_inflated.end(); ++it) {
-    // Only add nodes that are being added to the slim tree as well
-    if (free_cells.find(*it) != free_cells.end()) {
-        tree_inflated_.updateNode(*it, true);
-    } else if (endpoints.find(*it) != endpoints.end()) {
-        tree_inflated_.updateNode(*it, true);
-    }
-  }
-  for (octomap::KeySet::iterator it = occ_cells_in_range.begin(); it != occ_cells_in_range.end(); ++it) {
-    tree_.updateNode(*it, true);
-  }
-  for (octomap::KeySet::iterator it = inflated_free_cells.begin(); it != inflated_free_cells.end(); ++it) {
-    tree_inflated_.updateNode(*it, false);
-    tree_.updateNode(*it, false);
+  // Occupied nodes first, then free ones, in both trees. Only add inflated
+  // nodes that are being added to the slim tree as well.
+  std::vector<uint64_t> occ_inflated;
+  occ_inflated.reserve(endpoints_inflated.size());
+  for (size_t i = 0; i < endpoints_inflated.size(); i++) {
+    if (std::binary_search(free_cells.begin(), free_cells.end(), endpoints_inflated[i]) ||
+        std::binary_search(endpoints.begin(), endpoints.end(), endpoints_inflated[i]))
+      occ_inflated.push_back(endpoints_inflated[i]);
   }
+  UpdateNodes(occ_inflated, inflated_free_cells, &tree_inflated_);
+  UpdateNodes(occ_cells_in_range, inflated_free_cells, &tree_);
+}
+
+void OctoClass::UpdateNodes(const std::vector<uint64_t> &occupied,
+                            const std::vector<uint64_t> &free,
+                            DecayingOcTree *tree) {
+  // Inner nodes are updated once at the end rather than along with every leaf
+  tree->SetUpdateTime(ros::Time::now().toSec());
+  for (size_t i = 0; i < occupied.size(); i++)
+    tree->updateNode(UnpackKey(occupied[i]), true, true);
+  for (size_t i = 0; i < free.size(); i++)
+    tree->updateNode(UnpackKey(free[i]), false, true);
+  tree->updateInnerOccupancy();
 }
 
-void OctoClass::ComputeUpdate(const octomap::KeySet &occ_inflated,  // Inflated endpoints
-                              const octomap::KeySet &occ_slim,      // Non-inflated endpoints
+void OctoClass::ComputeUpdate(const std::vector<uint64_t> &occ_inflated,  // Inflated endpoints
+                              const std::vector<uint64_t> &occ_slim,      // Non-inflated endpoints
                               const octomap::point3d& origin,
                               const double &max_range,
-                              octomap::KeySet *occ_slim_in_range,
-                              octomap::KeySet *free_slim,
-                              octomap::KeySet *free_inflated) {
-  octomap::KeyRay keyray;
-  for (octomap::KeySet::const_iterator occIt = occ_slim.begin(); occIt != occ_slim.end(); ++occIt) {
-    const octomap::point3d& p = tree_inflated_.keyToCoord(*occIt);
-    // If in line of sight, add free cells
-    if ((max_range < 0.0) || ((p - origin).norm() <= max_range)) {  // is not max_range_ meas.
+                              std::vector<uint64_t> *occ_slim_in_range,
+                              std::vector<uint64_t> *free_slim,
+                              std::vector<uint64_t> *free_inflated) {
+  const int num_threads = std::max(1, num_threads_);
+  std::vector<std::vector<uint64_t> > occ_buffers(num_threads), free_buffers(num_threads);
+  std::vector<std::vector<uint64_t> > free_inflated_buffers(num_threads);
+  ParallelFor(occ_slim.size(), [&](int thread, size_t begin, size_t end) {
+    octomap::KeyRay keyray;
+    for (size_t i = begin; i < end; i++) {
+      octomap::point3d p = tree_inflated_.keyToCoord(UnpackKey(occ_slim[i]));
+      // If in line of sight, add free cells
+      if ((max_range < 0.0) || ((p - origin).norm() <= max_range)) {  // is not max_range_ meas.
         octomap::OcTreeKey key;
         if (tree_.coordToKeyChecked(p, key))
-            occ_slim_in_range->insert(key);
-        // Ray keys are already checked using coordToKeyChecked
-        tree_inflated_.computeRayKeys(origin, p, keyray);
-        free_slim->insert(keyray.begin(), keyray.end());
-        for (octomap::KeyRay::iterator it = keyray.begin(); it != keyray.end(); ++it) {
-          if (occ_inflated.find(*it) == occ_inflated.end())   // If not occupied
-              free_inflated->insert(*it);
-          else  // If occupied
-            break;
-        }
-    } else {  // user set a max_range_ and length is above
-      octomap::point3d direction = (p - origin).normalized();
-      octomap::point3d new_end = origin + direction * static_cast<float>(max_range);
-      tree_inflated_.computeRayKeys(origin, new_end, keyray);
-      free_slim->insert(keyray.begin(), keyray.end());
+          occ_buffers[thread].push_back(PackKey(key));
+      } else {  // user set a max_range_ and length is above
+        octomap::point3d direction = (p - origin).normalized();
+        p = origin + direction * static_cast<float>(max_range);
+      }
+      // Ray keys are already checked using coordToKeyChecked
+      tree_inflated_.computeRayKeys(origin, p, keyray);
+      for (octomap::KeyRay::iterator it = keyray.begin(); it != keyray.end(); ++it)
+        free_buffers[thread].push_back(PackKey(*it));
       for (octomap::KeyRay::iterator it = keyray.begin(); it != keyray.end(); ++it) {
-        if (occ_inflated.find(*it) == occ_inflated.end())  // If not occupied
-          free_inflated->insert(*it);
-        else
+        const uint64_t key = PackKey(*it);
+        if (std::binary_search(occ_inflated.begin(), occ_inflated.end(), key))  // If occupied
           break;
+        free_inflated_buffers[thread].push_back(key);
       }
     }
+  });
+  MergeKeys(&occ_buffers, occ_slim_in_range);
+  MergeKeys(&free_buffers, free_slim);
+  MergeKeys(&free_inflated_buffers, free_inflated);
+}
+
+void OctoClass::SetNumThreads(const int num_threads) {
+  num_threads_ = num_threads;
+  // The workers are kept between point clouds, the calling thread makes up the last one
+  pool_.reset(num_threads_ > 1 ? new ff_common::ThreadPool(num_threads_ - 1) : NULL);
+  ROS_DEBUG("Ray casting threads: %d", num_threads_);
+}
+
+void OctoClass::ParallelFor(const size_t num_items,
+                            std::function<void(int, size_t, size_t)> const& job) const {
+  // Not worth a thread for small jobs
+  const int num_threads = std::max(1, num_threads_);
+  if (num_threads == 1 || num_items < static_cast<size_t>(num_threads) * 16) {
+    job(0, 0, num_items);
+    return;
+  }
+  for (int t = 1; t < num_threads; t++)
+    pool_->AddTask(job, t, num_items * t / num_threads, num_items * (t + 1) / num_threads);
+  job(0, 0, num_items / num_threads);
+  pool_->Join();
+}
+
+void OctoClass::MergeKeys(std::vector<std::vector<uint64_t> > *buffers,
+                          std::vector<uint64_t> *keys) {
+  size_t size = 0;
+  for (size_t t = 0; t < buffers->size(); t++)
+    size += (*buffers)[t].size();
+  keys->clear();
+  keys->reserve(size);
+  for (size_t t = 0; t < buffers->size(); t++) {
+    keys->insert(keys->end(), (*buffers)[t].begin(), (*buffers)[t].end());
+    (*buffers)[t].clear();
   }
+  std::sort(keys->begin(), keys->end());
+  keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
 }
 
-void OctoClass::FadeMemory(const double &rate) {  // rate at which this function is being called
-  const double clamp_log_max = tree_.getClampingThresMaxLog();
-  const double clamp_log_min = tree_.getClampingThresMinLog();
-  const double occ_thres = tree_.getOccupancyThres();
-  // const double probLogHit = tree.getProbHitLog();
-  const double prob_log_range_obs = clamp_log_max - occ_thres;
-  const double prob_log_range_free = clamp_log_min - occ_thres;
-  const double fading_obs_log_prob_per_run = -prob_log_range_obs/(memory_time_*rate);
-  const double fading_free_log_prob_per_run = -prob_log_range_free/(memory_time_*rate);
-
-  static bool is_occ;
-  static octomap::OcTreeKey key;
-
-  // Fade tree_
-  for (octomap::OcTree::leaf_iterator it = tree_.begin_leafs(),
-                                     end= tree_.end_leafs();
-                                     it!= end; ++it) {
-    // fade obstacles and free areas
-    key = it.getKey();
-    octomap::OcTreeNode* n = tree_.search(key);
-    is_occ = tree_.isNodeOccupied(n);
-    if (is_occ)
-        tree_.updateNodeLogOdds(n, fading_obs_log_prob_per_run);
-    else
-        tree_.updateNodeLogOdds(n, fading_free_log_prob_per_run);
-
-    // tree nodes that are unknown
-    // if it was occupied then disoccupied, delete node
-    if (is_occ != tree_.isNodeOccupied(n))
-      tree_.deleteNode(key, it.getDepth());
-  }
-  // Fade tree_inflated_
-  for (octomap::OcTree::leaf_iterator it = tree_inflated_.begin_leafs(),
-                                     end= tree_inflated_.end_leafs();
-                                     it!= end; ++it) {
-    // fade obstacles and free areas
-    key = it.getKey();
-    octomap::OcTreeNode* n = tree_inflated_.search(key);
-    is_occ = tree_inflated_.isNodeOccupied(n);
-    if (is_occ)
-        tree_inflated_.updateNodeLogOdds(n, fading_obs_log_prob_per_run);
-    else
-        tree_inflated_.updateNodeLogOdds(n, fading_free_log_prob_per_run);
+void OctoClass::FadeMemory() {
+  // Nodes fade as they are read, this only frees the expired ones
+  tree_.RemoveExpiredNodes(kFadeSlices);
+  tree_inflated_.RemoveExpiredNodes(kFadeSlices);
+}
 
-    // tree nodes that are unknown
-    // if it was occupied then disoccupied, delete node
-    if (is_occ != tree_inflated_.isNodeOccupied(n))
-      tree_inflated_.deleteNode(key, it.getDepth());
+void OctoClass::UpdateDecayRates() {
+  // Occupied nodes at the upper clamping threshold reach the occupancy
+  // threshold after memory_time_, and free nodes at the lower one too
+  float occupied_rate = 0, free_rate = 0;
+  if (memory_time_ > 0) {
+    occupied_rate = (tree_.getClampingThresMaxLog() - tree_.getOccupancyThresLog()) / memory_time_;
+    free_rate = (tree_.getOccupancyThresLog() - tree_.getClampingThresMinLog()) / memory_time_;
   }
+  tree_.SetDecayRates(occupied_rate, free_rate);
+  tree_inflated_.SetDecayRates(occupied_rate, free_rate);
 }
 
 // void OctoClass::InflateObstacles(const double &thickness) {
@@ -427,7 +475,7 @@ void OctoClass::FadeMemory(const double &rate) {  // rate at which this function
 void OctoClass::FindCollidingNodesInflated(const pcl::PointCloud< pcl::PointXYZ > &point_cloud,
                                            std::vector<octomap::point3d> *colliding_nodes) {
   static octomap::point3d query, node_center;
-  static octomap::OcTreeNode* node;
+  static DecayingOcTreeNode* node;
   static octomap::OcTreeKey key;
   octomap::KeySet endpoints;
 
@@ -442,7 +490,7 @@ void OctoClass::FindCollidingNodesInflated(const pcl::PointCloud< pcl::PointXYZ
 
     // check if current node has not been evaluated yet
     if (ret.second) {  // insertion took place => new node being evaluated
-      node = tree_inflated_.search(query);
+      node = tree_inflated_.SearchLive(key);
       if (node == NULL) {
         continue;
       } else if (tree_inflated_.isNodeOccupied(node)) {
@@ -484,6 +532,7 @@ void OctoClass::TreeVisMarkers(visualization_msgs::MarkerArray* obstacles,
   obstacles->markers.resize(tree_depth_+1);
   free->markers.resize(tree_depth_+1);
   const ros::Time rostime = ros::Time::now();
+  const double now = rostime.toSec();
 
   // get pointcloud holder
   pcl::PointCloud<pcl::PointXYZ>  free_points, obstacles_points;
@@ -496,10 +545,12 @@ void OctoClass::TreeVisMarkers(visualization_msgs::MarkerArray* obstacles,
 
   // publish all leafs from the tree
   static geometry_msgs::Point point_center;
-  for (octomap::OcTree::leaf_iterator it = tree_.begin_leafs(),
+  for (DecayingOcTree::leaf_iterator it = tree_.begin_leafs(),
                                      end= tree_.end_leafs();
                                      it!= end; ++it) {
     // set depth in the tree
+    if (tree_.IsNodeExpired(&(*it), now))
+      continue;
     const unsigned idx = it.getDepth();
     point_center.x = it.getX();
     point_center.y = it.getY();
@@ -566,6 +617,7 @@ void OctoClass::InflatedVisMarkers(visualization_msgs::MarkerArray* obstacles,
   obstacles->markers.resize(tree_depth_+1);
   free->markers.resize(tree_depth_+1);
   const ros::Time rostime = ros::Time::now();
+  const double now = rostime.toSec();
 
   // get pointcloud holder
   pcl::PointCloud<pcl::PointXYZ> free_points, obstacles_points;
@@ -578,10 +630,12 @@ void OctoClass::InflatedVisMarkers(visualization_msgs::MarkerArray* obstacles,
 
   // publish all leafs from the tree_inflated_
   static geometry_msgs::Point point_center;
-  for (octomap::OcTree::leaf_iterator it = tree_inflated_.begin_leafs(),
+  for (DecayingOcTree::leaf_iterator it = tree_inflated_.begin_leafs(),
                                      end= tree_inflated_.end_leafs();
                                      it!= end; ++it) {
       // set depth in the tree_inflated_
+      if (tree_inflated_.IsNodeExpired(&(*it), now))
+        continue;
       const unsigned idx = it.getDepth();
       point_center.x = it.getX();
       point_center.y = it.getY();
@@ -641,7 +695,7 @@ void OctoClass::InflatedVisMarkers(visualization_msgs::MarkerArray* obstacles,
 int OctoClass::CheckOccupancy(const octomap::point3d &p) {
   static octomap::OcTreeKey key;
   key = tree_inflated_.coordToKey(p);
-  const octomap::OcTreeNode* n = tree_inflated_.search(key);
+  const DecayingOcTreeNode* n = tree_inflated_.SearchLive(key);
   if (n == NULL)
     return -1;
   else if (tree_inflated_.isNodeOccupied(n))
@@ -667,9 +721,9 @@ int OctoClass::CheckOccupancy(const octomap::point3d &p1,
   octomap::KeyRay ray;
   tree_inflated_.computeRayKeys(p1, p2, ray);
   int retVal = 0;
-  const octomap::OcTreeNode* n;
+  const DecayingOcTreeNode* n;
   for (octomap::KeyRay::iterator it = ray.begin(); it != ray.end(); ++it) {
-    n = tree_inflated_.search(*it);
+    n = tree_inflated_.SearchLive(*it);
     if (n == NULL)
       retVal = -1;
     else if (tree_inflated_.isNodeOccupied(n))
@@ -679,7 +733,7 @@ int OctoClass::CheckOccupancy(const octomap::point3d &p1,
   // computeRayKeys does not compute the final point, so we check manually
   static octomap::OcTreeKey key;
   key = tree_inflated_.coordToKey(p2);
-  n = tree_inflated_.search(key);
+  n = tree_inflated_.SearchLive(key);
   if (n == NULL)
     retVal = -1;
   else if (tree_inflated_.isNodeOccupied(n))
@@ -696,7 +750,7 @@ int OctoClass::CheckOccupancy(const Eigen::Vector3d &p1,
 bool OctoClass::CheckCollision(const octomap::point3d &p) {
   static octomap::OcTreeKey key;
   key = tree_inflated_.coordToKey(p);
-  const octomap::OcTreeNode* n = tree_inflated_.search(key);
+  const DecayingOcTreeNode* n = tree_inflated_.SearchLive(key);
   if (n == NULL)
       return true;
   else if (tree_inflated_.isNodeOccupied(n))
@@ -712,9 +766,9 @@ bool OctoClass::CheckCollision(const octomap::point3d &p1,
                                const octomap::point3d &p2) {
   octomap::KeyRay ray;
   tree_inflated_.computeRayKeys(p1, p2, ray);
-  const octomap::OcTreeNode* n;
+  const DecayingOcTreeNode* n;
   for (octomap::KeyRay::iterator it = ray.begin(); it != ray.end(); ++it) {
-    n = tree_inflated_.search(*it);
+    n = tree_inflated_.SearchLive(*it);
     if (n == NULL)
       return true;
     else if (tree_inflated_.isNodeOccupied(n))
@@ -724,7 +778,7 @@ bool OctoClass::CheckCollision(const octomap::point3d &p1,
   // computeRayKeys does not compute the final point, so we check manually
   static octomap::OcTreeKey key;
   key = tree_inflated_.coordToKey(p2);
-  n = tree_inflated_.search(key);
+  n = tree_inflated_.SearchLive(key);
   if (n == NULL)
       return true;
   else if (tree_inflated_.isNodeOccupied(n))
@@ -750,13 +804,13 @@ void OctoClass::BBXFreeVolume(const Eigen::Vector3d &box_min,
   }
 
   // Count number of nodes per depth in the tree
-  octomap::OcTree::leaf_bbx_iterator it;
+  DecayingOcTree::leaf_bbx_iterator it;
   uint depth;
-  const octomap::OcTreeNode* n;
+  const DecayingOcTreeNode* n;
   for (it = tree_inflated_.begin_leafs_bbx(octomap::point3d(box_min[0], box_min[1], box_min[2]),
                                            octomap::point3d(box_max[0], box_max[1], box_max[2]));
                                            it != tree_inflated_.end_leafs_bbx(); ++it) {
-    n = tree_inflated_.search(it.getKey());
+    n = tree_inflated_.SearchLive(it.getKey());
     if (n == NULL)
       continue;
 
@@ -783,13 +837,13 @@ void OctoClass::BBXOccVolume(const Eigen::Vector3d &box_min,
     n_nodes_per_depth[i] = 0;
 
   // Count number of nodes per depth in the bounding box
-  octomap::OcTree::leaf_bbx_iterator it;
+  DecayingOcTree::leaf_bbx_iterator it;
   uint depth;
-  const octomap::OcTreeNode* n;
+  const DecayingOcTreeNode* n;
   for (it = tree_inflated_.begin_leafs_bbx(octomap::point3d(box_min[0], box_min[1], box_min[2]),
                                          octomap::point3d(box_max[0], box_max[1], box_max[2]));
                                          it != tree_inflated_.end_leafs_bbx(); ++it) {
-    n = tree_inflated_.search(it.getKey());
+    n = tree_inflated_.SearchLive(it.getKey());
     if (n == NULL)
       continue;
     // Count free nodes per depth
@@ -813,16 +867,16 @@ void OctoClass::BBXFreeNodes(const Eigen::Vector3d &box_min,
                              const Eigen::Vector3d &box_max,
                              std::vector<octomap::OcTreeKey> *node_keys,
                              std::vector<double> *node_sizes) {
-  octomap::OcTree::leaf_bbx_iterator it;
+  DecayingOcTree::leaf_bbx_iterator it;
   // uint depth;
-  const octomap::OcTreeNode* n;
+  const DecayingOcTreeNode* n;
   // octomap::point3d nodeCenter;
   octomap::OcTreeKey key;
   for (it = tree_inflated_.begin_leafs_bbx(octomap::point3d(box_min[0], box_min[1], box_min[2]),
                                          octomap::point3d(box_max[0], box_max[1], box_max[2]));
                                          it != tree_inflated_.end_leafs_bbx(); ++it) {
     key = it.getKey();
-    n = tree_inflated_.search(key);
+    n = tree_inflated_.SearchLive(key);
     if (n == NULL)
       continue;
     if (!tree_inflated_.isNodeOccupied(n)) {
@@ -837,15 +891,15 @@ void OctoClass::BBXFreeNodes(const Eigen::Vector3d &box_min,
                              const Eigen::Vector3d &box_max,
                              IndexedKeySet *indexed_node_keys,
                              std::vector<double> *node_sizes) {
-  octomap::OcTree::leaf_bbx_iterator it;
-  const octomap::OcTreeNode* n;
+  DecayingOcTree::leaf_bbx_iterator it;
+  const DecayingOcTreeNode* n;
   octomap::OcTreeKey key;
   uint index = 0;
   for (it = tree_inflated_.begin_leafs_bbx(octomap::point3d(box_min[0], box_min[1], box_min[2]),
                                          octomap::point3d(box_max[0], box_max[1], box_max[2]));
                                          it != tree_inflated_.end_leafs_bbx(); ++it) {
     key = it.getKey();
-    n = tree_inflated_.search(key);
+    n = tree_inflated_.SearchLive(key);
     if (n == NULL)
       continue;
     if (!tree_inflated_.isNodeOccupied(n)) {
@@ -884,8 +938,8 @@ void OctoClass::GetNodeNeighbors(const octomap::OcTreeKey &node_key,
 
 // Returns size of node. Returns zero if node doesn't exist
 double OctoClass::GetNodeSize(const octomap::OcTreeKey &key) {
-  const octomap::OcTreeNode* n;
-  n = tree_inflated_.search(key);
+  const DecayingOcTreeNode* n;
+  n = tree_inflated_.SearchLive(key);
   if (n == NULL) {
       return 0.0;
   } else {
@@ -893,7 +947,7 @@ double OctoClass::GetNodeSize(const octomap::OcTreeKey &key) {
                                                      resolution_/4.0,
                                                      resolution_/4.0);
     const octomap::point3d pos = tree_inflated_.keyToCoord(key);
-    octomap::OcTree::leaf_bbx_iterator it;
+    DecayingOcTree::leaf_bbx_iterator it;
     it = tree_inflated_.begin_leafs_bbx(pos-bounds, pos+bounds);
     return tree_inflated_.getNodeSize(it.getDepth());
   }
@@ -25,6 +25,7 @@ namespace mapper {
 // Update resolution of the map
 bool MapperNodelet::SetResolution(ff_msgs::SetFloat::Request &req,
                                      ff_msgs::SetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.SetResolution(req.data);
   res.success = true;
   return true;
@@ -32,6 +33,7 @@ bool MapperNodelet::SetResolution(ff_msgs::SetFloat::Request &req,
 // Update resolution of the map
 bool MapperNodelet::GetResolution(ff_msgs::GetFloat::Request &req,
                                      ff_msgs::GetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   res.data = globals_.octomap.GetResolution();
   res.success = true;
   return true;
@@ -40,6 +42,7 @@ bool MapperNodelet::GetResolution(ff_msgs::GetFloat::Request &req,
 // Update map memory time
 bool MapperNodelet::SetMemoryTime(ff_msgs::SetFloat::Request &req,
                                      ff_msgs::SetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.SetMemoryTime(req.data);
   res.success = true;
   return true;
@@ -47,6 +50,7 @@ bool MapperNodelet::SetMemoryTime(ff_msgs::SetFloat::Request &req,
 // Update map memory time
 bool MapperNodelet::GetMemoryTime(ff_msgs::GetFloat::Request &req,
                                      ff_msgs::GetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   res.data = globals_.octomap.GetMemoryTime();
   res.success = true;
   return true;
@@ -54,12 +58,14 @@ bool MapperNodelet::GetMemoryTime(ff_msgs::GetFloat::Request &req,
 
 bool MapperNodelet::SetCollisionDistance(ff_msgs::SetFloat::Request &req,
                                  ff_msgs::SetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.SetMapInflation(req.data + cfg_.Get<double>("robot_radius"));
   res.success = true;
   return true;
 }
 bool MapperNodelet::GetMapInflation(ff_msgs::GetFloat::Request &req,
                                  ff_msgs::GetFloat::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   res.data = globals_.octomap.GetMapInflation();
   res.success = true;
   return true;
@@ -67,6 +73,7 @@ bool MapperNodelet::GetMapInflation(ff_msgs::GetFloat::Request &req,
 
 bool MapperNodelet::ResetMap(std_srvs::Trigger::Request &req,
                              std_srvs::Trigger::Response &res) {
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.ResetMap();
   res.success = true;
   res.message = "Map has been reset!";
@@ -78,6 +85,7 @@ bool MapperNodelet::GetFreeMapCallback(ff_msgs::GetMap::Request &req,
   visualization_msgs::MarkerArray om, fm;
   sensor_msgs::PointCloud2 oc, fc;
 
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.InflatedVisMarkers(&om, &fm, &oc, &fc);
 
   res.points = fc;
@@ -91,6 +99,7 @@ bool MapperNodelet::GetObstacleMapCallback(ff_msgs::GetMap::Request &req,
   visualization_msgs::MarkerArray om, fm;
   sensor_msgs::PointCloud2 oc, fc;
 
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   globals_.octomap.InflatedVisMarkers(&om, &fm, &oc, &fc);
 
   res.points = oc;
@@ -17,20 +17,25 @@
  */
 
 #include <mapper/mapper_nodelet.h>
+#include <algorithm>
+#include <chrono>   // NOLINT
 #include <string>
 #include <vector>
-#include <algorithm>
 
 namespace mapper {
 
 // Thread for fading memory of the octomap
 void MapperNodelet::FadeTask(ros::TimerEvent const& event) {
+  ff_util::ScopedLatencyTimer timer(pt_fade_);
+  std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
   if (globals_.octomap.memory_time_ > 0)
-      globals_.octomap.FadeMemory(fading_memory_update_rate_);
+      globals_.octomap.FadeMemory();
 }
 
-// Sentinel
+// Sentinel. The caller must hold both the trajectory and the octomap locks.
 void MapperNodelet::CollisionCheckTask() {
+  ff_util::ScopedLatencyTimer timer(pt_collision_);
+
   // visualization markers
   visualization_msgs::MarkerArray traj_markers, samples_markers;
   visualization_msgs::MarkerArray compressed_samples_markers, collision_markers;
@@ -111,42 +116,31 @@ void MapperNodelet::CollisionCheckTask() {
   ros::Duration solver_time = ros::Time::now() - time_now;
 }
 
-void MapperNodelet::OctomappingTask() {
-  pcl::PointCloud< pcl::PointXYZ > pcl_world;
-
-  // If there are no pcl point clounds
-  if (globals_.pcl_queue.empty())
-    return;
+void MapperNodelet::OctomappingThread() {
+  StampedPclPtr stamped_pcl;
+  while (octomap_running_) {
+    if (!globals_.pcl_queue->TryPop(&stamped_pcl)) {
+      // Sleep until a cloud arrives. The timeout covers a notification
+      // sent between the failed pop and the wait, and the shutdown.
+      std::unique_lock<std::mutex> lock(globals_.pcl_mutex);
+      globals_.pcl_cv.wait_for(lock, std::chrono::milliseconds(100));
+      continue;
+    }
+    OctomappingTask(*stamped_pcl);
+    stamped_pcl.reset();
+  }
+}
 
-// Update TF values
-  try {
-    globals_.tf_cam2world = buffer_.lookupTransform(FRAME_NAME_WORLD,
-      GetTransform(FRAME_NAME_HAZ_CAM), ros::Time(0));
-  } catch (tf2::TransformException &ex) {}
-  try {
-    globals_.tf_perch2world = buffer_.lookupTransform(FRAME_NAME_WORLD,
-      GetTransform(FRAME_NAME_PERCH_CAM), ros::Time(0));
-  } catch (tf2::TransformException &ex) {}
-  try {
-    globals_.tf_body2world = buffer_.lookupTransform(FRAME_NAME_WORLD,
-      GetTransform(FRAME_NAME_BODY), ros::Time(0));
-  } catch (tf2::TransformException &ex) {}
+void MapperNodelet::OctomappingTask(StampedPcl const& stamped_pcl) {
+  ff_util::ScopedLatencyTimer timer(pt_octomap_);
+  pcl::PointCloud< pcl::PointXYZ > pcl_world;
 
   // Get time for when this task started
   const ros::Time t0 = ros::Time::now();
 
-  // Get Point Cloud
-  pcl::PointCloud<pcl::PointXYZ> point_cloud =
-    globals_.pcl_queue.front().cloud;
-  const geometry_msgs::TransformStamped tf_cam2world =
-    globals_.pcl_queue.front().tf_cam2world;
-
-  // Remove data from queue
-  globals_.pcl_queue.pop();
-
-  // Check if a tf message has been received already. If not, return
-  if (tf_cam2world.header.stamp.toSec() == 0)
-    return;
+  // The cloud and the camera pose at its capture time
+  const pcl::PointCloud<pcl::PointXYZ> & point_cloud = stamped_pcl.cloud;
+  const geometry_msgs::TransformStamped & tf_cam2world = stamped_pcl.tf_cam2world;
 
   // Transform pcl into world frame
   Eigen::Affine3d transform = Eigen::Affine3d::Identity();
@@ -161,6 +155,7 @@ void MapperNodelet::OctomappingTask() {
   pcl::transformPointCloud(point_cloud, pcl_world, transform);
 
   // Save into octomap
+  std::unique_lock<std::mutex> octomap_lock(globals_.octomap_mutex);
   algebra_3d::FrustumPlanes world_frustum;
   globals_.octomap.cam_frustum_.TransformFrustum(transform, &world_frustum);
   globals_.octomap.PclToRayOctomap(pcl_world, tf_cam2world, world_frustum);
@@ -213,8 +208,14 @@ void MapperNodelet::OctomappingTask() {
     cam_frustum_pub_.publish(frustum_markers);
   }
 
+  octomap_lock.unlock();
+
   // Notify the collision checker to check for collision
-  CollisionCheckTask();
+  {
+    std::lock_guard<std::mutex> traj_lock(globals_.sampled_traj_mutex);
+    std::lock_guard<std::mutex> lock(globals_.octomap_mutex);
+    CollisionCheckTask();
+  }
   ros::Duration map_time = ros::Time::now() - t0;
 }
 
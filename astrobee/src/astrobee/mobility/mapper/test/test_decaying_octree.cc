@@ -0,0 +1,215 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Tests the fading of the DecayingOcTree: nodes are live when updated, fade
+// at the configured rates, start over from unknown once expired, and are
+// freed slab by slab. Time is simulated so that it only moves when told.
+
+#include <mapper/decaying_octree.h>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <vector>
+
+class DecayingOcTreeTest : public ::testing::Test {
+ protected:
+  DecayingOcTreeTest() : tree_(0.1) {
+    tree_.SetDecayRates(1.0, 1.0);
+    SetTime(10.0);
+  }
+
+  void SetTime(const double time) {
+    ros::Time::setNow(ros::Time(time));
+    tree_.SetUpdateTime(time);
+  }
+
+  octomap::OcTreeKey Key(const double x, const double y, const double z) {
+    return tree_.coordToKey(octomap::point3d(x, y, z));
+  }
+
+  octoclass::DecayingOcTree tree_;
+};
+
+TEST_F(DecayingOcTreeTest, InsertedNodesAreLive) {
+  const octomap::OcTreeKey occupied_key = Key(0.05, 0.05, 0.05), free_key = Key(1.05, 0.05, 0.05);
+  tree_.updateNode(occupied_key, true);
+  tree_.updateNode(free_key, false);
+
+  octoclass::DecayingOcTreeNode* occupied = tree_.SearchLive(occupied_key);
+  ASSERT_TRUE(occupied != NULL);
+  EXPECT_TRUE(tree_.isNodeOccupied(occupied));
+  EXPECT_FLOAT_EQ(tree_.getProbHitLog(), occupied->getLogOdds());
+  EXPECT_DOUBLE_EQ(10.0, occupied->getTimestamp());
+
+  octoclass::DecayingOcTreeNode* free_node = tree_.SearchLive(free_key);
+  ASSERT_TRUE(free_node != NULL);
+  EXPECT_FALSE(tree_.isNodeOccupied(free_node));
+  EXPECT_FLOAT_EQ(tree_.getProbMissLog(), free_node->getLogOdds());
+
+  EXPECT_TRUE(tree_.SearchLive(Key(2.05, 0.05, 0.05)) == NULL);
+}
+
+TEST_F(DecayingOcTreeTest, NodesExpire) {
+  const octomap::OcTreeKey occupied_key = Key(0.05, 0.05, 0.05), free_key = Key(1.05, 0.05, 0.05);
+  tree_.updateNode(occupied_key, true);
+  tree_.updateNode(free_key, false);
+  const octoclass::DecayingOcTreeNode* occupied = tree_.search(occupied_key);
+  const octoclass::DecayingOcTreeNode* free_node = tree_.search(free_key);
+  ASSERT_TRUE(occupied != NULL && free_node != NULL);
+
+  // One hit fades in about 0.85 s and one miss in about 0.41 s at 1 log-odds per second
+  EXPECT_NEAR(tree_.getProbHitLog() - 0.25, tree_.DecayedLogOdds(occupied, 10.25), 1e-5);
+  EXPECT_NEAR(tree_.getProbMissLog() + 0.25, tree_.DecayedLogOdds(free_node, 10.25), 1e-5);
+  EXPECT_FALSE(tree_.IsNodeExpired(occupied, 10.25));
+  EXPECT_FALSE(tree_.IsNodeExpired(free_node, 10.25));
+  EXPECT_FALSE(tree_.IsNodeExpired(occupied, 10.75));
+  EXPECT_TRUE(tree_.IsNodeExpired(free_node, 10.75));
+  EXPECT_TRUE(tree_.IsNodeExpired(occupied, 11.0));
+  // Time before the last update does not fade nodes
+  EXPECT_FALSE(tree_.IsNodeExpired(occupied, 5.0));
+
+  ros::Time::setNow(ros::Time(10.75));
+  EXPECT_TRUE(tree_.SearchLive(occupied_key) != NULL);
+  EXPECT_TRUE(tree_.SearchLive(free_key) == NULL);
+  ros::Time::setNow(ros::Time(11.0));
+  EXPECT_TRUE(tree_.SearchLive(occupied_key) == NULL);
+  // Expired nodes are still stored until removed
+  EXPECT_TRUE(tree_.search(occupied_key) != NULL);
+}
+
+TEST_F(DecayingOcTreeTest, ZeroRatesDisableFading) {
+  tree_.SetDecayRates(0, 0);
+  const octomap::OcTreeKey key = Key(0.05, 0.05, 0.05);
+  tree_.updateNode(key, true);
+  ros::Time::setNow(ros::Time(1e6));
+  EXPECT_TRUE(tree_.SearchLive(key) != NULL);
+  EXPECT_FALSE(tree_.IsNodeExpired(tree_.search(key), 1e6));
+}
+
+TEST_F(DecayingOcTreeTest, UpdatesApplyFading) {
+  const octomap::OcTreeKey key = Key(0.05, 0.05, 0.05);
+  tree_.updateNode(key, true);
+
+  // A live node keeps its faded value
+  SetTime(10.5);
+  tree_.updateNode(key, true);
+  const octoclass::DecayingOcTreeNode* node = tree_.search(key);
+  ASSERT_TRUE(node != NULL);
+  EXPECT_NEAR(2 * tree_.getProbHitLog() - 0.5, node->getLogOdds(), 1e-5);
+  EXPECT_DOUBLE_EQ(10.5, node->getTimestamp());
+
+  // An expired node starts over from unknown
+  SetTime(20.0);
+  tree_.updateNode(key, false);
+  node = tree_.search(key);
+  ASSERT_TRUE(node != NULL);
+  EXPECT_FLOAT_EQ(tree_.getProbMissLog(), node->getLogOdds());
+  EXPECT_DOUBLE_EQ(20.0, node->getTimestamp());
+}
+
+TEST_F(DecayingOcTreeTest, ClampedNodesAreRefreshed) {
+  const octomap::OcTreeKey key = Key(0.05, 0.05, 0.05);
+  for (int i = 0; i < 10; i++)
+    tree_.updateNode(key, true);
+  const octoclass::DecayingOcTreeNode* node = tree_.search(key);
+  ASSERT_TRUE(node != NULL);
+  EXPECT_FLOAT_EQ(tree_.getClampingThresMaxLog(), node->getLogOdds());
+
+  // Hitting a clamped node still fades it and moves its timestamp
+  SetTime(11.0);
+  tree_.updateNode(key, true);
+  node = tree_.search(key);
+  EXPECT_NEAR(tree_.getClampingThresMaxLog() - 1.0 + tree_.getProbHitLog(), node->getLogOdds(), 1e-5);
+  EXPECT_DOUBLE_EQ(11.0, node->getTimestamp());
+}
+
+TEST_F(DecayingOcTreeTest, PruningRequiresEqualTimestamps) {
+  // Keep the log-odds equal so that only the timestamps tell the siblings apart
+  tree_.SetDecayRates(0, 0);
+  const octomap::OcTreeKey base = Key(0.05, 0.05, 0.05);
+  std::vector<octomap::OcTreeKey> siblings;
+  for (unsigned int i = 0; i < 8; i++) {
+    octomap::OcTreeKey key = base;
+    for (unsigned int j = 0; j < 3; j++)
+      key[j] = (base[j] & ~1) | ((i >> j) & 1);
+    siblings.push_back(key);
+  }
+
+  for (unsigned int i = 0; i < 8; i++)
+    tree_.updateNode(siblings[i], true);
+  tree_.prune();
+  EXPECT_EQ(1u, tree_.getNumLeafNodes());
+
+  tree_.clear();
+  for (unsigned int i = 0; i < 7; i++)
+    tree_.updateNode(siblings[i], true);
+  SetTime(11.0);
+  tree_.updateNode(siblings[7], true);
+  tree_.prune();
+  EXPECT_EQ(8u, tree_.getNumLeafNodes());
+  // The parent is as recent as its latest child
+  const octoclass::DecayingOcTreeNode* parent = tree_.search(siblings[0], tree_.getTreeDepth() - 1);
+  ASSERT_TRUE(parent != NULL);
+  EXPECT_DOUBLE_EQ(11.0, parent->getTimestamp());
+}
+
+TEST_F(DecayingOcTreeTest, RemoveExpiredNodes) {
+  const unsigned int num_slices = 8;
+  EXPECT_EQ(0u, tree_.RemoveExpiredNodes(num_slices));
+
+  // Nodes far enough apart not to be pruned together, alternately old and recent
+  const int num_nodes = 32;
+  for (int i = 0; i < num_nodes; i += 2)
+    tree_.updateNode(Key(0.05 + 0.3 * i, 0.05, 0.05), true);
+  SetTime(19.5);
+  for (int i = 1; i < num_nodes; i += 2)
+    tree_.updateNode(Key(0.05 + 0.3 * i, 0.05, 0.05), true);
+  ASSERT_EQ(static_cast<size_t>(num_nodes), tree_.getNumLeafNodes());
+
+  // Each call sweeps one slab, and a full sweep frees exactly the expired nodes
+  ros::Time::setNow(ros::Time(20.0));
+  size_t removed = 0;
+  for (unsigned int i = 0; i < num_slices; i++) {
+    const size_t removed_in_slice = tree_.RemoveExpiredNodes(num_slices);
+    EXPECT_LT(removed_in_slice, static_cast<size_t>(num_nodes / 2));
+    removed += removed_in_slice;
+  }
+  EXPECT_EQ(static_cast<size_t>(num_nodes / 2), removed);
+  EXPECT_EQ(static_cast<size_t>(num_nodes / 2), tree_.getNumLeafNodes());
+  for (int i = 0; i < num_nodes; i++)
+    EXPECT_EQ(i % 2 == 1, tree_.search(Key(0.05 + 0.3 * i, 0.05, 0.05)) != NULL) << "Node " << i;
+
+  // Once the recent nodes expire too the tree is empty
+  ros::Time::setNow(ros::Time(30.0));
+  for (unsigned int i = 0; i < num_slices; i++)
+    tree_.RemoveExpiredNodes(num_slices);
+  EXPECT_EQ(0u, tree_.getNumLeafNodes());
+
+  // Clearing forgets the mapped volume
+  tree_.updateNode(Key(0.05, 0.05, 0.05), true);
+  tree_.clear();
+  EXPECT_EQ(0u, tree_.RemoveExpiredNodes(num_slices));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  ros::Time::init();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,220 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Tests that the packed-key ray casting of OctoClass, with any number of
+// threads, updates the maps exactly like inserting the points one by one
+// into octomap key sets and casting each ray serially.
+
+#include <mapper/octoclass.h>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const double kResolution = 0.1, kMinRange = 0.2, kMaxRange = 3.0;
+
+// Log-odds of each leaf, by key and depth
+typedef std::map<std::pair<uint64_t, unsigned int>, float> LeafMap;
+
+// Organized cloud seen from the origin, wider than the frustum, with
+// invalid points and points beyond the maximum and below the minimum range
+pcl::PointCloud<pcl::PointXYZ> MakeCloud(const Eigen::Vector3d &origin, const double phase) {
+  pcl::PointCloud<pcl::PointXYZ> cloud(64, 48);
+  for (uint32_t i = 0; i < cloud.height; i++) {
+    for (uint32_t j = 0; j < cloud.width; j++) {
+      pcl::PointXYZ &point = cloud.at(j, i);
+      if ((i * cloud.width + j) % 11 == 0) {
+        point.x = point.y = point.z = std::numeric_limits<float>::quiet_NaN();
+        continue;
+      }
+      const Eigen::Vector3d direction = Eigen::Vector3d(1.5 * j / cloud.width - 0.75,
+                                                        1.2 * i / cloud.height - 0.6, 1.0).normalized();
+      const double range = 0.1 + 2.0 * (1.0 + std::sin(phase + 0.3 * i + 0.17 * j)) +
+                           ((i + j) % 13 == 0 ? 2.0 : 0.0);
+      const Eigen::Vector3d p = origin + range * direction;
+      point.x = p.x();
+      point.y = p.y();
+      point.z = p.z();
+    }
+  }
+  return cloud;
+}
+
+LeafMap Leaves(const octoclass::DecayingOcTree &tree) {
+  LeafMap leaves;
+  for (octoclass::DecayingOcTree::leaf_iterator it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it) {
+    const octomap::OcTreeKey key = it.getKey();
+    const uint64_t packed = (static_cast<uint64_t>(key[0]) << 32) | (static_cast<uint64_t>(key[1]) << 16) | key[2];
+    leaves[std::make_pair(packed, it.getDepth())] = it->getLogOdds();
+  }
+  return leaves;
+}
+
+void ExpectSameLeaves(const octoclass::DecayingOcTree &expected, const octoclass::DecayingOcTree &tree) {
+  const LeafMap expected_leaves = Leaves(expected), leaves = Leaves(tree);
+  ASSERT_EQ(expected_leaves.size(), leaves.size());
+  for (LeafMap::const_iterator it = expected_leaves.begin(), jt = leaves.begin(); it != expected_leaves.end();
+       ++it, ++jt) {
+    ASSERT_TRUE(it->first == jt->first);
+    EXPECT_FLOAT_EQ(it->second, jt->second);
+  }
+}
+
+// Serial reference of OctoClass::PclToRayOctomap, with octomap key sets
+class SerialMapper {
+ public:
+  explicit SerialMapper(const double inflate_radius) : tree_(kResolution), tree_inflated_(kResolution) {
+    const int max_xyz = static_cast<int>(round(inflate_radius / kResolution));
+    for (int x = -max_xyz; x <= max_xyz; x++) {
+      for (int y = -max_xyz; y <= max_xyz; y++) {
+        for (int z = -max_xyz; z <= max_xyz; z++) {
+          if ((x * x + y * y + z * z) * kResolution * kResolution <= inflate_radius * inflate_radius)
+            sphere_.push_back(Eigen::Vector3i(x, y, z));
+        }
+      }
+    }
+  }
+
+  void Insert(const pcl::PointCloud<pcl::PointXYZ> &cloud, const Eigen::Vector3d &cam_origin,
+              const algebra_3d::FrustumPlanes &frustum) {
+    const octomap::point3d origin(cam_origin.x(), cam_origin.y(), cam_origin.z());
+    octomap::KeySet endpoints, endpoints_in_range, endpoints_inflated;
+    for (size_t i = 0; i < cloud.size(); i++) {
+      const pcl::PointXYZ &point = cloud[i];
+      if (std::isnan(point.x) || std::isnan(point.y) || std::isnan(point.z))
+        continue;
+      if (!frustum.IsPointWithinFrustum(Eigen::Vector3d(point.x, point.y, point.z)))
+        continue;
+      const double dx = cam_origin.x() - point.x, dy = cam_origin.y() - point.y, dz = cam_origin.z() - point.z;
+      const double range_sqr = dx * dx + dy * dy + dz * dz;
+      if (range_sqr < kMinRange * kMinRange)
+        continue;
+      const octomap::OcTreeKey key = tree_.coordToKey(octomap::point3d(point.x, point.y, point.z));
+      endpoints.insert(key);
+      if (range_sqr < kMaxRange * kMaxRange)
+        endpoints_in_range.insert(key);
+    }
+    for (octomap::KeySet::iterator it = endpoints_in_range.begin(); it != endpoints_in_range.end(); ++it) {
+      for (size_t i = 0; i < sphere_.size(); i++) {
+        const Eigen::Vector3i key = Eigen::Vector3i((*it)[0], (*it)[1], (*it)[2]) + sphere_[i];
+        if (key.minCoeff() < 0 || key.maxCoeff() > 0xffff)
+          continue;
+        const octomap::OcTreeKey inflated_key(key[0], key[1], key[2]);
+        const octomap::point3d p = tree_.keyToCoord(inflated_key);
+        if (frustum.IsPointWithinFrustum(Eigen::Vector3d(p.x(), p.y(), p.z())))
+          endpoints_inflated.insert(inflated_key);
+      }
+    }
+
+    octomap::KeySet occupied, free, free_inflated;
+    octomap::KeyRay ray;
+    for (octomap::KeySet::iterator it = endpoints.begin(); it != endpoints.end(); ++it) {
+      octomap::point3d p = tree_.keyToCoord(*it);
+      if ((p - origin).norm() <= kMaxRange)
+        occupied.insert(*it);
+      else
+        p = origin + (p - origin).normalized() * static_cast<float>(kMaxRange);
+      tree_.computeRayKeys(origin, p, ray);
+      free.insert(ray.begin(), ray.end());
+      for (octomap::KeyRay::iterator jt = ray.begin(); jt != ray.end(); ++jt) {
+        if (endpoints_inflated.count(*jt) > 0)
+          break;
+        free_inflated.insert(*jt);
+      }
+    }
+
+    for (octomap::KeySet::iterator it = endpoints_inflated.begin(); it != endpoints_inflated.end(); ++it) {
+      if (free.count(*it) > 0 || endpoints.count(*it) > 0)
+        tree_inflated_.updateNode(*it, true, true);
+    }
+    for (octomap::KeySet::iterator it = occupied.begin(); it != occupied.end(); ++it)
+      tree_.updateNode(*it, true, true);
+    for (octomap::KeySet::iterator it = free_inflated.begin(); it != free_inflated.end(); ++it) {
+      tree_inflated_.updateNode(*it, false, true);
+      tree_.updateNode(*it, false, true);
+    }
+    tree_.updateInnerOccupancy();
+    tree_inflated_.updateInnerOccupancy();
+  }
+
+  octoclass::DecayingOcTree tree_, tree_inflated_;
+
+ private:
+  std::vector<Eigen::Vector3i> sphere_;
+};
+
+void ExpectSerialInsertion(const int num_threads, const double inflate_radius) {
+  SCOPED_TRACE(testing::Message() << num_threads << " threads, inflation " << inflate_radius);
+  octoclass::OctoClass octomap(kResolution);
+  octomap.SetMaxRange(kMaxRange);
+  octomap.SetMinRange(kMinRange);
+  octomap.SetMapInflation(inflate_radius);
+  octomap.SetNumThreads(num_threads);
+  SerialMapper serial(inflate_radius);
+
+  algebra_3d::FrustumPlanes cam_frustum(1.0, 4.0 / 3.0);
+  // Several clouds, so that later ones update known nodes and the workers are reused
+  for (int i = 0; i < 4; i++) {
+    const Eigen::Vector3d origin(0.37 * i, -0.21 * i, 0.13 * i);
+    algebra_3d::FrustumPlanes frustum;
+    cam_frustum.TransformFrustum(Eigen::Affine3d(Eigen::Translation3d(origin)), &frustum);
+    geometry_msgs::TransformStamped tf_cam2world;
+    tf_cam2world.transform.translation.x = origin.x();
+    tf_cam2world.transform.translation.y = origin.y();
+    tf_cam2world.transform.translation.z = origin.z();
+    tf_cam2world.transform.rotation.w = 1.0;
+    const pcl::PointCloud<pcl::PointXYZ> cloud = MakeCloud(origin, i);
+
+    octomap.PclToRayOctomap(cloud, tf_cam2world, frustum);
+    serial.Insert(cloud, origin, frustum);
+    ASSERT_GT(serial.tree_.getNumLeafNodes(), 0u);
+    ExpectSameLeaves(serial.tree_, octomap.tree_);
+    ExpectSameLeaves(serial.tree_inflated_, octomap.tree_inflated_);
+  }
+}
+
+}  // namespace
+
+TEST(ray_casting, MatchesSerialInsertion) {
+  ExpectSerialInsertion(1, 0.0);
+  ExpectSerialInsertion(1, 0.25);
+}
+
+TEST(ray_casting, ThreadsMatchSerialInsertion) {
+  for (const int num_threads : {2, 3, 8}) {
+    ExpectSerialInsertion(num_threads, 0.0);
+    ExpectSerialInsertion(num_threads, 0.25);
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  // The map updates are timestamped
+  ros::Time::init();
+  ros::Time::setNow(ros::Time(10.0));
+  return RUN_ALL_TESTS();
+}
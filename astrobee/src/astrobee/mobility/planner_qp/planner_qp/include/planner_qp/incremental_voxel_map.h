@@ -0,0 +1,88 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef PLANNER_QP_INCREMENTAL_VOXEL_MAP_H_
+#define PLANNER_QP_INCREMENTAL_VOXEL_MAP_H_
+
+#include <jps3d/planner/jps_3d_util.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace planner_qp {
+
+// Voxel map of the zones and the mapper keepouts for the planner, kept
+// between plans. It gives the same map as building a JPS::VoxelMapUtil
+// from the zones, adding the keepout points and dilating everything,
+// but each voxel counts how many occupied voxels its dilation covers.
+// When only the keepout points change, only the voxels in the stencils
+// of the added and removed points are touched, and the cloud of
+// occupied voxels for the decomposition is updated in place.
+class IncrementalVoxelMap {
+ public:
+  IncrementalVoxelMap();
+
+  // Whether the map was built from this zones map and these radii
+  bool Matches(Vec3f const& origin, Vec3i const& dim, double res,
+               std::vector<signed char> const& zones, double point_radius, double inflation) const;
+
+  // Rebuild everything from a zones map. Unknown voxels are free, and the
+  // keepout points are dropped.
+  void Reset(Vec3f const& origin, Vec3i const& dim, double res,
+             std::vector<signed char> const& zones, double point_radius, double inflation);
+
+  // Replace the keepout points, occupying their voxels dilated by the point
+  // radius. Returns whether the map changed.
+  bool SetPoints(vec_Vec3f const& points);
+
+  // The map to plan in, and its occupied voxels
+  std::shared_ptr<JPS::VoxelMapUtil> GetMapUtil() const { return map_util_; }
+  vec_Vec3f const& GetCloud() const { return cloud_; }
+
+ private:
+  // Offsets of the voxels JPS occupies around one voxel, by dilating an
+  // occupied voxel, or by adding a point at its center
+  std::vector<Vec3i> Stencil(double radius, bool point) const;
+
+  // Add or remove the inflation stencil of an occupied voxel
+  void AddSource(int index);
+  void RemoveSource(int index);
+
+  std::shared_ptr<JPS::VoxelMapUtil> map_util_;
+  Vec3f origin_;
+  Vec3i dim_;
+  double res_ = 0;
+  double point_radius_ = 0;
+  double inflation_ = 0;
+  std::vector<signed char> zones_;          // as received
+  std::vector<signed char> map_;            // dilated map
+  std::vector<uint32_t> cover_;             // stencils covering each voxel
+  std::vector<Vec3i> point_stencil_;
+  std::vector<Vec3i> inflation_stencil_;
+  std::vector<int> point_voxels_;           // sorted voxels of the keepout points
+  std::vector<int> new_point_voxels_, added_, removed_;  // reused by SetPoints
+  vec_Vec3f cloud_;                         // centers of the occupied voxels
+  std::vector<int> cloud_voxel_;            // voxel of each cloud point
+  std::vector<int> cloud_slot_;             // cloud point of each voxel, or -1
+  bool dirty_ = false;                      // map_ differs from map_util_
+};
+
+}  // namespace planner_qp
+
+#endif  // PLANNER_QP_INCREMENTAL_VOXEL_MAP_H_
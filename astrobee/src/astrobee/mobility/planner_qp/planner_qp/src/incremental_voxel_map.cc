@@ -0,0 +1,179 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <planner_qp/incremental_voxel_map.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+namespace planner_qp {
+
+// Voxel values, as in the zones map of the choreographer
+static const signed char kOccupied = 100;
+static const signed char kFree = 0;
+
+IncrementalVoxelMap::IncrementalVoxelMap() : map_util_(new JPS::VoxelMapUtil()) {}
+
+bool IncrementalVoxelMap::Matches(Vec3f const& origin, Vec3i const& dim, double res,
+                                  std::vector<signed char> const& zones, double point_radius,
+                                  double inflation) const {
+  return res_ > 0 && origin == origin_ && dim == dim_ && res == res_ && point_radius == point_radius_ &&
+         inflation == inflation_ && zones == zones_;
+}
+
+void IncrementalVoxelMap::Reset(Vec3f const& origin, Vec3i const& dim, double res,
+                                std::vector<signed char> const& zones, double point_radius,
+                                double inflation) {
+  origin_ = origin;
+  dim_ = dim;
+  res_ = res;
+  point_radius_ = point_radius;
+  inflation_ = inflation;
+  zones_ = zones;
+  point_stencil_ = Stencil(point_radius, true);
+  inflation_stencil_ = Stencil(inflation, false);
+
+  map_util_->setMap(origin, dim, zones, res);
+  map_util_->freeUnKnown();
+  int num_cell = dim.prod();
+  map_.assign(num_cell, kFree);
+  cover_.assign(num_cell, 0);
+  cloud_slot_.assign(num_cell, -1);
+  cloud_.clear();
+  cloud_voxel_.clear();
+  point_voxels_.clear();
+  for (int i = 0; i < num_cell; i++)
+    if (map_util_->isOccupied(i))
+      AddSource(i);
+  dirty_ = true;
+}
+
+bool IncrementalVoxelMap::SetPoints(vec_Vec3f const& points) {
+  if (res_ <= 0)
+    return false;
+
+  // Voxels of the new points, dilated by the point radius
+  new_point_voxels_.clear();
+  for (auto const& p : points) {
+    Vec3i pn = map_util_->floatToInt(p);
+    for (auto const& offset : point_stencil_) {
+      Vec3i q = pn + offset;
+      if ((q.array() >= 0).all() && (q.array() < dim_.array()).all())
+        new_point_voxels_.push_back(map_util_->getIndex(q));
+    }
+  }
+  std::sort(new_point_voxels_.begin(), new_point_voxels_.end());
+  new_point_voxels_.erase(std::unique(new_point_voxels_.begin(), new_point_voxels_.end()),
+                          new_point_voxels_.end());
+
+  // Only the difference with the previous points is dilated. Adding
+  // first keeps voxels covered by both from leaving and rejoining the
+  // cloud.
+  added_.clear();
+  removed_.clear();
+  std::set_difference(new_point_voxels_.begin(), new_point_voxels_.end(), point_voxels_.begin(),
+                      point_voxels_.end(), std::back_inserter(added_));
+  std::set_difference(point_voxels_.begin(), point_voxels_.end(), new_point_voxels_.begin(),
+                      new_point_voxels_.end(), std::back_inserter(removed_));
+  for (int index : added_)
+    AddSource(index);
+  for (int index : removed_)
+    RemoveSource(index);
+  point_voxels_.swap(new_point_voxels_);
+
+  bool changed = dirty_;
+  if (dirty_) {
+    map_util_->setMap(origin_, dim_, map_, res_);
+    dirty_ = false;
+  }
+  return changed;
+}
+
+std::vector<Vec3i> IncrementalVoxelMap::Stencil(double radius, bool point) const {
+  // Let JPS dilate a single voxel in a map just large enough, so the
+  // stencil has exactly the shape JPS uses
+  int n = static_cast<int>(std::ceil(radius / res_)) + 1;
+  Vec3i dim = Vec3i::Constant(2 * n + 1);
+  Vec3f origin = Vec3f::Zero();
+  Vec3i center = Vec3i::Constant(n);
+  std::vector<signed char> map(dim.prod(), kFree);
+  JPS::VoxelMapUtil probe;
+  probe.setMap(origin, dim, map, res_);
+  if (point) {
+    probe.dilate(radius, radius);
+    vec_Vec3f points(1, probe.intToFloat(center));
+    probe.add3DPoints(points);
+  } else {
+    map[probe.getIndex(center)] = kOccupied;
+    probe.setMap(origin, dim, map, res_);
+    probe.dilate(radius, radius);
+    probe.dilating();
+  }
+  std::vector<Vec3i> stencil;
+  for (int k = 0; k < dim(2); k++)
+    for (int j = 0; j < dim(1); j++)
+      for (int i = 0; i < dim(0); i++)
+        if (probe.isOccupied(probe.getIndex(Vec3i(i, j, k))))
+          stencil.push_back(Vec3i(i, j, k) - center);
+  return stencil;
+}
+
+void IncrementalVoxelMap::AddSource(int index) {
+  // Voxels are stored with x fastest, as in JPS
+  Vec3i pn(index % dim_(0), (index / dim_(0)) % dim_(1), index / (dim_(0) * dim_(1)));
+  for (auto const& offset : inflation_stencil_) {
+    Vec3i q = pn + offset;
+    if ((q.array() < 0).any() || (q.array() >= dim_.array()).any())
+      continue;
+    int v = map_util_->getIndex(q);
+    if (cover_[v]++ > 0)
+      continue;
+    map_[v] = kOccupied;
+    cloud_slot_[v] = cloud_.size();
+    cloud_.push_back(map_util_->intToFloat(q));
+    cloud_voxel_.push_back(v);
+    dirty_ = true;
+  }
+}
+
+void IncrementalVoxelMap::RemoveSource(int index) {
+  Vec3i pn(index % dim_(0), (index / dim_(0)) % dim_(1), index / (dim_(0) * dim_(1)));
+  for (auto const& offset : inflation_stencil_) {
+    Vec3i q = pn + offset;
+    if ((q.array() < 0).any() || (q.array() >= dim_.array()).any())
+      continue;
+    int v = map_util_->getIndex(q);
+    if (--cover_[v] > 0)
+      continue;
+    map_[v] = kFree;
+    // Move the last cloud point into the freed slot
+    int slot = cloud_slot_[v];
+    int last = cloud_voxel_.back();
+    cloud_[slot] = cloud_.back();
+    cloud_voxel_[slot] = last;
+    cloud_slot_[last] = slot;
+    cloud_.pop_back();
+    cloud_voxel_.pop_back();
+    cloud_slot_[v] = -1;
+    dirty_ = true;
+  }
+}
+
+}  // namespace planner_qp
@@ -30,6 +30,7 @@
 #include <decomp_util/ellipse_decomp.h>
 #include <jps3d/planner/jps_3d_util.h>
 #include <choreographer/planner.h>
+#include <planner_qp/incremental_voxel_map.h>
 
 // Keepout zones for the planner
 #include <jsonloader/keepout.h>
@@ -72,6 +73,7 @@ class Planner : public planner::PlannerImplementation {
   bool check_obstacles_;  // Perform obstacle checking
   bool uniform_time_;
   bool time_optiization_;
+  bool warm_start_;       // Start from the previous solution
 
   float desired_vel_;    // Soft limit on velocity
   float desired_accel_;  // Soft limit on accel
@@ -380,7 +382,7 @@ class Planner : public planner::PlannerImplementation {
   double map_res_{0.5};     // map resolution
 
  private:
-  std::shared_ptr<JPS::VoxelMapUtil> jps_map_util_;
+  IncrementalVoxelMap voxel_map_;
   std::unique_ptr<EllipseDecomp> decomp_util_;
   std::unique_ptr<JPS::JPS3DUtil> jps_planner_;
 
@@ -519,7 +521,12 @@ class Planner : public planner::PlannerImplementation {
                            ff_msgs::PlanResult *result) {
     OUTPUT_DEBUG("PlannerQP: Planning from " << start.transpose()
                                              << " to: " << goal.transpose());
-    // clear trajectory
+    // clear trajectory, keeping it to start the optimization from
+    boost::shared_ptr<traj_opt::NonlinearTrajectory> previous;
+    if (!cfg_.Get<bool>("warm_start", warm_start_))
+      warm_start_ = false;
+    if (warm_start_)
+      previous = trajectory_;
     trajectory_ = boost::shared_ptr<traj_opt::NonlinearTrajectory>();
 
     if (!cfg_.Get<bool>("time_optimization", time_optiization_))
@@ -625,7 +632,7 @@ class Planner : public planner::PlannerImplementation {
     try {
       trajectory_.reset(new traj_opt::NonlinearTrajectory(
           con, cons, 7, 3, ds, boost::shared_ptr<traj_opt::VecDVec>(),
-          time_optiization_, gap_threshold_, max_iterations_));
+          time_optiization_, gap_threshold_, max_iterations_, previous));
     } catch (std::runtime_error &e) {
       ROS_ERROR_STREAM("QP::Planner failed with error: " << e.what());
       return false;
@@ -639,7 +646,7 @@ class Planner : public planner::PlannerImplementation {
       try {
         trajectory_.reset(new traj_opt::NonlinearTrajectory(
             con, cons, 7, 3, ds, boost::shared_ptr<traj_opt::VecDVec>(),
-            false, gap_threshold_, max_iterations_));
+            false, gap_threshold_, max_iterations_, previous));
       } catch (std::runtime_error &e) {
         ROS_ERROR_STREAM("QP::Planner failed with error: " << e.what());
         return false;
@@ -878,8 +885,6 @@ class Planner : public planner::PlannerImplementation {
     for (auto &p : points) {
       mapper_points_.push_back(Vec3f(p.x, p.y, p.z));
     }
-    // Declare keepout points
-    vec_Vec3f keepout_points_mapper = mapper_points_;
 
     // Get zones map
     std::vector<signed char> map;
@@ -890,16 +895,6 @@ class Planner : public planner::PlannerImplementation {
       return false;
     }
 
-    jps_map_util_.reset(new JPS::VoxelMapUtil());
-    jps_map_util_->setMap(origin, dim, map, map_res_);
-
-    // Set all remaining space as free
-    jps_map_util_->freeUnKnown();
-
-    // Add obstacle map points
-    jps_map_util_->dilate(map_res_ / 2, map_res_ / 2);    // sets dilating radius
-    jps_map_util_->add3DPoints(keepout_points_mapper);    // add keepout points from mapper
-
     OUTPUT_DEBUG("PlannerQP: Map origin " << origin.transpose() << " dim "
                                           << dim.transpose() << " resolution "
                                           << map_res_);
@@ -913,26 +908,31 @@ class Planner : public planner::PlannerImplementation {
     if (planner_distance < map_res_)
       planner_distance = map_res_;
 
-    jps_map_util_->dilate(planner_distance, planner_distance);    // sets dilating radius
-    jps_map_util_->dilating();                                    // dillate entire map
-
-
-    jps_planner_.reset(new JPS::JPS3DUtil(false));
-    jps_planner_->setMapUtil(jps_map_util_.get());
-
-    decomp_util_.reset(new EllipseDecomp(
-        jps_map_util_->getOrigin(),
-        jps_map_util_->getDim().cast<decimal_t>() * jps_map_util_->getRes(),
-        false));
-    decomp_util_->set_obstacles(jps_map_util_->getCloud());
+    // The zones with unknown space set as free, the keepout points from the mapper
+    // dilated by half a voxel, and all of it dilated by the planner distance. The
+    // map is only rebuilt when the zones or the distances change, otherwise only
+    // the voxels around the keepout points which appeared or disappeared are updated.
+    bool rebuild = !voxel_map_.Matches(origin, dim, map_res_, map, map_res_ / 2, planner_distance);
+    if (rebuild)
+      voxel_map_.Reset(origin, dim, map_res_, map, map_res_ / 2, planner_distance);
+    bool changed = voxel_map_.SetPoints(mapper_points_);
+
+    if (rebuild || !decomp_util_) {
+      jps_planner_.reset(new JPS::JPS3DUtil(false));
+      decomp_util_.reset(new EllipseDecomp(
+          origin, dim.cast<decimal_t>() * map_res_, false));
+    }
+    jps_planner_->setMapUtil(voxel_map_.GetMapUtil().get());
+    if (rebuild || changed)
+      decomp_util_->set_obstacles(voxel_map_.GetCloud());
 
     // debugCloud();
 
     return true;
   }
   /*  void debugCloud(){
-      // vec_Vec3f free = jps_map_util_->getFreeCloud();
-      vec_Vec3f free = jps_map_util_->getCloud();
+      // vec_Vec3f free = voxel_map_.GetMapUtil()->getFreeCloud();
+      vec_Vec3f free = voxel_map_.GetCloud();
       pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new
     pcl::PointCloud<pcl::PointXYZ>);
       cloud->header.frame_id = "world";
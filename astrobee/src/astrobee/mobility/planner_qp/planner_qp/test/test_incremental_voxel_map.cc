@@ -0,0 +1,192 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Tests that the incremental voxel map of the planner, as zones, keepout
+// points and radii change, is always the map JPS builds from scratch by
+// dilating the points and then the whole map.
+
+#include <planner_qp/incremental_voxel_map.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const double kResolution = 0.5;
+const Vec3f kOrigin(-3.0, -2.5, -2.0);
+const Vec3i kDim(12, 10, 8);
+
+// Zones map with some unknown space, which the planner takes as free
+std::vector<signed char> MakeZones() {
+  std::vector<signed char> zones(kDim.prod(), 0);
+  for (int k = 0; k < kDim(2); k++) {
+    for (int j = 0; j < kDim(1); j++) {
+      for (int i = 0; i < kDim(0); i++) {
+        signed char &value = zones[i + kDim(0) * (j + kDim(1) * k)];
+        if (i == 0 || k == kDim(2) - 1)
+          value = 100;    // walls
+        else if (i >= 5 && i <= 6 && j >= 3 && j <= 5 && k <= 4)
+          value = 100;    // a column
+        else if (j >= 8)
+          value = -1;     // unknown
+      }
+    }
+  }
+  return zones;
+}
+
+// Keepout points from the mapper, all inside the map and crowded enough
+// for their stencils to overlap
+vec_Vec3f MakePoints(unsigned int seed, int num_points) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> x(kOrigin(0), kOrigin(0) + kDim(0) * kResolution);
+  std::uniform_real_distribution<double> y(kOrigin(1), kOrigin(1) + kDim(1) * kResolution);
+  std::uniform_real_distribution<double> z(kOrigin(2), kOrigin(2) + kDim(2) * kResolution);
+  vec_Vec3f points;
+  for (int i = 0; i < num_points; i++)
+    points.push_back(Vec3f(x(generator), y(generator), z(generator)));
+  return points;
+}
+
+// Build the map the way the planner did before it was incremental
+std::shared_ptr<JPS::VoxelMapUtil> BuildFromScratch(std::vector<signed char> const& zones,
+                                                     vec_Vec3f const& points, double point_radius,
+                                                     double inflation) {
+  std::shared_ptr<JPS::VoxelMapUtil> map_util(new JPS::VoxelMapUtil());
+  map_util->setMap(kOrigin, kDim, zones, kResolution);
+  map_util->freeUnKnown();
+  map_util->dilate(point_radius, point_radius);
+  map_util->add3DPoints(points);
+  map_util->dilate(inflation, inflation);
+  map_util->dilating();
+  return map_util;
+}
+
+// Update the map as the planner does, returning whether it was rebuilt
+bool Update(planner_qp::IncrementalVoxelMap* map, std::vector<signed char> const& zones,
+            vec_Vec3f const& points, double point_radius, double inflation) {
+  bool rebuild = !map->Matches(kOrigin, kDim, kResolution, zones, point_radius, inflation);
+  if (rebuild)
+    map->Reset(kOrigin, kDim, kResolution, zones, point_radius, inflation);
+  map->SetPoints(points);
+  return rebuild;
+}
+
+// Both the map and the cloud of occupied voxels must match
+void ExpectSameMap(planner_qp::IncrementalVoxelMap const& map, JPS::VoxelMapUtil* expected) {
+  std::shared_ptr<JPS::VoxelMapUtil> actual = map.GetMapUtil();
+  std::vector<int> expected_occupied;
+  int num_mismatched = 0;
+  for (int i = 0; i < kDim.prod(); i++) {
+    if (expected->isOccupied(i))
+      expected_occupied.push_back(i);
+    if (actual->isOccupied(i) != expected->isOccupied(i))
+      num_mismatched++;
+  }
+  EXPECT_EQ(0, num_mismatched);
+  ASSERT_FALSE(expected_occupied.empty());
+
+  std::vector<int> cloud_voxels;
+  for (auto const& p : map.GetCloud()) {
+    Vec3i pn = actual->floatToInt(p);
+    EXPECT_TRUE((actual->intToFloat(pn) - p).norm() < 1e-9);
+    cloud_voxels.push_back(actual->getIndex(pn));
+  }
+  std::sort(cloud_voxels.begin(), cloud_voxels.end());
+  EXPECT_EQ(expected_occupied, cloud_voxels);
+}
+
+}  // namespace
+
+TEST(IncrementalVoxelMap, ChangingPoints) {
+  const double point_radius = kResolution / 2, inflation = kResolution;
+  std::vector<signed char> zones = MakeZones();
+  planner_qp::IncrementalVoxelMap map;
+
+  std::vector<vec_Vec3f> point_sets;
+  point_sets.push_back(MakePoints(1, 40));
+  // Some of the same points along with new ones, then only new ones
+  point_sets.push_back(vec_Vec3f(point_sets[0].begin(), point_sets[0].begin() + 20));
+  vec_Vec3f more = MakePoints(2, 30);
+  point_sets.back().insert(point_sets.back().end(), more.begin(), more.end());
+  point_sets.push_back(MakePoints(3, 60));
+  point_sets.push_back(vec_Vec3f());
+  point_sets.push_back(point_sets[0]);
+
+  EXPECT_TRUE(Update(&map, zones, point_sets[0], point_radius, inflation));
+  ExpectSameMap(map, BuildFromScratch(zones, point_sets[0], point_radius, inflation).get());
+  for (auto const& points : point_sets) {
+    EXPECT_FALSE(Update(&map, zones, points, point_radius, inflation));
+    ExpectSameMap(map, BuildFromScratch(zones, points, point_radius, inflation).get());
+  }
+  // Setting the same points again changes nothing
+  EXPECT_FALSE(map.SetPoints(point_sets.back()));
+}
+
+TEST(IncrementalVoxelMap, ChangingZones) {
+  const double point_radius = kResolution / 2, inflation = kResolution;
+  std::vector<signed char> zones = MakeZones();
+  vec_Vec3f points = MakePoints(4, 40);
+  planner_qp::IncrementalVoxelMap map;
+  Update(&map, zones, points, point_radius, inflation);
+
+  // Add a keepout zone and remove the column
+  for (int i = 2; i < 4; i++)
+    for (int j = 1; j < 3; j++)
+      zones[i + kDim(0) * (j + kDim(1) * 3)] = 100;
+  for (int k = 0; k <= 4; k++)
+    for (int j = 3; j <= 5; j++)
+      for (int i = 5; i <= 6; i++)
+        zones[i + kDim(0) * (j + kDim(1) * k)] = 0;
+  EXPECT_TRUE(Update(&map, zones, points, point_radius, inflation));
+  ExpectSameMap(map, BuildFromScratch(zones, points, point_radius, inflation).get());
+
+  // And keep updating the points incrementally in the new zones
+  points = MakePoints(5, 50);
+  EXPECT_FALSE(Update(&map, zones, points, point_radius, inflation));
+  ExpectSameMap(map, BuildFromScratch(zones, points, point_radius, inflation).get());
+}
+
+TEST(IncrementalVoxelMap, ChangingRadius) {
+  std::vector<signed char> zones = MakeZones();
+  vec_Vec3f points = MakePoints(6, 30);
+  planner_qp::IncrementalVoxelMap map;
+  Update(&map, zones, points, kResolution / 2, kResolution);
+
+  // Planner distances of more than one voxel, and a different point radius
+  unsigned int seed = 7;
+  for (double inflation : {0.75, 1.0, 0.5}) {
+    for (double point_radius : {kResolution / 2, kResolution}) {
+      EXPECT_TRUE(Update(&map, zones, points, point_radius, inflation));
+      ExpectSameMap(map, BuildFromScratch(zones, points, point_radius, inflation).get());
+      points = MakePoints(seed++, 30);
+      EXPECT_FALSE(Update(&map, zones, points, point_radius, inflation));
+      ExpectSameMap(map, BuildFromScratch(zones, points, point_radius, inflation).get());
+    }
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
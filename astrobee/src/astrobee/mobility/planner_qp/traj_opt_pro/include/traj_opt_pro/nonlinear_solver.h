@@ -79,9 +79,9 @@ class EqConstraint {  // constraint of the form a_i^T x <= rhs
   Variable *var_v;  // dual var
   std::vector<EqPair> coeff;
   decimal_t rhs;
-  ETV ai();                           // gets a_i
+  void ai(ETV *coeffs);               // appends a_i and a_i^T
   ET bi();                            // geta a_i^Tz - rhs
-  ETV audio_video();                  // gets A^Tv
+  void audio_video(VecD *b);          // adds A^Tv
   std::pair<ETV, ET> get_presolve();  // returns system
 
   friend class NonlinearSolver;
@@ -93,7 +93,6 @@ class IneqConstraint {  // constraint of the form g(x) <= 0
  private:
   friend class NonlinearSolver;
 
-  ETV gradientS();               // gets g_i'u_i
   ET slack();                    // gets g(z) + s
   ET sports_util(decimal_t nu);  // gets Su - \nu   (SUV)
   decimal_t linesearch(const VecD &delta,
@@ -102,10 +101,10 @@ class IneqConstraint {  // constraint of the form g(x) <= 0
   Variable *var_u;  // dual var v
   Variable *var_s;  // dual var s
 
-  std::vector<Variable *> vars;      // variables involved
-  virtual decimal_t evaluate() = 0;  // gets g(x)
-  virtual ETV gradient() = 0;        // gets G(x)
-  virtual ETV hessian() = 0;         // gets  (u \nabla^2 g(x))
+  std::vector<Variable *> vars;               // variables involved
+  virtual decimal_t evaluate() = 0;           // gets g(x)
+  virtual void gradient(ETV *grad) = 0;       // appends G(x)
+  virtual void hessian(ETV *hess) = 0;        // appends  (u \nabla^2 g(x))
   void update_slack();
 
  public:
@@ -115,13 +114,29 @@ class IneqConstraint {  // constraint of the form g(x) <= 0
 };
 class CostFunction {
  protected:
-  virtual decimal_t evaluate() = 0;  // gets f(x)
-  virtual ETV gradient() = 0;        // gets \nabla f(x)
-  virtual ETV hessian() = 0;         // gets  \nabla^2 f(x)
-  std::vector<Variable *> vars;      // variables involved
+  virtual decimal_t evaluate() = 0;           // gets f(x)
+  virtual void gradient(VecD *grad) = 0;      // adds \nabla f(x)
+  virtual void hessian(ETV *hess) = 0;        // appends  \nabla^2 f(x)
+  std::vector<Variable *> vars;               // variables involved
   friend class NonlinearSolver;
 };
 
+// Sparse matrix assembled from triplets which come in the same positions
+// and order every time, like the KKT system of one problem from one
+// iteration to the next. The structure is built on the first assembly,
+// along with where each triplet lands in it, and later assemblies only
+// rewrite the values. A factorization of the matrix can then keep its
+// symbolic analysis.
+class SparsePattern {
+ public:
+  // Returns true if the structure of mat was (re)built
+  bool assemble(const ETV &trip, int rows, int cols, SpMat *mat);
+
+ private:
+  std::vector<int> rows_, cols_;
+  std::vector<int> slots_;  // index of each triplet in the values of mat
+};
+
 class NonlinearSolver {
  private:
   std::vector<Variable> vars;
@@ -142,6 +157,20 @@ class NonlinearSolver {
   decimal_t epsilon_;
   decimal_t centering_;
 
+  // KKT system, kept between iterations
+  ETV coeffs_;
+  SparsePattern kkt_pattern_;
+  SpMat kkt_;
+  VecD kkt_b_;
+  Eigen::SparseLU<SpMat> kkt_solver_;
+  // Same for the time allocation
+  ETV time_coeffs_;
+  SparsePattern time_pattern_;
+  SpMat time_hess_;
+  VecD time_grad_;
+  std::vector<int> time_inds_;  // index among the times of each variable, or -1
+  Eigen::SparseLU<SpMat> time_solver_;
+
  public:
   static ETV transpose(const ETV &vec);
   explicit NonlinearSolver(uint max_vars) : max_vars_(max_vars) {
@@ -58,13 +58,16 @@ class SymbolicPoly {
   SymbolicPoly &operator+=(const SymbolicPoly &rhs);
   friend SymbolicPoly operator*(decimal_t lhs, const SymbolicPoly &rhs);
   decimal_t evaluate();
+  // The derivatives are appended to the output, which is reused between
+  // iterations so it does not allocate. Terms of the same variable may
+  // come as separate triplets, the sparse assembly sums them.
   // for these derrivaties assume only linear terms
-  ETV gradient(int u_id);
-  ETV hessian();
+  void gradient(int u_id, ETV *grad) const;
+  void hessian(ETV *hess) const;
   // for these derrivaties assume only quadratic terms
-  ETV quad_gradient(int u_id);
-  ETV quad_gradient();
-  ETV quad_hessian();
+  void quad_gradient(int u_id, ETV *grad) const;
+  void quad_gradient(VecD *grad) const;  // adds to a dense gradient
+  void quad_hessian(ETV *hess) const;
 
   SymbolicPoly square();  // returns the square the linear parts
   void add(const SymbolicPoly &rhs);
@@ -79,14 +82,17 @@ class PolyCost;
 class TimeBound;
 class NonlinearTrajectory : public Trajectory {
  public:
-  // standard contruction
+  // standard contruction, optionally starting from the solution of a
+  // previous plan with the same number of segments (see warm_start)
   NonlinearTrajectory(
       const std::vector<Waypoint> &waypoints,
       const std::vector<std::pair<MatD, VecD> > &cons, int deg = 7,
       int min_dim = 3, boost::shared_ptr<std::vector<decimal_t> > ds =
                            boost::shared_ptr<std::vector<decimal_t> >(),
       boost::shared_ptr<VecDVec> path = boost::shared_ptr<VecDVec>(),
-      bool time_opt = false, decimal_t gap = 1e-8, int max_it = 200);
+      bool time_opt = false, decimal_t gap = 1e-8, int max_it = 200,
+      boost::shared_ptr<NonlinearTrajectory> warm =
+          boost::shared_ptr<NonlinearTrajectory>());
   // nonconvex pointcloud test
   NonlinearTrajectory(const std::vector<Waypoint> &waypoints,
                       const Vec3Vec &points, int segs, decimal_t dt);
@@ -107,6 +113,8 @@ class NonlinearTrajectory : public Trajectory {
           boost::shared_ptr<std::vector<decimal_t> >(),
       boost::shared_ptr<VecDVec> path = boost::shared_ptr<VecDVec>());
   void allocate_beads();
+  // copies the coefficients of a previous solution, if it has the same shape
+  bool warm_start(const NonlinearTrajectory &previous);
   void link_sections();  // note, requires endpoint basis
   void add_boundary(
       const std::vector<Waypoint> &waypoints);  // add boundary values
@@ -136,8 +144,8 @@ class PolyCost : public CostFunction {
   PolyCost(const NLTraj &traj, const NLTimes &times, BasisBundlePro &basis,
            int min_dim);
   decimal_t evaluate();
-  ETV gradient();
-  ETV hessian();
+  void gradient(VecD *grad);
+  void hessian(ETV *hess);
 
  private:
   SymbolicPoly poly;
@@ -91,9 +91,40 @@ decimal_t SymbolicPoly::evaluate() {
   //        std::cout << "evaluate " << val << std::endl;
   return val;
 }
-ETV SymbolicPoly::gradient(int u_id) {
-  ETV grad;
-  std::map<Variable *, decimal_t> time_grad;
+namespace {
+// Sums consecutive terms of the same time variable into one triplet. The
+// polynomials of a constraint are over a single segment, so this merges
+// all of their time terms without a map.
+class TimeTerms {
+ public:
+  // row of the triplets, or -1 for the diagonal
+  TimeTerms(int row, ETV *out) : row_(row), out_(out) {}
+  ~TimeTerms() { flush(); }
+  void add(Variable *time, decimal_t val) {
+    if (time != time_) {
+      flush();
+      time_ = time;
+    }
+    val_ += val;
+  }
+
+ private:
+  void flush() {
+    if (time_ != NULL)
+      out_->push_back(
+          ET(row_ < 0 ? time_->getId() : row_, time_->getId(), val_));
+    time_ = NULL;
+    val_ = 0.0;
+  }
+  int row_;
+  ETV *out_;
+  Variable *time_{NULL};
+  decimal_t val_{0.0};
+};
+}  // namespace
+
+void SymbolicPoly::gradient(int u_id, ETV *grad) const {
+  TimeTerms time_grad(u_id, grad);
   for (auto &p : poly_map) {
     Variable *coeff = std::get<0>(p.first);
     Variable *time = std::get<1>(p.first);
@@ -101,173 +132,101 @@ ETV SymbolicPoly::gradient(int u_id) {
 
     decimal_t dt = decimal_t(n) * std::pow(time->getVal(), n - 1) *
                    coeff->getVal() * p.second;
-    if (time_grad.find(time) == time_grad.end())
-      time_grad[time] = dt;
-    else
-      time_grad[time] += dt;
+    time_grad.add(time, dt);
 
-    ET gi = ET(u_id, coeff->getId(), p.second * std::pow(time->getVal(), n));
-    grad.push_back(gi);
-  }
-  for (auto &v : time_grad) {
-    ET gt = ET(u_id, v.first->getId(), v.second);
-    grad.push_back(gt);
+    grad->push_back(
+        ET(u_id, coeff->getId(), p.second * std::pow(time->getVal(), n)));
   }
-  return grad;
 }
-ETV SymbolicPoly::hessian() {
-  std::map<Variable *, decimal_t> time_hess;
-  ETV hess;
+void SymbolicPoly::hessian(ETV *hess) const {
+  TimeTerms time_hess(-1, hess);
   // note for this form, all second derivatives are zero with respect to the
   // coeffiients
   for (auto &p : poly_map) {
     Variable *coeff = std::get<0>(p.first);
     Variable *time = std::get<1>(p.first);
     int n = std::get<2>(p.first);
-    // if (n > 1) {
+    // d^2g/dtdt
     decimal_t dt = decimal_t(n * (n - 1)) * std::pow(time->getVal(), n - 2) *
                    coeff->getVal() * p.second;
-    if (time_hess.find(time) == time_hess.end())
-      time_hess[time] = dt;
-    else
-      time_hess[time] += dt;
-    // }
-    // if (n > 0) {
+    time_hess.add(time, dt);
     decimal_t c = decimal_t(n) * std::pow(time->getVal(), n - 1) *
                   coeff->getVal() * p.second;
-    hess.push_back(ET(coeff->getId(), time->getId(), c));
-    hess.push_back(ET(time->getId(), coeff->getId(), c));
-    // }
-  }
-  // d^2g/dtdt
-  for (auto &v : time_hess) {
-    ET ht = ET(v.first->getId(), v.first->getId(), v.second);
-    hess.push_back(ht);
+    hess->push_back(ET(coeff->getId(), time->getId(), c));
+    hess->push_back(ET(time->getId(), coeff->getId(), c));
   }
-  return hess;
 }
-ETV SymbolicPoly::quad_gradient() {
-  return NonlinearSolver::transpose(
-      quad_gradient(0));  // for cost function, gradient is single column
-}
-
-ETV SymbolicPoly::quad_gradient(int u_id) {
-  ETV grad;
-  std::map<Variable *, decimal_t> time_grad;
-  std::map<Variable *, decimal_t> coeff_grad;
-
+void SymbolicPoly::quad_gradient(int u_id, ETV *grad) const {
+  TimeTerms time_grad(u_id, grad);
   for (auto &p : quad_map) {
     Variable *coeff0 = std::get<0>(p.first);
     Variable *coeff1 = std::get<1>(p.first);
     Variable *time = std::get<2>(p.first);
     int n = std::get<3>(p.first);
-    if (1) {
-      decimal_t dt = decimal_t(n) * std::pow(time->getVal(), n - 1) *
-                     coeff0->getVal() * coeff1->getVal() * p.second;
-      if (time_grad.find(time) == time_grad.end())
-        time_grad[time] = dt;
-      else
-        time_grad[time] += dt;
-    }
+    decimal_t tn = p.second * std::pow(time->getVal(), n);
+    time_grad.add(time, decimal_t(n) * std::pow(time->getVal(), n - 1) *
+                            coeff0->getVal() * coeff1->getVal() * p.second);
     if (coeff0->getId() == coeff1->getId()) {
-      if (coeff_grad.find(coeff0) == coeff_grad.end())
-        coeff_grad[coeff0] =
-            2.0 * coeff0->getVal() * p.second * std::pow(time->getVal(), n);
-      else
-        coeff_grad[coeff0] +=
-            2.0 * coeff0->getVal() * p.second * std::pow(time->getVal(), n);
-
+      grad->push_back(ET(u_id, coeff0->getId(), 2.0 * coeff0->getVal() * tn));
     } else {
-      if (coeff_grad.find(coeff0) == coeff_grad.end())
-        coeff_grad[coeff0] =
-            coeff1->getVal() * p.second * std::pow(time->getVal(), n);
-      else
-        coeff_grad[coeff0] +=
-            coeff1->getVal() * p.second * std::pow(time->getVal(), n);
-
-      if (coeff_grad.find(coeff1) == coeff_grad.end())
-        coeff_grad[coeff1] =
-            coeff0->getVal() * p.second * std::pow(time->getVal(), n);
-      else
-        coeff_grad[coeff1] +=
-            coeff0->getVal() * p.second * std::pow(time->getVal(), n);
+      grad->push_back(ET(u_id, coeff0->getId(), coeff1->getVal() * tn));
+      grad->push_back(ET(u_id, coeff1->getId(), coeff0->getVal() * tn));
     }
   }
-  for (auto &v : coeff_grad) {
-    ET gt = ET(u_id, v.first->getId(), v.second);
-    grad.push_back(gt);
-  }
-  for (auto &v : time_grad) {
-    ET gt = ET(u_id, v.first->getId(), v.second);
-    grad.push_back(gt);
+}
+void SymbolicPoly::quad_gradient(VecD *grad) const {
+  for (auto &p : quad_map) {
+    Variable *coeff0 = std::get<0>(p.first);
+    Variable *coeff1 = std::get<1>(p.first);
+    Variable *time = std::get<2>(p.first);
+    int n = std::get<3>(p.first);
+    decimal_t tn = p.second * std::pow(time->getVal(), n);
+    (*grad)(time->getId()) += decimal_t(n) * std::pow(time->getVal(), n - 1) *
+                              coeff0->getVal() * coeff1->getVal() * p.second;
+    if (coeff0->getId() == coeff1->getId()) {
+      (*grad)(coeff0->getId()) += 2.0 * coeff0->getVal() * tn;
+    } else {
+      (*grad)(coeff0->getId()) += coeff1->getVal() * tn;
+      (*grad)(coeff1->getId()) += coeff0->getVal() * tn;
+    }
   }
-  return grad;
 }
-ETV SymbolicPoly::quad_hessian() {
-  ETV hess;
-  std::map<Variable *, decimal_t> time_hess;
+void SymbolicPoly::quad_hessian(ETV *hess) const {
+  TimeTerms time_hess(-1, hess);
   for (auto &p : quad_map) {
     Variable *coeff0 = std::get<0>(p.first);
     Variable *coeff1 = std::get<1>(p.first);
     Variable *time = std::get<2>(p.first);
     int n = std::get<3>(p.first);
+    decimal_t tn = p.second * std::pow(time->getVal(), n);
+    decimal_t dtn =
+        p.second * decimal_t(n) * std::pow(time->getVal(), n - 1);
     // d^2/dt^2
-    decimal_t dt = decimal_t(n - 1) * decimal_t(n) *
-                   std::pow(time->getVal(), n - 2) * coeff0->getVal() *
-                   coeff1->getVal() * p.second;
-    if (time_hess.find(time) == time_hess.end())
-      time_hess[time] = dt;
-    else
-      time_hess[time] += dt;
+    time_hess.add(time, decimal_t(n - 1) * decimal_t(n) *
+                            std::pow(time->getVal(), n - 2) *
+                            coeff0->getVal() * coeff1->getVal() * p.second);
     // d^2/dc/dc
     if (coeff0->getId() == coeff1->getId()) {
-      ET gi = ET(coeff0->getId(), coeff0->getId(),
-                 2.0 * p.second * std::pow(time->getVal(), n));
-      hess.push_back(gi);
+      hess->push_back(ET(coeff0->getId(), coeff0->getId(), 2.0 * tn));
       // d^2/{dtdc} has 2 terms
-      ET gi2 = ET(coeff0->getId(), time->getId(),
-                  2.0 * coeff1->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-      ET gi3 = ET(time->getId(), coeff0->getId(),
-                  2.0 * coeff1->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-      hess.push_back(gi2);
-      hess.push_back(gi3);
-
+      hess->push_back(
+          ET(coeff0->getId(), time->getId(), 2.0 * coeff1->getVal() * dtn));
+      hess->push_back(
+          ET(time->getId(), coeff0->getId(), 2.0 * coeff1->getVal() * dtn));
     } else {
-      ET gi0 = ET(coeff0->getId(), coeff1->getId(),
-                  p.second * std::pow(time->getVal(), n));
-      ET gi1 = ET(coeff1->getId(), coeff0->getId(),
-                  p.second * std::pow(time->getVal(), n));
-
-      hess.push_back(gi0);
-      hess.push_back(gi1);
-
+      hess->push_back(ET(coeff0->getId(), coeff1->getId(), tn));
+      hess->push_back(ET(coeff1->getId(), coeff0->getId(), tn));
       // 4 things  d^2/{dtdc}
-      ET gi2 = ET(coeff0->getId(), time->getId(),
-                  coeff1->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-      ET gi3 = ET(time->getId(), coeff0->getId(),
-                  coeff1->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-      ET gi4 = ET(coeff1->getId(), time->getId(),
-                  coeff0->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-      ET gi5 = ET(time->getId(), coeff1->getId(),
-                  coeff0->getVal() * p.second * decimal_t(n) *
-                      std::pow(time->getVal(), n - 1));
-
-      hess.push_back(gi2);
-      hess.push_back(gi3);
-      hess.push_back(gi4);
-      hess.push_back(gi5);
+      hess->push_back(
+          ET(coeff0->getId(), time->getId(), coeff1->getVal() * dtn));
+      hess->push_back(
+          ET(time->getId(), coeff0->getId(), coeff1->getVal() * dtn));
+      hess->push_back(
+          ET(coeff1->getId(), time->getId(), coeff0->getVal() * dtn));
+      hess->push_back(
+          ET(time->getId(), coeff1->getId(), coeff0->getVal() * dtn));
     }
   }
-  for (auto &v : time_hess) {
-    ET gt = ET(v.first->getId(), v.first->getId(), v.second);
-    hess.push_back(gt);
-  }
-  return hess;
 }
 SymbolicPoly SymbolicPoly::square() {
   SymbolicPoly resultant;
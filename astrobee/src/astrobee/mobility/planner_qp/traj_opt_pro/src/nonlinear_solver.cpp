@@ -19,7 +19,6 @@
 #include <traj_opt_pro/nonlinear_solver.h>
 // move to cpp
 #include <algorithm>
-#include <map>
 #include <utility>
 #include <vector>
 
@@ -64,22 +63,54 @@ std::ostream &operator<<(std::ostream &os, const ETV &trip) {
   return os;
 }
 
+// Sparse pattern
+bool SparsePattern::assemble(const ETV &trip, int rows, int cols, SpMat *mat) {
+  bool same = rows == mat->rows() && cols == mat->cols() &&
+              trip.size() == slots_.size();
+  for (size_t k = 0; same && k < trip.size(); k++)
+    same = trip[k].row() == rows_[k] && trip[k].col() == cols_[k];
+  if (same) {
+    decimal_t *values = mat->valuePtr();
+    std::fill(values, values + mat->nonZeros(), 0.0);
+    for (size_t k = 0; k < trip.size(); k++)
+      values[slots_[k]] += trip[k].value();
+    return false;
+  }
+
+  // setFromTriplets sums duplicates and keeps explicit zeros, so every
+  // triplet has its own entry in the compressed columns
+  mat->resize(rows, cols);
+  mat->setFromTriplets(trip.begin(), trip.end());
+  mat->makeCompressed();
+  rows_.resize(trip.size());
+  cols_.resize(trip.size());
+  slots_.resize(trip.size());
+  const int *outer = mat->outerIndexPtr();
+  const int *inner = mat->innerIndexPtr();
+  for (size_t k = 0; k < trip.size(); k++) {
+    rows_[k] = trip[k].row();
+    cols_[k] = trip[k].col();
+    slots_[k] = std::lower_bound(inner + outer[cols_[k]],
+                                 inner + outer[cols_[k] + 1], rows_[k]) -
+                inner;
+  }
+  return true;
+}
+
 // Eq solver helpers
-ETV EqConstraint::ai() {
-  ETV a;
-  a.reserve(coeff.size());
-  for (auto &p : coeff) a.push_back(ET(var_v->id, p.first->getId(), p.second));
-  return a;
+void EqConstraint::ai(ETV *coeffs) {
+  for (auto &p : coeff) {
+    coeffs->push_back(ET(var_v->id, p.first->getId(), p.second));
+    coeffs->push_back(ET(p.first->getId(), var_v->id, p.second));
+  }
 }
 ET EqConstraint::bi() {
   decimal_t val = -rhs;
   for (auto &p : coeff) val += p.first->val * p.second;
   return ET(var_v->id, 0, val);
 }
-ETV EqConstraint::audio_video() {
-  ETV av;
-  for (auto &p : coeff) av.push_back(ET(p.first->id, 0, var_v->val * p.second));
-  return av;
+void EqConstraint::audio_video(VecD *b) {
+  for (auto &p : coeff) (*b)(p.first->id) += var_v->val * p.second;
 }
 std::pair<ETV, ET> EqConstraint::get_presolve() {
   ETV a_i;
@@ -95,13 +126,6 @@ ET IneqConstraint::slack() { return ET(var_u->id, 0, evaluate() + var_s->val); }
 ET IneqConstraint::sports_util(decimal_t nu) {
   return ET(var_s->id, 0, var_s->val * var_u->val - nu);
 }
-ETV IneqConstraint::gradientS() {
-  ETV grad = gradient();
-  ETV gradS;
-  gradS.reserve(grad.size());
-  for (auto t : grad) gradS.push_back(ET(t.col(), 0, t.value() * var_u->val));
-  return gradS;
-}
 decimal_t IneqConstraint::linesearch(const VecD &delta, decimal_t max_h) {
   max_h = 1.0;
   decimal_t ui = var_u->val;
@@ -175,94 +199,62 @@ bool NonlinearSolver::iterate() {
   int total_v = vars.size();
   // int num_z = total_v - 2*num_u - num_v;
 
-  SpMat M(total_v, total_v);
-  SpMat b(total_v, 1);
-  ETV coeffs;
-  ETV bcoeffs;
+  // Gather the KKT system. The triplets come in the same positions and
+  // order every iteration, only their values change.
+  coeffs_.clear();
+  kkt_b_.setZero(total_v);
 
   VecD nu = VecD::Zero(num_u);
   // add A
-  ETV A;
   for (auto &eq : eq_con) {
-    ETV ai = eq->ai();
-    //        for(auto &aii:ai)
-    //            std::cout << aii.row() << " , " << aii.col() << " : " <<
-    //            aii.value() << std::endl;
-    //        std::cout << "rhs " << eq->rhs << std::endl;
-    A.insert(A.end(), ai.begin(), ai.end());
-    bcoeffs.push_back(eq->bi());
+    eq->ai(&coeffs_);
+    ET bi = eq->bi();
+    kkt_b_(bi.row()) += bi.value();
   }
-  ETV AT = transpose(A);
-  coeffs.insert(coeffs.end(), A.begin(), A.end());
-  coeffs.insert(coeffs.end(), AT.begin(), AT.end());
 
   // add G
-  ETV G;
   for (auto &ineq : ineq_con) {
-    ETV Gi = ineq->gradient();
-    G.insert(G.end(), Gi.begin(), Gi.end());
-    bcoeffs.push_back(ineq->slack());
-    bcoeffs.push_back(ineq->sports_util(nu(ineq->id)));
+    size_t begin = coeffs_.size();
+    ineq->gradient(&coeffs_);
+    size_t end = coeffs_.size();
+    for (size_t k = begin; k < end; k++) {
+      ET g = coeffs_[k];
+      coeffs_.push_back(ET(g.col(), g.row(), g.value()));  // G^T
+      kkt_b_(g.col()) += g.value() * ineq->var_u->val;     // G^T u
+    }
+    ET slack = ineq->slack();
+    kkt_b_(slack.row()) += slack.value();
+    ET suv = ineq->sports_util(nu(ineq->id));
+    kkt_b_(suv.row()) += suv.value();
     // S,I and Z
-    coeffs.push_back(
+    coeffs_.push_back(
         ET(ineq->var_s->id, ineq->var_u->id, ineq->var_s->val));  // S
-    coeffs.push_back(ET(ineq->var_u->id, ineq->var_s->id, 1.0));  // I
-    coeffs.push_back(
+    coeffs_.push_back(ET(ineq->var_u->id, ineq->var_s->id, 1.0));  // I
+    coeffs_.push_back(
         ET(ineq->var_s->id, ineq->var_s->id, ineq->var_u->val));  // Z
   }
-  ETV GT = transpose(G);
-  coeffs.insert(coeffs.end(), G.begin(), G.end());
-  coeffs.insert(coeffs.end(), GT.begin(), GT.end());
 
   // add Cost
-
-  // add to left hand side
-
-  ETV co = cost->hessian();
-  coeffs.insert(coeffs.end(), co.begin(), co.end());
-  ETV na = cost->gradient();
-  bcoeffs.insert(bcoeffs.end(), na.begin(), na.end());
-  // end Add Cost
+  cost->hessian(&coeffs_);
+  cost->gradient(&kkt_b_);
 
   // add tensor sum terms
-  for (auto &ineq : ineq_con) {
-    ETV coi = ineq->hessian();
-    ETV gu = ineq->gradientS();
+  for (auto &ineq : ineq_con) ineq->hessian(&coeffs_);
+  for (auto &eq : eq_con) eq->audio_video(&kkt_b_);
 
-    coeffs.insert(coeffs.end(), coi.begin(), coi.end());
-    bcoeffs.insert(bcoeffs.end(), gu.begin(), gu.end());
-  }
-  for (auto &eq : eq_con) {
-    ETV av = eq->audio_video();
-    bcoeffs.insert(bcoeffs.end(), av.begin(), av.end());
-  }
-
-  // pack non summands
-  M.setFromTriplets(coeffs.begin(), coeffs.end());
-  b.setFromTriplets(bcoeffs.begin(), bcoeffs.end());
-
-  // pass to backend
-
-  //    std::cout << "Frontend took " << tm.toc() << std::endl;
-  //    tm.tic();
+  // pack, analyzing the sparsity pattern only when it is new
+  if (kkt_pattern_.assemble(coeffs_, total_v, total_v, &kkt_))
+    kkt_solver_.analyzePattern(kkt_);
 
   // backend bottleneck
-  Eigen::SparseLU<SpMat> solver;
-  //    Eigen::SparseQR<SpMat,Eigen::COLAMDOrdering<int> > solver;
-  //    Eigen::PardisoLU<SpMat> solver;
-
-  //        std::cout << "M: " << M << std::endl;
-  //        std::cout << "b: " << b << std::endl;
-  //    draw_matrix(M);
-  solver.compute(M);
-  //    std::cout << "Back end took " << tm.toc() << std::endl;
+  //    draw_matrix(kkt_);
+  kkt_solver_.factorize(kkt_);
 
-  if (solver.info() != Eigen::Success) {
+  if (kkt_solver_.info() != Eigen::Success) {
     std::cout << "Back end failed" << std::endl;
-    //        std::cout << M << std::endl;
     return false;
   }
-  VecD delta_x = solver.solve(b);
+  VecD delta_x = kkt_solver_.solve(kkt_b_);
 
   //    VecD err = M*delta_x;
   //    err-=b;
@@ -315,10 +307,10 @@ bool NonlinearSolver::iterate() {
   // update b
   for (auto &ineq : ineq_con) {
     ET suv = ineq->sports_util(nu(ineq->id));
-    b.coeffRef(suv.row(), suv.col()) = suv.value();
+    kkt_b_(suv.row()) = suv.value();
   }
-  //     std::cout << "updated b: " << b << std::endl;
-  delta_x = solver.solve(b);
+  //     std::cout << "updated b: " << kkt_b_ << std::endl;
+  delta_x = kkt_solver_.solve(kkt_b_);
 
   // redo line search
   max_h = 1.0;
@@ -378,59 +370,45 @@ bool NonlinearSolver::iterate() {
   return (mu > epsilon_) && (max_h > 1e-15);
 }
 
-inline bool contains(const std::map<int, int> &map, int key) {
-  auto val = map.find(key);
-  return val != map.end();
-}
 bool NonlinearSolver::iterate_time(std::vector<Variable *> times) {
   decimal_t alpha = 10;  // richer, roy magic parameter maybe pass in
 
   // check input
   if (times.size() == 0) return true;
   uint num_t = times.size();
-  // get gradient + hession
-  ETV hess = cost->hessian();
-  ETV grad = cost->gradient();
-
-  ETV hess_time;
-  hess_time.reserve(hess.size());
-  ETV grad_time;
-  grad_time.reserve(grad.size());
 
   // get dimension reduced version
-  std::map<int, int> time_inds;
+  time_inds_.assign(vars.size(), -1);
   int i = 0;
-  for (auto &v : times) time_inds[v->id] = i++;
-
-  for (auto &triple : hess)
-    if (contains(time_inds, triple.row()) && contains(time_inds, triple.col()))
-      hess_time.push_back(
-          ET(time_inds[triple.row()], time_inds[triple.col()], triple.value()));
+  for (auto &v : times) time_inds_[v->id] = i++;
 
-  for (auto &triple : grad)
-    if (contains(time_inds, triple.row()))
-      grad_time.push_back(
-          ET(time_inds[triple.row()], triple.col(), triple.value()));
-
-  for (uint c = 0; c < num_t; c++) grad_time.push_back(ET(c, 0, alpha));
-
-  SpMat AE(num_t, num_t);
-  SpMat bE(num_t, 1);
-  AE.setFromTriplets(hess_time.begin(), hess_time.end());
-  bE.setFromTriplets(grad_time.begin(), grad_time.end());
+  // get gradient + hession
+  time_coeffs_.clear();
+  coeffs_.clear();
+  cost->hessian(&coeffs_);
+  for (auto &triple : coeffs_)
+    if (time_inds_[triple.row()] >= 0 && time_inds_[triple.col()] >= 0)
+      time_coeffs_.push_back(ET(time_inds_[triple.row()],
+                                time_inds_[triple.col()], triple.value()));
+  time_grad_.setZero(vars.size());
+  cost->gradient(&time_grad_);
+
+  VecD bE(num_t);
+  for (uint c = 0; c < num_t; c++) bE(c) = time_grad_(times[c]->id) + alpha;
 
   // solver and iterate
-  Eigen::SparseLU<SpMat> solver;
-  solver.compute(AE);
-  if (solver.info() != Eigen::Success) {
+  if (time_pattern_.assemble(time_coeffs_, num_t, num_t, &time_hess_))
+    time_solver_.analyzePattern(time_hess_);
+  time_solver_.factorize(time_hess_);
+  if (time_solver_.info() != Eigen::Success) {
     std::cout << "Time opt back end failed" << std::endl;
-    std::cout << "AE " << AE << std::endl;
-    std::cout << "bE " << bE << std::endl;
+    std::cout << "AE " << time_hess_ << std::endl;
+    std::cout << "bE " << bE.transpose() << std::endl;
     for (auto &t : times) std::cout << "time id " << t->id << std::endl;
 
     return false;
   }
-  VecD delta_x = solver.solve(bE);
+  VecD delta_x = time_solver_.solve(bE);
 
   decimal_t h = 1.0;
   // do line search
@@ -446,7 +424,7 @@ bool NonlinearSolver::iterate_time(std::vector<Variable *> times) {
 
   for (auto &eq : eq_con) {
     for (auto &v : eq->coeff) {
-      if (contains(time_inds, v.first->id)) {
+      if (time_inds_[v.first->id] >= 0) {
         ET diff = eq->bi();
         eq->rhs += diff.value();
       }
@@ -62,7 +62,8 @@ NonlinearTrajectory::NonlinearTrajectory(
     const std::vector<Waypoint> &waypoints,
     const std::vector<std::pair<MatD, VecD>> &cons, int deg, int min_dim,
     boost::shared_ptr<std::vector<decimal_t>> ds,
-    boost::shared_ptr<VecDVec> path, bool time_opt, decimal_t gap, int max_its)
+    boost::shared_ptr<VecDVec> path, bool time_opt, decimal_t gap, int max_its,
+    boost::shared_ptr<NonlinearTrajectory> warm)
     : seg_(cons.size()), deg_(deg), basis(PolyType::ENDPOINT, deg_, min_dim) {
   dim_ = waypoints.front().pos.rows();
   assert(dim_ == cons.front().first.cols());
@@ -78,6 +79,7 @@ NonlinearTrajectory::NonlinearTrajectory(
 
   // setup poly
   allocate_poly(ds, path);
+  if (warm != NULL) warm_start(*warm);
   // equality
   add_boundary(waypoints);
   link_sections();
@@ -159,6 +161,18 @@ void NonlinearTrajectory::allocate_poly(
       times.push_back(solver.addVar());
   }
 }
+bool NonlinearTrajectory::warm_start(const NonlinearTrajectory &previous) {
+  // In the endpoint basis the coefficients are the derivatives at the knots,
+  // which do not depend on the segment times, so they carry over to a plan
+  // with different times. The duals start afresh, the constraints differ.
+  if (previous.dim_ != dim_ || previous.seg_ != seg_ || previous.deg_ != deg_)
+    return false;
+  for (int d = 0; d < dim_; d++)
+    for (int j = 0; j < seg_; j++)
+      for (int k = 0; k <= deg_; k++)
+        traj.at(d).at(j).at(k)->val = previous.traj.at(d).at(j).at(k)->val;
+  return true;
+}
 void NonlinearTrajectory::allocate_beads() {
   beads.clear();
   for (int i = 0; i <= dim_; i++) {
@@ -251,8 +265,8 @@ class AxbConstraint : public IneqConstraint {
 
  private:
   decimal_t evaluate() { return poly.evaluate() - bi_; }
-  ETV gradient() { return poly.gradient(var_u->getId()); }
-  ETV hessian() { return poly.hessian(); }
+  void gradient(ETV *grad) { poly.gradient(var_u->getId(), grad); }
+  void hessian(ETV *hess) { poly.hessian(hess); }
 };
 // first need to create Axb class
 class BallConstraint : public IneqConstraint {
@@ -310,19 +324,13 @@ class BallConstraint : public IneqConstraint {
 
  private:
   decimal_t evaluate() { return poly.evaluate() + rhs; }
-  ETV gradient() {
-    ETV gradl = poly.gradient(var_u->getId());
-    ETV gradq = poly.quad_gradient(var_u->getId());
-
-    gradl.insert(gradl.end(), gradq.begin(), gradq.end());
-    return gradl;
+  void gradient(ETV *grad) {
+    poly.gradient(var_u->getId(), grad);
+    poly.quad_gradient(var_u->getId(), grad);
   }
-  ETV hessian() {
-    ETV hessl = poly.hessian();
-    ETV hessq = poly.quad_hessian();
-
-    hessl.insert(hessl.end(), hessq.begin(), hessq.end());
-    return hessl;
+  void hessian(ETV *hess) {
+    poly.hessian(hess);
+    poly.quad_hessian(hess);
   }
 };
 class PosTimeConstraint : public IneqConstraint {
@@ -331,11 +339,10 @@ class PosTimeConstraint : public IneqConstraint {
  public:
   explicit PosTimeConstraint(Variable *v) : v_(v) { vars.push_back(v); }
   decimal_t evaluate() { return -1.0 * v_->getVal(); }
-  ETV gradient() {
-    ET gt = ET(var_u->getId(), v_->getId(), -1.0);
-    return ETV(1, gt);
+  void gradient(ETV *grad) {
+    grad->push_back(ET(var_u->getId(), v_->getId(), -1.0));
   }
-  ETV hessian() { return ETV(); }
+  void hessian(ETV *hess) {}
 };
 class TimeBound : public IneqConstraint {
   decimal_t bound_;
@@ -351,15 +358,10 @@ class TimeBound : public IneqConstraint {
     for (auto &v : vars) val += v->getVal();
     return val;
   }
-  ETV gradient() {
-    ETV gs;
-    for (auto &v : vars) {
-      ET gt = ET(var_u->getId(), v->getId(), 1.0);
-      gs.push_back(gt);
-    }
-    return gs;
+  void gradient(ETV *grad) {
+    for (auto &v : vars) grad->push_back(ET(var_u->getId(), v->getId(), 1.0));
   }
-  ETV hessian() { return ETV(); }
+  void hessian(ETV *hess) {}
 };
 
 void NonlinearTrajectory::addPosTime() {
@@ -495,8 +497,8 @@ PolyCost::PolyCost(const NLTraj &traj, const NLTimes &times,
   //    std::cout << "Cost " << poly << std::endl;
 }
 decimal_t PolyCost::evaluate() { return poly.evaluate(); }
-ETV PolyCost::gradient() { return poly.quad_gradient(); }
-ETV PolyCost::hessian() { return poly.quad_hessian(); }
+void PolyCost::gradient(VecD *grad) { poly.quad_gradient(grad); }
+void PolyCost::hessian(ETV *hess) { poly.quad_hessian(hess); }
 
 void NonlinearTrajectory::addCloudConstraint(const Vec3Vec &points) {
   for (int j = 0; j < seg_; j++) {
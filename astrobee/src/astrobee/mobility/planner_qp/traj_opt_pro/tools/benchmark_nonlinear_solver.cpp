@@ -0,0 +1,185 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Time the nonlinear trajectory solver on corridors through the ISS
+// modules, set up the way planner_qp sets up its problems: polytopes
+// as Ax <= b per segment, a full stop at both ends and segment times
+// proportional to the length of the path.
+//
+// Usage: benchmark_nonlinear_solver [repeats]
+
+#include <traj_opt_pro/nonlinear_trajectory.h>
+#include <traj_opt_pro/timers.h>
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Box {
+  traj_opt::Vec3 min, max;
+};
+
+struct Route {
+  std::string name;
+  traj_opt::Vec3 start, goal;
+  std::vector<Box> boxes;  // consecutive boxes overlap
+};
+
+Box MakeBox(double x0, double y0, double z0, double x1, double y1, double z1) {
+  Box box;
+  box.min << x0, y0, z0;
+  box.max << x1, y1, z1;
+  return box;
+}
+
+// Free space in the modules, already shrunk by the robot radius
+std::vector<Route> Routes() {
+  Box lab = MakeBox(-0.5, -0.5, 4.4, 6.5, 0.5, 5.2);
+  Box hatch = MakeBox(5.8, -0.35, 4.5, 8.0, 0.35, 5.1);
+  Box node2 = MakeBox(7.5, -0.8, 4.2, 11.3, 0.8, 5.6);
+  Box jem_hatch = MakeBox(10.6, 0.6, 4.4, 11.2, 2.6, 5.2);
+  Box jem = MakeBox(10.2, 2.3, 4.2, 11.6, 6.9, 5.5);
+  Box col_hatch = MakeBox(10.6, -2.6, 4.4, 11.2, -0.6, 5.2);
+  Box col = MakeBox(10.2, -8.9, 4.2, 11.6, -2.3, 5.5);
+
+  std::vector<Route> routes(5);
+  routes[0].name = "us_lab";
+  routes[0].start << 0.0, 0.0, 4.8;
+  routes[0].goal << 6.0, 0.3, 5.0;
+  routes[0].boxes = {lab};
+  routes[1].name = "us_lab_to_node2";
+  routes[1].start << 0.0, 0.0, 4.8;
+  routes[1].goal << 11.0, 0.0, 4.8;
+  routes[1].boxes = {lab, hatch, node2};
+  routes[2].name = "node2_to_jem";
+  routes[2].start << 10.9, 0.0, 4.8;
+  routes[2].goal << 10.9, 6.0, 4.8;
+  routes[2].boxes = {node2, jem_hatch, jem};
+  routes[3].name = "us_lab_to_jem";
+  routes[3].start << 1.0, 0.0, 4.8;
+  routes[3].goal << 10.9, 6.0, 4.8;
+  routes[3].boxes = {lab, hatch, node2, jem_hatch, jem};
+  routes[4].name = "jem_to_columbus";
+  routes[4].start << 10.9, 6.0, 4.8;
+  routes[4].goal << 10.9, -8.0, 4.8;
+  routes[4].boxes = {jem, jem_hatch, node2, col_hatch, col};
+  return routes;
+}
+
+// The problem planner_qp would pose for a route
+struct Problem {
+  std::vector<traj_opt::Waypoint> waypoints;
+  std::vector<std::pair<traj_opt::MatD, traj_opt::VecD> > cons;
+  boost::shared_ptr<std::vector<traj_opt::decimal_t> > ds;
+};
+
+Problem MakeProblem(Route const& route) {
+  Problem problem;
+  traj_opt::Waypoint start, goal;
+  start.pos.head<3>() = route.start;
+  goal.pos.head<3>() = route.goal;
+  start.use_pos = start.use_vel = start.use_acc = start.use_jrk = true;
+  goal.use_pos = goal.use_vel = goal.use_acc = goal.use_jrk = true;
+  start.knot_id = 0;
+  goal.knot_id = -1;
+  problem.waypoints = {start, goal};
+
+  // Path through the middle of the overlaps of consecutive boxes
+  std::vector<traj_opt::Vec3> path(1, route.start);
+  for (size_t i = 0; i + 1 < route.boxes.size(); i++) {
+    traj_opt::Vec3 lo = route.boxes[i].min.cwiseMax(route.boxes[i + 1].min);
+    traj_opt::Vec3 hi = route.boxes[i].max.cwiseMin(route.boxes[i + 1].max);
+    path.push_back(0.5 * (lo + hi));
+  }
+  path.push_back(route.goal);
+
+  problem.ds = boost::make_shared<std::vector<traj_opt::decimal_t> >();
+  for (size_t i = 0; i < route.boxes.size(); i++) {
+    Box const& box = route.boxes[i];
+    traj_opt::MatD A = traj_opt::MatD::Zero(6, 4);
+    traj_opt::VecD b(6);
+    for (int d = 0; d < 3; d++) {
+      A(2 * d, d) = 1.0;
+      b(2 * d) = box.max(d);
+      A(2 * d + 1, d) = -1.0;
+      b(2 * d + 1) = -box.min(d);
+    }
+    problem.cons.push_back(std::make_pair(A, b));
+    problem.ds->push_back((path[i + 1] - path[i]).norm());
+  }
+  return problem;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int repeats = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 10;
+  // Same as the defaults of planner_qp
+  traj_opt::decimal_t gap = 1e-14;
+  int max_iterations = 1000;
+
+  // The solver reports on std::cout, which we silence while timing
+  std::stringstream sink;
+  std::streambuf* out = std::cout.rdbuf();
+
+  printf("%-18s %4s %6s %10s %10s %6s %10s %10s\n", "route", "segs", "its", "ms/solve", "min ms",
+         "warm", "warm ms", "solved");
+  for (Route const& route : Routes()) {
+    Problem problem = MakeProblem(route);
+    double total = 0.0, best = 1e9, warm_total = 0.0;
+    int its = 0, warm_its = 0;
+    bool solved = true;
+    for (int r = 0; r < repeats; r++) {
+      std::cout.rdbuf(sink.rdbuf());
+      traj_opt::Timer timer;
+      boost::shared_ptr<traj_opt::NonlinearTrajectory> cold =
+        boost::make_shared<traj_opt::NonlinearTrajectory>(
+          problem.waypoints, problem.cons, 7, 3, problem.ds, boost::shared_ptr<traj_opt::VecDVec>(), false,
+          gap, max_iterations);
+      double dt = timer.toc();
+      // Replanning the same route, starting from the previous solution
+      timer.tic();
+      boost::shared_ptr<traj_opt::NonlinearTrajectory> warm =
+        boost::make_shared<traj_opt::NonlinearTrajectory>(
+          problem.waypoints, problem.cons, 7, 3, problem.ds, boost::shared_ptr<traj_opt::VecDVec>(), false,
+          gap, max_iterations, cold);
+      warm_total += timer.toc();
+      std::cout.rdbuf(out);
+      sink.str(std::string());
+
+      total += dt;
+      best = std::min(best, dt);
+      its = cold->getInfo().iterations;
+      warm_its = warm->getInfo().iterations;
+      solved = solved && cold->isSolved() && warm->isSolved();
+    }
+    printf("%-18s %4zu %6d %10.2f %10.2f %6d %10.2f %10s\n", route.name.c_str(), route.boxes.size(), its,
+           1000.0 * total / repeats, 1000.0 * best, warm_its, 1000.0 * warm_total / repeats,
+           solved ? "yes" : "no");
+  }
+  return 0;
+}
@@ -20,10 +20,18 @@
 #define FF_COMMON_THREAD_H_
 
 #include <gflags/gflags.h>
-#include <pthread.h>
 
-#include <list>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 DECLARE_int32(num_threads);
 
@@ -34,13 +42,16 @@ GOOGLE_ALLOW_RVALUE_REFERENCES_PUSH
 
 namespace ff_common {
 
-  void* HolderFunction(void* ptr);
-
+  // A fixed set of worker threads, created once and kept until the pool
+  // is destroyed. Each worker has its own queue of tasks. A worker runs
+  // the newest task of its own queue first, and when that is empty it
+  // steals the oldest task from another queue. Tasks added from inside a
+  // task go to the queue of the worker running it.
   class ThreadPool {
    public:
-    typedef std::tuple<std::function<void(void)>, pthread_mutex_t*, pthread_cond_t*, bool> VarsTuple;
-
+    // Use FLAGS_num_threads workers
     ThreadPool();
+    explicit ThreadPool(int num_threads);
     ~ThreadPool();
     // The following identifies this thread as non copyable and non
     // moveable. Our threads are holding pointers to this exact
@@ -48,9 +59,10 @@ namespace ff_common {
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
 
+    int NumThreads() const {return threads_.size();}
+
     // This pushes back a function and it's arguments to be
-    // executed. This method will block if the number of threads is
-    // already maxed. You can also push back mixed types of functions.
+    // executed. You can also push back mixed types of functions.
     //
     // Example:
     // void Monkey(std::vector const& input, int val, std::vector * output);
@@ -61,28 +73,62 @@ namespace ff_common {
     // will be copied. Other alternatives are to use a pointer.
     template <typename Function, typename... Args>
     void AddTask(Function&& f, Args&&... args) {
-      WaitTillJobOpening();
-
-      // Bind up the function the user has given us
-      var_bindings_.emplace_back(std::bind(f, args...),
-                                 &cond_mutex_,
-                                 &cond_, false);
+      Push(std::bind(f, args...));
+    }
 
-      // Create the thread and start doing work
-      threads_.push_back(pthread_t());
-      pthread_create(&threads_.back(), NULL, HolderFunction, &var_bindings_.back());
+    // Same as AddTask, but returns a future for the result of the function
+    template <typename Function, typename... Args>
+    std::future<typename std::result_of<Function(Args...)>::type>
+    Submit(Function&& f, Args&&... args) {
+      typedef typename std::result_of<Function(Args...)>::type Result;
+      std::shared_ptr<std::packaged_task<Result()> > task =
+        std::make_shared<std::packaged_task<Result()> >(std::bind(f, args...));
+      Push([task]() {(*task)();});
+      return task->get_future();
     }
 
+    // Call body(chunk_begin, chunk_end) on consecutive chunks of
+    // [begin, end) of at most grain_size elements, and return when all
+    // are done. The calling thread processes chunks too.
+    void ParallelFor(size_t begin, size_t end, size_t grain_size,
+                     std::function<void(size_t, size_t)> const& body);
+
+    // Wait for all the tasks added so far. The calling thread runs
+    // queued tasks while it waits. Called from a task, Join only waits
+    // for the tasks added by that task, and the ones they added in turn.
     void Join();
 
    private:
-    void WaitTillJobOpening();
-
-    size_t max_concurrent_jobs_;
-    std::list<pthread_t> threads_;
-    std::list<VarsTuple> var_bindings_;
-    pthread_mutex_t cond_mutex_;
-    pthread_cond_t cond_;
+    // A task is done once it has run and all the tasks it added are
+    // done. pending counts the task itself, until it has run, and each
+    // of the tasks it added which is not done.
+    struct TaskNode {
+      std::shared_ptr<TaskNode> parent;
+      std::atomic<size_t> pending;
+      TaskNode() : pending(1) {}
+    };
+    struct Task {
+      std::function<void(void)> function;
+      std::shared_ptr<TaskNode> node;
+    };
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    void Push(std::function<void(void)> && function);
+    bool RunOneTask(int worker);
+    void Finish(TaskNode * node);
+    void Work(int worker);
+
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cond_work_, cond_idle_;
+    std::atomic<size_t> num_queued_;   // tasks waiting in the queues
+    std::atomic<size_t> num_pending_;  // tasks queued or running
+    std::atomic<size_t> next_queue_;
+    bool stop_;
   };
 
 }  // namespace ff_common
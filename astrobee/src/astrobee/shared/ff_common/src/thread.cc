@@ -21,80 +21,195 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
-#include <sys/time.h>
+#include <algorithm>
+#include <chrono>
 #include <thread>
+#include <utility>
 
 DEFINE_int32(num_threads, (std::thread::hardware_concurrency() == 0 ? 2 : std::thread::hardware_concurrency()),
              "Number of threads to use for processing.");
 
-void* ff_common::HolderFunction(void* ptr) {
-  ff_common::ThreadPool::VarsTuple* vars = reinterpret_cast<ff_common::ThreadPool::VarsTuple*>(ptr);
-
-  // Run the function
-  std::get<0>(*vars)();
-
-  // Set out boolean so someone can know they can delete this
-  std::get<3>(*vars) = true;
-
-  // Signal that we are finished
-  pthread_mutex_lock(std::get<1>(*vars));
-  pthread_cond_signal(std::get<2>(*vars));
-  pthread_mutex_unlock(std::get<1>(*vars));
-
-  return NULL;
+namespace {
+  // The pool and the queue of the worker running on this thread, if any
+  thread_local ff_common::ThreadPool const* current_pool = NULL;
+  thread_local int current_worker = -1;
+  // The pool and the node of the innermost task running on this thread, if any
+  thread_local ff_common::ThreadPool const* current_task_pool = NULL;
+  thread_local std::shared_ptr<void> current_task_node;
 }
 
 ff_common::ThreadPool::ThreadPool()
-  : max_concurrent_jobs_(FLAGS_num_threads) {
-  pthread_mutex_init(&cond_mutex_, NULL);
-  pthread_cond_init(&cond_, NULL);
-  if (max_concurrent_jobs_ <= 0) {
+  : ThreadPool(FLAGS_num_threads) {}
+
+ff_common::ThreadPool::ThreadPool(int num_threads)
+  : num_queued_(0), num_pending_(0), next_queue_(0), stop_(false) {
+  if (num_threads <= 0) {
     LOG(ERROR) << "Thread pool without threads created...";
   }
+  // At least one queue, so that tasks can be added. Without workers
+  // they are run by Join().
+  for (int i = 0; i < std::max(num_threads, 1); i++)
+    queues_.emplace_back(new Queue);
+  for (int i = 0; i < num_threads; i++)
+    threads_.emplace_back(&ThreadPool::Work, this, i);
 }
 
 ff_common::ThreadPool::~ThreadPool() {
   Join();
-  pthread_cond_destroy(&cond_);
-  pthread_mutex_destroy(&cond_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_work_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+}
+
+void ff_common::ThreadPool::Push(std::function<void(void)> && function) {
+  // Tasks added by a worker stay on its queue, others are spread out
+  size_t queue = (current_pool == this) ? current_worker : next_queue_++ % queues_.size();
+  Task task;
+  task.function = std::move(function);
+  task.node = std::make_shared<TaskNode>();
+  // A task added by a task of this pool is part of it
+  if (current_task_pool == this) {
+    task.node->parent = std::static_pointer_cast<TaskNode>(current_task_node);
+    task.node->parent->pending++;
+  }
+  num_pending_++;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_queued_++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+    queues_[queue]->tasks.push_back(std::move(task));
+  }
+  cond_work_.notify_one();
+}
+
+bool ff_common::ThreadPool::RunOneTask(int worker) {
+  Task task;
+  // The newest task of our own queue, then the oldest of the others
+  if (worker >= 0) {
+    Queue & queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+  for (size_t i = 1; !task.function && i <= queues_.size(); i++) {
+    Queue & queue = *queues_[(worker + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+  if (!task.function)
+    return false;
+  num_queued_--;
+
+  ThreadPool const* previous_task_pool = current_task_pool;
+  std::shared_ptr<void> previous_task_node = std::move(current_task_node);
+  current_task_pool = this;
+  current_task_node = task.node;
+  task.function();
+  current_task_pool = previous_task_pool;
+  current_task_node = std::move(previous_task_node);
+
+  Finish(task.node.get());
+  if (--num_pending_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cond_idle_.notify_all();
+  }
+  return true;
+}
+
+// The task of node has run. Once all it added are done too, it is done
+// and counts no more as pending for the task which added it.
+void ff_common::ThreadPool::Finish(TaskNode * node) {
+  if (--node->pending > 0)
+    return;
+  for (TaskNode * parent = node->parent.get(); parent; parent = parent->parent.get()) {
+    size_t pending = --parent->pending;
+    // Only the parent itself may be left, possibly waiting in Join
+    if (pending == 1) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cond_idle_.notify_all();
+    }
+    if (pending > 0)
+      return;
+  }
+}
+
+void ff_common::ThreadPool::Work(int worker) {
+  current_pool = this;
+  current_worker = worker;
+  while (true) {
+    if (RunOneTask(worker))
+      continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_work_.wait(lock, [this] {return stop_ || num_queued_ > 0;});
+    if (stop_)
+      return;
+  }
 }
 
 void ff_common::ThreadPool::Join() {
-  while (threads_.size()) {
-    pthread_join(threads_.front(), NULL);
-    threads_.pop_front();
-    var_bindings_.pop_front();
+  int worker = (current_pool == this) ? current_worker : -1;
+  // Called from a task, wait until only that task itself is pending
+  // in its node, otherwise until no task is pending at all
+  std::shared_ptr<TaskNode> task;
+  if (current_task_pool == this)
+    task = std::static_pointer_cast<TaskNode>(current_task_node);
+  auto done = [this, &task] {return task ? task->pending == 1 : num_pending_ == 0;};
+  while (!done()) {
+    if (RunOneTask(worker))
+      continue;
+    // The remaining tasks are running. Wake up when they finish, or
+    // when one of them adds another task.
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_idle_.wait_for(lock, std::chrono::milliseconds(10),
+                        [this, &done] {return done() || num_queued_ > 0;});
   }
 }
 
-void ff_common::ThreadPool::WaitTillJobOpening() {
-  while (threads_.size() >= max_concurrent_jobs_) {
-    // Wait for a condition event to signal a free job or time out
-    // after one second. I do a time out because somehow I still have
-    // a deadlock. I think it occurs if a task just finishes faster
-    // than we can get back into a state to wait for condition.
-    pthread_mutex_lock(&cond_mutex_);
-    struct timeval tv;
-    struct timespec ts;
-    gettimeofday(&tv, NULL);
-    ts.tv_sec = tv.tv_sec + 1;
-    ts.tv_nsec = 0;
-    pthread_cond_timedwait(&cond_, &cond_mutex_, &ts);
-    pthread_mutex_unlock(&cond_mutex_);
-
-    // Iterate through and clean out all the finished jobs
-    std::list<pthread_t>::iterator thread_it = threads_.begin();
-    std::list<VarsTuple>::iterator vars_it = var_bindings_.begin();
-    while (thread_it != threads_.end()) {
-      if (std::get<3>(*vars_it)) {
-        // Thread says it has finished. Join.
-        pthread_join(*thread_it, NULL);
-        thread_it = threads_.erase(thread_it);
-        vars_it = var_bindings_.erase(vars_it);
-      } else {
-        thread_it++;
-        vars_it++;
+void ff_common::ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain_size,
+                                        std::function<void(size_t, size_t)> const& body) {
+  if (end <= begin)
+    return;
+  grain_size = std::max(grain_size, static_cast<size_t>(1));
+  const size_t num_chunks = (end - begin + grain_size - 1) / grain_size;
+
+  // Chunks are claimed from a shared counter, by the calling thread and
+  // by as many helper tasks as can usefully run. The state is shared, as
+  // a helper may only start after all the chunks are done.
+  struct State {
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> num_done{0};
+    std::mutex mutex;
+    std::condition_variable cond_done;
+  };
+  std::shared_ptr<State> state = std::make_shared<State>();
+  auto run_chunks = [state, begin, end, grain_size, num_chunks, &body]() {
+    for (size_t chunk = state->next_chunk++; chunk < num_chunks; chunk = state->next_chunk++) {
+      size_t chunk_begin = begin + chunk * grain_size;
+      body(chunk_begin, std::min(chunk_begin + grain_size, end));
+      if (++state->num_done == num_chunks) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cond_done.notify_all();
       }
     }
-  }
+  };
+
+  size_t num_helpers = std::min(num_chunks - 1, threads_.size());
+  for (size_t i = 0; i < num_helpers; i++)
+    Push(run_chunks);
+  run_chunks();
+
+  // Chunks claimed by the helpers may still be running
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cond_done.wait(lock, [&state, num_chunks] {return state->num_done == num_chunks;});
 }
@@ -24,6 +24,8 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <future>
 #include <vector>
 
 void Simple(int a, int b) {
@@ -75,6 +77,134 @@ TEST(thread, thread_pool) {
   EXPECT_EQ(4u, vec.size());
 }
 
+int Square(int a) {
+  return a * a;
+}
+
+TEST(thread, thread_pool_futures) {
+  ff_common::ThreadPool pool(3);
+  std::vector<std::future<int> > squares;
+  for (int i = 0; i < 100; i++)
+    squares.push_back(pool.Submit(Square, i));
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(i * i, squares[i].get());
+}
+
+TEST(thread, thread_pool_nested_tasks) {
+  // Tasks adding tasks to the same pool are all done by Join()
+  ff_common::ThreadPool pool(2);
+  std::atomic<int> count(0);
+  for (int i = 0; i < 10; i++) {
+    pool.AddTask([&pool, &count]() {
+      for (int j = 0; j < 10; j++)
+        pool.AddTask([&count]() {count++;});
+    });
+  }
+  pool.Join();
+  EXPECT_EQ(100, count);
+}
+
+TEST(thread, thread_pool_join_from_task) {
+  // Join from a task waits for the tasks it added, but not for itself
+  ff_common::ThreadPool pool(2);
+  std::vector<std::atomic<int> > counts(4);
+  std::vector<int> counts_after_join(4, 0);
+  for (int i = 0; i < 4; i++) {
+    counts[i] = 0;
+    pool.AddTask([&pool, &counts, &counts_after_join, i]() {
+      for (int j = 0; j < 10; j++)
+        pool.AddTask([&counts, i]() {counts[i]++;});
+      pool.Join();
+      counts_after_join[i] = counts[i];
+    });
+  }
+  pool.Join();
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(10, counts[i]);
+    EXPECT_EQ(10, counts_after_join[i]);
+  }
+}
+
+// A task adding a task which joins its own subtasks, then joining it
+static void JoinNestedTasks(ff_common::ThreadPool * pool) {
+  std::atomic<int> count(0);
+  std::atomic<bool> inner_done(false), outer_done(false);
+  pool->AddTask([pool, &count, &inner_done, &outer_done]() {
+    pool->AddTask([pool, &count, &inner_done]() {
+      for (int j = 0; j < 10; j++)
+        pool->AddTask([&count]() {count++;});
+      pool->Join();
+      EXPECT_EQ(10, count);
+      count++;
+      inner_done = true;
+    });
+    pool->Join();
+    EXPECT_TRUE(inner_done);
+    EXPECT_EQ(11, count);
+    outer_done = true;
+  });
+  pool->Join();
+  // Nothing is left running with references to this frame
+  EXPECT_TRUE(outer_done);
+  EXPECT_EQ(11, count);
+}
+
+TEST(thread, thread_pool_join_from_nested_task) {
+  ff_common::ThreadPool pool(2);
+  JoinNestedTasks(&pool);
+
+  // Also without workers, where Join runs all the tasks
+  ff_common::ThreadPool serial_pool(0);
+  JoinNestedTasks(&serial_pool);
+}
+
+TEST(thread, thread_pool_join_from_nested_task_stress) {
+  // Races between the nested Joins only show up now and then, more
+  // so with more tasks than cores
+  for (int num_threads : {1, 2, 3, 8}) {
+    ff_common::ThreadPool pool(num_threads);
+    for (int i = 0; i < 200; i++)
+      JoinNestedTasks(&pool);
+
+    // Several nested groups at once, joined from outside
+    std::atomic<int> count(0);
+    for (int i = 0; i < 8; i++) {
+      pool.AddTask([&pool, &count]() {
+        for (int j = 0; j < 4; j++) {
+          pool.AddTask([&pool, &count]() {
+            for (int k = 0; k < 4; k++)
+              pool.AddTask([&count]() {count++;});
+            pool.Join();
+          });
+        }
+        pool.Join();
+      });
+    }
+    pool.Join();
+    EXPECT_EQ(8 * 4 * 4, count);
+  }
+}
+
+TEST(thread, thread_pool_parallel_for) {
+  ff_common::ThreadPool pool(3);
+  for (size_t grain_size : {1, 7, 1000}) {
+    std::vector<int> visits(1000, 0);
+    std::atomic<int> num_chunks(0);
+    pool.ParallelFor(0, visits.size(), grain_size, [&](size_t begin, size_t end) {
+      EXPECT_LE(end - begin, grain_size);
+      num_chunks++;
+      for (size_t i = begin; i < end; i++)
+        visits[i]++;
+    });
+    for (size_t i = 0; i < visits.size(); i++)
+      EXPECT_EQ(1, visits[i]);
+    EXPECT_EQ(static_cast<int>((visits.size() + grain_size - 1) / grain_size), num_chunks);
+  }
+
+  // Nothing to do
+  pool.ParallelFor(5, 5, 1, [](size_t, size_t) {ADD_FAILURE();});
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
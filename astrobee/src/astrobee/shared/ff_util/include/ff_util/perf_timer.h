@@ -1,14 +1,14 @@
 /* Copyright (c) 2017, United States Government, as represented by the
  * Administrator of the National Aeronautics and Space Administration.
- * 
+ *
  * All rights reserved.
- * 
+ *
  * The Astrobee platform is licensed under the Apache License, Version 2.0
  * (the "License"); you may not use this file except in compliance with the
  * License. You may obtain a copy of the License at
- * 
+ *
  *     http://www.apache.org/licenses/LICENSE-2.0
- * 
+ *
  * Unless required by applicable law or agreed to in writing, software
  * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
  * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
@@ -21,61 +21,127 @@
 
 #include <ros/ros.h>
 
+#include <ff_msgs/LatencyReport.h>
 #include <ff_msgs/Performance.h>
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace ff_util {
 
-class PerfTimer {
+// Counts of a latency histogram, taken over one reporting window
+struct LatencySnapshot {
+  std::vector<uint64_t> counts;  // per bucket
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  uint64_t min_ns = 0;
+  uint64_t max_ns = 0;
+  uint64_t last_ns = 0;  // the latest measurement, even from an earlier window
+
+  // Latency in seconds below which the fraction p of the measurements
+  // lie, or 0 if there are none
+  double Percentile(double p) const;
+  double Mean() const;
+  // Variance in seconds squared, taking each measurement at the middle
+  // of its bucket
+  double Variance() const;
+};
+
+// Log-linear latency histogram, in the manner of HdrHistogram. Each
+// power of two of nanoseconds is split in kSubBuckets linear buckets,
+// so a bucket is never wider than 1/kSubBuckets of its value, up to
+// about 4 seconds. Recording is a handful of relaxed atomic operations
+// on counters of the recording thread's shard, so threads which time
+// the same code do not contend on the same cache lines.
+class LatencyHistogram {
  public:
-  void Initialize(std::string const& name) {
-    ros::NodeHandle nh("/performance");
-    pub_ = nh.advertise<ff_msgs::Performance>(name, 5);
-    init_ = true;
-  }
-  void Clear() {
-    if (!init_) return;
-    msg_.count = msg_.mean = msg_.var = msg_.stddev = 0.0;
-    msg_.last = msg_.max = msg_.min = -1.0;
-  }
-  void Tick() {
-    if (!init_) return;
-    start_ = std::chrono::system_clock::now();
-  }
-  void Tock() {
-    if (!init_) return;
-    std::chrono::time_point<std::chrono::system_clock> end;
-    end = std::chrono::system_clock::now();
-    std::chrono::duration<double> dt = end - start_;
-    // Add the measurement and the count
-    msg_.stamp = ros::Time::now();
-    msg_.count += 1.0;
-    msg_.last = dt.count();
-    if (msg_.last > msg_.max || msg_.min < 0.0) msg_.max = msg_.last;
-    if (msg_.last < msg_.min || msg_.min < 0.0) msg_.min = msg_.last;
-    if (msg_.count > 1) {
-      // See: http://math.stackexchange.com/questions/102978/incremental-computation-of-standard-deviation
-      msg_.var = (msg_.count - 2.0) / (msg_.count - 1.0) * msg_.var
-               + (msg_.last - msg_.mean) * (msg_.last - msg_.mean) / msg_.count;
-      msg_.mean = ((msg_.count - 1.0) * msg_.mean + msg_.last) / msg_.count;
-    } else {
-      msg_.mean = msg_.last;
-      msg_.var = 0;
-    }
-    msg_.stddev = sqrt(msg_.var);
-  }
-  void Send() {
-    if (!init_) return;
-    pub_.publish(msg_);
+  enum {
+    kSubBucketBits = 5,
+    kSubBuckets = 1 << kSubBucketBits,
+    kMaxBits = 32,
+    kNumBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets,
+    kNumShards = 4
+  };
+
+  LatencyHistogram();
+
+  // Record one measurement. Lock-free and safe from any thread.
+  void Record(std::chrono::nanoseconds latency);
+
+  // Move the counts since the previous call into snapshot, which starts
+  // the next window. The counters are moved one at a time, so a
+  // measurement recorded meanwhile may have its bucket counted in one
+  // window and its total in the next; the windows add up all the same.
+  void TakeSnapshot(LatencySnapshot * snapshot);
+
+  // Bucket of a latency in nanoseconds, and the largest latency which
+  // falls in a bucket
+  static int BucketIndex(uint64_t ns);
+  static uint64_t BucketUpperBound(int index);
+
+ private:
+  struct Shard {
+    std::array<std::atomic<uint64_t>, kNumBuckets> counts;
+    std::atomic<uint64_t> count, sum_ns, min_ns, max_ns;
+    char padding[64];  // keeps the totals of neighboring shards apart
+  };
+  static int ShardIndex();
+
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<uint64_t> last_ns_;
+};
+
+// Times the scope it lives in with the monotonic clock, recording the
+// duration when it goes out of scope.
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(LatencyHistogram * histogram)
+    : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedLatencyTimer() {
+    if (histogram_)
+      histogram_->Record(std::chrono::steady_clock::now() - start_);
   }
 
  private:
-  std::chrono::time_point<std::chrono::system_clock> start_;
-  ff_msgs::Performance msg_;
-  ros::Publisher pub_;
-  bool init_;
+  LatencyHistogram * histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Owns the latency histograms of one nodelet and publishes all of them
+// in one ff_msgs::LatencyReport on /performance/<name>/latency,
+// periodically. The first timer added is also published as an
+// ff_msgs::Performance on /performance/<name>, with its statistics since
+// initialization, as PerfTimer used to. Timers are added at
+// initialization; the histograms they return stay valid for the
+// lifetime of the reporter.
+class PerfReporter {
+ public:
+  void Initialize(ros::NodeHandle * nh, std::string const& name, double rate = 1.0);
+
+  // Add a timed section, or return the existing one with this name
+  LatencyHistogram * AddTimer(std::string const& name);
+
+  // Publish the statistics since the previous report, and reset them
+  void Send();
+
+ private:
+  void AccumulatePerformance();
+
+  std::mutex mutex_;
+  std::vector<std::string> names_;
+  std::vector<std::unique_ptr<LatencyHistogram>> histograms_;
+  ros::Publisher pub_, perf_pub_;
+  ff_msgs::Performance perf_;  // of the first timer, since initialization
+  double perf_m2_ = 0.0;       // sum of squared deviations from the mean
+  ros::Timer timer_;
+  ros::Time last_report_;
+  LatencySnapshot snapshot_;
 };
 
 }  // namespace ff_util
@@ -23,6 +23,7 @@
 #include <msg_conversions/msg_conversions.h>
 
 // STL includes
+#include <cmath>
 #include <fstream>
 #include <string>
 
@@ -316,7 +317,26 @@ namespace ff_util {
     return SUCCESS;
   }
 
-  // Resample a segment to a minimum control rate
+  // Fill a setpoint from the state of a constant acceleration piece
+  static void SetSetpoint(double t, Eigen::Quaterniond const& q,
+    Eigen::Vector3d const& p, Eigen::Vector3d const& w,
+    Eigen::Vector3d const& v, Eigen::Vector3d const& b,
+    Eigen::Vector3d const& a, Setpoint & sp) {
+    sp.when = ros::Time(t);
+    sp.pose.orientation = msg_conversions::eigen_to_ros_quat(q);
+    sp.pose.position = msg_conversions::eigen_to_ros_point(p);
+    sp.twist.angular = msg_conversions::eigen_to_ros_vector(w);
+    sp.twist.linear = msg_conversions::eigen_to_ros_vector(v);
+    sp.accel.angular = msg_conversions::eigen_to_ros_vector(b);
+    sp.accel.linear = msg_conversions::eigen_to_ros_vector(a);
+  }
+
+  // Resample a segment to a minimum control rate. Between two setpoints
+  // the linear and angular accelerations of the first are held, as
+  // the trapezoidal planner emits them, so the position and velocity
+  // have a closed form. So does the attitude when the angular velocity
+  // keeps its axis, which is also what the trapezoidal planner emits;
+  // otherwise the attitude is integrated numerically at 100Hz.
   SegmentResult FlightUtil::Resample(Segment const& in, Segment & out,
     double rate) {
     // Check that we have enough setpoints
@@ -327,112 +347,70 @@ namespace ff_util {
     // If the rate was not specified, try and get it from the general config
     if (rate < MIN_CONTROL_RATE)
       rate = MIN_CONTROL_RATE;
-    // Clear the output
+    double tsamp = 1.0 / rate;    // Trajectory sampling period
+    double nsamp = 0.01;          // Numerical sampling period, 100Hz
+    // Count the output setpoints, so that the output is allocated once,
+    // or not at all if it is reused and large enough already. Every
+    // piece contributes its start setpoint, and its samples up to and
+    // including its end.
+    size_t num = 1;
+    for (size_t i = 0; i + 1 < in.size(); i++) {
+      double duration = (in[i + 1].when - in[i].when).toSec();
+      num += 1;
+      if (duration > 0.0)
+        num += static_cast<size_t>(std::ceil(duration / tsamp));
+    }
     out.clear();
-    // Perform the resample of the segment - we are expecting as an input the
-    // four points of trapezoid. What we want as an output is the segment
-    Segment::const_iterator it;
-    Segment::const_iterator jt;
-    // ROS_INFO_STREAM("***");
-    for (Segment::const_iterator it = in.begin(); it != in.end(); it++) {
-      // Convert the angular velocity and angular acceleration from the
-      // world to the body frame, avoiding a GDS / FSW incompatibility
-      State is(*it);
-      // Do we have an end setpoint?
-      jt = std::next(it);
-      if (jt == in.end()) {
-        out.push_back(is.ToSetpoint());
-      } else {
-        // State at start end of setpoint (we just need the timestamp)
-        State js(*jt);
-        // Debug for clarity
-        /*
-        ROS_INFO_STREAM("---");
-        ROS_INFO_STREAM("PREV: "
-                          << " t: "  << is.t
-                          << " qw: " << is.q.w()
-                          << " qx: " << is.q.x()
-                          << " qy: " << is.q.y()
-                          << " qz: " << is.q.z()
-                          << " wx: " << is.w[0]
-                          << " wy: " << is.w[1]
-                          << " wz: " << is.w[2]
-                          << " bx: " << is.b[0]
-                          << " by: " << is.b[1]
-                          << " bz: " << is.b[2]);
-        ROS_INFO_STREAM("NEXT: "
-                          << " t: "  << js.t
-                          << " qw: " << js.q.w()
-                          << " qx: " << js.q.x()
-                          << " qy: " << js.q.y()
-                          << " qz: " << js.q.z()
-                          << " wx: " << js.w[0]
-                          << " wy: " << js.w[1]
-                          << " wz: " << js.w[2]
-                          << " bx: " << js.b[0]
-                          << " by: " << js.b[1]
-                          << " bz: " << js.b[2]);
-        */
-        // Get the discrete time step
-        double tsamp = 1.0 / rate;    // Trajectory sampling rate 1Hz
-        double nsamp = 0.01;          // Numerical sampling rate 100Hz
-        // Add the first
-        State state = is;
-        /*
-        ROS_INFO_STREAM("SAMP: "
-                          << " t: "  << state.t
-                          << " qw: " << state.q.w()
-                          << " qx: " << state.q.x()
-                          << " qy: " << state.q.y()
-                          << " qz: " << state.q.z()
-                          << " wx: " << state.w[0]
-                          << " wy: " << state.w[1]
-                          << " wz: " << state.w[2]
-                          << " bx: " << state.b[0]
-                          << " by: " << state.b[1]
-                          << " bz: " << state.b[2]);
-        */
-        out.push_back(state.ToSetpoint());
-        // Now resample
-        while (state.t < js.t) {
-          double tend = (state.t + tsamp < js.t ? state.t + tsamp : js.t);
-          while (state.t < tend) {
-            double dt = (state.t + nsamp < tend ? nsamp : tend - state.t);
-            Eigen::Matrix4d omega;
-            omega << 0.0,        state.w[2], -state.w[1], state.w[0],
-                    -state.w[2], 0.0,         state.w[0], state.w[1],
-                     state.w[1], -state.w[0], 0.0,        state.w[2],
-                    -state.w[0], -state.w[1], -state.w[2], 0.0;
-            Eigen::Vector4d qdiff(state.q.x(), state.q.y(), state.q.z(), state.q.w());
-            qdiff = omega * qdiff * 0.5;
-            state.q.x() += qdiff[0] * dt;
-            state.q.y() += qdiff[1] * dt;
-            state.q.z() += qdiff[2] * dt;
-            state.q.w() += qdiff[3] * dt;
-            state.q.normalize();
-            state.p += state.v * dt;
-            state.w += state.b * dt;
-            state.v += state.a * dt;
-            state.t += dt;
+    out.reserve(num);
+    for (size_t i = 0; i + 1 < in.size(); i++) {
+      State is(in[i]);
+      double duration = in[i + 1].when.toSec() - is.t;
+      out.push_back(in[i]);
+      if (duration <= 0.0)
+        continue;
+      // The angular velocity keeps its axis if the angular acceleration
+      // is parallel to it, and then the rotation about the axis is a
+      // quadratic in time
+      Eigen::Vector3d axis = (is.w.squaredNorm() > is.b.squaredNorm() ? is.w : is.b);
+      bool closed_form = axis.norm() < EPSILON
+        || is.w.cross(is.b).norm() <= EPSILON * is.w.norm() * is.b.norm();
+      double w0 = 0.0, b0 = 0.0;
+      if (axis.norm() >= EPSILON) {
+        axis.normalize();
+        w0 = is.w.dot(axis);
+        b0 = is.b.dot(axis);
+      }
+      // Numerical attitude integration state, for the fallback
+      Eigen::Quaterniond q = is.q;
+      double tq = 0.0;
+      // Samples at the control rate, then the end of the piece
+      for (size_t k = 1; ; k++) {
+        double tk = k * tsamp;
+        if (tk + EPSILON >= duration)
+          tk = duration;
+        if (closed_form) {
+          if (axis.norm() >= EPSILON)
+            q = is.q * Eigen::Quaterniond(
+              Eigen::AngleAxisd(w0 * tk + 0.5 * b0 * tk * tk, axis));
+        } else {
+          while (tq < tk) {
+            double dt = (tq + nsamp < tk ? nsamp : tk - tq);
+            Eigen::Vector3d w = is.w + is.b * tq;
+            Eigen::Quaterniond qdiff = q * Eigen::Quaterniond(0.0, w[0], w[1], w[2]);
+            q.coeffs() += 0.5 * dt * qdiff.coeffs();
+            q.normalize();
+            tq += dt;
           }
-          /*
-          ROS_INFO_STREAM("SAMP: "
-                            << " t: "  << state.t
-                            << " qw: " << state.q.w()
-                            << " qx: " << state.q.x()
-                            << " qy: " << state.q.y()
-                            << " qz: " << state.q.z()
-                            << " wx: " << state.w[0]
-                            << " wy: " << state.w[1]
-                            << " wz: " << state.w[2]
-                            << " bx: " << state.b[0]
-                            << " by: " << state.b[1]
-                            << " bz: " << state.b[2]);
-          */
-          out.push_back(state.ToSetpoint());
         }
+        out.emplace_back();
+        SetSetpoint(is.t + tk, q,
+          is.p + is.v * tk + 0.5 * is.a * tk * tk, is.w + is.b * tk,
+          is.v + is.a * tk, is.b, is.a, out.back());
+        if (tk == duration)
+          break;
       }
     }
+    out.push_back(in.back());
     // Success
     return SUCCESS;
   }
@@ -15,3 +15,181 @@
  * License for the specific language governing permissions and limitations
  * under the License.
  */
+
+#include <ff_util/perf_timer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace ff_util {
+
+double LatencySnapshot::Percentile(double p) const {
+  if (count == 0)
+    return 0.0;
+  // Rank of the measurement, counting from one
+  uint64_t rank = static_cast<uint64_t>(std::ceil(p * count));
+  rank = std::min(std::max(rank, static_cast<uint64_t>(1)), count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); i++) {
+    seen += counts[i];
+    if (seen >= rank)
+      return 1.0e-9 * std::min(LatencyHistogram::BucketUpperBound(i), max_ns);
+  }
+  return 1.0e-9 * max_ns;
+}
+
+double LatencySnapshot::Mean() const {
+  return count > 0 ? 1.0e-9 * sum_ns / count : 0.0;
+}
+
+double LatencySnapshot::Variance() const {
+  if (count < 2)
+    return 0.0;
+  double mean = Mean(), sum = 0.0;
+  for (size_t i = 0; i < counts.size(); i++) {
+    if (counts[i] == 0)
+      continue;
+    uint64_t lower = (i > 0) ? LatencyHistogram::BucketUpperBound(i - 1) + 1 : 0;
+    double value = 0.5e-9 * (lower + LatencyHistogram::BucketUpperBound(i));
+    sum += counts[i] * (value - mean) * (value - mean);
+  }
+  return sum / (count - 1);
+}
+
+LatencyHistogram::LatencyHistogram() : shards_(new Shard[kNumShards]), last_ns_(0) {
+  for (int s = 0; s < kNumShards; s++) {
+    Shard & shard = shards_[s];
+    for (auto & c : shard.counts)
+      c.store(0, std::memory_order_relaxed);
+    shard.count.store(0, std::memory_order_relaxed);
+    shard.sum_ns.store(0, std::memory_order_relaxed);
+    shard.min_ns.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    shard.max_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+int LatencyHistogram::BucketIndex(uint64_t ns) {
+  ns = std::min(ns, (static_cast<uint64_t>(1) << kMaxBits) - 1);
+  if (ns < kSubBuckets)
+    return static_cast<int>(ns);
+  int msb = 63 - __builtin_clzll(ns);
+  int shift = msb - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + static_cast<int>((ns >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+  if (index < kSubBuckets)
+    return index;
+  int shift = index / kSubBuckets - 1;
+  uint64_t sub = index % kSubBuckets + kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+int LatencyHistogram::ShardIndex() {
+  static std::atomic<int> next_shard(0);
+  thread_local int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  uint64_t ns = latency.count() > 0 ? latency.count() : 0;
+  Shard & shard = shards_[ShardIndex()];
+  shard.counts[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+  last_ns_.store(ns, std::memory_order_relaxed);
+  uint64_t prev = shard.min_ns.load(std::memory_order_relaxed);
+  while (ns < prev && !shard.min_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+  prev = shard.max_ns.load(std::memory_order_relaxed);
+  while (ns > prev && !shard.max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::TakeSnapshot(LatencySnapshot * snapshot) {
+  snapshot->counts.assign(kNumBuckets, 0);
+  snapshot->count = snapshot->sum_ns = snapshot->max_ns = 0;
+  uint64_t min_ns = std::numeric_limits<uint64_t>::max();
+  for (int s = 0; s < kNumShards; s++) {
+    Shard & shard = shards_[s];
+    for (int i = 0; i < kNumBuckets; i++)
+      snapshot->counts[i] += shard.counts[i].exchange(0, std::memory_order_relaxed);
+    snapshot->count += shard.count.exchange(0, std::memory_order_relaxed);
+    snapshot->sum_ns += shard.sum_ns.exchange(0, std::memory_order_relaxed);
+    min_ns = std::min(min_ns, shard.min_ns.exchange(std::numeric_limits<uint64_t>::max(),
+                                                    std::memory_order_relaxed));
+    snapshot->max_ns = std::max(snapshot->max_ns, shard.max_ns.exchange(0, std::memory_order_relaxed));
+  }
+  snapshot->min_ns = snapshot->count > 0 ? min_ns : 0;
+  snapshot->last_ns = last_ns_.load(std::memory_order_relaxed);
+}
+
+void PerfReporter::Initialize(ros::NodeHandle * nh, std::string const& name, double rate) {
+  ros::NodeHandle nh_perf("/performance");
+  perf_pub_ = nh_perf.advertise<ff_msgs::Performance>(name, 5);
+  pub_ = nh_perf.advertise<ff_msgs::LatencyReport>(name + "/latency", 5);
+  perf_.count = perf_.mean = perf_.var = perf_.stddev = 0.0;
+  perf_.last = perf_.max = perf_.min = -1.0;
+  last_report_ = ros::Time::now();
+  if (rate > 0.0)
+    timer_ = nh->createTimer(ros::Duration(1.0 / rate), [this](ros::TimerEvent const&) { Send(); });
+}
+
+LatencyHistogram * PerfReporter::AddTimer(std::string const& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < names_.size(); i++)
+    if (names_[i] == name)
+      return histograms_[i].get();
+  names_.push_back(name);
+  histograms_.emplace_back(new LatencyHistogram());
+  return histograms_.back().get();
+}
+
+void PerfReporter::Send() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ff_msgs::LatencyReport msg;
+  msg.header.stamp = ros::Time::now();
+  msg.window = (msg.header.stamp - last_report_).toSec();
+  last_report_ = msg.header.stamp;
+  msg.timers.resize(histograms_.size());
+  for (size_t i = 0; i < histograms_.size(); i++) {
+    histograms_[i]->TakeSnapshot(&snapshot_);
+    ff_msgs::LatencyStats & stats = msg.timers[i];
+    stats.name = names_[i];
+    stats.count = snapshot_.count;
+    stats.mean = snapshot_.Mean();
+    stats.min = 1.0e-9 * snapshot_.min_ns;
+    stats.max = 1.0e-9 * snapshot_.max_ns;
+    stats.p50 = snapshot_.Percentile(0.5);
+    stats.p90 = snapshot_.Percentile(0.9);
+    stats.p99 = snapshot_.Percentile(0.99);
+    stats.p999 = snapshot_.Percentile(0.999);
+    if (i == 0 && snapshot_.count > 0)
+      AccumulatePerformance();
+  }
+  pub_.publish(msg);
+  if (!histograms_.empty()) {
+    perf_.stamp = msg.header.stamp;
+    perf_pub_.publish(perf_);
+  }
+}
+
+// Add the window in snapshot_ to the statistics since initialization,
+// combining the variances as in Chan et al.
+void PerfReporter::AccumulatePerformance() {
+  double count = perf_.count, window_count = snapshot_.count;
+  double total = count + window_count;
+  double window_mean = snapshot_.Mean();
+  double delta = window_mean - perf_.mean;
+  perf_m2_ += snapshot_.Variance() * (window_count - 1.0) + delta * delta * count * window_count / total;
+  perf_.mean += delta * window_count / total;
+  perf_.count = total;
+  perf_.var = total > 1.0 ? perf_m2_ / (total - 1.0) : 0.0;
+  perf_.stddev = std::sqrt(perf_.var);
+  perf_.last = 1.0e-9 * snapshot_.last_ns;
+  double window_min = 1.0e-9 * snapshot_.min_ns, window_max = 1.0e-9 * snapshot_.max_ns;
+  if (perf_.min < 0.0 || window_min < perf_.min) perf_.min = window_min;
+  if (window_max > perf_.max) perf_.max = window_max;
+}
+
+}  // namespace ff_util
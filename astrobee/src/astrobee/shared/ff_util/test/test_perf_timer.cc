@@ -0,0 +1,95 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Test perf_timer
+// Checks the bucketing and the percentiles of ff_util::LatencyHistogram,
+// with measurements recorded from several threads
+
+#include <ff_util/perf_timer.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using ff_util::LatencyHistogram;
+
+TEST(perf_timer, buckets) {
+  // Exact below kSubBuckets, then each bucket contains its values and
+  // is at most 1/kSubBuckets of them wide
+  int last = -1;
+  for (uint64_t ns = 0; ns < (1 << 20); ns += 1 + ns / 100) {
+    int index = LatencyHistogram::BucketIndex(ns);
+    EXPECT_GE(index, last);
+    last = index;
+    uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_GE(upper, ns);
+    if (index > 0) {
+      uint64_t lower = LatencyHistogram::BucketUpperBound(index - 1) + 1;
+      EXPECT_LE(lower, ns);
+      EXPECT_LE(upper - lower, lower / LatencyHistogram::kSubBuckets);
+    }
+  }
+
+  // Very long latencies go to the last bucket
+  EXPECT_EQ(LatencyHistogram::kNumBuckets - 1, LatencyHistogram::BucketIndex(UINT64_C(1) << 40));
+}
+
+TEST(perf_timer, percentiles) {
+  LatencyHistogram histogram;
+  const int kThreads = 4, kSamples = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++)
+    threads.emplace_back([&histogram]() {
+      for (int i = 1; i <= kSamples; i++)
+        histogram.Record(std::chrono::microseconds(i));
+    });
+  for (auto & thread : threads)
+    thread.join();
+
+  ff_util::LatencySnapshot snapshot;
+  histogram.TakeSnapshot(&snapshot);
+  EXPECT_EQ(static_cast<uint64_t>(kThreads * kSamples), snapshot.count);
+  EXPECT_EQ(1000u, snapshot.min_ns);
+  EXPECT_EQ(static_cast<uint64_t>(kSamples) * 1000u, snapshot.max_ns);
+  // Every thread ends with the longest measurement
+  EXPECT_EQ(static_cast<uint64_t>(kSamples) * 1000u, snapshot.last_ns);
+  EXPECT_NEAR(5.0005e-3, snapshot.Mean(), 1e-9);
+  // Uniform over 1 to 10 ms
+  EXPECT_NEAR(1.0e-4 / 12.0, snapshot.Variance(), 1.0e-4 / 12.0 * 2.0 / LatencyHistogram::kSubBuckets);
+  double tolerance = 1.0 / LatencyHistogram::kSubBuckets;
+  EXPECT_NEAR(5.0e-3, snapshot.Percentile(0.5), 5.0e-3 * tolerance);
+  EXPECT_NEAR(9.0e-3, snapshot.Percentile(0.9), 9.0e-3 * tolerance);
+  EXPECT_NEAR(9.9e-3, snapshot.Percentile(0.99), 9.9e-3 * tolerance);
+  EXPECT_NEAR(9.99e-3, snapshot.Percentile(0.999), 9.99e-3 * tolerance);
+  EXPECT_DOUBLE_EQ(1.0e-2, snapshot.Percentile(1.0));
+
+  // The snapshot started a new window
+  histogram.TakeSnapshot(&snapshot);
+  EXPECT_EQ(0u, snapshot.count);
+  EXPECT_EQ(0.0, snapshot.Percentile(0.5));
+  EXPECT_EQ(0.0, snapshot.Variance());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
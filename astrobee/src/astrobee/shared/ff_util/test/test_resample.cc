@@ -0,0 +1,175 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Test resample
+// Compares FlightUtil::Resample on long trapezoidal segments with the
+// 100Hz numerical integration it replaced. tools/benchmark_resample
+// times both.
+
+#include <ff_util/ff_flight.h>
+
+#include <gtest/gtest.h>
+
+using ff_util::Segment;
+using ff_util::Setpoint;
+using ff_util::State;
+
+// The previous resampler, which integrates every piece at 100Hz
+static void NumericalResample(Segment const& in, Segment & out, double rate) {
+  out.clear();
+  double tsamp = 1.0 / rate;
+  double nsamp = 0.01;
+  for (Segment::const_iterator it = in.begin(); it != in.end(); it++) {
+    State is(*it);
+    Segment::const_iterator jt = std::next(it);
+    if (jt == in.end()) {
+      out.push_back(is.ToSetpoint());
+      continue;
+    }
+    State js(*jt);
+    State state = is;
+    out.push_back(state.ToSetpoint());
+    while (state.t < js.t) {
+      double tend = (state.t + tsamp < js.t ? state.t + tsamp : js.t);
+      while (state.t < tend) {
+        double dt = (state.t + nsamp < tend ? nsamp : tend - state.t);
+        Eigen::Matrix4d omega;
+        omega << 0.0,        state.w[2], -state.w[1], state.w[0],
+                -state.w[2], 0.0,         state.w[0], state.w[1],
+                 state.w[1], -state.w[0], 0.0,        state.w[2],
+                -state.w[0], -state.w[1], -state.w[2], 0.0;
+        Eigen::Vector4d qdiff(state.q.x(), state.q.y(), state.q.z(), state.q.w());
+        qdiff = omega * qdiff * 0.5;
+        state.q.x() += qdiff[0] * dt;
+        state.q.y() += qdiff[1] * dt;
+        state.q.z() += qdiff[2] * dt;
+        state.q.w() += qdiff[3] * dt;
+        state.q.normalize();
+        state.p += state.v * dt;
+        state.w += state.b * dt;
+        state.v += state.a * dt;
+        state.t += dt;
+      }
+      out.push_back(state.ToSetpoint());
+    }
+  }
+}
+
+// A rest-to-rest trapezoid, each piece of which starts from the state
+// the previous one reaches, with the angular velocity about one axis
+// unless an off-axis angular acceleration is given
+static Segment Trapezoid(double ramp, double coast, Eigen::Vector3d const& accel,
+  Eigen::Vector3d const& alpha, Eigen::Vector3d const& off_axis) {
+  Segment segment;
+  State state;
+  state.t = 100.0;
+  state.q = Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d(1.0, 2.0, 3.0).normalized()));
+  state.p = Eigen::Vector3d(1.0, -2.0, 4.5);
+  state.w = state.v = Eigen::Vector3d::Zero();
+  double durations[] = {ramp, coast, ramp};
+  double signs[] = {1.0, 0.0, -1.0};
+  for (int i = 0; i < 3; i++) {
+    state.a = signs[i] * accel;
+    state.b = signs[i] * alpha + (i == 1 ? off_axis : Eigen::Vector3d::Zero());
+    segment.push_back(state.ToSetpoint());
+    // Reference end state of the piece, integrated finely
+    for (int k = 0; k < 10000; k++) {
+      double dt = durations[i] / 10000;
+      Eigen::Vector3d w = state.w + 0.5 * dt * state.b;
+      state.q = state.q * Eigen::Quaterniond(Eigen::AngleAxisd(w.norm() * dt,
+        w.norm() > 0 ? w.normalized() : Eigen::Vector3d::UnitX()));
+      state.p += state.v * dt + 0.5 * state.a * dt * dt;
+      state.v += state.a * dt;
+      state.w += state.b * dt;
+    }
+    state.t += durations[i];
+  }
+  state.a = state.b = Eigen::Vector3d::Zero();
+  segment.push_back(state.ToSetpoint());
+  return segment;
+}
+
+// Maximum difference between two resampled segments
+static void Compare(Segment const& a, Segment const& b, double tol_pos, double tol_att) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    State sa(a[i]), sb(b[i]);
+    EXPECT_NEAR(sa.t, sb.t, 1e-6);
+    EXPECT_LT((sa.p - sb.p).norm(), tol_pos) << "setpoint " << i;
+    EXPECT_LT((sa.v - sb.v).norm(), 1e-6) << "setpoint " << i;
+    EXPECT_LT((sa.w - sb.w).norm(), 1e-6) << "setpoint " << i;
+    EXPECT_LT(sa.q.angularDistance(sb.q), tol_att) << "setpoint " << i;
+  }
+}
+
+TEST(resample, trapezoid) {
+  // Ten minutes of flight, checked at the rate of the validator. The
+  // durations are not multiples of the sampling period, where the
+  // numerical integrator can add a setpoint a rounding error before
+  // the end of a piece.
+  Segment in = Trapezoid(20.05, 560.03, Eigen::Vector3d(0.002, -0.001, 0.0005),
+    Eigen::Vector3d(0.0, 0.0, 0.001), Eigen::Vector3d::Zero());
+  Segment closed, numerical;
+  ff_util::FlightUtil::Resample(in, closed, 10.0);
+  NumericalResample(in, numerical, 10.0);
+  // The numerical integrator drifts by half the acceleration times the
+  // time step, per second of acceleration
+  Compare(closed, numerical, 1e-3, 1e-3);
+
+  // The ends of the pieces are the input setpoints themselves
+  EXPECT_TRUE(ff_util::FlightUtil::Equal(closed.front(), in.front()));
+  EXPECT_TRUE(ff_util::FlightUtil::Equal(closed.back(), in.back()));
+
+  // Reusing the output does not allocate again
+  const Setpoint * data = closed.data();
+  ff_util::FlightUtil::Resample(in, closed, 10.0);
+  EXPECT_EQ(data, closed.data());
+}
+
+TEST(resample, off_axis) {
+  // An angular acceleration across the angular velocity falls back on
+  // the numerical attitude integration
+  Segment in = Trapezoid(10.5, 50.5, Eigen::Vector3d(0.01, 0.0, 0.0),
+    Eigen::Vector3d(0.0, 0.0, 0.01), Eigen::Vector3d(0.001, 0.0, 0.0));
+  Segment closed, numerical;
+  ff_util::FlightUtil::Resample(in, closed, 1.0);
+  NumericalResample(in, numerical, 1.0);
+  Compare(closed, numerical, 1e-3, 1e-3);
+}
+
+TEST(resample, short_segments) {
+  // Too short to resample
+  Segment in(1), out;
+  EXPECT_EQ(ff_util::SUCCESS, ff_util::FlightUtil::Resample(in, out));
+  EXPECT_EQ(1u, out.size());
+
+  // Pieces shorter than the sampling period keep only their ends
+  in = Trapezoid(0.2, 0.5, Eigen::Vector3d(0.01, 0.0, 0.0),
+    Eigen::Vector3d(0.0, 0.01, 0.0), Eigen::Vector3d::Zero());
+  Segment numerical;
+  ff_util::FlightUtil::Resample(in, out, 1.0);
+  NumericalResample(in, numerical, 1.0);
+  Compare(out, numerical, 1e-3, 1e-3);
+  EXPECT_EQ(7u, out.size());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+/* Copyright (c) 2017, United States Government, as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * 
+ * All rights reserved.
+ * 
+ * The Astrobee platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Times FlightUtil::Resample on long trapezoidal segments against the
+// 100Hz numerical integration it replaced. test_resample checks that
+// both give the same setpoints.
+//
+// Usage: benchmark_resample [number of repetitions]
+
+#include <ff_util/ff_flight.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using ff_util::Segment;
+using ff_util::State;
+
+// The previous resampler, which integrates every piece at 100Hz
+static void NumericalResample(Segment const& in, Segment & out, double rate) {
+  out.clear();
+  double tsamp = 1.0 / rate;
+  double nsamp = 0.01;
+  for (Segment::const_iterator it = in.begin(); it != in.end(); it++) {
+    State is(*it);
+    Segment::const_iterator jt = std::next(it);
+    if (jt == in.end()) {
+      out.push_back(is.ToSetpoint());
+      continue;
+    }
+    State js(*jt);
+    State state = is;
+    out.push_back(state.ToSetpoint());
+    while (state.t < js.t) {
+      double tend = (state.t + tsamp < js.t ? state.t + tsamp : js.t);
+      while (state.t < tend) {
+        double dt = (state.t + nsamp < tend ? nsamp : tend - state.t);
+        Eigen::Matrix4d omega;
+        omega << 0.0,        state.w[2], -state.w[1], state.w[0],
+                -state.w[2], 0.0,         state.w[0], state.w[1],
+                 state.w[1], -state.w[0], 0.0,        state.w[2],
+                -state.w[0], -state.w[1], -state.w[2], 0.0;
+        Eigen::Vector4d qdiff(state.q.x(), state.q.y(), state.q.z(), state.q.w());
+        qdiff = omega * qdiff * 0.5;
+        state.q.x() += qdiff[0] * dt;
+        state.q.y() += qdiff[1] * dt;
+        state.q.z() += qdiff[2] * dt;
+        state.q.w() += qdiff[3] * dt;
+        state.q.normalize();
+        state.p += state.v * dt;
+        state.w += state.b * dt;
+        state.v += state.a * dt;
+        state.t += dt;
+      }
+      out.push_back(state.ToSetpoint());
+    }
+  }
+}
+
+// A rest-to-rest trapezoid, with the angular velocity about one axis
+// unless an off-axis angular acceleration is given. Only the timing
+// matters here, so the attitude is not carried from one piece to the
+// next.
+static Segment Trapezoid(double ramp, double coast, Eigen::Vector3d const& accel,
+  Eigen::Vector3d const& alpha, Eigen::Vector3d const& off_axis) {
+  Segment segment;
+  State state;
+  state.t = 100.0;
+  state.q = Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d(1.0, 2.0, 3.0).normalized()));
+  state.p = Eigen::Vector3d(1.0, -2.0, 4.5);
+  state.w = state.v = Eigen::Vector3d::Zero();
+  double durations[] = {ramp, coast, ramp};
+  double signs[] = {1.0, 0.0, -1.0};
+  for (int i = 0; i < 3; i++) {
+    state.a = signs[i] * accel;
+    state.b = signs[i] * alpha + (i == 1 ? off_axis : Eigen::Vector3d::Zero());
+    segment.push_back(state.ToSetpoint());
+    double dt = durations[i];
+    state.p += state.v * dt + 0.5 * state.a * dt * dt;
+    state.v += state.a * dt;
+    state.w += state.b * dt;
+    state.t += dt;
+  }
+  state.a = state.b = Eigen::Vector3d::Zero();
+  segment.push_back(state.ToSetpoint());
+  return segment;
+}
+
+// Time num resamples of a segment with both methods
+static void Benchmark(char const* name, Segment const& in, double rate, int num) {
+  Segment closed, numerical;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < num; i++)
+    ff_util::FlightUtil::Resample(in, closed, rate);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < num; i++)
+    NumericalResample(in, numerical, rate);
+  auto t2 = std::chrono::steady_clock::now();
+  std::chrono::duration<double> dt_closed = t1 - t0, dt_numerical = t2 - t1;
+  std::cout << name << ": resampled " << closed.size() << " setpoints at " << rate << "Hz, closed form "
+            << 1000.0 * dt_closed.count() / num << " ms, numerical "
+            << 1000.0 * dt_numerical.count() / num << " ms, speedup "
+            << dt_numerical.count() / dt_closed.count() << std::endl;
+}
+
+int main(int argc, char** argv) {
+  int num = (argc > 1 ? std::atoi(argv[1]) : 20);
+  if (num < 1) {
+    std::cerr << "Usage: " << argv[0] << " [number of repetitions]" << std::endl;
+    return 1;
+  }
+  // Ten minutes of flight, at the rate of the validator
+  Benchmark("trapezoid", Trapezoid(20.05, 560.03, Eigen::Vector3d(0.002, -0.001, 0.0005),
+    Eigen::Vector3d(0.0, 0.0, 0.001), Eigen::Vector3d::Zero()), 10.0, num);
+  // Falls back on the numerical attitude integration
+  Benchmark("off axis", Trapezoid(10.5, 50.5, Eigen::Vector3d(0.01, 0.0, 0.0),
+    Eigen::Vector3d(0.0, 0.0, 0.01), Eigen::Vector3d(0.001, 0.0, 0.0)), 1.0, num);
+  return 0;
+}
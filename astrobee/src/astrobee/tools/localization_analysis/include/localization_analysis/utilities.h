@@ -37,13 +37,13 @@ using Calibration = gtsam::Cal3_S2;
 using Camera = gtsam::PinholePose<Calibration>;
 using SmartFactor = gtsam::RobustSmartProjectionPoseFactor<Calibration>;
 
-void FeatureTrackImage(const graph_localizer::FeatureTrackIdMap& feature_tracks,
+void FeatureTrackImage(const graph_localizer::FeatureTracks& feature_tracks,
                        const camera::CameraParameters& camera_params, cv::Mat& feature_track_image);
 void MarkSmartFactorPoints(const std::vector<const SmartFactor*> smart_factors,
                            const camera::CameraParameters& camera_params, const double feature_track_min_separation,
                            const int max_num_factors, cv::Mat& feature_track_image);
 boost::optional<sensor_msgs::ImagePtr> CreateFeatureTrackImage(
-  const sensor_msgs::ImageConstPtr& image_msg, const graph_localizer::FeatureTrackIdMap& feature_tracks,
+  const sensor_msgs::ImageConstPtr& image_msg, const graph_localizer::FeatureTracks& feature_tracks,
   const camera::CameraParameters& camera_params, const std::vector<const SmartFactor*>& smart_factors = {});
 
 cv::Point2f Distort(const Eigen::Vector2d& undistorted_point, const camera::CameraParameters& params);
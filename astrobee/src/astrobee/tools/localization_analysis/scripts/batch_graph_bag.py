@@ -0,0 +1,330 @@
+#!/usr/bin/python
+#
+# Copyright (c) 2017, United States Government, as represented by the
+# Administrator of the National Aeronautics and Space Administration.
+#
+# All rights reserved.
+#
+# The Astrobee platform is licensed under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with the
+# License. You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations
+# under the License.
+"""
+Runs the graph bag tool in parallel for each combination of bagfile and graph localizer config variant.
+Bagfiles are listed in a bag sweep config file (see bag_sweep.py).  Config variants are listed in a csv file
+whose first row contains graph_localizer.config parameter names and each following row the values for one
+variant, as in the all_value_combos.csv file saved by parameter sweeps.  Without a variants file each bagfile is
+run with the unchanged config.  Optionally a random subset of the variants, drawn using the provided seed, is run.
+
+Each job runs in a separate process with its own output directory, graph_localizer.config, results bagfile,
+stats file and plots.  The accuracy and timing stats of all jobs are combined in batch_results.csv and
+batch_results.json, ordered by job id.  Job ids, selected variants and results depend only on the inputs and the
+seed, and each job linearizes its graph on a single thread, so results don't depend on how jobs are scheduled.
+"""
+
+
+import argparse
+import collections
+import csv
+import json
+import math
+import multiprocessing
+import os
+import random
+import subprocess
+import sys
+import traceback
+
+import bag_sweep
+import config_creator
+import localization_common.utilities as lu
+
+
+class Job(object):
+    def __init__(self, job_id, graph_bag_params, variant_id, values):
+        self.job_id = job_id
+        self.graph_bag_params = graph_bag_params
+        self.variant_id = variant_id
+        self.values = values
+
+
+def load_variants(variants_file):
+    with open(variants_file) as variants_csvfile:
+        reader = csv.reader(variants_csvfile)
+        value_names = next(reader)
+        variants = []
+        for row in reader:
+            if not row:
+                continue
+            # config_creator exits on a mismatch, which would hang the pool if done in a job
+            if len(row) != len(value_names):
+                print(
+                    (
+                        "Variant on line "
+                        + str(reader.line_num)
+                        + " of "
+                        + variants_file
+                        + " has "
+                        + str(len(row))
+                        + " values, expected "
+                        + str(len(value_names))
+                        + "."
+                    )
+                )
+                sys.exit(1)
+            variants.append(row)
+    return value_names, variants
+
+
+def select_variants(variants, num_variants, seed):
+    variant_ids = list(range(len(variants)))
+    if num_variants is not None and num_variants < len(variants):
+        # Sort so selected variants run in file order
+        variant_ids = sorted(random.Random(seed).sample(variant_ids, num_variants))
+    return variant_ids
+
+
+def make_jobs(graph_bag_params_list, variants, variant_ids):
+    jobs = []
+    for graph_bag_params in graph_bag_params_list:
+        for variant_id in variant_ids:
+            values = variants[variant_id] if variants else []
+            jobs.append(Job(len(jobs), graph_bag_params, variant_id, values))
+    return jobs
+
+
+def bag_name(graph_bag_params):
+    return os.path.splitext(os.path.basename(graph_bag_params.bagfile))[0]
+
+
+def run_job_commands(job, value_names, output_dir):
+    params = job.graph_bag_params
+    job_output_dir = os.path.join(output_dir, str(job.job_id))
+    os.mkdir(job_output_dir)
+    graph_config_filepath = os.path.join(
+        params.config_path, "config", "graph_localizer.config"
+    )
+    new_graph_config_filepath = os.path.join(job_output_dir, "graph_localizer.config")
+    # Jobs already run in parallel, so avoid competing linearization threads
+    config_creator.make_config(
+        list(job.values) + [1],
+        list(value_names) + ["num_linearization_threads"],
+        graph_config_filepath,
+        new_graph_config_filepath,
+    )
+    output_bag = os.path.join(job_output_dir, "results.bag")
+    output_stats_file = os.path.join(job_output_dir, "graph_stats.csv")
+    run_command = [
+        "rosrun",
+        "localization_analysis",
+        "run_graph_bag",
+        params.bagfile,
+        params.map_file,
+        params.config_path,
+        "-i",
+        params.image_topic,
+        "-o",
+        output_bag,
+        "-r",
+        params.robot_config_file,
+        "-w",
+        params.world,
+        "-s",
+        output_stats_file,
+        "-f",
+        params.use_image_features,
+        "-g",
+        job_output_dir + "/",
+    ]
+    plot_command = [
+        "rosrun",
+        "localization_analysis",
+        "plot_results.py",
+        output_bag,
+        "--output-file",
+        os.path.join(job_output_dir, "output.pdf"),
+        "--output-csv-file",
+        output_stats_file,
+        "-g",
+        params.groundtruth_bagfile,
+        "--rmse-rel-start-time",
+        params.rmse_rel_start_time,
+        "--rmse-rel-end-time",
+        params.rmse_rel_end_time,
+    ]
+    with open(os.path.join(job_output_dir, "log.txt"), "w") as log_file:
+        return_code = subprocess.call(
+            run_command, stdout=log_file, stderr=subprocess.STDOUT
+        )
+        if return_code == 0:
+            return_code = subprocess.call(
+                plot_command, stdout=log_file, stderr=subprocess.STDOUT
+            )
+    return return_code
+
+
+# Returns the job's return code, nonzero if it raised or exited, so every job has a result
+def run_job(job, value_names, output_dir):
+    try:
+        return run_job_commands(job, value_names, output_dir)
+    except (Exception, SystemExit):
+        print(("Job " + str(job.job_id) + " failed:\n" + traceback.format_exc()))
+        return 1
+
+
+def run_job_helper(zipped_vals):
+    return run_job(*zipped_vals)
+
+
+def load_value(value_string):
+    value = float(value_string)
+    # Keep json output valid, averagers without any values have nan stats
+    return None if math.isnan(value) or math.isinf(value) else value
+
+
+# Returns an ordered map of stat names to values.  Timer and averager rows hold average, min, max and stddev
+# while rmse rows hold a single value.
+def load_stats(stats_file):
+    stats = collections.OrderedDict()
+    if not os.path.isfile(stats_file):
+        return stats
+    with open(stats_file) as stats_csvfile:
+        for row in csv.reader(stats_csvfile):
+            if len(row) < 2:
+                continue
+            stats[row[0]] = [load_value(value) for value in row[1:]]
+    return stats
+
+
+def save_results(jobs, return_codes, value_names, output_dir):
+    results = []
+    stat_names = []
+    for job, return_code in zip(jobs, return_codes):
+        stats = load_stats(os.path.join(output_dir, str(job.job_id), "graph_stats.csv"))
+        for name in stats:
+            if name not in stat_names:
+                stat_names.append(name)
+        results.append(
+            collections.OrderedDict(
+                [
+                    ("job_id", job.job_id),
+                    ("bag", bag_name(job.graph_bag_params)),
+                    ("variant_id", job.variant_id),
+                    ("values", collections.OrderedDict(zip(value_names, job.values))),
+                    ("succeeded", return_code == 0),
+                    ("stats", stats),
+                ]
+            )
+        )
+
+    with open(os.path.join(output_dir, "batch_results.json"), "w") as json_file:
+        json.dump(results, json_file, indent=2)
+
+    # Csv contains the first value of each stat, the average for timers and averagers
+    with open(os.path.join(output_dir, "batch_results.csv"), "w") as csv_file:
+        writer = csv.writer(csv_file, lineterminator="\n")
+        writer.writerow(
+            ["job_id", "bag", "variant_id"] + list(value_names) + ["succeeded"] + stat_names
+        )
+        for result in results:
+            stats = result["stats"]
+            writer.writerow(
+                [result["job_id"], result["bag"], result["variant_id"]]
+                + list(result["values"].values())
+                + [result["succeeded"]]
+                + [stats[name][0] if name in stats else "" for name in stat_names]
+            )
+
+
+def batch_graph_bag(
+    bag_config_file, output_dir, variants_file, num_variants, seed, num_processes
+):
+    graph_bag_params_list = bag_sweep.load_params(bag_config_file)
+    bag_sweep.check_params(graph_bag_params_list)
+    value_names, variants = [], []
+    if variants_file:
+        value_names, variants = load_variants(variants_file)
+    variant_ids = select_variants(variants, num_variants, seed) if variants else [None]
+    jobs = make_jobs(graph_bag_params_list, variants, variant_ids)
+    print(("Running " + str(len(jobs)) + " jobs."))
+
+    pool = multiprocessing.Pool(num_processes)
+    # zip arguments so we can pass as one argument to pool worker, map returns results in job order
+    return_codes = pool.map(
+        run_job_helper,
+        [(job, value_names, output_dir) for job in jobs],
+        chunksize=1,
+    )
+    pool.close()
+    pool.join()
+    save_results(jobs, return_codes, value_names, output_dir)
+    num_failed = sum(1 for return_code in return_codes if return_code != 0)
+    if num_failed > 0:
+        print((str(num_failed) + " jobs failed, see the errors above and log.txt in their output directories."))
+
+
+if __name__ == "__main__":
+
+    class Formatter(
+        argparse.RawTextHelpFormatter, argparse.RawDescriptionHelpFormatter
+    ):
+        pass
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=Formatter)
+    parser.add_argument(
+        "bag_config_file",
+        help="Config file containing bag names, map names, image topics, config path, robot config, world, use image features, groundtruth bag and rmse start and end times.  See bag_sweep.py for more details.",
+    )
+    parser.add_argument(
+        "output_dir", help="Output directory where results files are saved."
+    )
+    parser.add_argument(
+        "-v",
+        "--variants-file",
+        default=None,
+        help="Csv file with graph_localizer.config parameter names in the first row and values for one variant in each following row.  Example:\n max_iterations,smart_projection_adder_max_num_factors\n 4,13\n 8,20",
+    )
+    parser.add_argument(
+        "-n",
+        "--num-variants",
+        type=int,
+        default=None,
+        help="Run a random subset of this many variants, drawn using the seed.  Runs all variants by default.",
+    )
+    parser.add_argument(
+        "--seed", type=int, default=0, help="Seed for selecting variants."
+    )
+    parser.add_argument(
+        "-p",
+        "--num-processes",
+        type=int,
+        default=multiprocessing.cpu_count(),
+        help="Number of jobs to run in parallel.",
+    )
+    args = parser.parse_args()
+    if not os.path.isfile(args.bag_config_file):
+        print(("Config file " + args.bag_config_file + " does not exist."))
+        sys.exit()
+    if args.variants_file and not os.path.isfile(args.variants_file):
+        print(("Variants file " + args.variants_file + " does not exist."))
+        sys.exit()
+    if os.path.isdir(args.output_dir):
+        print(("Output directory " + args.output_dir + " already exists."))
+        sys.exit()
+    output_dir = lu.create_directory(args.output_dir)
+
+    batch_graph_bag(
+        args.bag_config_file,
+        output_dir,
+        args.variants_file,
+        args.num_variants,
+        args.seed,
+        args.num_processes,
+    )
@@ -32,10 +32,10 @@ namespace localization_analysis {
 namespace lc = localization_common;
 namespace mc = msg_conversions;
 
-void FeatureTrackImage(const graph_localizer::FeatureTrackIdMap& feature_tracks,
+void FeatureTrackImage(const graph_localizer::FeatureTracks& feature_tracks,
                        const camera::CameraParameters& camera_params, cv::Mat& feature_track_image) {
   for (const auto& feature_track : feature_tracks) {
-    const auto& points = feature_track.second->points();
+    const auto& points = feature_track.points();
     cv::Scalar color;
     if (points.size() <= 1) {
       // Red for single point tracks
@@ -80,7 +80,7 @@ void MarkSmartFactorPoints(const std::vector<const SmartFactor*> smart_factors,
 }
 
 boost::optional<sensor_msgs::ImagePtr> CreateFeatureTrackImage(const sensor_msgs::ImageConstPtr& image_msg,
-                                                               const graph_localizer::FeatureTrackIdMap& feature_tracks,
+                                                               const graph_localizer::FeatureTracks& feature_tracks,
                                                                const camera::CameraParameters& camera_params,
                                                                const std::vector<const SmartFactor*>& smart_factors) {
   cv_bridge::CvImagePtr feature_track_image;